@@ -529,6 +529,28 @@ std::string BamAlignment::GetErrorString(void) const {
     return ErrorString;
 }
 
+/*! \fn size_t BamAlignment::GetMemoryUsage(void) const
+    \brief Returns the (approximate) number of bytes held by this alignment.
+
+    Includes the object itself, plus the heap storage of its string fields and CIGAR data.
+    Useful for budgeting memory when buffering many alignments, e.g. while sorting.
+
+    \return number of bytes
+*/
+size_t BamAlignment::GetMemoryUsage(void) const {
+
+    size_t numBytes = sizeof(BamAlignment);
+    const string* strings[] = { &Name, &QueryBases, &AlignedBases, &Qualities, &TagData,
+                                     &Filename, &SupportData.AllCharData, &ErrorString };
+    const size_t numStrings = sizeof(strings) / sizeof(strings[0]);
+    for ( size_t i = 0; i < numStrings; ++i ) {
+        if ( !strings[i]->empty() )
+            numBytes += strings[i]->capacity() + 1;
+    }
+    numBytes += CigarData.capacity() * sizeof(CigarOp);
+    return numBytes;
+}
+
 /*! \fn bool BamAlignment::GetSoftClips(std::vector<int>& clipSizes, std::vector<int>& readPositions, std::vector<int>& genomePositions, bool usePadded = false) const
     \brief Identifies if an alignment has a soft clip. If so, identifies the
            sizes of the soft clips, as well as their positions in the read and reference.
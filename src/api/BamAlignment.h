@@ -22,6 +22,9 @@ namespace BamTools {
 
 //! \cond
 // forward declaration of BamAlignment's "friends"
+namespace Algorithms {
+    struct Sort;
+} // namespace Algorithms
 namespace Internal {
     class BamReaderPrivate;
     class BamWriterPrivate;
@@ -106,6 +109,9 @@ struct API_EXPORT BamAlignment {
         // returns a description of the last error that occurred
         std::string GetErrorString(void) const;
 
+        // returns (approximate) number of bytes held by this alignment, including its string & CIGAR data
+        size_t GetMemoryUsage(void) const;
+
         // retrieves the size, read locations and reference locations of soft-clip operations
         bool GetSoftClips(std::vector<int>& clipSizes,
                           std::vector<int>& readPositions,
@@ -167,6 +173,7 @@ struct API_EXPORT BamAlignment {
             { }
         };
         BamAlignmentSupportData SupportData;
+        friend struct Algorithms::Sort;
         friend class Internal::BamReaderPrivate;
         friend class Internal::BamWriterPrivate;
 
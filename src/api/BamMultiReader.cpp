@@ -290,13 +290,15 @@ bool BamMultiReader::LocateIndexes(const BamIndex::IndexType& preferredType) {
 /*! \fn bool BamMultiReader::Open(const std::vector<std::string>& filenames)
     \brief Opens BAM files.
 
+    Files are opened, and their headers parsed, on several threads at once.
+
     \note Opening BAM files will invalidate any current region set on the multireader.
     All file pointers will be returned to the beginning of the alignment data. Follow
     this with Jump() or SetRegion() to establish a region of interest.
 
     \param[in] filenames list of BAM filenames to open
     \returns \c true if BAM files were opened successfully
-    \sa Close(), HasOpenReaders(), OpenFile(), OpenIndexes(), BamReader::Open()
+    \sa Close(), HasOpenReaders(), OpenFile(), OpenIndexes(), SetMaxOpenFiles(), BamReader::Open()
 */
 bool BamMultiReader::Open(const std::vector<std::string>& filenames) {
     return d->Open(filenames);
@@ -375,6 +377,53 @@ bool BamMultiReader::SetExplicitMergeOrder(BamMultiReader::MergeOrder order) {
     return d->SetExplicitMergeOrder(order);
 }
 
+/*! \fn bool BamMultiReader::SetMaxOpenFiles(unsigned int maxOpenFiles)
+    \brief Limits the number of BAM files kept physically open at any one time.
+
+    By default every BAM file stays open until closed, which can exceed the
+    system's open file limit when merging thousands of files. With a limit set,
+    files are opened (and their headers parsed) up front, then closed again
+    until their alignments are actually needed. The least-recently used files
+    are closed as others are re-opened, each resuming from its saved position.
+    Alignments are buffered per file in small batches, so re-opening is
+    amortized over many records.
+
+    \note This must be called before opening any files. Index files loaded via
+    LocateIndexes() or OpenIndexes() keep their own file handles.
+
+    \param[in] maxOpenFiles maximum number of open BAM files (0 = unlimited, default)
+    \returns \c true if limit could be applied
+    \sa Open(), SetPrefetching()
+*/
+bool BamMultiReader::SetMaxOpenFiles(unsigned int maxOpenFiles) {
+    return d->SetMaxOpenFiles(maxOpenFiles);
+}
+
+/*! \fn void BamMultiReader::SetPrefetching(bool ok)
+    \brief Enables/disables background read-ahead of the open BAM files.
+
+    When enabled, BAM files are decompressed and parsed a few batches of
+    alignments ahead of the merge, by a shared pool of decoder threads: one per
+    available processor besides the calling thread, but no more than there are
+    files. The calling thread then only has to select & hand out the next
+    alignment, so merging many files scales with the number of cores instead of
+    being limited to one. On a single processor, no threads are started and
+    alignments are simply decoded in batches.
+
+    \note The setting takes effect the next time the files are positioned,
+    i.e. on Open(), OpenFile(), Rewind(), Jump() or SetRegion(). It is
+    simplest to call this method before opening any files.
+
+    If SetMaxOpenFiles() has limited the number of open files, alignments are
+    still read ahead in batches, but without background threads.
+
+    \param[in] ok \c true to enable read-ahead, \c false to read synchronously (default)
+    \sa Open(), GetNextAlignment(), GetNextAlignmentCore()
+*/
+void BamMultiReader::SetPrefetching(bool ok) {
+    d->SetPrefetching(ok);
+}
+
 /*! \fn bool BamMultiReader::SetRegion(const BamRegion& region)
     \brief Sets a target region of interest
 
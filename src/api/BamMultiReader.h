@@ -65,6 +65,10 @@ class API_EXPORT BamMultiReader {
         bool Rewind(void);
         // sets an explicit merge order, regardless of the BAM files' SO header tag
         bool SetExplicitMergeOrder(BamMultiReader::MergeOrder order);
+        // limits number of BAM files kept physically open (0 = unlimited)
+        bool SetMaxOpenFiles(unsigned int maxOpenFiles);
+        // enables background read-ahead (decoding) for each BAM file
+        void SetPrefetching(bool ok);
         // sets the target region of interest
         bool SetRegion(const BamRegion& region);
         // sets the target region of interest
@@ -261,6 +261,39 @@ bool BamReader::LocateIndex(const BamIndex::IndexType& preferredType) {
     return d->LocateIndex(preferredType);
 }
 
+/*! \fn bool BamReader::MergeIndexes(const std::vector<std::string>& indexFilenames,
+                                      const std::vector<int64_t>& offsets,
+                                      const BamIndex::IndexType& type)
+    \brief Creates an index file for current BAM file, from its shards' index files.
+
+    Use this function when the current BAM file was built by concatenating
+    coordinate-disjoint shards that were already indexed. Rather than re-scanning
+    the full file, as CreateIndex() would, each shard's index data is shifted by
+    the compressed byte offset at which that shard landed in the current file,
+    and the results are combined.
+
+    All shards must share the current file's reference sequences, and each index
+    file must be of the requested \a type.
+
+    \note An offset describes where byte 0 of the shard would be in the current file.
+    If a shard's own header blocks were dropped during concatenation, subtract their
+    compressed size from the offset where its alignment data landed. Offsets are
+    checked against the current file: if one lies outside of it, or a shard's data
+    would not start on a BGZF block, no index file is written.
+
+    \param[in] indexFilenames index files of the shards
+    \param[in] offsets        compressed byte offset of each shard in the current BAM file
+    \param[in] type           file format to create, see BamIndex::IndexType for available formats
+    \return \c true if index created OK
+    \sa CreateIndex()
+*/
+bool BamReader::MergeIndexes(const std::vector<std::string>& indexFilenames,
+                             const std::vector<int64_t>& offsets,
+                             const BamIndex::IndexType& type)
+{
+    return d->MergeIndexes(indexFilenames, offsets, type);
+}
+
 /*! \fn bool BamReader::Open(const std::string& filename)
     \brief Opens a BAM file.
 
@@ -304,6 +337,21 @@ bool BamReader::Rewind(void) {
     return d->Rewind();
 }
 
+/*! \fn bool BamReader::Seek(const int64_t& virtualOffset)
+    \brief Sets the internal file pointer to a virtual file offset.
+
+    The offset must be one previously returned by Tell() (or BamWriter::Tell()
+    for the same file), i.e. the start of an alignment record. Calling this
+    function clears any prior region that may have been set.
+
+    \param[in] virtualOffset BGZF virtual offset (compressed block address << 16 | in-block offset)
+    \returns \c true if seek operation was successful
+    \sa Rewind(), Tell()
+*/
+bool BamReader::Seek(const int64_t& virtualOffset) {
+    return d->SeekToOffset(virtualOffset);
+}
+
 /*! \fn void BamReader::SetIndex(BamIndex* index)
     \brief Sets a custom BamIndex on this reader.
 
@@ -327,6 +375,23 @@ void BamReader::SetIndex(BamIndex* index) {
     d->SetIndex(index);
 }
 
+/*! \fn void BamReader::SetReadBufferSize(const size_t numBytes)
+    \brief Sets the size of the buffer used for reading the BAM file.
+
+    By default, the IO device's standard buffering is used. A larger buffer means
+    fewer, larger sequential reads, which helps when many files (or many readers
+    on the same file) are read in an interleaved fashion.
+
+    \note This setting only takes effect when a file is opened, so be sure to call
+    this function before Open().
+
+    \param[in] numBytes buffer size in bytes (0 = device default)
+    \sa Open()
+*/
+void BamReader::SetReadBufferSize(const size_t numBytes) {
+    d->SetReadBufferSize(numBytes);
+}
+
 /*! \fn bool BamReader::SetRegion(const BamRegion& region)
     \brief Sets a target region of interest
 
@@ -381,3 +446,15 @@ bool BamReader::SetRegion(const int& leftRefID,
 {
     return d->SetRegion( BamRegion(leftRefID, leftBound, rightRefID, rightBound) );
 }
+
+/*! \fn int64_t BamReader::Tell(void) const
+    \brief Returns the (virtual) file offset of the next alignment record.
+
+    The returned value may be passed to Seek() to return to this record.
+
+    \returns BGZF virtual offset (compressed block address << 16 | in-block offset)
+    \sa Seek()
+*/
+int64_t BamReader::Tell(void) const {
+    return d->Tell();
+}
@@ -15,10 +15,12 @@
 #include "api/BamIndex.h"
 #include "api/SamHeader.h"
 #include <string>
+#include <vector>
 
 namespace BamTools {
   
 namespace Internal {
+    class BamMultiReaderPrivate;
     class BamReaderPrivate;
 } // namespace Internal
 
@@ -48,6 +50,10 @@ class API_EXPORT BamReader {
         bool Open(const std::string& filename);
         // returns internal file pointer to beginning of alignment data
         bool Rewind(void);
+        // sets internal file pointer to a (virtual) file offset, as returned by Tell()
+        bool Seek(const int64_t& virtualOffset);
+        // sets size of the file read buffer (takes effect on next Open)
+        void SetReadBufferSize(const size_t numBytes);
         // sets the target region of interest
         bool SetRegion(const BamRegion& region);
         // sets the target region of interest
@@ -55,6 +61,8 @@ class API_EXPORT BamReader {
                        const int& leftPosition,
                        const int& rightRefID,
                        const int& rightPosition);
+        // returns (virtual) file offset of the next alignment record
+        int64_t Tell(void) const;
 
         // ----------------------
         // access alignment data
@@ -97,6 +105,10 @@ class API_EXPORT BamReader {
         bool HasIndex(void) const;
         // looks in BAM file's directory for a matching index file
         bool LocateIndex(const BamIndex::IndexType& preferredType = BamIndex::STANDARD);
+        // creates an index file for current BAM file, by merging index files of its shards
+        bool MergeIndexes(const std::vector<std::string>& indexFilenames,
+                          const std::vector<int64_t>& offsets,
+                          const BamIndex::IndexType& type = BamIndex::STANDARD);
         // opens a BAM index file
         bool OpenIndex(const std::string& indexFilename);
         // sets a custom BamIndex on this reader
@@ -112,6 +124,11 @@ class API_EXPORT BamReader {
     // private implementation
     private:
         Internal::BamReaderPrivate* d;
+
+    //! \cond
+    // allows BamMultiReader to suspend/resume the underlying file
+    friend class Internal::BamMultiReaderPrivate;
+    //! \endcond
 };
 
 } // namespace BamTools
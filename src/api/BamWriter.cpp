@@ -55,6 +55,21 @@ void BamWriter::Close(void) {
     d->Close();
 }
 
+/*! \fn bool BamWriter::Flush(void)
+    \brief Writes out any buffered data.
+
+    The current BGZF block is compressed & written to the file, so that the next
+    alignment saved will start a new BGZF block. Useful for splitting output at
+    block boundaries (e.g. after the header), so that the pieces may later be
+    concatenated without re-compression.
+
+    \returns \c true if buffered data was written successfully
+    \sa Tell()
+*/
+bool BamWriter::Flush(void) {
+    return d->Flush();
+}
+
 /*! \fn std::string BamWriter::GetErrorString(void) const
     \brief Returns a human-readable description of the last error that occurred
 
@@ -129,6 +144,23 @@ bool BamWriter::SaveAlignment(const BamAlignment& alignment) {
     return d->SaveAlignment(alignment);
 }
 
+/*! \fn void BamWriter::SetCompressionLevel(const int level)
+    \brief Sets the zlib compression level used for output BGZF blocks.
+
+    Default level is zlib's default (-1). Lower levels (e.g. 1) trade file size
+    for much faster writing, which is useful for short-lived intermediate files.
+    Has no effect if compression mode is BamWriter::Uncompressed.
+
+    \note Changing the compression level is disabled on open files (i.e. the request will
+    be ignored). Be sure to call this function before opening the BAM file.
+
+    \param[in] level zlib compression level (0-9, or -1 for default)
+    \sa SetCompressionMode(), Open()
+*/
+void BamWriter::SetCompressionLevel(const int level) {
+    d->SetCompressionLevel(level);
+}
+
 /*! \fn void BamWriter::SetCompressionMode(const BamWriter::CompressionMode& compressionMode)
     \brief Sets the output compression mode.
 
@@ -150,3 +182,16 @@ bool BamWriter::SaveAlignment(const BamAlignment& alignment) {
 void BamWriter::SetCompressionMode(const BamWriter::CompressionMode& compressionMode) {
     d->SetWriteCompressed( compressionMode == BamWriter::Compressed );
 }
+
+/*! \fn int64_t BamWriter::Tell(void) const
+    \brief Returns the (virtual) file offset at which the next alignment will be written.
+
+    Once the file has been closed, this offset may be passed to BamReader::Seek()
+    to start reading at that alignment.
+
+    \returns BGZF virtual offset (compressed block address << 16 | in-block offset)
+    \sa BamReader::Seek(), BamReader::Tell()
+*/
+int64_t BamWriter::Tell(void) const {
+    return d->Tell();
+}
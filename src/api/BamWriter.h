@@ -42,6 +42,8 @@ class API_EXPORT BamWriter {
     public:
         //  closes the current BAM file
         void Close(void);
+        // writes out any buffered data, so that the next alignment starts a new BGZF block
+        bool Flush(void);
         // returns a human-readable description of the last error that occurred
         std::string GetErrorString(void) const;
         // returns true if BAM file is open for writing
@@ -58,6 +60,10 @@ class API_EXPORT BamWriter {
         bool SaveAlignment(const BamAlignment& alignment);
         // sets the output compression mode
         void SetCompressionMode(const BamWriter::CompressionMode& compressionMode);
+        // sets the zlib compression level (0-9, -1 = default)
+        void SetCompressionLevel(const int level);
+        // returns (virtual) file offset at which the next alignment will be written
+        int64_t Tell(void) const;
 
     // private implementation
     private:
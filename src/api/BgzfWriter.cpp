@@ -0,0 +1,124 @@
+// ***************************************************************************
+// BgzfWriter.cpp (c) 2026
+// Marth Lab, Department of Biology, Boston College
+// ---------------------------------------------------------------------------
+// Last modified: 17 October 2026
+// ---------------------------------------------------------------------------
+// Provides BGZF (gzip-compatible) compressed output of arbitrary data
+// ***************************************************************************
+
+#include "api/BgzfWriter.h"
+#include "api/internal/io/BgzfWriter_p.h"
+using namespace BamTools;
+using namespace BamTools::Internal;
+using namespace std;
+
+/*! \class BamTools::BgzfWriter
+    \brief Provides BGZF-compressed output of arbitrary data (e.g. SAM or FASTQ text).
+
+    BGZF is a series of concatenated gzip members, so the output can be read by
+    standard tools (gzip, zcat, etc.) as well as by BGZF-aware ones. Data is
+    compressed in independent blocks, using the same compression routine as
+    BamWriter, which lets blocks be compressed on several threads at once (see
+    SetNumThreads()). Blocks are always written in order.
+*/
+
+/*! \fn BgzfWriter::BgzfWriter(void)
+    \brief constructor
+*/
+BgzfWriter::BgzfWriter(void)
+    : d(new BgzfWriterPrivate)
+{ }
+
+/*! \fn BgzfWriter::~BgzfWriter(void)
+    \brief destructor
+
+    Closes the current file, if still open.
+*/
+BgzfWriter::~BgzfWriter(void) {
+    delete d;
+    d = 0;
+}
+
+/*! \fn bool BgzfWriter::Close(void)
+    \brief Writes all buffered data & closes the current file.
+
+    An empty BGZF block is written after the data, as end-of-file marker.
+
+    \returns \c true if all data was written successfully
+    \sa Open()
+*/
+bool BgzfWriter::Close(void) {
+    return d->Close();
+}
+
+/*! \fn std::string BgzfWriter::GetErrorString(void) const
+    \brief Returns a human-readable description of the last error that occurred
+
+    This method allows elimination of STDERR pollution. Developers of client code
+    may choose how the messages are displayed to the user, if at all.
+
+    \return error description
+*/
+std::string BgzfWriter::GetErrorString(void) const {
+    return d->GetErrorString();
+}
+
+/*! \fn bool BgzfWriter::IsOpen(void) const
+    \brief Returns \c true if file is open for writing
+    \sa Open()
+*/
+bool BgzfWriter::IsOpen(void) const {
+    return d->IsOpen();
+}
+
+/*! \fn bool BgzfWriter::Open(const std::string& filename)
+    \brief Opens a file for writing.
+
+    If a file is already open, it is closed first.
+
+    \param[in] filename name of output file (or "stdout", to write to standard output)
+    \returns \c true if opened successfully
+    \sa Close(), IsOpen()
+*/
+bool BgzfWriter::Open(const std::string& filename) {
+    return d->Open(filename);
+}
+
+/*! \fn void BgzfWriter::SetCompressionLevel(const int level)
+    \brief Sets the output compression level.
+
+    Valid values are 0 (no compression) to 9 (best compression), or -1 for the
+    zlib default. Must be called before Open().
+
+    \param[in] level compression level
+*/
+void BgzfWriter::SetCompressionLevel(const int level) {
+    d->SetCompressionLevel(level);
+}
+
+/*! \fn void BgzfWriter::SetNumThreads(const unsigned int numThreads)
+    \brief Sets the number of threads compressing data.
+
+    With more than 1 thread, full blocks are compressed on worker threads while
+    the caller keeps writing. Output is identical for any number of threads.
+    Takes effect on the next call to Open().
+
+    \param[in] numThreads number of compression threads (default 1, compress on caller's thread)
+*/
+void BgzfWriter::SetNumThreads(const unsigned int numThreads) {
+    d->SetNumThreads(numThreads);
+}
+
+/*! \fn bool BgzfWriter::Write(const char* data, const size_t dataLength)
+    \brief Writes data to the file.
+
+    Data is buffered, & compressed and written out one block at a time.
+
+    \param[in] data       data to write
+    \param[in] dataLength number of bytes to write
+    \returns \c true if data was buffered (& any full blocks written) successfully
+*/
+bool BgzfWriter::Write(const char* data, const size_t dataLength) {
+    return d->Write(data, dataLength);
+}
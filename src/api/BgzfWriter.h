@@ -0,0 +1,60 @@
+// ***************************************************************************
+// BgzfWriter.h (c) 2026
+// Marth Lab, Department of Biology, Boston College
+// ---------------------------------------------------------------------------
+// Last modified: 17 October 2026
+// ---------------------------------------------------------------------------
+// Provides BGZF (gzip-compatible) compressed output of arbitrary data
+// ***************************************************************************
+
+#ifndef BGZFWRITER_H
+#define BGZFWRITER_H
+
+#include "api/api_global.h"
+#include <string>
+
+namespace BamTools {
+
+//! \cond
+namespace Internal {
+    class BgzfWriterPrivate;
+} // namespace Internal
+//! \endcond
+
+class API_EXPORT BgzfWriter {
+
+    // ctor & dtor
+    public:
+        BgzfWriter(void);
+        ~BgzfWriter(void);
+
+    // public interface
+    public:
+        // writes all buffered data & closes the current file
+        bool Close(void);
+        // returns a human-readable description of the last error that occurred
+        std::string GetErrorString(void) const;
+        // returns true if file is open for writing
+        bool IsOpen(void) const;
+        // opens a file for writing
+        bool Open(const std::string& filename);
+        // sets the zlib compression level (0-9, -1 = default)
+        void SetCompressionLevel(const int level);
+        // sets number of threads compressing data (applied on Open)
+        void SetNumThreads(const unsigned int numThreads);
+        // writes data (compressed & written out in blocks)
+        bool Write(const char* data, const size_t dataLength);
+
+    // not copyable
+    private:
+        BgzfWriter(const BgzfWriter& other);
+        BgzfWriter& operator=(const BgzfWriter& other);
+
+    // private implementation
+    private:
+        Internal::BgzfWriterPrivate* d;
+};
+
+} // namespace BamTools
+
+#endif // BGZFWRITER_H
@@ -0,0 +1,56 @@
+// ***************************************************************************
+// SamRecordFormatter.cpp (c) 2026
+// Marth Lab, Department of Biology, Boston College
+// ---------------------------------------------------------------------------
+// Last modified: 17 October 2026
+// ---------------------------------------------------------------------------
+// Provides fast SAM-formatted text output for alignment records
+// ***************************************************************************
+
+#include "api/BamAlignment.h"
+#include "api/SamRecordFormatter.h"
+#include "api/internal/sam/SamRecordPrinter_p.h"
+using namespace BamTools;
+using namespace BamTools::Internal;
+using namespace std;
+
+/*! \class BamTools::SamRecordFormatter
+    \brief Provides SAM-formatted text for alignment records.
+
+    Formatting appends directly to a caller-provided buffer, so a buffer that is
+    re-used (cleared, rather than re-allocated) between batches of records keeps
+    its capacity. A formatter holds no state besides the reference names, so a
+    single instance may be used from multiple threads at once.
+
+    \sa \samSpecURL
+*/
+
+/*! \fn SamRecordFormatter::SamRecordFormatter(const RefVector& references)
+    \brief constructor
+
+    \param[in] references reference data, used to look up reference names by ID
+*/
+SamRecordFormatter::SamRecordFormatter(const RefVector& references)
+    : d(new SamRecordPrinter(references))
+{ }
+
+/*! \fn SamRecordFormatter::~SamRecordFormatter(void)
+    \brief destructor
+*/
+SamRecordFormatter::~SamRecordFormatter(void) {
+    delete d;
+    d = 0;
+}
+
+/*! \fn void SamRecordFormatter::Append(const BamAlignment& alignment, std::string& buffer) const
+    \brief Appends SAM-formatted line for \a alignment to \a buffer.
+
+    The line includes its terminating newline. Alignment must have its character
+    data available (e.g. from BamReader::GetNextAlignment()).
+
+    \param[in]     alignment alignment record to format
+    \param[in,out] buffer    destination buffer, existing contents are kept
+*/
+void SamRecordFormatter::Append(const BamAlignment& alignment, std::string& buffer) const {
+    d->Print(alignment, buffer);
+}
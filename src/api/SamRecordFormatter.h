@@ -0,0 +1,51 @@
+// ***************************************************************************
+// SamRecordFormatter.h (c) 2026
+// Marth Lab, Department of Biology, Boston College
+// ---------------------------------------------------------------------------
+// Last modified: 17 October 2026
+// ---------------------------------------------------------------------------
+// Provides fast SAM-formatted text output for alignment records
+// ***************************************************************************
+
+#ifndef SAMRECORDFORMATTER_H
+#define SAMRECORDFORMATTER_H
+
+#include "api/api_global.h"
+#include "api/BamAux.h"
+#include <string>
+
+namespace BamTools {
+
+class BamAlignment;
+
+//! \cond
+namespace Internal {
+    class SamRecordPrinter;
+} // namespace Internal
+//! \endcond
+
+class API_EXPORT SamRecordFormatter {
+
+    // ctor & dtor
+    public:
+        explicit SamRecordFormatter(const RefVector& references);
+        ~SamRecordFormatter(void);
+
+    // formatting
+    public:
+        // appends SAM-formatted line (including newline) to buffer
+        void Append(const BamAlignment& alignment, std::string& buffer) const;
+
+    // not copyable
+    private:
+        SamRecordFormatter(const SamRecordFormatter& other);
+        SamRecordFormatter& operator=(const SamRecordFormatter& other);
+
+    // private implementation
+    private:
+        Internal::SamRecordPrinter* d;
+};
+
+} // namespace BamTools
+
+#endif // SAMRECORDFORMATTER_H
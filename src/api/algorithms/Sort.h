@@ -16,7 +16,9 @@
 #include "api/BamReader.h"
 #include "api/BamMultiReader.h"
 #include <cassert>
+#include <cstring>
 #include <algorithm>
+#include <deque>
 #include <functional>
 #include <string>
 #include <vector>
@@ -52,6 +54,124 @@ struct API_EXPORT Sort {
     //! Base class for our sorting function objects
     typedef std::binary_function<BamAlignment, BamAlignment, bool> AlignmentSortBase;
 
+    /*! \struct BamTools::Algorithms::Sort::NameKey
+        \brief Pre-computed key for comparing alignments by name
+
+        Packs the first 8 bytes of the name into a single integer, so that most
+        comparisons never touch the name itself. Works directly on alignments
+        read with BamReader::GetNextAlignmentCore() - no char data required.
+
+        \note The key refers to the alignment's own name storage, so it is only
+        valid as long as that alignment is not modified or destroyed.
+    */
+    struct NameKey {
+
+        // data members
+        uint64_t    Prefix;     // first 8 name bytes (big-endian, zero-padded)
+        const char* Name;       // full, NUL-terminated name
+
+        // ctors
+        NameKey(void)
+            : Prefix(0)
+            , Name("")
+        { }
+
+        explicit NameKey(const BamTools::BamAlignment& al)
+            : Prefix(0)
+        {
+            // core-only alignments still carry the raw name at the start of their char data
+            Name = ( al.SupportData.HasCoreOnly ? al.SupportData.AllCharData.c_str()
+                                                : al.Name.c_str() );
+
+            const unsigned char* c = reinterpret_cast<const unsigned char*>(Name);
+            for ( int i = 0; i < 8; ++i ) {
+                Prefix <<= 8;
+                if ( *c ) Prefix |= *c++;
+            }
+        }
+
+        // comparison operators, these match std::string's (lexicographic) ordering
+        bool operator<(const NameKey& other) const {
+            if ( Prefix != other.Prefix )
+                return Prefix < other.Prefix;
+
+            // same prefix, names are only unequal if both are longer than 8 chars
+            if ( (Prefix & 0xff) == 0 )
+                return false;
+            return std::strcmp(Name + 8, other.Name + 8) < 0;
+        }
+
+        bool operator>(const NameKey& other) const {
+            return other < *this;
+        }
+    };
+
+    /*! \struct BamTools::Algorithms::Sort::PositionKey
+        \brief Pre-computed key for comparing alignments by position
+
+        Packs (RefID, Position) into a single 64-bit integer, with unmapped alignments
+        sorting last. The requested Sort::Order is folded into the key, so keys always
+        compare in ascending numeric order - which also makes them suitable for
+        radix sorting (see Sort::RadixSort()).
+    */
+    struct PositionKey {
+
+        // data members
+        uint64_t Value;
+
+        // ctors
+        PositionKey(void)
+            : Value(0)
+        { }
+
+        explicit PositionKey(const BamTools::BamAlignment& al,
+                             const Sort::Order& order = Sort::AscendingOrder)
+        {
+            // force unmapped alignments to end
+            if ( al.RefID == -1 )
+                Value = ~static_cast<uint64_t>(0);
+            else {
+                // flip sign bits so that signed values compare correctly as unsigned
+                const uint32_t refId    = static_cast<uint32_t>(al.RefID)    ^ 0x80000000u;
+                const uint32_t position = static_cast<uint32_t>(al.Position) ^ 0x80000000u;
+                Value = ( static_cast<uint64_t>(refId) << 32 ) | position;
+                if ( order == Sort::DescendingOrder )
+                    Value = ~Value - 1;
+            }
+        }
+
+        // comparison operator
+        bool operator<(const PositionKey& other) const {
+            return Value < other.Value;
+        }
+    };
+
+    /*! \struct BamTools::Algorithms::Sort::TagKey
+        \brief Pre-computed key for comparing alignments by tag value
+
+        Stores the typed tag value, so that the tag data is parsed only once per alignment.
+    */
+    template<typename T>
+    struct TagKey {
+
+        // data members
+        T    Value;
+        bool HasTag;
+
+        // ctors
+        TagKey(void)
+            : Value()
+            , HasTag(false)
+        { }
+
+        TagKey(const BamTools::BamAlignment& al, const std::string& tag)
+            : Value()
+            , HasTag(false)
+        {
+            HasTag = al.GetTag(tag, Value);
+        }
+    };
+
     /*! \struct BamTools::Algorithms::Sort::ByName
         \brief Function object for comparing alignments by name
 
@@ -67,6 +187,9 @@ struct API_EXPORT Sort {
             // OR sort in descending order
             std::sort( a.begin(), a.end(), Sort::ByName(Sort::DescendingOrder) );
         \endcode
+
+        Names are compared via Sort::NameKey, so alignments read with
+        BamReader::GetNextAlignmentCore() may be compared as well.
     */
     struct ByName : public AlignmentSortBase {
 
@@ -75,13 +198,21 @@ struct API_EXPORT Sort {
             : m_order(order)
         { }
 
-        // comparison function
+        // comparison functions
         bool operator()(const BamTools::BamAlignment& lhs, const BamTools::BamAlignment& rhs) {
-            return sort_helper(m_order, lhs.Name, rhs.Name);
+            return sort_helper(m_order, NameKey(lhs), NameKey(rhs));
+        }
+
+        bool operator()(const Sort::NameKey& lhs, const Sort::NameKey& rhs) {
+            return sort_helper(m_order, lhs, rhs);
         }
 
+        // pre-computed sort key
+        typedef Sort::NameKey KeyType;
+        KeyType MakeKey(const BamTools::BamAlignment& al) const { return KeyType(al); }
+
         // used by BamMultiReader internals
-        static inline bool UsesCharData(void) { return true; }
+        static inline bool UsesCharData(void) { return false; }
 
         // data members
         private:
@@ -126,6 +257,14 @@ struct API_EXPORT Sort {
             return sort_helper(m_order, lhs.RefID, rhs.RefID);
         }
 
+        bool operator()(const Sort::PositionKey& lhs, const Sort::PositionKey& rhs) {
+            return lhs < rhs;
+        }
+
+        // pre-computed sort key
+        typedef Sort::PositionKey KeyType;
+        KeyType MakeKey(const BamTools::BamAlignment& al) const { return KeyType(al, m_order); }
+
         // used by BamMultiReader internals
         static inline bool UsesCharData(void) { return false; }
 
@@ -173,6 +312,20 @@ struct API_EXPORT Sort {
             return sort_helper(m_order, lhsTagValue, rhsTagValue);
         }
 
+        bool operator()(const Sort::TagKey<T>& lhs, const Sort::TagKey<T>& rhs) {
+
+            // force alignments without tag to end
+            if ( !lhs.HasTag ) return false;
+            if ( !rhs.HasTag ) return true;
+
+            // otherwise compare on tag values
+            return sort_helper(m_order, lhs.Value, rhs.Value);
+        }
+
+        // pre-computed sort key
+        typedef Sort::TagKey<T> KeyType;
+        KeyType MakeKey(const BamTools::BamAlignment& al) const { return KeyType(al, m_tag); }
+
         // used by BamMultiReader internals
         static inline bool UsesCharData(void) { return true; }
 
@@ -204,6 +357,155 @@ struct API_EXPORT Sort {
         static inline bool UsesCharData(void) { return false; }
     };
 
+    //! \internal
+    // (key, index) pair for radix sorting alignments
+    struct RadixEntry {
+        uint64_t Key;
+        size_t   Index;
+    };
+
+    //! \internal
+    // returns the key of a RadixEntry
+    struct RadixEntryKey {
+        uint64_t operator()(const RadixEntry& entry) const { return entry.Key; }
+    };
+
+    /*! \fn template<typename T, typename KeyOf> static void RadixSort(T* begin, T* end, KeyOf keyOf)
+        \internal
+
+        Stable LSD radix sort on 64-bit keys (as returned by \a keyOf for each element),
+        one byte per pass. Passes over bytes that are identical for all keys are skipped,
+        so e.g. the (mostly zero) upper RefID bits of Sort::PositionKey cost nothing.
+    */
+    template<typename T, typename KeyOf>
+    static void RadixSort(T* begin, T* end, KeyOf keyOf) {
+
+        const size_t numElements = end - begin;
+        if ( numElements < 2 ) return;
+
+        // count digits for all passes at once
+        std::vector<size_t> counts(8*256, 0);
+        for ( const T* i = begin; i != end; ++i ) {
+            uint64_t key = keyOf(*i);
+            for ( size_t digit = 0; digit < 8; ++digit ) {
+                ++counts[digit*256 + (key & 0xff)];
+                key >>= 8;
+            }
+        }
+
+        // distribute elements, ping-ponging between data & scratch space
+        std::vector<T> scratch(numElements);
+        T* source = begin;
+        T* target = &scratch[0];
+        for ( size_t digit = 0; digit < 8; ++digit ) {
+
+            const size_t shift = digit*8;
+            size_t* offsets = &counts[digit*256];
+
+            // skip digit if all keys share it
+            if ( offsets[(keyOf(*source) >> shift) & 0xff] == numElements )
+                continue;
+
+            size_t total = 0;
+            for ( size_t bucket = 0; bucket < 256; ++bucket ) {
+                const size_t count = offsets[bucket];
+                offsets[bucket] = total;
+                total += count;
+            }
+
+            for ( const T* i = source; i != source + numElements; ++i )
+                target[ offsets[(keyOf(*i) >> shift) & 0xff]++ ] = *i;
+            std::swap(source, target);
+        }
+
+        // make sure result ends up in [begin, end)
+        if ( source != begin )
+            std::copy(source, source + numElements, begin);
+    }
+
+    //! \internal
+    // (key, index) pair for sorting alignments on pre-computed keys
+    template<typename KeyType>
+    struct KeyedEntry {
+        KeyType Key;
+        size_t  Index;
+
+        KeyedEntry(const KeyType& key, const size_t index)
+            : Key(key)
+            , Index(index)
+        { }
+    };
+
+    //! \internal
+    // compares KeyedEntry objects on their keys, using the provided compare function
+    template<typename Compare>
+    struct KeyedEntryCompare {
+
+        explicit KeyedEntryCompare(const Compare& comp)
+            : m_comp(comp)
+        { }
+
+        bool operator()(const KeyedEntry<typename Compare::KeyType>& lhs,
+                        const KeyedEntry<typename Compare::KeyType>& rhs)
+        {
+            return m_comp(lhs.Key, rhs.Key);
+        }
+
+        private:
+            Compare m_comp;
+    };
+
+    /*! \fn template<typename KeyType> static inline void DetachKey(KeyType& key, std::deque<std::string>& storage)
+        \internal
+
+        Makes a pre-computed key independent of the alignment it was built from. Only
+        Sort::NameKey refers to its alignment's data, all other keys are self-contained.
+    */
+    template<typename KeyType>
+    static inline void DetachKey(KeyType&, std::deque<std::string>&) { }
+
+    static inline void DetachKey(NameKey& key, std::deque<std::string>& storage) {
+        storage.push_back( std::string(key.Name) );
+        key.Name = storage.back().c_str();
+    }
+
+    /*! Sorts a std::vector of alignments (in-place) on pre-computed keys.
+
+        Each alignment's key (see \a Compare::MakeKey()) is extracted just once, then
+        only (key, index) pairs are sorted, and finally each alignment is moved just once.
+        This is much cheaper than comparing alignments directly whenever the key is
+        expensive to extract (e.g. Sort::ByTag, which would otherwise re-parse the tag
+        data of both alignments in every single comparison).
+
+        The sort is stable. Sort::SortAlignments() uses this for Sort::ByName and Sort::ByTag.
+
+        \param[in,out] data vector of alignments to be sorted
+        \param[in]     comp comparison function object, must provide KeyType & MakeKey()
+    */
+    template<typename Compare>
+    static void SortAlignmentsByKey(std::vector<BamAlignment>& data,
+                                    const Compare& comp = Compare())
+    {
+        typedef KeyedEntry<typename Compare::KeyType> Entry;
+
+        // decorate
+        const size_t numAlignments = data.size();
+        std::vector<Entry> entries;
+        entries.reserve(numAlignments);
+        for ( size_t i = 0; i < numAlignments; ++i )
+            entries.push_back( Entry(comp.MakeKey(data[i]), i) );
+
+        // sort
+        std::stable_sort(entries.begin(), entries.end(), KeyedEntryCompare<Compare>(comp));
+
+        // undecorate
+        std::vector<BamAlignment> sorted;
+        sorted.reserve(numAlignments);
+        for ( size_t i = 0; i < numAlignments; ++i )
+            sorted.push_back( data[entries[i].Index] );
+        data.swap(sorted);
+    }
+
     /*! Sorts a std::vector of alignments (in-place), using the provided compare function.
 
         \code
@@ -214,6 +516,11 @@ struct API_EXPORT Sort {
             Sort::SortAlignments(a, Sort::ByTag<int>("NM"));
         \endcode
 
+        Sorting by Sort::ByPosition uses a (stable) radix sort on packed
+        coordinate keys, instead of comparing the alignments themselves. Sorting by
+        Sort::ByName or Sort::ByTag extracts each alignment's key only once
+        (see Sort::SortAlignmentsByKey()).
+
         \param[in,out] data vector of alignments to be sorted
         \param[in]     comp comparison function object
     */
@@ -224,6 +531,24 @@ struct API_EXPORT Sort {
         std::sort(data.begin(), data.end(), comp);
     }
 
+    /*! \internal
+
+        Sort::SortAlignments() for tag order: parses each alignment's tag data just once,
+        building char data first for alignments read with GetNextAlignmentCore().
+    */
+    template<typename T>
+    static inline void SortAlignments(std::vector<BamAlignment>& data,
+                                      const ByTag<T>& comp)
+    {
+        std::vector<BamAlignment>::iterator alIter = data.begin();
+        std::vector<BamAlignment>::iterator alEnd  = data.end();
+        for ( ; alIter != alEnd; ++alIter ) {
+            if ( alIter->SupportData.HasCoreOnly )
+                alIter->BuildCharData();
+        }
+        SortAlignmentsByKey(data, comp);
+    }
+
     /*! Returns a sorted copy of the input alignments, using the provided compare function.
 
         \code
@@ -327,8 +652,209 @@ struct API_EXPORT Sort {
         SortAlignments(results, comp);
         return results;
     }
+
+    /*! \class BamTools::Algorithms::Sort::SortedRegion
+        \brief Provides sorted, streaming access to a region's alignments
+
+        Unlike Sort::GetSortedRegion(), this does not hold a full BamAlignment copy of each
+        record. Only the pre-computed sort key, core data & raw char data are kept per
+        record, and alignments are handed out one at a time, in sorted order. Keys are
+        extracted just once per record, so sorting e.g. by tag value costs little more than
+        reading the region itself.
+
+        \code
+            BamReader reader;
+            // open BAM file & index file
+
+            BamRegion region;
+            // define a region of interest (i.e. a exon or some other feature)
+
+            // iterate over all alignments covering that region, sorted by read group name
+            Sort::SortedRegion< Sort::ByTag<std::string> > sorted( Sort::ByTag<std::string>("RG") );
+            if ( sorted.Load(reader, region) ) {
+                BamAlignment al;
+                while ( sorted.GetNextAlignment(al) ) {
+                    // do something
+                }
+            }
+        \endcode
+
+        \a Compare must provide KeyType & MakeKey(), as Sort::ByName, Sort::ByPosition
+        & Sort::ByTag do.
+
+        \note The alignments' Filename field is not retained.
+    */
+    template<typename Compare>
+    class SortedRegion {
+
+        // ctor
+        public:
+            explicit SortedRegion(const Compare& comp = Compare())
+                : m_comp(comp)
+                , m_current(0)
+            { }
+
+        // SortedRegion interface
+        public:
+
+            // reads all alignments covering region (from a BamReader or BamMultiReader) & sorts them
+            template<typename Reader>
+            bool Load(Reader& reader, const BamRegion& region) {
+
+                Clear();
+                if ( !reader.SetRegion(region) )
+                    return false;
+
+                BamAlignment al;
+                while ( reader.GetNextAlignmentCore(al) ) {
+
+                    // extract key (tag values need char data)
+                    if ( Compare::UsesCharData() )
+                        al.BuildCharData();
+                    typename Compare::KeyType key = m_comp.MakeKey(al);
+                    DetachKey(key, m_keyData);
+                    m_entries.push_back( Entry(key, m_records.size()) );
+
+                    // store record, taking over its data buffers
+                    m_records.push_back( Record() );
+                    Record& record = m_records.back();
+                    record.RefID         = al.RefID;
+                    record.Position      = al.Position;
+                    record.Bin           = al.Bin;
+                    record.MapQuality    = al.MapQuality;
+                    record.AlignmentFlag = al.AlignmentFlag;
+                    record.MateRefID     = al.MateRefID;
+                    record.MatePosition  = al.MatePosition;
+                    record.InsertSize    = al.InsertSize;
+                    record.BlockLength         = al.SupportData.BlockLength;
+                    record.NumCigarOperations  = al.SupportData.NumCigarOperations;
+                    record.QueryNameLength     = al.SupportData.QueryNameLength;
+                    record.QuerySequenceLength = al.SupportData.QuerySequenceLength;
+                    record.CharData.swap(al.SupportData.AllCharData);
+                    record.CigarData.swap(al.CigarData);
+                }
+
+                std::stable_sort(m_entries.begin(), m_entries.end(), KeyedEntryCompare<Compare>(m_comp));
+                return true;
+            }
+
+            // retrieves next alignment in sorted order, with char data populated
+            bool GetNextAlignment(BamAlignment& al) {
+                if ( !GetNextAlignmentCore(al) )
+                    return false;
+                return al.BuildCharData();
+            }
+
+            // retrieves next alignment in sorted order, core data only
+            bool GetNextAlignmentCore(BamAlignment& al) {
+
+                if ( m_current >= m_entries.size() )
+                    return false;
+
+                // N.B. - each record is handed out once, so its buffers are simply moved over
+                Record& record = m_records[ m_entries[m_current++].Index ];
+                al.RefID         = record.RefID;
+                al.Position      = record.Position;
+                al.Bin           = record.Bin;
+                al.MapQuality    = record.MapQuality;
+                al.AlignmentFlag = record.AlignmentFlag;
+                al.MateRefID     = record.MateRefID;
+                al.MatePosition  = record.MatePosition;
+                al.InsertSize    = record.InsertSize;
+                al.Length        = record.QuerySequenceLength;
+                al.SupportData.BlockLength         = record.BlockLength;
+                al.SupportData.NumCigarOperations  = record.NumCigarOperations;
+                al.SupportData.QueryNameLength     = record.QueryNameLength;
+                al.SupportData.QuerySequenceLength = record.QuerySequenceLength;
+                al.SupportData.AllCharData.swap(record.CharData);
+                al.SupportData.HasCoreOnly = true;
+                al.CigarData.swap(record.CigarData);
+                al.Filename.clear();
+                return true;
+            }
+
+            // returns number of alignments loaded
+            size_t Size(void) const {
+                return m_entries.size();
+            }
+
+        // internal methods
+        private:
+            void Clear(void) {
+                m_entries.clear();
+                m_records.clear();
+                m_keyData.clear();
+                m_current = 0;
+            }
+
+        // internal types
+        private:
+            typedef KeyedEntry<typename Compare::KeyType> Entry;
+
+            // alignment core data & (raw) char data
+            struct Record {
+                int32_t  RefID;
+                int32_t  Position;
+                uint16_t Bin;
+                uint16_t MapQuality;
+                uint32_t AlignmentFlag;
+                int32_t  MateRefID;
+                int32_t  MatePosition;
+                int32_t  InsertSize;
+                uint32_t BlockLength;
+                uint32_t NumCigarOperations;
+                uint32_t QueryNameLength;
+                uint32_t QuerySequenceLength;
+                std::string CharData;
+                std::vector<CigarOp> CigarData;
+            };
+
+        // data members
+        private:
+            Compare m_comp;
+            std::vector<Entry> m_entries;
+            std::deque<Record> m_records;       // deque, so records are never copied as it grows
+            std::deque<std::string> m_keyData;  // detached key data (i.e. names)
+            size_t m_current;
+    };
 };
 
+/*! \internal
+
+    Sort::SortAlignments() for name order: extracts each alignment's name key just once.
+*/
+template<>
+inline void Sort::SortAlignments<Sort::ByName>(std::vector<BamAlignment>& data,
+                                               const Sort::ByName& comp)
+{
+    SortAlignmentsByKey(data, comp);
+}
+
+/*! \internal
+
+    Sort::SortAlignments() for coordinate order: radix sorts packed position keys, then
+    moves each alignment just once.
+*/
+template<>
+inline void Sort::SortAlignments<Sort::ByPosition>(std::vector<BamAlignment>& data,
+                                                   const Sort::ByPosition& comp)
+{
+    const size_t numAlignments = data.size();
+    std::vector<RadixEntry> entries(numAlignments);
+    for ( size_t i = 0; i < numAlignments; ++i ) {
+        entries[i].Key   = comp.MakeKey(data[i]).Value;
+        entries[i].Index = i;
+    }
+    if ( numAlignments > 0 )
+        RadixSort(&entries[0], &entries[0] + numAlignments, RadixEntryKey());
+
+    std::vector<BamAlignment> sorted;
+    sorted.reserve(numAlignments);
+    for ( size_t i = 0; i < numAlignments; ++i )
+        sorted.push_back( data[entries[i].Index] );
+    data.swap(sorted);
+}
+
 } // namespace Algorithms
 } // namespace BamTools
 
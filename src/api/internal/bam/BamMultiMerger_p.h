@@ -26,8 +26,10 @@
 #include "api/algorithms/Sort.h"
 #include <deque>
 #include <functional>
+#include <map>
 #include <set>
 #include <string>
+#include <vector>
 
 namespace BamTools {
 namespace Internal {
@@ -179,6 +181,311 @@ inline MergeItem MultiMerger<Compare>::TakeFirst(void) {
     return firstItem;
 }
 
+// cached comparison key used by LoserTreeMerger
+//
+// The general case stores nothing and simply defers to the Compare object.
+// Specializations may pre-compute a cheaper key when an alignment enters the
+// merger, so that the O(log k) comparisons per record avoid touching the full
+// BamAlignment.
+template<typename Compare>
+struct MergeKey {
+
+    void Set(const BamAlignment& al) { (void)al; }
+
+    bool IsLess(const MergeKey& other,
+                const BamAlignment& lhs,
+                const BamAlignment& rhs,
+                Compare& comp) const
+    {
+        (void)other;
+        return comp(lhs, rhs);
+    }
+};
+
+// packed (refId, position), see Sort::PositionKey
+template<>
+struct MergeKey<Algorithms::Sort::ByPosition> {
+
+    Algorithms::Sort::PositionKey Value;
+
+    void Set(const BamAlignment& al) {
+        Value = Algorithms::Sort::PositionKey(al);
+    }
+
+    // N.B. - BamMultiReader only ever merges in ascending order
+    bool IsLess(const MergeKey& other,
+                const BamAlignment& lhs,
+                const BamAlignment& rhs,
+                Algorithms::Sort::ByPosition& comp) const
+    {
+        (void)lhs; (void)rhs; (void)comp;
+        return Value < other.Value;
+    }
+};
+
+// packed name prefix (see Sort::NameKey), so name-ordered merging needs no char data
+template<>
+struct MergeKey<Algorithms::Sort::ByName> {
+
+    Algorithms::Sort::NameKey Value;
+
+    void Set(const BamAlignment& al) {
+        Value = Algorithms::Sort::NameKey(al);
+    }
+
+    bool IsLess(const MergeKey& other,
+                const BamAlignment& lhs,
+                const BamAlignment& rhs,
+                Algorithms::Sort::ByName& comp) const
+    {
+        (void)lhs; (void)rhs;
+        return comp(Value, other.Value);
+    }
+};
+
+// tournament-tree ("loser tree") merger
+//
+// Each reader owns a fixed slot (leaf). Replacing the current winner - the
+// common TakeFirst()/Add() cycle while reading - costs one comparison per tree
+// level and does not allocate. Ties are broken by insertion order, so records
+// are emitted in exactly the same order as the multiset-based MultiMerger.
+template<typename Compare>
+class LoserTreeMerger : public IMultiMerger {
+
+    public:
+        typedef Compare           CompareType;
+        typedef MergeKey<Compare> KeyType;
+
+    public:
+        explicit LoserTreeMerger(const Compare& comp = Compare())
+            : IMultiMerger()
+            , m_comp(comp)
+            , m_numActive(0)
+            , m_sequence(0)
+            , m_pendingSlot(NO_SLOT)
+            , m_isDirty(false)
+        { }
+        ~LoserTreeMerger(void) { }
+
+    public:
+        void Add(MergeItem item);
+        void Clear(void);
+        const MergeItem& First(void) const;
+        bool IsEmpty(void) const;
+        void Remove(BamReader* reader);
+        int Size(void) const;
+        MergeItem TakeFirst(void);
+
+    private:
+        struct Entry {
+            MergeItem Item;
+            KeyType   Key;
+            uint64_t  Sequence;
+            bool      IsActive;
+
+            Entry(const MergeItem& item = MergeItem())
+                : Item(item)
+                , Sequence(0)
+                , IsActive(false)
+            { }
+        };
+
+    private:
+        bool IsBefore(const size_t lhs, const size_t rhs) const;
+        void Rebuild(void) const;
+        void Replay(const size_t slot) const;
+        void Settle(void) const;
+
+    private:
+        static const size_t NO_SLOT = static_cast<size_t>(-1);
+
+        typedef std::map<BamReader*, size_t> SlotMap;
+
+        mutable Compare m_comp;
+        std::vector<Entry> m_entries;
+        SlotMap m_slots;
+        int m_numActive;
+        uint64_t m_sequence;
+
+        // tree state is updated lazily, so First() may need to settle it
+        mutable std::vector<size_t> m_tree;      // [0] = winner, [1..k-1] = losers
+        mutable std::vector<size_t> m_winners;   // scratch space for Rebuild()
+        mutable size_t m_pendingSlot;
+        mutable bool   m_isDirty;
+};
+
+template <typename Compare>
+inline void LoserTreeMerger<Compare>::Add(MergeItem item) {
+
+    // N.B. - any future custom Compare types must define this method
+    //        see algorithms/Sort.h
+
+    if ( CompareType::UsesCharData() )
+        item.Alignment->BuildCharData();
+
+    // lookup reader's slot, adding a new leaf if necessary
+    // (usually the reader just taken is refilled, so check its slot first)
+    size_t slot;
+    typename SlotMap::const_iterator slotIter;
+    if ( m_pendingSlot != NO_SLOT && m_entries[m_pendingSlot].Item.Reader == item.Reader )
+        slot = m_pendingSlot;
+    else if ( (slotIter = m_slots.find(item.Reader)) != m_slots.end() )
+        slot = slotIter->second;
+    else {
+        slot = m_entries.size();
+        m_entries.push_back( Entry(item) );
+        m_slots.insert( std::make_pair(item.Reader, slot) );
+        m_isDirty = true;
+    }
+
+    // store item & its comparison key
+    Entry& entry = m_entries[slot];
+    if ( !entry.IsActive ) {
+        entry.IsActive = true;
+        ++m_numActive;
+    }
+    entry.Item = item;
+    entry.Key.Set(*item.Alignment);
+    entry.Sequence = m_sequence++;
+
+    // only the most-recently taken winner can be replayed in place
+    if ( slot != m_pendingSlot )
+        m_isDirty = true;
+}
+
+template <typename Compare>
+inline void LoserTreeMerger<Compare>::Clear(void) {
+    m_entries.clear();
+    m_slots.clear();
+    m_tree.clear();
+    m_numActive   = 0;
+    m_pendingSlot = NO_SLOT;
+    m_isDirty     = false;
+}
+
+template <typename Compare>
+inline const MergeItem& LoserTreeMerger<Compare>::First(void) const {
+    Settle();
+    return m_entries[ m_tree[0] ].Item;
+}
+
+// returns true if entry in slot 'lhs' should be emitted before that in 'rhs'
+template <typename Compare>
+inline bool LoserTreeMerger<Compare>::IsBefore(const size_t lhs, const size_t rhs) const {
+
+    const Entry& l = m_entries[lhs];
+    const Entry& r = m_entries[rhs];
+
+    // empty slots always lose
+    if ( !l.IsActive ) return false;
+    if ( !r.IsActive ) return true;
+
+    // on equal keys, the earlier-inserted entry wins
+    if ( l.Sequence < r.Sequence )
+        return !r.Key.IsLess(l.Key, *r.Item.Alignment, *l.Item.Alignment, m_comp);
+    else
+        return l.Key.IsLess(r.Key, *l.Item.Alignment, *r.Item.Alignment, m_comp);
+}
+
+template <typename Compare>
+inline bool LoserTreeMerger<Compare>::IsEmpty(void) const {
+    return ( m_numActive == 0 );
+}
+
+template <typename Compare>
+inline void LoserTreeMerger<Compare>::Rebuild(void) const {
+
+    const size_t numSlots = m_entries.size();
+    m_tree.assign(numSlots, 0);
+    if ( numSlots == 0 ) return;
+
+    // play full tournament, leaves live at [k, 2k)
+    m_winners.resize(numSlots*2);
+    for ( size_t i = 0; i < numSlots; ++i )
+        m_winners[numSlots + i] = i;
+    for ( size_t node = numSlots - 1; node > 0; --node ) {
+        const size_t left  = m_winners[node*2];
+        const size_t right = m_winners[node*2 + 1];
+        if ( IsBefore(right, left) ) {
+            m_winners[node] = right;
+            m_tree[node]    = left;
+        } else {
+            m_winners[node] = left;
+            m_tree[node]    = right;
+        }
+    }
+    m_tree[0] = ( numSlots == 1 ? 0 : m_winners[1] );
+}
+
+template <typename Compare>
+inline void LoserTreeMerger<Compare>::Remove(BamReader* reader) {
+
+    if ( reader == 0 ) return;
+
+    typename SlotMap::iterator slotIter = m_slots.find(reader);
+    if ( slotIter == m_slots.end() ) return;
+    const size_t slot = slotIter->second;
+
+    // drop reader's leaf & renumber the remaining slots
+    if ( m_entries[slot].IsActive )
+        --m_numActive;
+    m_entries.erase(m_entries.begin() + slot);
+    m_slots.erase(slotIter);
+    typename SlotMap::iterator iter = m_slots.begin();
+    typename SlotMap::iterator end  = m_slots.end();
+    for ( ; iter != end; ++iter ) {
+        if ( iter->second > slot )
+            --iter->second;
+    }
+
+    m_pendingSlot = NO_SLOT;
+    m_isDirty = true;
+}
+
+// re-plays matches from the (previous winner's) leaf up to the root
+template <typename Compare>
+inline void LoserTreeMerger<Compare>::Replay(const size_t slot) const {
+
+    const size_t numSlots = m_entries.size();
+    size_t winner = slot;
+    for ( size_t node = (numSlots + slot) / 2; node > 0; node /= 2 ) {
+        if ( IsBefore(m_tree[node], winner) )
+            std::swap(m_tree[node], winner);
+    }
+    m_tree[0] = winner;
+}
+
+// brings the tree up to date with any entries added/removed since last query
+template <typename Compare>
+inline void LoserTreeMerger<Compare>::Settle(void) const {
+    if ( m_isDirty )
+        Rebuild();
+    else if ( m_pendingSlot != NO_SLOT )
+        Replay(m_pendingSlot);
+    m_pendingSlot = NO_SLOT;
+    m_isDirty = false;
+}
+
+template <typename Compare>
+inline int LoserTreeMerger<Compare>::Size(void) const {
+    return m_numActive;
+}
+
+template <typename Compare>
+inline MergeItem LoserTreeMerger<Compare>::TakeFirst(void) {
+
+    Settle();
+
+    // vacate winner's slot, it is re-played when refilled (or on next query)
+    const size_t winner = m_tree[0];
+    Entry& entry = m_entries[winner];
+    MergeItem firstItem = entry.Item;
+    entry.IsActive = false;
+    --m_numActive;
+    m_pendingSlot = winner;
+    return firstItem;
+}
+
 // unsorted "merger"
 template<>
 class MultiMerger<Algorithms::Sort::Unsorted> : public IMultiMerger {
@@ -12,6 +12,9 @@
 #include "api/SamConstants.h"
 #include "api/algorithms/Sort.h"
 #include "api/internal/bam/BamMultiReader_p.h"
+#include "api/internal/bam/BamPrefetcher_p.h"
+#include "api/internal/bam/BamReader_p.h"
+#include "api/internal/utils/BamThread_p.h"
 using namespace BamTools;
 using namespace BamTools::Internal;
 
@@ -22,11 +25,81 @@ using namespace BamTools::Internal;
 #include <sstream>
 using namespace std;
 
+namespace BamTools {
+namespace Internal {
+
+// number of open readers at/above which the tournament-tree merger replaces
+// the multiset-based one (fewer comparisons & no per-record allocation)
+// N.B. - src/benchmarks/bamtools_merge_benchmark measured it faster at every
+//        input count from 2 to 2000 (1.3x - 3x)
+static const size_t LOSER_TREE_MIN_READERS = 2;
+
+// maximum number of threads used to open files & parse their headers
+static const size_t MAX_OPEN_THREADS = 8;
+
+// opens BAM files, each worker taking the next unopened file from a shared list
+class ReaderOpener : public BamThread {
+
+    public:
+        ReaderOpener(const vector<string>& filenames,
+                     vector<BamReader*>& readers,
+                     const bool suspend,
+                     size_t& nextIndex,
+                     BamMutex& mutex)
+            : BamThread()
+            , m_filenames(filenames)
+            , m_readers(readers)
+            , m_suspend(suspend)
+            , m_nextIndex(nextIndex)
+            , m_mutex(mutex)
+        { }
+
+        ~ReaderOpener(void) {
+            Wait();
+        }
+
+    // N.B. - public, so it can also be run on the calling thread
+    public:
+        void Run(void) {
+            while ( true ) {
+
+                // fetch next file
+                size_t index;
+                {
+                    BamMutexLocker locker(m_mutex);
+                    if ( m_nextIndex >= m_filenames.size() )
+                        return;
+                    index = m_nextIndex++;
+                }
+
+                // open it (on failure, leave reader slot empty)
+                BamReader* reader = new BamReader;
+                if ( BamMultiReaderPrivate::OpenReader(reader, m_filenames.at(index), m_suspend) )
+                    m_readers[index] = reader;
+                else
+                    delete reader;
+            }
+        }
+
+    private:
+        const vector<string>& m_filenames;
+        vector<BamReader*>& m_readers;
+        const bool m_suspend;
+        size_t& m_nextIndex;
+        BamMutex& m_mutex;
+};
+
+} // namespace Internal
+} // namespace BamTools
+
 // ctor
 BamMultiReaderPrivate::BamMultiReaderPrivate(void)
     : m_alignmentCache(0)
     , m_hasUserMergeOrder(false)
     , m_mergeOrder(BamMultiReader::RoundRobinMerge)
+    , m_isPrefetching(false)
+    , m_prefetchPool(0)
+    , m_maxOpenFiles(0)
 { }
 
 // dtor
@@ -34,6 +107,37 @@ BamMultiReaderPrivate::~BamMultiReaderPrivate(void) {
     Close();
 }
 
+// makes sure reader's file is physically open, suspending least-recently used
+// readers as needed to stay within the open file limit
+bool BamMultiReaderPrivate::AcquireReader(BamReader* reader) {
+
+    // skip if no limit on open files
+    if ( m_maxOpenFiles == 0 )
+        return true;
+
+    // if already open, just mark as most-recently used
+    list<BamReader*>::iterator openIter = find(m_openReaders.begin(), m_openReaders.end(), reader);
+    if ( openIter != m_openReaders.end() ) {
+        m_openReaders.splice(m_openReaders.begin(), m_openReaders, openIter);
+        return true;
+    }
+
+    // make room
+    while ( !m_openReaders.empty() && m_openReaders.size() >= m_maxOpenFiles ) {
+        BamReader* leastRecent = m_openReaders.back();
+        m_openReaders.pop_back();
+        leastRecent->d->Suspend();
+    }
+
+    // re-open reader's file at its saved position
+    if ( !reader->d->Resume() ) {
+        SetErrorString("BamMultiReader::AcquireReader", reader->GetErrorString());
+        return false;
+    }
+    m_openReaders.push_front(reader);
+    return true;
+}
+
 // close all BAM files
 bool BamMultiReaderPrivate::Close(void) {
 
@@ -92,6 +196,10 @@ bool BamMultiReaderPrivate::CloseFiles(const vector<string>& filenames) {
                 // remove reader's entry from alignment cache
                 m_alignmentCache->Remove(reader);
 
+                // stop & clean up any read-ahead on this reader
+                RemovePrefetcher(reader);
+                m_openReaders.remove(reader);
+
                 // clean up reader & its alignment
                 if ( !reader->Close() ) {
                     m_errorString.append(1, '\t');
@@ -127,6 +235,10 @@ bool BamMultiReaderPrivate::CloseFiles(const vector<string>& filenames) {
             m_alignmentCache = 0;
         }
 
+        // clean up decoder threads (all prefetchers are gone by now)
+        delete m_prefetchPool;
+        m_prefetchPool = 0;
+
         // reset merge flags
         m_hasUserMergeOrder = false;
         m_mergeOrder = BamMultiReader::RoundRobinMerge;
@@ -142,6 +254,9 @@ bool BamMultiReaderPrivate::CreateIndexes(const BamIndex::IndexType& type) {
     bool errorsEncountered = false;
     m_errorString.clear();
 
+    // make sure no read-ahead is touching the readers
+    StopPrefetchers();
+
     // iterate over readers
     vector<MergeItem>::iterator itemIter = m_readers.begin();
     vector<MergeItem>::iterator itemEnd  = m_readers.end();
@@ -152,7 +267,7 @@ bool BamMultiReaderPrivate::CreateIndexes(const BamIndex::IndexType& type) {
 
         // if reader doesn't have an index, create one
         if ( !reader->HasIndex() ) {
-            if ( !reader->CreateIndex(type) ) {
+            if ( !AcquireReader(reader) || !reader->CreateIndex(type) ) {
                 m_errorString.append(1, '\t');
                 m_errorString.append(reader->GetErrorString());
                 m_errorString.append(1, '\n');
@@ -192,16 +307,22 @@ IMultiMerger* BamMultiReaderPrivate::CreateAlignmentCache(void) {
             m_mergeOrder = BamMultiReader::RoundRobinMerge;
     }
 
+    // large fan-in benefits from the tournament-tree merger
+    // (name-ordered merging always uses it, since it caches each record's name key)
+    const bool useLoserTree = ( m_readers.size() >= LOSER_TREE_MIN_READERS );
+
     // use current merge order to create proper 'multi-merger'
     switch ( m_mergeOrder ) {
 
         // merge BAM files by position
         case BamMultiReader::MergeByCoordinate :
+            if ( useLoserTree )
+                return new LoserTreeMerger<Algorithms::Sort::ByPosition>();
             return new MultiMerger<Algorithms::Sort::ByPosition>();
 
         // merge BAM files by read name
         case BamMultiReader::MergeByName :
-            return new MultiMerger<Algorithms::Sort::ByName>();
+            return new LoserTreeMerger<Algorithms::Sort::ByName>();
 
         // sorting is "unknown", "unsorted" or "ignored"... so use unsorted merger
         case BamMultiReader::RoundRobinMerge :
@@ -402,6 +523,9 @@ bool BamMultiReaderPrivate::Jump(int refID, int position) {
     // alignments here."  It makes sense to simply accept the failure,
     // UpdateAlignments(), and continue.
 
+    // drop any read-ahead data, readers are about to be repositioned
+    ResetPrefetchers();
+
     // iterate over readers
     vector<MergeItem>::iterator readerIter = m_readers.begin();
     vector<MergeItem>::iterator readerEnd  = m_readers.end();
@@ -411,7 +535,8 @@ bool BamMultiReaderPrivate::Jump(int refID, int position) {
         if ( reader == 0 ) continue;
 
         // jump in each BamReader to position of interest
-        reader->Jump(refID, position);
+        if ( AcquireReader(reader) )
+            reader->Jump(refID, position);
     }
 
     // returns status of cache update
@@ -424,6 +549,9 @@ bool BamMultiReaderPrivate::LocateIndexes(const BamIndex::IndexType& preferredTy
     bool errorsEncountered = false;
     m_errorString.clear();
 
+    // make sure no read-ahead is touching the readers
+    StopPrefetchers();
+
     // iterate over readers
     vector<MergeItem>::iterator readerIter = m_readers.begin();
     vector<MergeItem>::iterator readerEnd  = m_readers.end();
@@ -466,31 +594,56 @@ bool BamMultiReaderPrivate::Open(const vector<string>& filenames) {
         return false;
     }
 
-    // iterate over filenames
-    bool errorsEncountered = false;
+    // skip empty filenames
+    vector<string> requestedFilenames;
+    requestedFilenames.reserve(filenames.size());
     vector<string>::const_iterator filenameIter = filenames.begin();
     vector<string>::const_iterator filenameEnd  = filenames.end();
     for ( ; filenameIter != filenameEnd; ++filenameIter ) {
         const string& filename = (*filenameIter);
-        if ( filename.empty() ) continue;
+        if ( !filename.empty() )
+            requestedFilenames.push_back(filename);
+    }
 
-        // attempt to open BamReader
-        BamReader* reader = new BamReader;
-        const bool readerOpened = reader->Open(filename);
+    // open files & parse headers in parallel
+    // (if limiting open files, each file is suspended until it is needed)
+    const size_t numFiles = requestedFilenames.size();
+    const bool suspend = ( m_maxOpenFiles > 0 );
+    vector<BamReader*> openedReaders(numFiles, (BamReader*)0);
+    size_t nextIndex = 0;
+    BamMutex mutex;
+    {
+        const size_t numThreads = min(numFiles, MAX_OPEN_THREADS);
+        vector<ReaderOpener*> openers;
+        for ( size_t i = 0; i < numThreads; ++i ) {
+            ReaderOpener* opener = new ReaderOpener(requestedFilenames, openedReaders, suspend, nextIndex, mutex);
+            openers.push_back(opener);
+            if ( numThreads == 1 || !opener->Start() )
+                opener->Run();
+        }
+
+        // wait for all workers to finish
+        vector<ReaderOpener*>::iterator openerIter = openers.begin();
+        vector<ReaderOpener*>::iterator openerEnd  = openers.end();
+        for ( ; openerIter != openerEnd; ++openerIter )
+            delete (*openerIter);
+    }
+
+    // store readers, in requested order
+    bool errorsEncountered = false;
+    for ( size_t i = 0; i < numFiles; ++i ) {
+        BamReader* reader = openedReaders.at(i);
 
         // if opened OK, store it
-        if ( readerOpened )
+        if ( reader )
             m_readers.push_back( MergeItem(reader, new BamAlignment) );
 
-        // otherwise store error & clean up invalid reader
+        // otherwise store error
         else {
             m_errorString.append(1, '\t');
-            m_errorString += string("unable to open file: ") + filename;
+            m_errorString += string("unable to open file: ") + requestedFilenames.at(i);
             m_errorString.append(1, '\n');
             errorsEncountered = true;
-
-            delete reader;
-            reader = 0;
         }
     }
 
@@ -526,6 +679,13 @@ bool BamMultiReaderPrivate::OpenFile(const std::string& filename) {
     }
 }
 
+// opens a single reader (called from ReaderOpener threads)
+bool BamMultiReaderPrivate::OpenReader(BamReader* reader, const string& filename, const bool suspend) {
+    if ( !reader->Open(filename) )
+        return false;
+    return ( !suspend || reader->d->Suspend() );
+}
+
 bool BamMultiReaderPrivate::OpenIndexes(const vector<string>& indexFilenames) {
 
     // TODO: This needs to be cleaner - should not assume same order.
@@ -542,6 +702,9 @@ bool BamMultiReaderPrivate::OpenIndexes(const vector<string>& indexFilenames) {
     bool errorsEncountered = false;
     m_errorString.clear();
 
+    // make sure no read-ahead is touching the readers
+    StopPrefetchers();
+
     // iterate over BamReaders
     vector<string>::const_iterator indexFilenameIter = indexFilenames.begin();
     vector<string>::const_iterator indexFilenameEnd  = indexFilenames.end();
@@ -600,10 +763,29 @@ bool BamMultiReaderPrivate::PopNextCachedAlignment(BamAlignment& al, const bool
     al = *alignment;
 
     // load next alignment from reader & store in cache
-    SaveNextAlignment(reader, alignment);
+    SaveNextAlignment(reader, alignment, needCharData);
     return true;
 }
 
+// stops & deletes read-ahead for a reader (if any)
+void BamMultiReaderPrivate::RemovePrefetcher(BamReader* reader) {
+
+    map<BamReader*, BamPrefetcher*>::iterator prefetchIter = m_prefetchers.find(reader);
+    if ( prefetchIter != m_prefetchers.end() ) {
+        delete prefetchIter->second;
+        m_prefetchers.erase(prefetchIter);
+    }
+}
+
+// stops all read-ahead & discards any buffered alignments
+void BamMultiReaderPrivate::ResetPrefetchers(void) {
+
+    map<BamReader*, BamPrefetcher*>::iterator prefetchIter = m_prefetchers.begin();
+    map<BamReader*, BamPrefetcher*>::iterator prefetchEnd  = m_prefetchers.end();
+    for ( ; prefetchIter != prefetchEnd; ++prefetchIter )
+        prefetchIter->second->Reset();
+}
+
 // returns BAM file pointers to beginning of alignment data & resets alignment cache
 bool BamMultiReaderPrivate::Rewind(void) {
 
@@ -629,6 +811,9 @@ bool BamMultiReaderPrivate::RewindReaders(void) {
     m_errorString.clear();
     bool errorsEncountered = false;
 
+    // drop any read-ahead data, readers are about to be repositioned
+    ResetPrefetchers();
+
     // iterate over readers
     vector<MergeItem>::iterator readerIter = m_readers.begin();
     vector<MergeItem>::iterator readerEnd  = m_readers.end();
@@ -638,7 +823,7 @@ bool BamMultiReaderPrivate::RewindReaders(void) {
         if ( reader == 0 ) continue;
 
         // attempt rewind on BamReader
-        if ( !reader->Rewind() ) {
+        if ( !AcquireReader(reader) || !reader->Rewind() ) {
             m_errorString.append(1, '\t');
             m_errorString.append( reader->GetErrorString() );
             m_errorString.append(1, '\n');
@@ -649,7 +834,10 @@ bool BamMultiReaderPrivate::RewindReaders(void) {
     return !errorsEncountered;
 }
 
-void BamMultiReaderPrivate::SaveNextAlignment(BamReader* reader, BamAlignment* alignment) {
+void BamMultiReaderPrivate::SaveNextAlignment(BamReader* reader,
+                                              BamAlignment* alignment,
+                                              const bool needCharData)
+{
 
     // if can read alignment from reader, store in cache
     //
@@ -657,6 +845,21 @@ void BamMultiReaderPrivate::SaveNextAlignment(BamReader* reader, BamAlignment* a
     //        automatically by alignment cache to maintain its sorting OR
     //        on demand from client call to future call to GetNextAlignment()
 
+    // if reader is backed by read-ahead, take its next decoded alignment instead
+    // (letting the decoder thread build char data if the caller needs it)
+    map<BamReader*, BamPrefetcher*>::iterator prefetchIter = m_prefetchers.find(reader);
+    if ( prefetchIter != m_prefetchers.end() ) {
+        BamPrefetcher* prefetcher = prefetchIter->second;
+        if ( prefetcher->NeedsReader() && !AcquireReader(reader) )
+            return;
+        BamAlignment* prefetched = prefetcher->GetNextAlignment(needCharData);
+        if ( prefetched )
+            m_alignmentCache->Add( MergeItem(reader, prefetched) );
+        return;
+    }
+
+    if ( !AcquireReader(reader) )
+        return;
     if ( reader->GetNextAlignmentCore(*alignment) )
         m_alignmentCache->Add( MergeItem(reader, alignment) );
 }
@@ -700,6 +903,24 @@ void BamMultiReaderPrivate::SetErrorString(const string& where, const string& wh
     m_errorString = where + SEPARATOR + what;
 }
 
+// N.B. - must be set before any files are opened
+bool BamMultiReaderPrivate::SetMaxOpenFiles(unsigned int maxOpenFiles) {
+
+    if ( !m_readers.empty() ) {
+        SetErrorString("BamMultiReader::SetMaxOpenFiles", "cannot change limit while files are open");
+        return false;
+    }
+
+    m_maxOpenFiles = maxOpenFiles;
+    return true;
+}
+
+// N.B. - takes effect the next time the alignment cache is refreshed
+//        (Open, Rewind, Jump, SetRegion)
+void BamMultiReaderPrivate::SetPrefetching(bool ok) {
+    m_isPrefetching = ok;
+}
+
 bool BamMultiReaderPrivate::SetRegion(const BamRegion& region) {
 
     // NB: While it may make sense to track readers in which we can
@@ -707,6 +928,9 @@ bool BamMultiReaderPrivate::SetRegion(const BamRegion& region) {
     // alignments here."  It makes sense to simply accept the failure,
     // UpdateAlignments(), and continue.
 
+    // drop any read-ahead data, readers are about to be repositioned
+    ResetPrefetchers();
+
     // iterate over alignments
     vector<MergeItem>::iterator readerIter = m_readers.begin();
     vector<MergeItem>::iterator readerEnd  = m_readers.end();
@@ -716,13 +940,23 @@ bool BamMultiReaderPrivate::SetRegion(const BamRegion& region) {
         if ( reader == 0 ) continue;
 
         // set region of interest
-        reader->SetRegion(region);
+        if ( AcquireReader(reader) )
+            reader->SetRegion(region);
     }
 
     // return status of cache update
     return UpdateAlignmentCache();
 }
 
+// pauses all read-ahead, keeping any buffered alignments
+void BamMultiReaderPrivate::StopPrefetchers(void) {
+
+    map<BamReader*, BamPrefetcher*>::iterator prefetchIter = m_prefetchers.begin();
+    map<BamReader*, BamPrefetcher*>::iterator prefetchEnd  = m_prefetchers.end();
+    for ( ; prefetchIter != prefetchEnd; ++prefetchIter )
+        prefetchIter->second->Stop();
+}
+
 // updates our alignment cache
 bool BamMultiReaderPrivate::UpdateAlignmentCache(void) {
 
@@ -738,6 +972,17 @@ bool BamMultiReaderPrivate::UpdateAlignmentCache(void) {
     // clear any prior cache data
     m_alignmentCache->Clear();
 
+    // start decoder threads for read-ahead, if requested: one per processor besides
+    // the calling (merging) thread, but no more than there are files
+    // N.B. - when limiting open files, alignments are buffered per file (without
+    //        decoder threads) so that each re-opened file serves a whole batch
+    if ( m_isPrefetching && m_maxOpenFiles == 0 && m_prefetchPool == 0 ) {
+        const size_t numThreads = std::min<size_t>( BamThread::IdealThreadCount() - 1, m_readers.size() );
+        if ( numThreads > 0 )
+            m_prefetchPool = new BamPrefetchPool(numThreads);
+    }
+    BamPrefetchPool* pool = ( m_maxOpenFiles == 0 ? m_prefetchPool : 0 );
+
     // iterate over readers
     vector<MergeItem>::iterator readerIter = m_readers.begin();
     vector<MergeItem>::iterator readerEnd  = m_readers.end();
@@ -747,6 +992,14 @@ bool BamMultiReaderPrivate::UpdateAlignmentCache(void) {
         BamAlignment* alignment = item.Alignment;
         if ( reader == 0 || alignment == 0 ) continue;
 
+        // back reader with read-ahead, if requested
+        const bool hasPrefetcher  = ( m_prefetchers.find(reader) != m_prefetchers.end() );
+        const bool needPrefetcher = ( m_isPrefetching || m_maxOpenFiles > 0 );
+        if ( needPrefetcher && !hasPrefetcher )
+            m_prefetchers.insert( make_pair(reader, new BamPrefetcher(reader, pool)) );
+        else if ( !needPrefetcher && hasPrefetcher )
+            RemovePrefetcher(reader);
+
         // save next alignment from each reader in cache
         SaveNextAlignment(reader, alignment);
     }
@@ -23,12 +23,17 @@
 #include "api/SamHeader.h"
 #include "api/BamMultiReader.h"
 #include "api/internal/bam/BamMultiMerger_p.h"
+#include <list>
+#include <map>
 #include <string>
 #include <vector>
 
 namespace BamTools {
 namespace Internal {
 
+class BamPrefetchPool;
+class BamPrefetcher;
+
 class BamMultiReaderPrivate {
 
     // typedefs
@@ -59,6 +64,8 @@ class BamMultiReaderPrivate {
         bool GetNextAlignmentCore(BamAlignment& al);
         bool HasOpenReaders(void);
         bool SetExplicitMergeOrder(BamMultiReader::MergeOrder order);
+        bool SetMaxOpenFiles(unsigned int maxOpenFiles);
+        void SetPrefetching(bool ok);
 
         // access auxiliary data
         SamHeader GetHeader(void) const;
@@ -79,15 +86,23 @@ class BamMultiReaderPrivate {
     // 'internal' methods
     public:
 
+        bool AcquireReader(BamReader* reader);
         bool CloseFiles(const std::vector<std::string>& filenames);
         IMultiMerger* CreateAlignmentCache(void);
         bool PopNextCachedAlignment(BamAlignment& al, const bool needCharData);
+        void RemovePrefetcher(BamReader* reader);
+        void ResetPrefetchers(void);
         bool RewindReaders(void);
-        void SaveNextAlignment(BamReader* reader, BamAlignment* alignment);
+        void SaveNextAlignment(BamReader* reader,
+                               BamAlignment* alignment,
+                               const bool needCharData = false);
         void SetErrorString(const std::string& where, const std::string& what) const; //
+        void StopPrefetchers(void);
         bool UpdateAlignmentCache(void);
         bool ValidateReaders(void) const;
 
+        static bool OpenReader(BamReader* reader, const std::string& filename, const bool suspend);
+
     // data members
     public:
         std::vector<MergeItem> m_readers;
@@ -96,6 +111,13 @@ class BamMultiReaderPrivate {
         bool m_hasUserMergeOrder;
         BamMultiReader::MergeOrder m_mergeOrder;
 
+        bool m_isPrefetching;
+        std::map<BamReader*, BamPrefetcher*> m_prefetchers;
+        BamPrefetchPool* m_prefetchPool;
+
+        unsigned int m_maxOpenFiles;
+        std::list<BamReader*> m_openReaders; // most-recently used first
+
         mutable std::string m_errorString;
 };
 
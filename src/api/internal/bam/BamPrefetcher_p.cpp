@@ -0,0 +1,260 @@
+// ***************************************************************************
+// BamPrefetcher_p.cpp (c) 2026
+// Marth Lab, Department of Biology, Boston College
+// ---------------------------------------------------------------------------
+// Last modified: 17 October 2026
+// ---------------------------------------------------------------------------
+// Provides read-ahead (decompression & parsing) of alignment batches from
+// BamReaders, on a shared pool of decoder threads
+// ***************************************************************************
+
+#include "api/BamReader.h"
+#include "api/internal/bam/BamPrefetcher_p.h"
+using namespace BamTools;
+using namespace BamTools::Internal;
+
+#include <cstddef>
+using namespace std;
+
+// alignments decoded per batch & number of batches in flight per reader
+static const size_t PREFETCH_BATCH_SIZE  = 64;
+static const size_t PREFETCH_BATCH_COUNT = 3;
+
+// ---------------------------
+// BamPrefetchPool implementation
+// ---------------------------
+
+// ctor
+BamPrefetchPool::BamPrefetchPool(const unsigned int numThreads)
+    : m_isStopping(false)
+{
+    for ( unsigned int i = 0; i < numThreads; ++i ) {
+        Worker* worker = new Worker(this);
+        if ( !worker->Start() ) {
+            delete worker;
+            break;
+        }
+        m_workers.push_back(worker);
+    }
+}
+
+// dtor
+// N.B. - all prefetchers using this pool must be stopped (or deleted) first
+BamPrefetchPool::~BamPrefetchPool(void) {
+
+    {
+        BamMutexLocker locker(m_mutex);
+        m_isStopping = true;
+        m_hasWork.WakeAll();
+    }
+
+    vector<Worker*>::iterator workerIter = m_workers.begin();
+    vector<Worker*>::iterator workerEnd  = m_workers.end();
+    for ( ; workerIter != workerEnd; ++workerIter )
+        delete (*workerIter);
+    m_workers.clear();
+}
+
+unsigned int BamPrefetchPool::NumThreads(void) const {
+    return m_workers.size();
+}
+
+// decoder thread
+void BamPrefetchPool::RunWorker(void) {
+
+    while ( true ) {
+
+        // wait for a scheduled prefetcher
+        BamPrefetcher* prefetcher = 0;
+        {
+            BamMutexLocker locker(m_mutex);
+            while ( m_queue.empty() && !m_isStopping )
+                m_hasWork.Wait(m_mutex);
+            if ( m_isStopping )
+                return;
+            prefetcher = m_queue.front();
+            m_queue.pop_front();
+        }
+
+        // decode one batch (this re-queues the prefetcher if it has room for more)
+        prefetcher->DecodeNextBatch();
+    }
+}
+
+void BamPrefetchPool::Schedule(BamPrefetcher* prefetcher) {
+    BamMutexLocker locker(m_mutex);
+    m_queue.push_back(prefetcher);
+    m_hasWork.WakeOne();
+}
+
+// ---------------------------
+// BamPrefetcher implementation
+// ---------------------------
+
+// ctor
+BamPrefetcher::BamPrefetcher(BamReader* reader, BamPrefetchPool* pool)
+    : m_reader(reader)
+    , m_pool(pool)
+    , m_current(0)
+    , m_currentIndex(0)
+    , m_isAtEnd(false)
+    , m_isScheduled(false)
+    , m_isStopping(false)
+    , m_needCharData(false)
+{
+    // without decoder threads, the current batch is simply refilled in place
+    const size_t numBatches = ( m_pool ? PREFETCH_BATCH_COUNT : 1 );
+    for ( size_t i = 0; i < numBatches; ++i ) {
+        Batch* batch = new Batch(PREFETCH_BATCH_SIZE);
+        m_batches.push_back(batch);
+        m_freeBatches.push_back(batch);
+    }
+}
+
+// dtor
+BamPrefetcher::~BamPrefetcher(void) {
+
+    Stop();
+
+    vector<Batch*>::iterator batchIter = m_batches.begin();
+    vector<Batch*>::iterator batchEnd  = m_batches.end();
+    for ( ; batchIter != batchEnd; ++batchIter )
+        delete (*batchIter);
+    m_batches.clear();
+}
+
+// pool thread
+void BamPrefetcher::DecodeNextBatch(void) {
+
+    // take a free batch
+    Batch* batch = 0;
+    bool needCharData = false;
+    {
+        BamMutexLocker locker(m_mutex);
+        if ( m_isStopping || m_isAtEnd || m_freeBatches.empty() ) {
+            m_isScheduled = false;
+            m_batchFilled.WakeAll();
+            return;
+        }
+        batch = m_freeBatches.back();
+        m_freeBatches.pop_back();
+        needCharData = m_needCharData;
+    }
+
+    // fill batch (without holding lock)
+    const bool isAtEnd = FillBatch(batch, needCharData);
+
+    // publish batch, & stay in the pool's queue while there is room for more
+    bool isRescheduled = false;
+    {
+        BamMutexLocker locker(m_mutex);
+        m_filledBatches.push_back(batch);
+        m_isAtEnd = isAtEnd;
+        isRescheduled = ( !m_isAtEnd && !m_isStopping && !m_freeBatches.empty() );
+        if ( !isRescheduled )
+            m_isScheduled = false;
+        m_batchFilled.WakeAll();
+    }
+    if ( isRescheduled )
+        m_pool->Schedule(this);
+}
+
+// returns true if reader has no more data
+bool BamPrefetcher::FillBatch(Batch* batch, const bool needCharData) {
+
+    batch->Count = 0;
+    while ( batch->Count < PREFETCH_BATCH_SIZE ) {
+        BamAlignment& alignment = batch->Alignments[batch->Count];
+        if ( !m_reader->GetNextAlignmentCore(alignment) )
+            return true;
+        if ( needCharData )
+            alignment.BuildCharData();
+        ++batch->Count;
+    }
+    return false;
+}
+
+BamAlignment* BamPrefetcher::GetNextAlignment(const bool needCharData) {
+
+    // return next alignment from current batch, if available
+    if ( m_current && m_currentIndex < m_current->Count )
+        return &m_current->Alignments[m_currentIndex++];
+
+    BamMutexLocker locker(m_mutex);
+    m_needCharData = needCharData;
+
+    // hand exhausted batch back for decoding
+    if ( m_current ) {
+        m_freeBatches.push_back(m_current);
+        m_current = 0;
+    }
+
+    // decode next batch right here, if no decoder threads
+    if ( m_pool == 0 ) {
+        if ( m_filledBatches.empty() && !m_isAtEnd ) {
+            Batch* batch = m_freeBatches.back();
+            m_freeBatches.pop_back();
+            m_isAtEnd = FillBatch(batch, needCharData);
+            m_filledBatches.push_back(batch);
+        }
+    }
+
+    // otherwise keep the pool decoding ahead
+    else
+        ScheduleDecoding();
+
+    // wait for next batch
+    while ( m_filledBatches.empty() && !m_isAtEnd )
+        m_batchFilled.Wait(m_mutex);
+    if ( m_filledBatches.empty() )
+        return 0;
+
+    m_current = m_filledBatches.front();
+    m_filledBatches.pop_front();
+    m_currentIndex = 0;
+
+    // N.B. - a final batch may be empty
+    if ( m_current->Count == 0 )
+        return 0;
+    return &m_current->Alignments[m_currentIndex++];
+}
+
+bool BamPrefetcher::NeedsReader(void) const {
+    if ( m_pool )
+        return false;
+    const bool hasCurrent = ( m_current && m_currentIndex < m_current->Count );
+    return !( hasCurrent || !m_filledBatches.empty() || m_isAtEnd );
+}
+
+BamReader* BamPrefetcher::Reader(void) const {
+    return m_reader;
+}
+
+void BamPrefetcher::Reset(void) {
+
+    Stop();
+
+    // return all batches to free list
+    m_freeBatches = m_batches;
+    m_filledBatches.clear();
+    m_current = 0;
+    m_currentIndex = 0;
+    m_isAtEnd = false;
+}
+
+void BamPrefetcher::ScheduleDecoding(void) {
+    if ( m_isScheduled || m_isAtEnd || m_freeBatches.empty() )
+        return;
+    m_isScheduled = true;
+    m_pool->Schedule(this);
+}
+
+void BamPrefetcher::Stop(void) {
+
+    // wait for any queued or running decoding to finish
+    BamMutexLocker locker(m_mutex);
+    m_isStopping = true;
+    while ( m_isScheduled )
+        m_batchFilled.Wait(m_mutex);
+    m_isStopping = false;
+}
@@ -0,0 +1,157 @@
+// ***************************************************************************
+// BamPrefetcher_p.h (c) 2026
+// Marth Lab, Department of Biology, Boston College
+// ---------------------------------------------------------------------------
+// Last modified: 17 October 2026
+// ---------------------------------------------------------------------------
+// Provides read-ahead (decompression & parsing) of alignment batches from
+// BamReaders, on a shared pool of decoder threads
+// ***************************************************************************
+
+#ifndef BAMPREFETCHER_P_H
+#define BAMPREFETCHER_P_H
+
+//  -------------
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the BamTools API.  It exists purely as an
+// implementation detail. This header file may change from version to version
+// without notice, or even be removed.
+//
+// We mean it.
+
+#include "api/BamAlignment.h"
+#include "api/internal/utils/BamThread_p.h"
+#include <deque>
+#include <vector>
+
+namespace BamTools {
+
+class BamReader;
+
+namespace Internal {
+
+class BamPrefetcher;
+
+// fixed set of decoder threads, shared by all prefetchers of a BamMultiReader
+//
+// Each scheduled prefetcher gets one batch decoded & then goes to the back of
+// the queue, so that no reader is ever decoded by two threads at once & all
+// readers are served in turn.
+class BamPrefetchPool {
+
+    // ctor & dtor
+    public:
+        explicit BamPrefetchPool(const unsigned int numThreads);
+        ~BamPrefetchPool(void);
+
+    // BamPrefetchPool interface
+    public:
+        unsigned int NumThreads(void) const;
+        // queues prefetcher to have its next batch decoded
+        void Schedule(BamPrefetcher* prefetcher);
+
+    // internal worker type
+    private:
+        class Worker : public BamThread {
+            public:
+                explicit Worker(BamPrefetchPool* pool) : m_pool(pool) { }
+                ~Worker(void) { Wait(); }
+            protected:
+                void Run(void) { m_pool->RunWorker(); }
+            private:
+                BamPrefetchPool* m_pool;
+        };
+
+    // internal methods
+    private:
+        void RunWorker(void);
+
+    // not copyable
+    private:
+        BamPrefetchPool(const BamPrefetchPool& other);
+        BamPrefetchPool& operator=(const BamPrefetchPool& other);
+
+    // data members
+    private:
+        BamMutex m_mutex;
+        BamWaitCondition m_hasWork;
+        std::deque<BamPrefetcher*> m_queue;
+        bool m_isStopping;
+        std::vector<Worker*> m_workers;
+
+    friend class Worker;
+};
+
+class BamPrefetcher {
+
+    // ctor & dtor
+    public:
+        // N.B. - if pool is null, batches are decoded on the calling thread (read-ahead buffering only)
+        explicit BamPrefetcher(BamReader* reader, BamPrefetchPool* pool = 0);
+        ~BamPrefetcher(void);
+
+    // BamPrefetcher interface
+    public:
+        // returns next alignment, or 0 if reader has no more data
+        // N.B. - returned alignment remains valid until the following call
+        //      - if needCharData, upcoming alignments have their char data built on a decoder thread
+        BamAlignment* GetNextAlignment(const bool needCharData);
+        // returns true if the next GetNextAlignment() call must read from the reader itself
+        bool NeedsReader(void) const;
+        BamReader* Reader(void) const;
+        // discards all read-ahead data, call before repositioning the reader
+        void Reset(void);
+        // pauses read-ahead (keeping buffered data), call before any other reader access
+        void Stop(void);
+
+    // internal batch type
+    private:
+        struct Batch {
+            std::vector<BamAlignment> Alignments;
+            size_t Count;
+
+            explicit Batch(const size_t capacity)
+                : Alignments(capacity)
+                , Count(0)
+            { }
+        };
+
+    // internal methods
+    private:
+        // decodes next batch, called by a pool thread
+        void DecodeNextBatch(void);
+        // returns true if reader has no more data
+        bool FillBatch(Batch* batch, const bool needCharData);
+        // queues decoding, if there is room for another batch (N.B. - caller holds m_mutex)
+        void ScheduleDecoding(void);
+
+    // data members
+    private:
+        BamReader* m_reader;
+        BamPrefetchPool* m_pool;
+
+        // consumer-side state (merge thread only)
+        Batch* m_current;
+        size_t m_currentIndex;
+
+        // shared state (guarded by m_mutex)
+        BamMutex m_mutex;
+        BamWaitCondition m_batchFilled;
+        std::deque<Batch*>  m_filledBatches;
+        std::vector<Batch*> m_freeBatches;
+        bool m_isAtEnd;
+        bool m_isScheduled; // queued in, or being decoded by, the pool
+        bool m_isStopping;
+        bool m_needCharData;
+
+        std::vector<Batch*> m_batches; // owns all batches
+
+    friend class BamPrefetchPool;
+};
+
+} // namespace Internal
+} // namespace BamTools
+
+#endif // BAMPREFETCHER_P_H
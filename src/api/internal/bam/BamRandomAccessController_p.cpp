@@ -11,6 +11,8 @@
 #include "api/internal/bam/BamRandomAccessController_p.h"
 #include "api/internal/bam/BamReader_p.h"
 #include "api/internal/index/BamIndexFactory_p.h"
+#include "api/internal/index/BamStandardIndex_p.h"
+#include "api/internal/index/BamToolsIndex_p.h"
 #include "api/internal/utils/BamException_p.h"
 using namespace BamTools;
 using namespace BamTools::Internal;
@@ -212,6 +214,57 @@ bool BamRandomAccessController::LocateIndex(BamReaderPrivate* reader,
     return OpenIndex(indexFilename, reader);
 }
 
+bool BamRandomAccessController::MergeIndexes(BamReaderPrivate* reader,
+                                             const vector<string>& indexFilenames,
+                                             const vector<int64_t>& offsets,
+                                             const BamIndex::IndexType& type)
+{
+    // skip if reader is invalid
+    assert(reader);
+    if ( !reader->IsOpen() ) {
+        SetErrorString("BamRandomAccessController::MergeIndexes",
+                       "cannot merge index for unopened reader");
+        return false;
+    }
+
+    // attempt to build index of requested type from shards' index files
+    // N.B. - merging is not part of the BamIndex interface, so only built-in formats support it
+    BamIndex* newIndex = 0;
+    bool isMerged = false;
+    switch ( type ) {
+        case ( BamIndex::STANDARD ) : {
+            BamStandardIndex* standardIndex = new BamStandardIndex(reader);
+            isMerged = standardIndex->Merge(indexFilenames, offsets);
+            newIndex = standardIndex;
+            break;
+        }
+        case ( BamIndex::BAMTOOLS ) : {
+            BamToolsIndex* toolsIndex = new BamToolsIndex(reader);
+            isMerged = toolsIndex->Merge(indexFilenames, offsets);
+            newIndex = toolsIndex;
+            break;
+        }
+        default : {
+            stringstream s("");
+            s << "could not create index of type: " << type;
+            SetErrorString("BamRandomAccessController::MergeIndexes", s.str());
+            return false;
+        }
+    }
+
+    if ( !isMerged ) {
+        const string indexError = newIndex->GetErrorString();
+        const string message = "could not merge index: \n\t" + indexError;
+        SetErrorString("BamRandomAccessController::MergeIndexes", message);
+        delete newIndex;
+        return false;
+    }
+
+    // save new index & return success
+    SetIndex(newIndex);
+    return true;
+}
+
 bool BamRandomAccessController::OpenIndex(const string& indexFilename, BamReaderPrivate* reader) {
 
     // attempt create new index of type based on filename
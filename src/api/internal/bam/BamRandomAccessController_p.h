@@ -22,6 +22,8 @@
 
 #include "api/BamAux.h"
 #include "api/BamIndex.h"
+#include <string>
+#include <vector>
 
 namespace BamTools {
 
@@ -53,6 +55,10 @@ class BamRandomAccessController {
         bool HasIndex(void) const;
         bool IndexHasAlignmentsForReference(const int& refId);
         bool LocateIndex(BamReaderPrivate* reader, const BamIndex::IndexType& preferredType);
+        bool MergeIndexes(BamReaderPrivate* reader,
+                          const std::vector<std::string>& indexFilenames,
+                          const std::vector<int64_t>& offsets,
+                          const BamIndex::IndexType& type);
         bool OpenIndex(const std::string& indexFilename, BamReaderPrivate* reader);
         void SetIndex(BamIndex* index);
 
@@ -30,6 +30,8 @@ using namespace std;
 // constructor
 BamReaderPrivate::BamReaderPrivate(BamReader* parent)
     : m_alignmentsBeginOffset(0)
+    , m_isSuspended(false)
+    , m_suspendedPosition(0)
     , m_parent(parent)
 {
     m_isBigEndian = BamTools::SystemIsBigEndian();
@@ -53,8 +55,10 @@ bool BamReaderPrivate::Close(void) {
     // close random access controller
     m_randomAccessController.Close();
 
-    // if stream is open, attempt close
+    // if stream is open (or suspended), attempt close
     if ( IsOpen() ) {
+        m_isSuspended = false;
+        m_suspendedPosition = 0;
         try {
             m_stream.Close();
         } catch ( BamException& e ) {
@@ -222,8 +226,13 @@ bool BamReaderPrivate::HasIndex(void) const {
     return m_randomAccessController.HasIndex();
 }
 
+// N.B. - a suspended reader is still considered open
 bool BamReaderPrivate::IsOpen(void) const {
-    return m_stream.IsOpen();
+    return ( m_stream.IsOpen() || m_isSuspended );
+}
+
+bool BamReaderPrivate::IsSuspended(void) const {
+    return m_isSuspended;
 }
 
 // load BAM header data
@@ -362,6 +371,28 @@ bool BamReaderPrivate::LocateIndex(const BamIndex::IndexType& preferredType) {
     }
 }
 
+// creates an index file of requested type on current BAM file, from its shards' index files
+bool BamReaderPrivate::MergeIndexes(const vector<string>& indexFilenames,
+                                    const vector<int64_t>& offsets,
+                                    const BamIndex::IndexType& type)
+{
+    // skip if BAM file not open
+    if ( !IsOpen() ) {
+        SetErrorString("BamReader::MergeIndexes", "cannot merge index on unopened BAM file");
+        return false;
+    }
+
+    // attempt to merge index
+    if ( m_randomAccessController.MergeIndexes(this, indexFilenames, offsets, type) )
+        return true;
+    else {
+        const string bracError = m_randomAccessController.GetErrorString();
+        const string message = string("could not merge index: \n\t") + bracError;
+        SetErrorString("BamReader::MergeIndexes", message);
+        return false;
+    }
+}
+
 // opens BAM file (and index)
 bool BamReaderPrivate::Open(const string& filename) {
 
@@ -405,6 +436,26 @@ bool BamReaderPrivate::OpenIndex(const std::string& indexFilename) {
     }
 }
 
+// re-opens a suspended BAM file, restoring its file position
+bool BamReaderPrivate::Resume(void) {
+
+    // skip if not suspended
+    if ( !m_isSuspended )
+        return true;
+
+    try {
+        m_stream.Resume(m_filename, m_suspendedPosition);
+        m_isSuspended = false;
+        return true;
+    } catch ( BamException& e ) {
+        const string streamError = e.what();
+        const string message = string("could not re-open file: ") + m_filename +
+                               "\n\t" + streamError;
+        SetErrorString("BamReader::Resume", message);
+        return false;
+    }
+}
+
 // returns BAM file pointer to beginning of alignment data
 bool BamReaderPrivate::Rewind(void) {
 
@@ -422,6 +473,16 @@ bool BamReaderPrivate::Rewind(void) {
     }
 }
 
+// sets BAM file pointer to a previously stored (virtual) file offset
+bool BamReaderPrivate::SeekToOffset(const int64_t& virtualOffset) {
+
+    // reset region
+    m_randomAccessController.ClearRegion();
+
+    // return status of seeking to requested offset
+    return Seek(virtualOffset);
+}
+
 bool BamReaderPrivate::Seek(const int64_t& position) {
 
     // skip if BAM file not open
@@ -442,6 +503,10 @@ bool BamReaderPrivate::Seek(const int64_t& position) {
     }
 }
 
+void BamReaderPrivate::SetReadBufferSize(const size_t numBytes) {
+    m_stream.SetReadBufferSize(numBytes);
+}
+
 void BamReaderPrivate::SetErrorString(const string& where, const string& what) {
     static const string SEPARATOR = ": ";
     m_errorString = where + SEPARATOR + what;
@@ -465,6 +530,34 @@ bool BamReaderPrivate::SetRegion(const BamRegion& region) {
     }
 }
 
+// closes the underlying BAM file, keeping header, index & region data as well as
+// the current block data, so that Resume() can pick up where we left off
+//
+// N.B. - streams that cannot be re-opened & re-positioned (pipes, etc) are left open
+bool BamReaderPrivate::Suspend(void) {
+
+    // skip if already suspended or not suspendable
+    if ( m_isSuspended )
+        return true;
+    if ( !m_stream.IsOpen() ) {
+        SetErrorString("BamReader::Suspend", "cannot suspend unopened BAM file");
+        return false;
+    }
+    if ( !m_stream.m_device->IsRandomAccess() )
+        return true;
+
+    try {
+        m_suspendedPosition = m_stream.Suspend();
+        m_isSuspended = true;
+        return true;
+    } catch ( BamException& e ) {
+        const string streamError = e.what();
+        const string message = string("could not suspend BAM file: \n\t") + streamError;
+        SetErrorString("BamReader::Suspend", message);
+        return false;
+    }
+}
+
 int64_t BamReaderPrivate::Tell(void) const {
     return m_stream.Tell();
 }
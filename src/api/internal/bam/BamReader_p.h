@@ -28,6 +28,7 @@
 #include "api/internal/bam/BamRandomAccessController_p.h"
 #include "api/internal/io/BgzfStream_p.h"
 #include <string>
+#include <vector>
 
 namespace BamTools {
 namespace Internal {
@@ -48,6 +49,8 @@ class BamReaderPrivate {
         bool IsOpen(void) const;
         bool Open(const std::string& filename);
         bool Rewind(void);
+        bool SeekToOffset(const int64_t& virtualOffset);
+        void SetReadBufferSize(const size_t numBytes);
         bool SetRegion(const BamRegion& region);
 
         // access alignment data
@@ -66,6 +69,9 @@ class BamReaderPrivate {
         bool CreateIndex(const BamIndex::IndexType& type);
         bool HasIndex(void) const;
         bool LocateIndex(const BamIndex::IndexType& preferredType);
+        bool MergeIndexes(const std::vector<std::string>& indexFilenames,
+                          const std::vector<int64_t>& offsets,
+                          const BamIndex::IndexType& type);
         bool OpenIndex(const std::string& indexFilename);
         void SetIndex(BamIndex* index);
 
@@ -90,6 +96,15 @@ class BamReaderPrivate {
         // return reader's file position
         int64_t Tell(void) const;
 
+    // internal methods used by BamMultiReaderPrivate to bound the number of open files
+    public:
+        // returns true if file is temporarily closed
+        bool IsSuspended(void) const;
+        // re-opens file & continues from position saved by Suspend()
+        bool Resume(void);
+        // temporarily closes file, saving current position
+        bool Suspend(void);
+
     // data members
     public:
 
@@ -98,6 +113,10 @@ class BamReaderPrivate {
         std::string m_filename;
         RefVector   m_references;
 
+        // suspended file data
+        bool    m_isSuspended;
+        int64_t m_suspendedPosition;
+
         // system data
         bool m_isBigEndian;
 
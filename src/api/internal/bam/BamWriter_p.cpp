@@ -54,6 +54,18 @@ void BamWriterPrivate::Close(void) {
     }
 }
 
+// writes out any buffered data, ending the current BGZF block
+bool BamWriterPrivate::Flush(void) {
+
+    try {
+        m_stream.Flush();
+        return true;
+    } catch ( BamException& e ) {
+        m_errorString = e.what();
+        return false;
+    }
+}
+
 // creates a cigar string from the supplied alignment
 void BamWriterPrivate::CreatePackedCigar(const vector<CigarOp>& cigarOperations, string& packedCigar) {
 
@@ -199,12 +211,22 @@ bool BamWriterPrivate::SaveAlignment(const BamAlignment& al) {
     }
 }
 
+void BamWriterPrivate::SetCompressionLevel(const int level) {
+    // modifying compression is not allowed if BAM file is open
+    if ( !IsOpen() )
+        m_stream.SetCompressionLevel(level);
+}
+
 void BamWriterPrivate::SetWriteCompressed(bool ok) {
     // modifying compression is not allowed if BAM file is open
     if ( !IsOpen() )
         m_stream.SetWriteCompressed(ok);
 }
 
+int64_t BamWriterPrivate::Tell(void) const {
+    return m_stream.Tell();
+}
+
 void BamWriterPrivate::WriteAlignment(const BamAlignment& al) {
 
     // calculate char lengths
@@ -41,13 +41,16 @@ class BamWriterPrivate {
     // interface methods
     public:
         void Close(void);
+        bool Flush(void);
         std::string GetErrorString(void) const;
         bool IsOpen(void) const;
         bool Open(const std::string& filename,
                   const std::string& samHeaderText,
                   const BamTools::RefVector& referenceSequences);
         bool SaveAlignment(const BamAlignment& al);
+        void SetCompressionLevel(const int level);
         void SetWriteCompressed(bool ok);
+        int64_t Tell(void) const;
 
     // 'internal' methods
     public:
@@ -11,6 +11,7 @@
 #include "api/internal/bam/BamReader_p.h"
 #include "api/internal/index/BamStandardIndex_p.h"
 #include "api/internal/io/BamDeviceFactory_p.h"
+#include "api/internal/io/BgzfStream_p.h"
 #include "api/internal/utils/BamException_p.h"
 using namespace BamTools;
 using namespace BamTools::Internal;
@@ -457,6 +458,12 @@ void BamStandardIndex::GetOffset(const BamRegion& region, int64_t& offset, bool*
     sort( offsets.begin(), offsets.end() );
 
     // binary search for an overlapping block (may not be first one though)
+    //
+    // N.B. - alignment ends are not ordered (e.g. spliced alignments reach far beyond
+    //        their successors), so blocks are compared against the start of the linear
+    //        index window containing 'begin' instead: any alignment starting within that
+    //        window follows the first alignment of the block found
+    const int windowBegin = (int)( (begin >> BamStandardIndex::BAM_LIDX_SHIFT) << BamStandardIndex::BAM_LIDX_SHIFT );
     BamAlignment al;
     typedef vector<int64_t>::const_iterator OffsetConstIterator;
     OffsetConstIterator offsetFirst = offsets.begin();
@@ -481,7 +488,7 @@ void BamStandardIndex::GetOffset(const BamRegion& region, int64_t& offset, bool*
         *hasAlignmentsInRegion = m_reader->LoadNextAlignment(al);
 
         // check alignment against region
-        if ( al.GetEndPosition() <= region.LeftPosition ) {
+        if ( al.GetEndPosition() <= windowBegin ) {
             offsetFirst = ++offsetIter;
             count -= step+1;
         } else count = step;
@@ -491,6 +498,11 @@ void BamStandardIndex::GetOffset(const BamRegion& region, int64_t& offset, bool*
     if ( offsetIter != offsets.begin() )
         --offsetIter;
     offset = (*offsetIter);
+
+    // alignments spanning into the window from further upstream start no earlier than
+    // the window's linear offset
+    if ( minOffset > 0 )
+        offset = std::min( offset, std::max(offsets.front(), (int64_t)minOffset) );
 }
 
 // returns whether reference has alignments or no
@@ -576,6 +588,94 @@ uint64_t BamStandardIndex::LookupLinearOffset(const BaiReferenceSummary& refSumm
     return linearOffset;
 }
 
+// builds index for associated BAM file by merging existing index files of its shards
+//   * @offsets are the compressed byte offsets at which each shard landed in the BAM file
+//   * shards are expected to be coordinate-disjoint (e.g. concatenated sorted shards)
+bool BamStandardIndex::Merge(const vector<string>& indexFilenames,
+                             const vector<int64_t>& offsets)
+{
+    // skip if BamReader is invalid or not open
+    if ( m_reader == 0 || !m_reader->IsOpen() ) {
+        SetErrorString("BamStandardIndex::Merge", "could not merge index: reader is not open");
+        return false;
+    }
+
+    // make sure we have an offset for each shard
+    if ( indexFilenames.size() != offsets.size() ) {
+        SetErrorString("BamStandardIndex::Merge", "could not merge index: each index file requires an offset");
+        return false;
+    }
+
+    // visit shards in the order they appear in the BAM file
+    vector< pair<int64_t, size_t> > shardOrder;
+    shardOrder.reserve(offsets.size());
+    for ( size_t i = 0; i < offsets.size(); ++i )
+        shardOrder.push_back( make_pair(offsets.at(i), i) );
+    sort( shardOrder.begin(), shardOrder.end() );
+
+    try {
+
+        // initialize merged data with an (empty) entry for each reference
+        const int& numReferences = m_reader->GetReferenceCount();
+        vector<BaiReferenceEntry> mergedEntries;
+        mergedEntries.reserve(numReferences);
+        for ( int i = 0; i < numReferences; ++i )
+            mergedEntries.push_back( BaiReferenceEntry(i) );
+
+        // fold each shard's index data into merged data
+        vector<int64_t> firstBlockOffsets;
+        vector< pair<int64_t, size_t> >::const_iterator shardIter = shardOrder.begin();
+        vector< pair<int64_t, size_t> >::const_iterator shardEnd  = shardOrder.end();
+        for ( ; shardIter != shardEnd; ++shardIter ) {
+            const int64_t firstBlockOffset = MergeIndexFile(indexFilenames.at((*shardIter).second),
+                                                            (*shardIter).first,
+                                                            mergedEntries);
+            if ( firstBlockOffset >= 0 )
+                firstBlockOffsets.push_back( (*shardIter).first + firstBlockOffset );
+        }
+
+        // make sure offsets fit the BAM file (each shard's data must land on a BGZF block),
+        // before anything is written
+        try {
+            BgzfStream::CheckFileOffsets(m_reader->Filename(), offsets, firstBlockOffsets);
+        } catch ( BamException& e ) {
+            const string message = string("shard data does not line up with BAM file, check offsets: ") + e.what();
+            throw BamException("BamStandardIndex::Merge", message);
+        }
+
+        // open new index file (read & write)
+        const string indexFilename = m_reader->Filename() + Extension();
+        OpenFile(indexFilename, IBamIODevice::ReadWrite);
+
+        // initialize BaiFileSummary & output file
+        ReserveForSummary(numReferences);
+        WriteHeader();
+
+        // write merged reference entries
+        vector<BaiReferenceEntry>::iterator entryIter = mergedEntries.begin();
+        vector<BaiReferenceEntry>::iterator entryEnd  = mergedEntries.end();
+        for ( ; entryIter != entryEnd; ++entryIter ) {
+
+            // chunks from different shards may interleave within a bin
+            BaiBinMap::iterator binIter = (*entryIter).Bins.begin();
+            BaiBinMap::iterator binEnd  = (*entryIter).Bins.end();
+            for ( ; binIter != binEnd; ++binIter ) {
+                if ( (*binIter).first != (uint32_t)BamStandardIndex::MAX_BIN )
+                    sort( (*binIter).second.begin(), (*binIter).second.end() );
+            }
+
+            WriteReferenceEntry(*entryIter);
+        }
+
+    } catch ( BamException& e ) {
+        m_errorString = e.what();
+        return false;
+    }
+
+    // return success
+    return true;
+}
+
 void BamStandardIndex::MergeAlignmentChunks(BaiAlignmentChunkVector& chunks) {
 
     // skip if chunks are empty, nothing to merge
@@ -617,6 +717,136 @@ void BamStandardIndex::MergeAlignmentChunks(BaiAlignmentChunkVector& chunks) {
     chunks = mergedChunks;
 }
 
+void BamStandardIndex::MergeBin(BaiBinMap& bins,
+                                const uint32_t& binId,
+                                const int32_t& numAlignmentChunks,
+                                const uint64_t& shift,
+                                uint64_t& firstChunkStart)
+{
+    // read chunks (already in m_buffer) & shift them to their position in merged BAM file
+    BaiAlignmentChunkVector shardChunks;
+    shardChunks.reserve(numAlignmentChunks);
+    size_t offset = 0;
+    uint64_t chunkStart;
+    uint64_t chunkStop;
+    for ( int i = 0; i < numAlignmentChunks; ++i ) {
+
+        // read chunk start & stop from buffer
+        memcpy((char*)&chunkStart, m_resources.Buffer+offset, sizeof(uint64_t));
+        offset += sizeof(uint64_t);
+        memcpy((char*)&chunkStop, m_resources.Buffer+offset, sizeof(uint64_t));
+        offset += sizeof(uint64_t);
+
+        // swap endian-ness if necessary
+        if ( m_isBigEndian ) {
+            SwapEndian_64(chunkStart);
+            SwapEndian_64(chunkStop);
+        }
+
+        shardChunks.push_back( BaiAlignmentChunk(chunkStart, chunkStop) );
+    }
+
+    // if bin is the (samtools) metadata pseudo-bin, its 2nd chunk holds
+    // mapped/unmapped read counts, not offsets
+    if ( binId == (uint32_t)BamStandardIndex::MAX_BIN ) {
+        if ( shardChunks.size() != 2 )
+            throw BamException("BamStandardIndex::MergeBin", "invalid BAI metadata pseudo-bin");
+        shardChunks[0].Start += shift;
+        shardChunks[0].Stop  += shift;
+
+        // first occurrence is stored as-is
+        BaiBinMap::iterator binIter = bins.find(binId);
+        if ( binIter == bins.end() ) {
+            bins.insert( pair<uint32_t, BaiAlignmentChunkVector>(binId, shardChunks) );
+            return;
+        }
+
+        // otherwise, widen offset span & sum counts
+        BaiAlignmentChunkVector& metaChunks = (*binIter).second;
+        metaChunks[0].Start = min(metaChunks[0].Start, shardChunks[0].Start);
+        metaChunks[0].Stop  = max(metaChunks[0].Stop,  shardChunks[0].Stop);
+        metaChunks[1].Start += shardChunks[1].Start;
+        metaChunks[1].Stop  += shardChunks[1].Stop;
+        return;
+    }
+
+    // otherwise append shifted chunks to merged bin
+    BaiAlignmentChunkVector& binChunks = bins[binId];
+    BaiAlignmentChunkVector::const_iterator chunkIter = shardChunks.begin();
+    BaiAlignmentChunkVector::const_iterator chunkEnd  = shardChunks.end();
+    for ( ; chunkIter != chunkEnd; ++chunkIter ) {
+        firstChunkStart = min(firstChunkStart, (*chunkIter).Start);
+        binChunks.push_back( BaiAlignmentChunk((*chunkIter).Start + shift, (*chunkIter).Stop + shift) );
+    }
+}
+
+// folds shard's index data into merged data, returns compressed offset (within shard) of its
+// first indexed data block, or -1 if shard has no indexed alignments
+int64_t BamStandardIndex::MergeIndexFile(const string& filename,
+                                         const int64_t& offset,
+                                         vector<BaiReferenceEntry>& mergedEntries)
+{
+    // open shard's index file & validate format
+    OpenFile(filename, IBamIODevice::ReadOnly);
+    CheckMagicNumber();
+
+    // shard must describe same reference sequences as merged BAM file
+    int numReferences;
+    ReadNumReferences(numReferences);
+    if ( numReferences != (int)mergedEntries.size() ) {
+        const string message = string("reference count mismatch in index file: ") + filename;
+        throw BamException("BamStandardIndex::MergeIndexFile", message);
+    }
+
+    // virtual offsets store the compressed offset in upper 48 bits
+    const uint64_t shift = ((uint64_t)offset) << 16;
+
+    // iterate over reference entries
+    uint32_t binId;
+    int32_t numAlignmentChunks;
+    uint64_t firstChunkStart = (uint64_t)-1;
+    for ( int i = 0; i < numReferences; ++i ) {
+        BaiReferenceEntry& mergedEntry = mergedEntries.at(i);
+
+        // merge bins
+        int numBins;
+        ReadNumBins(numBins);
+        for ( int j = 0; j < numBins; ++j ) {
+            ReadBinIntoBuffer(binId, numAlignmentChunks);
+            MergeBin(mergedEntry.Bins, binId, numAlignmentChunks, shift, firstChunkStart);
+        }
+
+        // merge linear offsets
+        int numLinearOffsets;
+        ReadNumLinearOffsets(numLinearOffsets);
+        MergeLinearOffsets(mergedEntry.LinearOffsets, numLinearOffsets, shift);
+    }
+
+    // close shard's index file
+    CloseFile();
+    return ( firstChunkStart == (uint64_t)-1 ? -1 : (int64_t)(firstChunkStart >> 16) );
+}
+
+void BamStandardIndex::MergeLinearOffsets(BaiLinearOffsetVector& linearOffsets,
+                                          const int& numLinearOffsets,
+                                          const uint64_t& shift)
+{
+    // resize vector if necessary
+    if ( (int)linearOffsets.size() < numLinearOffsets )
+        linearOffsets.resize(numLinearOffsets, 0);
+
+    // keep the smallest (shifted) offset per window, 0 still marks an empty window
+    uint64_t linearOffset;
+    for ( int i = 0; i < numLinearOffsets; ++i ) {
+        ReadLinearOffset(linearOffset);
+        if ( linearOffset == 0 )
+            continue;
+        linearOffset += shift;
+        if ( linearOffsets[i] == 0 || linearOffset < linearOffsets[i] )
+            linearOffsets[i] = linearOffset;
+    }
+}
+
 void BamStandardIndex::OpenFile(const std::string& filename, IBamIODevice::OpenMode mode) {
 
     // make sure any previous index file is closed
@@ -864,9 +1094,6 @@ void BamStandardIndex::WriteAlignmentChunk(const BaiAlignmentChunk& chunk) {
 
 void BamStandardIndex::WriteAlignmentChunks(BaiAlignmentChunkVector& chunks) {
 
-    // make sure chunks are merged (simplified) before writing & saving summary
-    MergeAlignmentChunks(chunks);
-
     // write chunks
     int32_t chunkCount = chunks.size();
     if ( m_isBigEndian ) SwapEndian_32(chunkCount);
@@ -890,6 +1117,11 @@ void BamStandardIndex::WriteBin(const uint32_t& binId, BaiAlignmentChunkVector&
     if ( numBytesWritten != sizeof(binKey) )
         throw BamException("BamStandardIndex::WriteBin", "could not write bin ID");
 
+    // make sure chunks are merged (simplified) before writing & saving summary
+    // (metadata pseudo-bin holds counts, not offsets - so leave it alone)
+    if ( binId != (uint32_t)BamStandardIndex::MAX_BIN )
+        MergeAlignmentChunks(chunks);
+
     // write bin's alignment chunks
     WriteAlignmentChunks(chunks);
 }
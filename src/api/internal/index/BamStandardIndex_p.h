@@ -124,6 +124,11 @@ class BamStandardIndex : public BamIndex {
         // loads existing data from file into memory
         bool Load(const std::string& filename);
         BamIndex::IndexType Type(void) const { return BamIndex::STANDARD; }
+    public:
+        // builds index for associated BAM file by merging existing index files of its shards
+        //   * @offsets are the compressed byte offsets at which each shard landed in the BAM file
+        bool Merge(const std::vector<std::string>& indexFilenames,
+                   const std::vector<int64_t>& offsets);
     public:
         // returns format's file extension
         static const std::string Extension(void);
@@ -184,6 +189,19 @@ class BamStandardIndex : public BamIndex {
         void ReadNumLinearOffsets(int& numLinearOffsets);
         void ReadNumReferences(int& numReferences);
 
+        // BAI index merging methods
+        void MergeBin(BaiBinMap& bins,
+                      const uint32_t& binId,
+                      const int32_t& numAlignmentChunks,
+                      const uint64_t& shift,
+                      uint64_t& firstChunkStart);
+        int64_t MergeIndexFile(const std::string& filename,
+                               const int64_t& offset,
+                               std::vector<BaiReferenceEntry>& mergedEntries);
+        void MergeLinearOffsets(BaiLinearOffsetVector& linearOffsets,
+                                const int& numLinearOffsets,
+                                const uint64_t& shift);
+
         // BAI full index output methods
         void MergeAlignmentChunks(BaiAlignmentChunkVector& chunks);
         void SortLinearOffsets(BaiLinearOffsetVector& linearOffsets);
@@ -289,56 +289,33 @@ void BamToolsIndex::GetOffset(const BamRegion& region, int64_t& offset, bool* ha
     BtiReferenceEntry refEntry(region.LeftRefID);
     ReadReferenceEntry(refEntry);
 
-    // binary search for an overlapping block (may not be first one though)
+    // find first block holding an alignment that reaches into the region
+    //
+    // N.B. - block max end positions are not ordered (e.g. a block holding a spliced alignment
+    //        may reach far beyond its successors), so neither a binary search over them nor a
+    //        walk back that stops at the first non-overlapping block finds it reliably. The
+    //        reference's blocks are all in memory already, so a linear scan is cheap.
+    const bool isRightBoundHere = ( region.isRightBoundSpecified() && region.RightRefID == region.LeftRefID );
     bool found = false;
-    typedef BtiBlockVector::const_iterator BtiBlockConstIterator;
-    BtiBlockConstIterator blockFirst = refEntry.Blocks.begin();
-    BtiBlockConstIterator blockIter  = blockFirst;
-    BtiBlockConstIterator blockLast  = refEntry.Blocks.end();
-    iterator_traits<BtiBlockConstIterator>::difference_type count = distance(blockFirst, blockLast);
-    iterator_traits<BtiBlockConstIterator>::difference_type step;
-    while ( count > 0 ) {
-        blockIter = blockFirst;
-        step = count/2;
-        advance(blockIter, step);
-
+    BtiBlockVector::const_iterator blockIter = refEntry.Blocks.begin();
+    BtiBlockVector::const_iterator blockEnd  = refEntry.Blocks.end();
+    for ( ; blockIter != blockEnd; ++blockIter ) {
         const BtiBlock& block = (*blockIter);
-        if ( block.StartPosition <= region.RightPosition ) {
-            if ( block.MaxEndPosition > region.LeftPosition ) {
+        if ( block.MaxEndPosition > region.LeftPosition ) {
+            if ( !isRightBoundHere || block.StartPosition <= region.RightPosition ) {
                 offset = block.StartOffset;
-                break;
-            }
-            blockFirst = ++blockIter;
-            count -= step+1;
-        }
-        else count = step;
-    }
-
-    // if we didn't search "off the end" of the blocks
-    if ( blockIter != blockLast ) {
-
-        // "walk back" until we've gone too far
-        while ( blockIter != blockFirst ) {
-            const BtiBlock& currentBlock = (*blockIter);
-
-            --blockIter;
-            const BtiBlock& previousBlock = (*blockIter);
-            if ( previousBlock.MaxEndPosition <= region.LeftPosition ) {
-                offset = currentBlock.StartOffset;
                 found = true;
-                break;
             }
-        }
-
-        // if we walked all the way to first block, just return that and let the reader's
-        // region overlap parsing do the rest
-        if ( blockIter == blockFirst ) {
-            const BtiBlock& block = (*blockIter);
-            offset = block.StartOffset;
-            found = true;
+            break;
         }
     }
 
+    // if region continues onto later references, start from this reference's last block
+    // & let the reader's region overlap parsing do the rest
+    if ( !found && !isRightBoundHere && !refEntry.Blocks.empty() ) {
+        offset = refEntry.Blocks.back().StartOffset;
+        found = true;
+    }
 
     // sets to false if blocks container is empty, or if no matching block could be found
     *hasAlignmentsInRegion = found;
@@ -479,6 +456,139 @@ void BamToolsIndex::LoadReferenceSummary(BtiReferenceSummary& refSummary) {
     SkipBlocks(numBlocks);
 }
 
+// builds index for associated BAM file by merging existing index files of its shards
+//   * @offsets are the compressed byte offsets at which each shard landed in the BAM file
+//   * shards are expected to be coordinate-disjoint (e.g. concatenated sorted shards)
+bool BamToolsIndex::Merge(const vector<string>& indexFilenames,
+                          const vector<int64_t>& offsets)
+{
+    // skip if BamReader is invalid or not open
+    if ( m_reader == 0 || !m_reader->IsOpen() ) {
+        SetErrorString("BamToolsIndex::Merge", "could not merge index: reader is not open");
+        return false;
+    }
+
+    // make sure we have an offset for each shard
+    if ( indexFilenames.size() != offsets.size() ) {
+        SetErrorString("BamToolsIndex::Merge", "could not merge index: each index file requires an offset");
+        return false;
+    }
+
+    // visit shards in the order they appear in the BAM file
+    // (keeps each reference's blocks sorted by position)
+    vector< pair<int64_t, size_t> > shardOrder;
+    shardOrder.reserve(offsets.size());
+    for ( size_t i = 0; i < offsets.size(); ++i )
+        shardOrder.push_back( make_pair(offsets.at(i), i) );
+    sort( shardOrder.begin(), shardOrder.end() );
+
+    try {
+
+        // initialize merged data with an (empty) entry for each reference
+        const int& numReferences = m_reader->GetReferenceCount();
+        vector<BtiReferenceEntry> mergedEntries;
+        mergedEntries.reserve(numReferences);
+        for ( int i = 0; i < numReferences; ++i )
+            mergedEntries.push_back( BtiReferenceEntry(i) );
+
+        // fold each shard's index data into merged data
+        // (block size is taken from the first shard)
+        uint32_t blockSize = m_blockSize;
+        vector<int64_t> firstBlockOffsets;
+        vector< pair<int64_t, size_t> >::const_iterator shardIter = shardOrder.begin();
+        vector< pair<int64_t, size_t> >::const_iterator shardEnd  = shardOrder.end();
+        for ( ; shardIter != shardEnd; ++shardIter ) {
+            const int64_t firstBlockOffset = MergeIndexFile(indexFilenames.at((*shardIter).second),
+                                                            (*shardIter).first,
+                                                            mergedEntries);
+            if ( firstBlockOffset >= 0 )
+                firstBlockOffsets.push_back( (*shardIter).first + firstBlockOffset );
+            if ( shardIter == shardOrder.begin() )
+                blockSize = m_blockSize;
+        }
+        m_blockSize = blockSize;
+
+        // make sure offsets fit the BAM file (each shard's data must land on a BGZF block),
+        // before anything is written
+        try {
+            BgzfStream::CheckFileOffsets(m_reader->Filename(), offsets, firstBlockOffsets);
+        } catch ( BamException& e ) {
+            const string message = string("shard data does not line up with BAM file, check offsets: ") + e.what();
+            throw BamException("BamToolsIndex::Merge", message);
+        }
+
+        // open new index file (read & write)
+        const string indexFilename = m_reader->Filename() + Extension();
+        OpenFile(indexFilename, IBamIODevice::ReadWrite);
+
+        // initialize BtiFileSummary & output file header
+        InitializeFileSummary(numReferences);
+        WriteHeader();
+
+        // write merged reference entries, saving summary data as we go
+        vector<BtiReferenceEntry>::const_iterator entryIter = mergedEntries.begin();
+        vector<BtiReferenceEntry>::const_iterator entryEnd  = mergedEntries.end();
+        for ( ; entryIter != entryEnd; ++entryIter ) {
+            const BtiReferenceEntry& entry = (*entryIter);
+            BtiReferenceSummary& refSummary = m_indexFileSummary.at(entry.ID);
+            refSummary.NumBlocks = entry.Blocks.size();
+            refSummary.FirstBlockFilePosition = Tell() + sizeof(uint32_t);
+            WriteReferenceEntry(entry);
+        }
+
+    } catch ( BamException& e ) {
+        m_errorString = e.what();
+        return false;
+    }
+
+    // return success
+    return true;
+}
+
+// folds shard's index data into merged data, returns compressed offset (within shard) of its
+// first indexed data block, or -1 if shard has no indexed alignments
+int64_t BamToolsIndex::MergeIndexFile(const string& filename,
+                                      const int64_t& offset,
+                                      vector<BtiReferenceEntry>& mergedEntries)
+{
+    // open shard's index file & validate format
+    OpenFile(filename, IBamIODevice::ReadOnly);
+    LoadHeader();
+
+    // shard must describe same reference sequences as merged BAM file
+    int numReferences;
+    LoadNumReferences(numReferences);
+    if ( numReferences != (int)mergedEntries.size() ) {
+        const string message = string("reference count mismatch in index file: ") + filename;
+        throw BamException("BamToolsIndex::MergeIndexFile", message);
+    }
+
+    // virtual offsets store the compressed offset in upper 48 bits
+    const int64_t shift = (int64_t)( ((uint64_t)offset) << 16 );
+
+    // append shard's blocks (shifted to their position in merged BAM file)
+    BtiBlock block;
+    int64_t firstStartOffset = -1;
+    for ( int i = 0; i < numReferences; ++i ) {
+        BtiBlockVector& mergedBlocks = mergedEntries.at(i).Blocks;
+
+        int numBlocks;
+        LoadNumBlocks(numBlocks);
+        mergedBlocks.reserve(mergedBlocks.size() + numBlocks);
+        for ( int j = 0; j < numBlocks; ++j ) {
+            ReadBlock(block);
+            if ( firstStartOffset < 0 || block.StartOffset < firstStartOffset )
+                firstStartOffset = block.StartOffset;
+            block.StartOffset += shift;
+            mergedBlocks.push_back(block);
+        }
+    }
+
+    // close shard's index file
+    CloseFile();
+    return ( firstStartOffset < 0 ? -1 : (firstStartOffset >> 16) );
+}
+
 void BamToolsIndex::OpenFile(const std::string& filename, IBamIODevice::OpenMode mode) {
 
     // make sure any previous index file is closed
@@ -119,6 +119,11 @@ class BamToolsIndex : public BamIndex {
         // loads existing data from file into memory
         bool Load(const std::string& filename);
         BamIndex::IndexType Type(void) const { return BamIndex::BAMTOOLS; }
+    public:
+        // builds index for associated BAM file by merging existing index files of its shards
+        //   * @offsets are the compressed byte offsets at which each shard landed in the BAM file
+        bool Merge(const std::vector<std::string>& indexFilenames,
+                   const std::vector<int64_t>& offsets);
     public:
         // returns format's file extension
         static const std::string Extension(void);
@@ -142,6 +147,11 @@ class BamToolsIndex : public BamIndex {
         void WriteHeader(void);
         void WriteReferenceEntry(const BtiReferenceEntry& refEntry);
 
+        // index-merging methods
+        int64_t MergeIndexFile(const std::string& filename,
+                               const int64_t& offset,
+                               std::vector<BtiReferenceEntry>& mergedEntries);
+
         // random-access methods
         void GetOffset(const BamRegion& region, int64_t& offset, bool* hasAlignmentsInRegion);
         void ReadBlock(BtiBlock& block);
@@ -35,3 +35,15 @@ IBamIODevice* BamDeviceFactory::CreateDevice(const string& source) {
     // otherwise assume a "normal" file
     return new BamFile(source);
 }
+
+void BamDeviceFactory::SetBufferSize(IBamIODevice* device,
+                                     const string& source,
+                                     const size_t numBytes)
+{
+    // skip remote devices, they do their own buffering
+    if ( device == 0 || source.find("http://") == 0 || source.find("ftp://") == 0 )
+        return;
+
+    // otherwise device is a pipe or "normal" file (see CreateDevice())
+    static_cast<ILocalIODevice*>(device)->SetBufferSize(numBytes);
+}
@@ -29,6 +29,10 @@ namespace Internal {
 class BamDeviceFactory {
     public:
         static IBamIODevice* CreateDevice(const std::string& source);
+        // sets the IO buffer size of an (opened) device created from source, if it is buffered
+        static void SetBufferSize(IBamIODevice* device,
+                                  const std::string& source,
+                                  const size_t numBytes);
 };
 
 } // namespace Internal
@@ -35,6 +35,8 @@ BgzfStream::BgzfStream(void)
   , m_blockOffset(0)
   , m_blockAddress(0)
   , m_isWriteCompressed(true)
+  , m_compressionLevel(Z_DEFAULT_COMPRESSION)
+  , m_readBufferSize(0)
   , m_device(0)
   , m_uncompressedBlock(Constants::BGZF_DEFAULT_BLOCK_SIZE)
   , m_compressedBlock(Constants::BGZF_MAX_BLOCK_SIZE)
@@ -57,24 +59,78 @@ bool BgzfStream::CheckBlockHeader(char* header) {
             BamTools::UnpackUnsignedShort(&header[14]) == Constants::BGZF_LEN );
 }
 
+// checks that each of offsets lies within file, & each of blockOffsets starts a BGZF block (throws BamException if not)
+void BgzfStream::CheckFileOffsets(const string& filename,
+                                  const vector<int64_t>& offsets,
+                                  const vector<int64_t>& blockOffsets)
+{
+    // open file
+    IBamIODevice* device = BamDeviceFactory::CreateDevice(filename);
+    if ( device == 0 )
+        throw BamException("BgzfStream::CheckFileOffsets", "could not create IO device for: " + filename);
+    if ( !device->Open(IBamIODevice::ReadOnly) || !device->IsRandomAccess() ) {
+        delete device;
+        throw BamException("BgzfStream::CheckFileOffsets", "could not open " + filename + " for random access");
+    }
+
+    stringstream s("");
+
+    // get file size
+    int64_t fileSize = -1;
+    if ( device->Seek(0, SEEK_END) )
+        fileSize = device->Tell();
+    if ( fileSize < 0 )
+        s << "could not determine size of " << filename;
+
+    // check offsets are within file
+    vector<int64_t>::const_iterator offsetIter = offsets.begin();
+    vector<int64_t>::const_iterator offsetEnd  = offsets.end();
+    for ( ; s.str().empty() && offsetIter != offsetEnd; ++offsetIter ) {
+        if ( (*offsetIter) < 0 || (*offsetIter) >= fileSize )
+            s << "offset " << (*offsetIter) << " is outside of " << filename << " (" << fileSize << " bytes)";
+    }
+
+    // check block offsets point to a BGZF block header
+    char header[Constants::BGZF_BLOCK_HEADER_LENGTH];
+    offsetIter = blockOffsets.begin();
+    offsetEnd  = blockOffsets.end();
+    for ( ; s.str().empty() && offsetIter != offsetEnd; ++offsetIter ) {
+        const int64_t offset = (*offsetIter);
+        if ( offset < 0 || offset >= fileSize ||
+             !device->Seek(offset) ||
+             device->Read(header, Constants::BGZF_BLOCK_HEADER_LENGTH) != (int64_t)Constants::BGZF_BLOCK_HEADER_LENGTH ||
+             !BgzfStream::CheckBlockHeader(header) )
+        {
+            s << "offset " << offset << " is not the start of a BGZF block in " << filename;
+        }
+    }
+
+    // clean up
+    device->Close();
+    delete device;
+    if ( !s.str().empty() )
+        throw BamException("BgzfStream::CheckFileOffsets", s.str());
+}
+
 // closes BGZF file
 void BgzfStream::Close(void) {
 
-    // skip if no device open
-    if ( m_device == 0 ) return;
+    // N.B. - no device open, but a suspended stream still holds block data to reset
+    if ( m_device ) {
 
-    // if writing to file, flush the current BGZF block,
-    // then write an empty block (as EOF marker)
-    if ( m_device->IsOpen() && (m_device->Mode() == IBamIODevice::WriteOnly) ) {
-        FlushBlock();
-        const size_t blockLength = DeflateBlock(0);
-        m_device->Write(m_compressedBlock.Buffer, blockLength);
-    }
+        // if writing to file, flush the current BGZF block,
+        // then write an empty block (as EOF marker)
+        if ( m_device->IsOpen() && (m_device->Mode() == IBamIODevice::WriteOnly) ) {
+            FlushBlock();
+            const size_t blockLength = DeflateBlock(0);
+            m_device->Write(m_compressedBlock.Buffer, blockLength);
+        }
 
-    // close device
-    m_device->Close();
-    delete m_device;
-    m_device = 0;
+        // close device
+        m_device->Close();
+        delete m_device;
+        m_device = 0;
+    }
 
     // ensure our buffers are cleared out
     m_uncompressedBlock.Clear();
@@ -84,14 +140,60 @@ void BgzfStream::Close(void) {
     m_blockLength = 0;
     m_blockOffset = 0;
     m_blockAddress = 0;
-    m_isWriteCompressed = true;
+
+    // N.B. - compression & buffer settings are kept, since Open() calls Close() and
+    //        they must be set before opening
 }
 
 // compresses the current block
 size_t BgzfStream::DeflateBlock(int32_t blockLength) {
 
+    // set compression level
+    const int compressionLevel = ( m_isWriteCompressed ? m_compressionLevel : 0 );
+
+    // loop to retry for blocks that do not compress enough
+    int inputLength = blockLength;
+    size_t compressedLength = 0;
+    while ( true ) {
+        compressedLength = DeflateData(m_uncompressedBlock.Buffer,
+                                       inputLength,
+                                       m_compressedBlock.Buffer,
+                                       compressionLevel);
+        if ( compressedLength > 0 )
+            break;
+
+        // there was not enough space available in buffer
+        // try to reduce the input length & re-start loop
+        inputLength -= 1024;
+        if ( inputLength < 0 )
+            throw BamException("BgzfStream::DeflateBlock", "input reduction failed");
+    }
+
+    // ensure that we have less than a block of data left
+    int remaining = blockLength - inputLength;
+    if ( remaining > 0 ) {
+        if ( remaining > inputLength )
+            throw BamException("BgzfStream::DeflateBlock", "after deflate, remainder too large");
+        memcpy(m_uncompressedBlock.Buffer, m_uncompressedBlock.Buffer + inputLength, remaining);
+    }
+
+    // update block data
+    m_blockOffset = remaining;
+
+    // return result
+    return compressedLength;
+}
+
+// compresses data into a complete BGZF block (header, deflated data, & footer)
+//
+// N.B. - does not touch any stream state, so may be called from any thread
+//      - buffer must hold at least BGZF_MAX_BLOCK_SIZE bytes
+size_t BgzfStream::DeflateData(const char* data,
+                               const size_t dataLength,
+                               char* buffer,
+                               const int compressionLevel)
+{
     // initialize the gzip header
-    char* buffer = m_compressedBlock.Buffer;
     memset(buffer, 0, 18);
     buffer[0]  = Constants::GZIP_ID1;
     buffer[1]  = Constants::GZIP_ID2;
@@ -103,97 +205,74 @@ size_t BgzfStream::DeflateBlock(int32_t blockLength) {
     buffer[13] = Constants::BGZF_ID2;
     buffer[14] = Constants::BGZF_LEN;
 
-    // set compression level
-    const int compressionLevel = ( m_isWriteCompressed ? Z_DEFAULT_COMPRESSION : 0 );
-
-    // loop to retry for blocks that do not compress enough
-    int inputLength = blockLength;
-    size_t compressedLength = 0;
+    // initialize zstream values
     const unsigned int bufferSize = Constants::BGZF_MAX_BLOCK_SIZE;
+    z_stream zs;
+    zs.zalloc    = NULL;
+    zs.zfree     = NULL;
+    zs.next_in   = (Bytef*)data;
+    zs.avail_in  = dataLength;
+    zs.next_out  = (Bytef*)&buffer[Constants::BGZF_BLOCK_HEADER_LENGTH];
+    zs.avail_out = bufferSize -
+                   Constants::BGZF_BLOCK_HEADER_LENGTH -
+                   Constants::BGZF_BLOCK_FOOTER_LENGTH;
+
+    // initialize the zlib compression algorithm
+    int status = deflateInit2(&zs,
+                              compressionLevel,
+                              Z_DEFLATED,
+                              Constants::GZIP_WINDOW_BITS,
+                              Constants::Z_DEFAULT_MEM_LEVEL,
+                              Z_DEFAULT_STRATEGY);
+    if ( status != Z_OK )
+        throw BamException("BgzfStream::DeflateBlock", "zlib deflateInit2 failed");
 
-    while ( true ) {
+    // compress the data
+    status = deflate(&zs, Z_FINISH);
 
-        // initialize zstream values
-        z_stream zs;
-        zs.zalloc    = NULL;
-        zs.zfree     = NULL;
-        zs.next_in   = (Bytef*)m_uncompressedBlock.Buffer;
-        zs.avail_in  = inputLength;
-        zs.next_out  = (Bytef*)&buffer[Constants::BGZF_BLOCK_HEADER_LENGTH];
-        zs.avail_out = bufferSize -
-                       Constants::BGZF_BLOCK_HEADER_LENGTH -
-                       Constants::BGZF_BLOCK_FOOTER_LENGTH;
-
-        // initialize the zlib compression algorithm
-        int status = deflateInit2(&zs,
-                                  compressionLevel,
-                                  Z_DEFLATED,
-                                  Constants::GZIP_WINDOW_BITS,
-                                  Constants::Z_DEFAULT_MEM_LEVEL,
-                                  Z_DEFAULT_STRATEGY);
-        if ( status != Z_OK )
-            throw BamException("BgzfStream::DeflateBlock", "zlib deflateInit2 failed");
-
-        // compress the data
-        status = deflate(&zs, Z_FINISH);
-
-        // if not at stream end
-        if ( status != Z_STREAM_END ) {
-
-            deflateEnd(&zs);
-
-            // there was not enough space available in buffer
-            // try to reduce the input length & re-start loop
-            if ( status == Z_OK ) {
-                inputLength -= 1024;
-                if ( inputLength < 0 )
-                    throw BamException("BgzfStream::DeflateBlock", "input reduction failed");
-                continue;
-            }
-
-            throw BamException("BgzfStream::DeflateBlock", "zlib deflate failed");
-        }
+    // if not at stream end
+    if ( status != Z_STREAM_END ) {
 
-        // finalize the compression routine
-        status = deflateEnd(&zs);
-        if ( status != Z_OK )
-            throw BamException("BgzfStream::DeflateBlock", "zlib deflateEnd failed");
+        deflateEnd(&zs);
 
-        // update compressedLength
-        compressedLength = zs.total_out +
-                           Constants::BGZF_BLOCK_HEADER_LENGTH +
-                           Constants::BGZF_BLOCK_FOOTER_LENGTH;
-        if ( compressedLength > Constants::BGZF_MAX_BLOCK_SIZE )
-            throw BamException("BgzfStream::DeflateBlock", "deflate overflow");
+        // there was not enough space available in buffer
+        if ( status == Z_OK )
+            return 0;
 
-        // quit while loop
-        break;
+        throw BamException("BgzfStream::DeflateBlock", "zlib deflate failed");
     }
 
+    // finalize the compression routine
+    status = deflateEnd(&zs);
+    if ( status != Z_OK )
+        throw BamException("BgzfStream::DeflateBlock", "zlib deflateEnd failed");
+
+    // determine compressedLength
+    const size_t compressedLength = zs.total_out +
+                                    Constants::BGZF_BLOCK_HEADER_LENGTH +
+                                    Constants::BGZF_BLOCK_FOOTER_LENGTH;
+    if ( compressedLength > Constants::BGZF_MAX_BLOCK_SIZE )
+        throw BamException("BgzfStream::DeflateBlock", "deflate overflow");
+
     // store the compressed length
     BamTools::PackUnsignedShort(&buffer[16], static_cast<uint16_t>(compressedLength - 1));
 
     // store the CRC32 checksum
     uint32_t crc = crc32(0, NULL, 0);
-    crc = crc32(crc, (Bytef*)m_uncompressedBlock.Buffer, inputLength);
+    crc = crc32(crc, (Bytef*)data, dataLength);
     BamTools::PackUnsignedInt(&buffer[compressedLength - 8], crc);
-    BamTools::PackUnsignedInt(&buffer[compressedLength - 4], inputLength);
-
-    // ensure that we have less than a block of data left
-    int remaining = blockLength - inputLength;
-    if ( remaining > 0 ) {
-        if ( remaining > inputLength )
-            throw BamException("BgzfStream::DeflateBlock", "after deflate, remainder too large");
-        memcpy(m_uncompressedBlock.Buffer, m_uncompressedBlock.Buffer + inputLength, remaining);
-    }
-
-    // update block data
-    m_blockOffset = remaining;
+    BamTools::PackUnsignedInt(&buffer[compressedLength - 4], dataLength);
 
     // return result
     return compressedLength;
 }
 
+// writes out any buffered data, so that subsequent data starts a new BGZF block
+void BgzfStream::Flush(void) {
+    if ( m_device && m_device->IsOpen() && (m_device->Mode() == IBamIODevice::WriteOnly) )
+        FlushBlock();
+}
+
 // flushes the data in the BGZF block
 void BgzfStream::FlushBlock(void) {
 
@@ -284,6 +363,10 @@ void BgzfStream::Open(const string& filename, const IBamIODevice::OpenMode mode)
         const string message = string("could not open BGZF stream: \n\t") + deviceError;
         throw BamException("BgzfStream::Open", message);
     }
+
+    // apply custom read buffer size, before any data is read
+    if ( mode == IBamIODevice::ReadOnly && m_readBufferSize > 0 )
+        BamDeviceFactory::SetBufferSize(m_device, filename, m_readBufferSize);
 }
 
 // reads BGZF data into a byte buffer
@@ -394,6 +477,33 @@ void BgzfStream::ReadBlock(void) {
     m_blockLength  = newBlockLength;
 }
 
+// re-opens IO device after Suspend(), so that reading continues with the
+// current (already decompressed) block data
+void BgzfStream::Resume(const string& filename, const int64_t& nextBlockPosition) {
+
+    BT_ASSERT_X( (m_device == 0), "BgzfStream::Resume() - IO device is already open" );
+
+    // retrieve new IO device depending on filename
+    m_device = BamDeviceFactory::CreateDevice(filename);
+    BT_ASSERT_X( m_device, "BgzfStream::Resume() - unable to create IO device from filename" );
+
+    // if device fails to open
+    if ( !m_device->Open(IBamIODevice::ReadOnly) ) {
+        const string deviceError = m_device->GetErrorString();
+        const string message = string("could not re-open BGZF stream: \n\t") + deviceError;
+        throw BamException("BgzfStream::Resume", message);
+    }
+    if ( m_readBufferSize > 0 )
+        BamDeviceFactory::SetBufferSize(m_device, filename, m_readBufferSize);
+
+    // restore device position, following current block
+    if ( !m_device->Seek(nextBlockPosition) ) {
+        stringstream s("");
+        s << "unable to seek to position: " << nextBlockPosition;
+        throw BamException("BgzfStream::Resume", s.str());
+    }
+}
+
 // seek to position in BGZF file
 void BgzfStream::Seek(const int64_t& position) {
 
@@ -421,10 +531,34 @@ void BgzfStream::Seek(const int64_t& position) {
     }
 }
 
+void BgzfStream::SetCompressionLevel(const int level) {
+    m_compressionLevel = level;
+}
+
+void BgzfStream::SetReadBufferSize(const size_t numBytes) {
+    m_readBufferSize = numBytes;
+}
+
 void BgzfStream::SetWriteCompressed(bool ok) {
     m_isWriteCompressed = ok;
 }
 
+// closes read-only IO device, but keeps current block data & position (so
+// no re-inflating is needed on Resume)
+//
+// returns device position of the next BGZF block
+int64_t BgzfStream::Suspend(void) {
+
+    BT_ASSERT_X( m_device, "BgzfStream::Suspend() - trying to suspend null IO device");
+    BT_ASSERT_X( (m_device->Mode() == IBamIODevice::ReadOnly), "BgzfStream::Suspend() - device is not read-only");
+
+    const int64_t nextBlockPosition = m_device->Tell();
+    m_device->Close();
+    delete m_device;
+    m_device = 0;
+    return nextBlockPosition;
+}
+
 // get file position in BGZF file
 int64_t BgzfStream::Tell(void) const {
     if ( !IsOpen() )
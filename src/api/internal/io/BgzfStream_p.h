@@ -26,6 +26,7 @@
 #include "api/BamAux.h"
 #include "api/IBamIODevice.h"
 #include <string>
+#include <vector>
 
 namespace BamTools {
 namespace Internal {
@@ -41,18 +42,28 @@ class BgzfStream {
     public:
         // closes BGZF file
         void Close(void);
+        // compresses & writes any buffered output, so the next write starts a new BGZF block
+        void Flush(void);
         // returns true if BgzfStream open for IO
         bool IsOpen(void) const;
         // opens the BGZF file
         void Open(const std::string& filename, const IBamIODevice::OpenMode mode);
         // reads BGZF data into a byte buffer
         size_t Read(char* data, const size_t dataLength);
+        // re-opens a suspended BGZF file for reading
+        void Resume(const std::string& filename, const int64_t& nextBlockPosition);
         // seek to position in BGZF file
         void Seek(const int64_t& position);
         // sets IO device (closes previous, if any, but does not attempt to open)
         void SetIODevice(IBamIODevice* device);
+        // sets zlib compression level for compressed output
+        void SetCompressionLevel(const int level);
+        // sets device buffer size for reading (0 = device default), applied on (re-)opening
+        void SetReadBufferSize(const size_t numBytes);
         // enable/disable compressed output
         void SetWriteCompressed(bool ok);
+        // closes IO device, keeping current block data
+        int64_t Suspend(void);
         // get file position in BGZF file
         int64_t Tell(void) const;
         // writes the supplied data into the BGZF buffer
@@ -73,6 +84,15 @@ class BgzfStream {
     public:
         // checks BGZF block header
         static bool CheckBlockHeader(char* header);
+        // checks that each of offsets lies within file, & each of blockOffsets starts a BGZF block (throws BamException if not)
+        static void CheckFileOffsets(const std::string& filename,
+                                     const std::vector<int64_t>& offsets,
+                                     const std::vector<int64_t>& blockOffsets);
+        // compresses data into a complete BGZF block, returns its length (0 if it would exceed max block size)
+        static size_t DeflateData(const char* data,
+                                  const size_t dataLength,
+                                  char* buffer,
+                                  const int compressionLevel);
 
     // data members
     public:
@@ -81,6 +101,8 @@ class BgzfStream {
         int64_t m_blockAddress;
 
         bool m_isWriteCompressed;
+        int  m_compressionLevel;
+        size_t m_readBufferSize;
         IBamIODevice* m_device;
 
         RaiiBuffer m_uncompressedBlock;
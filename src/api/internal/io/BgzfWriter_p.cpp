@@ -0,0 +1,318 @@
+// ***************************************************************************
+// BgzfWriter_p.cpp (c) 2026
+// Marth Lab, Department of Biology, Boston College
+// ---------------------------------------------------------------------------
+// Last modified: 17 October 2026
+// ---------------------------------------------------------------------------
+// Provides BGZF compression of arbitrary data, with optional worker threads
+// ***************************************************************************
+
+#include "api/BamConstants.h"
+#include "api/internal/io/BamDeviceFactory_p.h"
+#include "api/internal/io/BgzfStream_p.h"
+#include "api/internal/io/BgzfWriter_p.h"
+#include "api/internal/utils/BamException_p.h"
+using namespace BamTools;
+using namespace BamTools::Internal;
+
+#include "zlib.h"
+
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+using namespace std;
+
+// uncompressed data per block
+// N.B. - slightly below BGZF_MAX_BLOCK_SIZE, so that even incompressible data
+//        (plus block header & footer) always fits into a single block
+static const size_t BGZF_WRITER_BLOCK_SIZE = 0xff00;
+
+// number of blocks compressing (or waiting to be written), per worker thread
+static const size_t BGZF_WRITER_BLOCKS_PER_THREAD = 4;
+
+// ---------------------------------------------
+// DeflateThread implementation
+
+class BgzfWriterPrivate::DeflateThread : public BamThread {
+
+    public:
+        explicit DeflateThread(BgzfWriterPrivate* writer)
+            : BamThread()
+            , m_writer(writer)
+        { }
+
+        ~DeflateThread(void) {
+            Wait();
+        }
+
+    protected:
+        void Run(void) {
+            m_writer->RunWorker();
+        }
+
+    private:
+        BgzfWriterPrivate* m_writer;
+};
+
+// ---------------------------------------------
+// BgzfWriterPrivate implementation
+
+BgzfWriterPrivate::BgzfWriterPrivate(void)
+    : m_device(0)
+    , m_compressionLevel(Z_DEFAULT_COMPRESSION)
+    , m_numThreads(1)
+    , m_numSubmitted(0)
+    , m_numWritten(0)
+    , m_isStopping(false)
+{ }
+
+BgzfWriterPrivate::~BgzfWriterPrivate(void) {
+    Close();
+}
+
+// writes all remaining data, followed by an empty block (as EOF marker), & closes device
+bool BgzfWriterPrivate::Close(void) {
+
+    // skip if not open
+    if ( m_device == 0 )
+        return true;
+
+    bool result = true;
+    try {
+
+        // compress & write all remaining blocks
+        if ( m_blocks[m_numSubmitted % m_blocks.size()].DataLength > 0 )
+            SubmitBlock();
+        while ( m_numWritten < m_numSubmitted )
+            WriteNextBlock();
+
+        // write EOF block
+        Block& block = m_blocks[m_numSubmitted % m_blocks.size()];
+        DeflateBlock(block);
+        if ( m_device->Write(&block.Compressed[0], block.CompressedLength) != (int64_t)block.CompressedLength )
+            throw BamException("BgzfWriter::Close", "could not write EOF block: " + m_device->GetErrorString());
+
+    } catch ( BamException& e ) {
+        m_errorString = e.what();
+        result = false;
+    }
+
+    StopThreads();
+
+    // close device
+    m_device->Close();
+    delete m_device;
+    m_device = 0;
+
+    // reset state
+    m_blocks.clear();
+    m_numSubmitted = 0;
+    m_numWritten = 0;
+    return result;
+}
+
+// compresses block data (safe to call from any thread)
+void BgzfWriterPrivate::DeflateBlock(Block& block) const {
+
+    block.Compressed.resize(Constants::BGZF_MAX_BLOCK_SIZE);
+    block.CompressedLength = BgzfStream::DeflateData( (block.DataLength > 0 ? &block.Data[0] : 0),
+                                                      block.DataLength,
+                                                      &block.Compressed[0],
+                                                      m_compressionLevel );
+    if ( block.CompressedLength == 0 )
+        throw BamException("BgzfWriter::DeflateBlock", "compressed data does not fit into BGZF block");
+}
+
+string BgzfWriterPrivate::GetErrorString(void) const {
+    return m_errorString;
+}
+
+bool BgzfWriterPrivate::IsOpen(void) const {
+    return ( m_device != 0 && m_device->IsOpen() );
+}
+
+bool BgzfWriterPrivate::Open(const string& filename) {
+
+    // close any previous file
+    Close();
+
+    // create & open device
+    m_device = BamDeviceFactory::CreateDevice(filename);
+    if ( m_device == 0 ) {
+        m_errorString = "BgzfWriter::Open: could not create IO device for: " + filename;
+        return false;
+    }
+    if ( !m_device->Open(IBamIODevice::WriteOnly) ) {
+        m_errorString = "BgzfWriter::Open: could not open " + filename + ": \n\t" + m_device->GetErrorString();
+        delete m_device;
+        m_device = 0;
+        return false;
+    }
+
+    // set up block slots & worker threads
+    m_blocks.clear();
+    m_blocks.resize( m_numThreads > 1 ? m_numThreads * BGZF_WRITER_BLOCKS_PER_THREAD : 1 );
+    for ( size_t i = 0; i < m_blocks.size(); ++i )
+        m_blocks[i].Data.resize(BGZF_WRITER_BLOCK_SIZE);
+    m_numSubmitted = 0;
+    m_numWritten = 0;
+    StartThreads();
+    return true;
+}
+
+// compresses queued blocks, until stopped
+void BgzfWriterPrivate::RunWorker(void) {
+
+    while ( true ) {
+
+        // wait for next block
+        Block* block = 0;
+        {
+            BamMutexLocker locker(m_mutex);
+            while ( m_queue.empty() && !m_isStopping )
+                m_blockAvailable.Wait(m_mutex);
+            if ( m_queue.empty() )
+                return;
+            block = m_queue.front();
+            m_queue.pop_front();
+        }
+
+        // compress (without holding lock)
+        string errorString;
+        try {
+            DeflateBlock(*block);
+        } catch ( BamException& e ) {
+            errorString = e.what();
+        }
+
+        // notify writer
+        BamMutexLocker locker(m_mutex);
+        block->ErrorString = errorString;
+        block->IsDone = true;
+        m_blockFinished.WakeAll();
+    }
+}
+
+void BgzfWriterPrivate::SetCompressionLevel(const int level) {
+    m_compressionLevel = level;
+}
+
+void BgzfWriterPrivate::SetNumThreads(const unsigned int numThreads) {
+    m_numThreads = ( numThreads > 1 ? numThreads : 1 );
+}
+
+void BgzfWriterPrivate::StartThreads(void) {
+
+    if ( m_numThreads <= 1 )
+        return;
+
+    m_isStopping = false;
+    for ( unsigned int i = 0; i < m_numThreads; ++i ) {
+        DeflateThread* thread = new DeflateThread(this);
+        if ( !thread->Start() ) {
+            delete thread;
+            break;
+        }
+        m_threads.push_back(thread);
+    }
+
+    // if no worker could be started, blocks are compressed on the caller's thread
+}
+
+void BgzfWriterPrivate::StopThreads(void) {
+
+    // let workers drain queue & exit
+    {
+        BamMutexLocker locker(m_mutex);
+        m_isStopping = true;
+        m_blockAvailable.WakeAll();
+    }
+
+    for ( size_t i = 0; i < m_threads.size(); ++i )
+        delete m_threads[i];
+    m_threads.clear();
+    m_queue.clear();
+}
+
+// hands current block over for compression, making sure the next slot is free to fill
+void BgzfWriterPrivate::SubmitBlock(void) {
+
+    Block& block = m_blocks[m_numSubmitted % m_blocks.size()];
+
+    // no workers, compress here
+    if ( m_threads.empty() ) {
+        DeflateBlock(block);
+        block.IsDone = true;
+    }
+
+    // else queue for workers
+    else {
+        BamMutexLocker locker(m_mutex);
+        block.IsDone = false;
+        block.ErrorString.clear();
+        m_queue.push_back(&block);
+        m_blockAvailable.WakeOne();
+    }
+    ++m_numSubmitted;
+
+    // if all slots in use, write out oldest block
+    if ( m_numSubmitted - m_numWritten == m_blocks.size() )
+        WriteNextBlock();
+}
+
+bool BgzfWriterPrivate::Write(const char* data, const size_t dataLength) {
+
+    if ( !IsOpen() ) {
+        m_errorString = "BgzfWriter::Write: file not open for writing";
+        return false;
+    }
+
+    try {
+        size_t numBytesWritten = 0;
+        while ( numBytesWritten < dataLength ) {
+
+            // copy as much data as fits into current block
+            Block& block = m_blocks[m_numSubmitted % m_blocks.size()];
+            const size_t copyLength = std::min(BGZF_WRITER_BLOCK_SIZE - block.DataLength,
+                                               dataLength - numBytesWritten);
+            memcpy(&block.Data[block.DataLength], data + numBytesWritten, copyLength);
+            block.DataLength += copyLength;
+            numBytesWritten  += copyLength;
+
+            // submit block if full
+            if ( block.DataLength == BGZF_WRITER_BLOCK_SIZE )
+                SubmitBlock();
+        }
+        return true;
+
+    } catch ( BamException& e ) {
+        m_errorString = e.what();
+        return false;
+    }
+}
+
+// waits for oldest submitted block & writes it to device
+void BgzfWriterPrivate::WriteNextBlock(void) {
+
+    Block& block = m_blocks[m_numWritten % m_blocks.size()];
+    {
+        BamMutexLocker locker(m_mutex);
+        while ( !block.IsDone )
+            m_blockFinished.Wait(m_mutex);
+    }
+    if ( !block.ErrorString.empty() )
+        throw BamException("BgzfWriter::WriteNextBlock", block.ErrorString);
+
+    // write compressed data
+    const int64_t numBytesWritten = m_device->Write(&block.Compressed[0], block.CompressedLength);
+    if ( numBytesWritten != (int64_t)block.CompressedLength ) {
+        stringstream s("");
+        s << "expected to write " << block.CompressedLength
+          << " bytes, but wrote " << numBytesWritten << ": " << m_device->GetErrorString();
+        throw BamException("BgzfWriter::WriteNextBlock", s.str());
+    }
+
+    // free slot
+    block.DataLength = 0;
+    ++m_numWritten;
+}
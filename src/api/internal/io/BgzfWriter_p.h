@@ -0,0 +1,103 @@
+// ***************************************************************************
+// BgzfWriter_p.h (c) 2026
+// Marth Lab, Department of Biology, Boston College
+// ---------------------------------------------------------------------------
+// Last modified: 17 October 2026
+// ---------------------------------------------------------------------------
+// Provides BGZF compression of arbitrary data, with optional worker threads
+// ***************************************************************************
+
+#ifndef BGZFWRITER_P_H
+#define BGZFWRITER_P_H
+
+//  -------------
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the BamTools API.  It exists purely as an
+// implementation detail. This header file may change from version to version
+// without notice, or even be removed.
+//
+// We mean it.
+
+#include "api/IBamIODevice.h"
+#include "api/internal/utils/BamThread_p.h"
+#include <deque>
+#include <string>
+#include <vector>
+
+namespace BamTools {
+namespace Internal {
+
+class BgzfWriterPrivate {
+
+    // ctor & dtor
+    public:
+        BgzfWriterPrivate(void);
+        ~BgzfWriterPrivate(void);
+
+    // interface methods
+    public:
+        bool Close(void);
+        std::string GetErrorString(void) const;
+        bool IsOpen(void) const;
+        bool Open(const std::string& filename);
+        void SetCompressionLevel(const int level);
+        void SetNumThreads(const unsigned int numThreads);
+        bool Write(const char* data, const size_t dataLength);
+
+    // internal types
+    private:
+        struct Block {
+            std::vector<char> Data;
+            size_t DataLength;
+            std::vector<char> Compressed;
+            size_t CompressedLength;
+            bool IsDone;
+            std::string ErrorString;
+
+            Block(void)
+                : DataLength(0)
+                , CompressedLength(0)
+                , IsDone(false)
+            { }
+        };
+
+        class DeflateThread;
+
+    // internal methods
+    private:
+        void DeflateBlock(Block& block) const;
+        void RunWorker(void);
+        void StartThreads(void);
+        void StopThreads(void);
+        void SubmitBlock(void);
+        void WriteNextBlock(void);
+
+    // data members
+    private:
+        IBamIODevice* m_device;
+        int m_compressionLevel;
+        unsigned int m_numThreads;
+        std::string m_errorString;
+
+        // blocks are re-used, cycling through a fixed number of slots:
+        // (m_numWritten <= slot index < m_numSubmitted) are compressing or waiting to be written,
+        // slot (m_numSubmitted) is being filled
+        std::vector<Block> m_blocks;
+        size_t m_numSubmitted;
+        size_t m_numWritten;
+
+        // worker state (guarded by m_mutex)
+        BamMutex m_mutex;
+        BamWaitCondition m_blockAvailable;
+        BamWaitCondition m_blockFinished;
+        std::deque<Block*> m_queue;
+        bool m_isStopping;
+        std::vector<DeflateThread*> m_threads;
+};
+
+} // namespace Internal
+} // namespace BamTools
+
+#endif // BGZFWRITER_P_H
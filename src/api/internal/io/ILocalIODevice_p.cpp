@@ -44,6 +44,12 @@ int64_t ILocalIODevice::Read(char* data, const unsigned int numBytes) {
     return static_cast<int64_t>( fread(data, sizeof(char), numBytes, m_stream) );
 }
 
+void ILocalIODevice::SetBufferSize(const size_t numBytes) {
+    // let stdio allocate a (fully-buffered) buffer of the requested size
+    if ( m_stream && numBytes > 0 )
+        setvbuf(m_stream, 0, _IOFBF, numBytes);
+}
+
 int64_t ILocalIODevice::Tell(void) const {
     BT_ASSERT_X( m_stream, "ILocalIODevice::Tell: trying to get file position fromnull stream" );
     return ftell64(m_stream);
@@ -39,6 +39,11 @@ class ILocalIODevice : public IBamIODevice {
         virtual int64_t Tell(void) const;
         virtual int64_t Write(const char* data, const unsigned int numBytes);
 
+    // ILocalIODevice interface
+    public:
+        // N.B. - must be called after Open(), but before any other IO
+        void SetBufferSize(const size_t numBytes);
+
     // data members
     protected:
         FILE* m_stream;
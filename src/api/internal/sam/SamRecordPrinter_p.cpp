@@ -0,0 +1,409 @@
+// ***************************************************************************
+// SamRecordPrinter_p.cpp (c) 2026
+// Marth Lab, Department of Biology, Boston College
+// ---------------------------------------------------------------------------
+// Last modified: 17 October 2026
+// ---------------------------------------------------------------------------
+// Provides functionality for printing SAM-formatted alignment records
+// ***************************************************************************
+
+#include "api/BamAlignment.h"
+#include "api/BamConstants.h"
+#include "api/internal/sam/SamRecordPrinter_p.h"
+using namespace BamTools;
+using namespace BamTools::Internal;
+
+#include <cmath>
+#include <cstring>
+using namespace std;
+
+// ------------------------
+// static utility methods
+// ------------------------
+
+// N.B. - output matches the previous (std::ostream-based) SAM output of the toolkit
+
+// writes unsigned integer, returns new end of output
+static inline
+char* PrintUnsigned(char* out, uint32_t value) {
+
+    // digits are generated backwards, into scratch space
+    char digits[16];
+    char* d = digits + sizeof(digits);
+    do {
+        *--d = (char)('0' + (value % 10));
+        value /= 10;
+    } while ( value != 0 );
+
+    const size_t numDigits = digits + sizeof(digits) - d;
+    memcpy(out, d, numDigits);
+    return out + numDigits;
+}
+
+static inline
+char* PrintSigned(char* out, const int32_t value) {
+    if ( value >= 0 )
+        return PrintUnsigned(out, (uint32_t)value);
+    *out++ = '-';
+    return PrintUnsigned(out, (uint32_t)0 - (uint32_t)value);
+}
+
+static inline
+char* PrintString(char* out, const char* s, const size_t length) {
+    memcpy(out, s, length);
+    return out + length;
+}
+
+// returns value * 10^exponent
+static double ScaleByPowerOf10(const double value, int exponent) {
+
+    // powers of 10 exactly representable as double
+    static const double powers[] = { 1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,
+                                     1e8,  1e9,  1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+                                     1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+    static const int maxExactExponent = 22;
+
+    double result = value;
+    if ( exponent >= 0 ) {
+        while ( exponent > maxExactExponent ) {
+            result *= powers[maxExactExponent];
+            exponent -= maxExactExponent;
+        }
+        return result * powers[exponent];
+    } else {
+        exponent = -exponent;
+        while ( exponent > maxExactExponent ) {
+            result /= powers[maxExactExponent];
+            exponent -= maxExactExponent;
+        }
+        return result / powers[exponent];
+    }
+}
+
+// rounds to nearest integer, ties to even (as printf does)
+static inline
+double RoundHalfEven(const double value) {
+    double result = floor(value);
+    const double remainder = value - result;
+    if ( remainder > 0.5 || (remainder == 0.5 && fmod(result, 2.0) != 0.0) )
+        result += 1.0;
+    return result;
+}
+
+// writes float like printf's "%g" (6 significant digits, trailing zeros removed,
+// exponent notation for very small or large values)
+static char* PrintFloat(char* out, const float value) {
+
+    // check sign & special values
+    union { float value; uint32_t bits; } un;
+    un.value = value;
+    const bool isNegative = ( (un.bits & 0x80000000u) != 0 );
+    const uint32_t exponentBits = (un.bits >> 23) & 0xFF;
+    if ( isNegative )
+        *out++ = '-';
+    if ( exponentBits == 0xFF ) {
+        if ( (un.bits & 0x7FFFFF) != 0 ) return PrintString(out, "nan", 3);
+        else                             return PrintString(out, "inf", 3);
+    }
+    const double absValue = fabs((double)value);
+    if ( absValue == 0.0 ) {
+        *out++ = '0';
+        return out;
+    }
+
+    // round to 6 significant digits: digits * 10^(exponent - 5)
+    static const int precision = 6;
+    static const double minDigits = 1e5;
+    static const double maxDigits = 1e6;
+    int exponent = (int)floor(log10(absValue));
+    double digits = RoundHalfEven( ScaleByPowerOf10(absValue, precision - 1 - exponent) );
+    if ( digits >= maxDigits ) {
+        ++exponent;
+        digits = RoundHalfEven( ScaleByPowerOf10(absValue, precision - 1 - exponent) );
+    } else if ( digits < minDigits ) {
+        --exponent;
+        digits = RoundHalfEven( ScaleByPowerOf10(absValue, precision - 1 - exponent) );
+    }
+
+    char d[precision];
+    uint32_t remaining = (uint32_t)digits;
+    for ( int i = precision - 1; i >= 0; --i ) {
+        d[i] = (char)('0' + (remaining % 10));
+        remaining /= 10;
+    }
+
+    // drop trailing zeros
+    int numDigits = precision;
+    while ( numDigits > 1 && d[numDigits-1] == '0' )
+        --numDigits;
+
+    // exponent notation: d[.ddddd]e(+|-)XX
+    if ( exponent < -4 || exponent >= precision ) {
+        *out++ = d[0];
+        if ( numDigits > 1 ) {
+            *out++ = '.';
+            out = PrintString(out, d + 1, numDigits - 1);
+        }
+        *out++ = 'e';
+        *out++ = ( exponent < 0 ? '-' : '+' );
+        const uint32_t absExponent = (uint32_t)( exponent < 0 ? -exponent : exponent );
+        if ( absExponent < 10 )
+            *out++ = '0';
+        return PrintUnsigned(out, absExponent);
+    }
+
+    // fixed notation, with leading zeros for negative exponent
+    if ( exponent < 0 ) {
+        *out++ = '0';
+        *out++ = '.';
+        for ( int i = exponent + 1; i < 0; ++i )
+            *out++ = '0';
+        return PrintString(out, d, numDigits);
+    }
+    const int numIntegerDigits = exponent + 1;
+    out = PrintString(out, d, numIntegerDigits);
+    if ( numDigits > numIntegerDigits ) {
+        *out++ = '.';
+        out = PrintString(out, d + numIntegerDigits, numDigits - numIntegerDigits);
+    }
+    return out;
+}
+
+// ------------------------
+// tag type table
+// ------------------------
+
+namespace BamTools {
+namespace Internal {
+
+enum SamTagValueType { TagValueUnknown = 0
+                     , TagValueChar
+                     , TagValueInt8
+                     , TagValueUInt8
+                     , TagValueInt16
+                     , TagValueUInt16
+                     , TagValueInt32
+                     , TagValueUInt32
+                     , TagValueFloat
+                     , TagValueString
+                     };
+
+// SAM printing info, for each BAM tag type
+struct SamTagTypeTable {
+
+    SamTagValueType ValueTypes[256];
+    char SamTypes[256];             // type char printed in SAM
+
+    SamTagTypeTable(void) {
+        for ( int i = 0; i < 256; ++i ) {
+            ValueTypes[i] = TagValueUnknown;
+            SamTypes[i]   = 'i';
+        }
+        Set(Constants::BAM_TAG_TYPE_ASCII,  TagValueChar,   'A');
+        Set(Constants::BAM_TAG_TYPE_INT8,   TagValueInt8,   'i');
+        Set(Constants::BAM_TAG_TYPE_UINT8,  TagValueUInt8,  'i');
+        Set(Constants::BAM_TAG_TYPE_INT16,  TagValueInt16,  'i');
+        Set(Constants::BAM_TAG_TYPE_UINT16, TagValueUInt16, 'i');
+        Set(Constants::BAM_TAG_TYPE_INT32,  TagValueInt32,  'i');
+        Set(Constants::BAM_TAG_TYPE_UINT32, TagValueUInt32, 'i');
+        Set(Constants::BAM_TAG_TYPE_FLOAT,  TagValueFloat,  'f');
+        Set(Constants::BAM_TAG_TYPE_HEX,    TagValueString, Constants::BAM_TAG_TYPE_HEX);
+        Set(Constants::BAM_TAG_TYPE_STRING, TagValueString, Constants::BAM_TAG_TYPE_STRING);
+    }
+
+    void Set(const char bamType, const SamTagValueType valueType, const char samType) {
+        ValueTypes[(unsigned char)bamType] = valueType;
+        SamTypes[(unsigned char)bamType]   = samType;
+    }
+};
+
+static const SamTagTypeTable TagTypes;
+
+} // namespace Internal
+} // namespace BamTools
+
+// ---------------------------------
+// SamRecordPrinter implementation
+// ---------------------------------
+
+SamRecordPrinter::SamRecordPrinter(const RefVector& references)
+    : m_maxReferenceNameLength(1)
+{
+    m_referenceNames.reserve(references.size());
+    RefVector::const_iterator refIter = references.begin();
+    RefVector::const_iterator refEnd  = references.end();
+    for ( ; refIter != refEnd; ++refIter ) {
+        m_referenceNames.push_back(refIter->RefName);
+        if ( refIter->RefName.size() > m_maxReferenceNameLength )
+            m_maxReferenceNameLength = refIter->RefName.size();
+    }
+}
+
+SamRecordPrinter::~SamRecordPrinter(void) { }
+
+// tab-delimited
+// <QNAME> <FLAG> <RNAME> <POS> <MAPQ> <CIGAR> <MRNM> <MPOS> <ISIZE> <SEQ> <QUAL> [ <TAG>:<VTYPE>:<VALUE> [...] ]
+void SamRecordPrinter::Print(const BamAlignment& a, string& buffer) const {
+
+    // make room for longest possible output
+    //   numeric fields: at most 11 chars (+ tab) each
+    //   tags: at most 4 chars printed per byte, e.g. "\tXY:i:255" from "XYC" + 1 byte
+    static const size_t maxNumberLength = 12;
+    const size_t maxLength = a.Name.size() + 2 * m_maxReferenceNameLength + 8 * maxNumberLength
+                           + a.CigarData.size() * maxNumberLength
+                           + a.QueryBases.size() + a.Qualities.size()
+                           + 4 * a.TagData.size() + 16;
+    const size_t oldLength = buffer.size();
+    buffer.resize(oldLength + maxLength);
+    char* const begin = &buffer[0];
+    char* out = begin + oldLength;
+
+    // write name & alignment flag
+    out = PrintString(out, a.Name.data(), a.Name.size());
+    *out++ = '\t';
+    out = PrintUnsigned(out, a.AlignmentFlag);
+    *out++ = '\t';
+
+    // write reference name
+    const int numReferences = (int)m_referenceNames.size();
+    if ( (a.RefID >= 0) && (a.RefID < numReferences) ) {
+        const string& refName = m_referenceNames[a.RefID];
+        out = PrintString(out, refName.data(), refName.size());
+    } else
+        *out++ = '*';
+    *out++ = '\t';
+
+    // write position & map quality
+    out = PrintSigned(out, a.Position + 1);
+    *out++ = '\t';
+    out = PrintUnsigned(out, a.MapQuality);
+    *out++ = '\t';
+
+    // write CIGAR
+    if ( a.CigarData.empty() )
+        *out++ = '*';
+    else {
+        vector<CigarOp>::const_iterator cigarIter = a.CigarData.begin();
+        vector<CigarOp>::const_iterator cigarEnd  = a.CigarData.end();
+        for ( ; cigarIter != cigarEnd; ++cigarIter ) {
+            out = PrintUnsigned(out, cigarIter->Length);
+            *out++ = cigarIter->Type;
+        }
+    }
+    *out++ = '\t';
+
+    // write mate reference name, mate position, & insert size
+    if ( a.IsPaired() && (a.MateRefID >= 0) && (a.MateRefID < numReferences) ) {
+        if ( a.MateRefID == a.RefID )
+            *out++ = '=';
+        else {
+            const string& mateRefName = m_referenceNames[a.MateRefID];
+            out = PrintString(out, mateRefName.data(), mateRefName.size());
+        }
+        *out++ = '\t';
+        out = PrintSigned(out, a.MatePosition + 1);
+        *out++ = '\t';
+        out = PrintSigned(out, a.InsertSize);
+        *out++ = '\t';
+    }
+    else
+        out = PrintString(out, "*\t0\t0\t", 6);
+
+    // write sequence
+    if ( a.QueryBases.empty() )
+        *out++ = '*';
+    else
+        out = PrintString(out, a.QueryBases.data(), a.QueryBases.size());
+    *out++ = '\t';
+
+    // write qualities
+    if ( a.Qualities.empty() || (a.Qualities[0] == (char)0xFF) )
+        *out++ = '*';
+    else
+        out = PrintString(out, a.Qualities.data(), a.Qualities.size());
+
+    // write tag data
+    const char* tagData = a.TagData.c_str();
+    const size_t tagDataLength = a.TagData.length();
+    size_t index = 0;
+    while ( index < tagDataLength ) {
+
+        // write tag name
+        *out++ = '\t';
+        const size_t nameLength = ( tagDataLength - index < 2 ? tagDataLength - index : 2 );
+        out = PrintString(out, &tagData[index], nameLength);
+        *out++ = ':';
+        index += 2;
+        if ( index >= tagDataLength )
+            break;
+
+        // write value, according to type
+        const unsigned char type = (unsigned char)tagData[index];
+        ++index;
+        const SamTagValueType valueType = TagTypes.ValueTypes[type];
+        if ( valueType != TagValueUnknown ) {
+            *out++ = TagTypes.SamTypes[type];
+            *out++ = ':';
+        }
+        switch ( valueType ) {
+
+            case ( TagValueChar ) :
+                *out++ = tagData[index];
+                ++index;
+                break;
+
+            case ( TagValueInt8 ) :
+                out = PrintSigned(out, (int8_t)tagData[index]);
+                ++index;
+                break;
+
+            // N.B. - promoted from (platform-dependent) char, as before
+            case ( TagValueUInt8 ) :
+                out = PrintUnsigned(out, static_cast<uint16_t>(tagData[index]));
+                ++index;
+                break;
+
+            case ( TagValueInt16 ) :
+                out = PrintSigned(out, BamTools::UnpackSignedShort(&tagData[index]));
+                index += sizeof(int16_t);
+                break;
+
+            case ( TagValueUInt16 ) :
+                out = PrintUnsigned(out, BamTools::UnpackUnsignedShort(&tagData[index]));
+                index += sizeof(uint16_t);
+                break;
+
+            case ( TagValueInt32 ) :
+                out = PrintSigned(out, BamTools::UnpackSignedInt(&tagData[index]));
+                index += sizeof(int32_t);
+                break;
+
+            case ( TagValueUInt32 ) :
+                out = PrintUnsigned(out, BamTools::UnpackUnsignedInt(&tagData[index]));
+                index += sizeof(uint32_t);
+                break;
+
+            case ( TagValueFloat ) :
+                out = PrintFloat(out, BamTools::UnpackFloat(&tagData[index]));
+                index += sizeof(float);
+                break;
+
+            case ( TagValueString ) : {
+                const size_t length = strlen(&tagData[index]);
+                out = PrintString(out, &tagData[index], length);
+                index += length + 1;
+                break;
+            }
+
+            // unsupported types (e.g. arrays) have no value printed
+            default :
+                break;
+        }
+
+        if ( tagData[index] == '\0' )
+            break;
+    }
+
+    *out++ = '\n';
+    buffer.resize(out - begin);
+}
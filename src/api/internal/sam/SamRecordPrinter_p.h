@@ -0,0 +1,53 @@
+// ***************************************************************************
+// SamRecordPrinter_p.h (c) 2026
+// Marth Lab, Department of Biology, Boston College
+// ---------------------------------------------------------------------------
+// Last modified: 17 October 2026
+// ---------------------------------------------------------------------------
+// Provides functionality for printing SAM-formatted alignment records
+// ***************************************************************************
+
+#ifndef SAM_RECORD_PRINTER_H
+#define SAM_RECORD_PRINTER_H
+
+//  -------------
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the BamTools API.  It exists purely as an
+// implementation detail. This header file may change from version to version
+// without notice, or even be removed.
+//
+// We mean it.
+
+#include "api/BamAux.h"
+#include <string>
+#include <vector>
+
+namespace BamTools {
+
+class BamAlignment;
+
+namespace Internal {
+
+class SamRecordPrinter {
+
+    // ctor & dtor
+    public:
+        SamRecordPrinter(const BamTools::RefVector& references);
+        ~SamRecordPrinter(void);
+
+    // appends SAM-formatted line (with newline) to buffer
+    public:
+        void Print(const BamTools::BamAlignment& alignment, std::string& buffer) const;
+
+    // data members
+    private:
+        std::vector<std::string> m_referenceNames;
+        size_t m_maxReferenceNameLength;
+};
+
+} // namespace Internal
+} // namespace BamTools
+
+#endif // SAM_RECORD_PRINTER_H
@@ -0,0 +1,166 @@
+// ***************************************************************************
+// BamThread_p.cpp (c) 2026
+// Marth Lab, Department of Biology, Boston College
+// ---------------------------------------------------------------------------
+// Last modified: 17 October 2026
+// ---------------------------------------------------------------------------
+// Provides minimal, platform-independent threading primitives for BamTools
+// internals (these are also the building blocks of the toolkit's ThreadPool)
+// ***************************************************************************
+
+#include "api/internal/utils/BamThread_p.h"
+using namespace BamTools;
+using namespace BamTools::Internal;
+
+#ifndef _WIN32
+#  include <unistd.h>
+#endif
+
+// ---------------------------
+// BamMutex implementation
+// ---------------------------
+
+BamMutex::BamMutex(void) {
+#ifdef _WIN32
+    InitializeCriticalSection(&m_mutex);
+#else
+    pthread_mutex_init(&m_mutex, 0);
+#endif
+}
+
+BamMutex::~BamMutex(void) {
+#ifdef _WIN32
+    DeleteCriticalSection(&m_mutex);
+#else
+    pthread_mutex_destroy(&m_mutex);
+#endif
+}
+
+void BamMutex::Lock(void) {
+#ifdef _WIN32
+    EnterCriticalSection(&m_mutex);
+#else
+    pthread_mutex_lock(&m_mutex);
+#endif
+}
+
+void BamMutex::Unlock(void) {
+#ifdef _WIN32
+    LeaveCriticalSection(&m_mutex);
+#else
+    pthread_mutex_unlock(&m_mutex);
+#endif
+}
+
+// ---------------------------
+// BamWaitCondition implementation
+// ---------------------------
+
+BamWaitCondition::BamWaitCondition(void) {
+#ifdef _WIN32
+    InitializeConditionVariable(&m_condition);
+#else
+    pthread_cond_init(&m_condition, 0);
+#endif
+}
+
+BamWaitCondition::~BamWaitCondition(void) {
+#ifndef _WIN32
+    pthread_cond_destroy(&m_condition);
+#endif
+}
+
+void BamWaitCondition::Wait(BamMutex& mutex) {
+#ifdef _WIN32
+    SleepConditionVariableCS(&m_condition, &mutex.m_mutex, INFINITE);
+#else
+    pthread_cond_wait(&m_condition, &mutex.m_mutex);
+#endif
+}
+
+void BamWaitCondition::WakeAll(void) {
+#ifdef _WIN32
+    WakeAllConditionVariable(&m_condition);
+#else
+    pthread_cond_broadcast(&m_condition);
+#endif
+}
+
+void BamWaitCondition::WakeOne(void) {
+#ifdef _WIN32
+    WakeConditionVariable(&m_condition);
+#else
+    pthread_cond_signal(&m_condition);
+#endif
+}
+
+// ---------------------------
+// BamThread implementation
+// ---------------------------
+
+BamThread::BamThread(void)
+    : m_isRunning(false)
+{ }
+
+// N.B. - derived classes must make sure their Run() has finished (e.g. by
+//        calling Wait() in their own dtor), since that object is gone by now
+BamThread::~BamThread(void) {
+    Wait();
+}
+
+unsigned int BamThread::IdealThreadCount(void) {
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    const long numProcessors = static_cast<long>(info.dwNumberOfProcessors);
+#else
+    const long numProcessors = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+    return ( numProcessors > 0 ? static_cast<unsigned int>(numProcessors) : 1 );
+}
+
+bool BamThread::IsRunning(void) const {
+    return m_isRunning;
+}
+
+bool BamThread::Start(void) {
+
+    // skip if already started
+    if ( m_isRunning )
+        return true;
+
+#ifdef _WIN32
+    m_thread = CreateThread(0, 0, &BamThread::ThreadEntry, this, 0, 0);
+    m_isRunning = ( m_thread != 0 );
+#else
+    m_isRunning = ( pthread_create(&m_thread, 0, &BamThread::ThreadEntry, this) == 0 );
+#endif
+    return m_isRunning;
+}
+
+#ifdef _WIN32
+DWORD WINAPI BamThread::ThreadEntry(LPVOID data) {
+    static_cast<BamThread*>(data)->Run();
+    return 0;
+}
+#else
+void* BamThread::ThreadEntry(void* data) {
+    static_cast<BamThread*>(data)->Run();
+    return 0;
+}
+#endif
+
+// blocks until Run() has returned
+void BamThread::Wait(void) {
+
+    if ( !m_isRunning )
+        return;
+
+#ifdef _WIN32
+    WaitForSingleObject(m_thread, INFINITE);
+    CloseHandle(m_thread);
+#else
+    pthread_join(m_thread, 0);
+#endif
+    m_isRunning = false;
+}
@@ -0,0 +1,162 @@
+// ***************************************************************************
+// BamThread_p.h (c) 2026
+// Marth Lab, Department of Biology, Boston College
+// ---------------------------------------------------------------------------
+// Last modified: 17 October 2026
+// ---------------------------------------------------------------------------
+// Provides minimal, platform-independent threading primitives for BamTools
+// internals (these are also the building blocks of the toolkit's ThreadPool)
+// ***************************************************************************
+
+#ifndef BAMTHREAD_P_H
+#define BAMTHREAD_P_H
+
+//  -------------
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the BamTools API.  It exists purely as an
+// implementation detail. This header file may change from version to version
+// without notice, or even be removed.
+//
+// We mean it.
+
+#include "api/api_global.h"
+
+#ifdef _WIN32
+#  include <windows.h>
+#else
+#  include <pthread.h>
+#endif
+
+namespace BamTools {
+namespace Internal {
+
+class API_EXPORT BamMutex {
+
+    // ctor & dtor
+    public:
+        BamMutex(void);
+        ~BamMutex(void);
+
+    // BamMutex interface
+    public:
+        void Lock(void);
+        void Unlock(void);
+
+    // not copyable
+    private:
+        BamMutex(const BamMutex& other);
+        BamMutex& operator=(const BamMutex& other);
+
+    // data members
+    private:
+#ifdef _WIN32
+        CRITICAL_SECTION m_mutex;
+#else
+        pthread_mutex_t m_mutex;
+#endif
+
+    friend class BamWaitCondition;
+};
+
+// locks mutex for the lifetime of the locker object
+class BamMutexLocker {
+
+    public:
+        explicit BamMutexLocker(BamMutex& mutex)
+            : m_mutex(mutex)
+        {
+            m_mutex.Lock();
+        }
+
+        ~BamMutexLocker(void) {
+            m_mutex.Unlock();
+        }
+
+    private:
+        BamMutexLocker(const BamMutexLocker& other);
+        BamMutexLocker& operator=(const BamMutexLocker& other);
+
+    private:
+        BamMutex& m_mutex;
+};
+
+class API_EXPORT BamWaitCondition {
+
+    // ctor & dtor
+    public:
+        BamWaitCondition(void);
+        ~BamWaitCondition(void);
+
+    // BamWaitCondition interface
+    public:
+        // N.B. - mutex must be locked by caller, it is re-locked before returning
+        void Wait(BamMutex& mutex);
+        void WakeAll(void);
+        void WakeOne(void);
+
+    // not copyable
+    private:
+        BamWaitCondition(const BamWaitCondition& other);
+        BamWaitCondition& operator=(const BamWaitCondition& other);
+
+    // data members
+    private:
+#ifdef _WIN32
+        CONDITION_VARIABLE m_condition;
+#else
+        pthread_cond_t m_condition;
+#endif
+};
+
+// derived classes implement Run(), which executes on its own thread after Start()
+//
+// N.B. - a thread may be re-started once Wait() has returned
+class API_EXPORT BamThread {
+
+    // ctor & dtor
+    public:
+        BamThread(void);
+        virtual ~BamThread(void);
+
+    // BamThread interface
+    public:
+        bool IsRunning(void) const;
+        bool Start(void);
+        // blocks until Run() has returned
+        void Wait(void);
+
+        // returns number of processors available (at least 1)
+        static unsigned int IdealThreadCount(void);
+
+    // 'internal' methods
+    protected:
+        virtual void Run(void) =0;
+
+    private:
+#ifdef _WIN32
+        static DWORD WINAPI ThreadEntry(LPVOID data);
+#else
+        static void* ThreadEntry(void* data);
+#endif
+
+    // not copyable
+    private:
+        BamThread(const BamThread& other);
+        BamThread& operator=(const BamThread& other);
+
+    // data members
+    private:
+#ifdef _WIN32
+        HANDLE m_thread;
+#else
+        pthread_t m_thread;
+#endif
+        bool m_isRunning;
+};
+
+} // namespace Internal
+} // namespace BamTools
+
+#endif // BAMTHREAD_P_H
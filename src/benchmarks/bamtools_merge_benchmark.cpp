@@ -0,0 +1,169 @@
+// ***************************************************************************
+// bamtools_merge_benchmark.cpp (c) 2026
+// Marth Lab, Department of Biology, Boston College
+// ---------------------------------------------------------------------------
+// Last modified: 17 October 2026
+// ---------------------------------------------------------------------------
+// Times the multiset-based MultiMerger against the LoserTreeMerger over a
+// range of input counts, to choose BamMultiReader's LOSER_TREE_MIN_READERS
+// ***************************************************************************
+
+#include <api/BamAlignment.h>
+#include <api/BamReader.h>
+#include <api/algorithms/Sort.h>
+#include <api/internal/bam/BamMultiMerger_p.h>
+using namespace BamTools;
+using namespace BamTools::Internal;
+
+#include <cstdlib>
+#include <ctime>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+using namespace std;
+
+namespace {
+
+// default number of records merged per run & runs per measurement
+const uint64_t DEFAULT_NUM_RECORDS = 2000000;
+const int      DEFAULT_NUM_RUNS    = 3;
+
+// input counts to measure
+const size_t INPUT_COUNTS[] = { 2, 3, 4, 5, 6, 8, 12, 16, 24, 32, 64,
+                                128, 256, 512, 1000, 2000 };
+const size_t NUM_INPUT_COUNTS = sizeof(INPUT_COUNTS) / sizeof(INPUT_COUNTS[0]);
+
+// simple LCG, so both mergers see exactly the same input
+class Random {
+
+    public:
+        explicit Random(uint32_t seed) : m_state(seed) { }
+
+        uint32_t Next(void) {
+            m_state = m_state * 1664525u + 1013904223u;
+            return ( m_state >> 8 );
+        }
+
+    private:
+        uint32_t m_state;
+};
+
+// merges 'numRecords' alignments from 'numInputs' position-sorted streams,
+// returns elapsed CPU time in seconds
+double TimeMerge(IMultiMerger* merger,
+                 const size_t numInputs,
+                 const uint64_t numRecords,
+                 uint64_t& checksum)
+{
+    // one (unopened) reader per stream, only used as the merge key's owner
+    vector<BamReader*> readers;
+    vector<BamAlignment*> alignments;
+    readers.reserve(numInputs);
+    alignments.reserve(numInputs);
+
+    // seed each stream with its first record
+    Random random(static_cast<uint32_t>(numInputs));
+    for ( size_t i = 0; i < numInputs; ++i ) {
+        BamAlignment* al = new BamAlignment;
+        al->RefID    = 0;
+        al->Position = static_cast<int32_t>( random.Next() % 1000 );
+        readers.push_back( new BamReader );
+        alignments.push_back(al);
+        merger->Add( MergeItem(readers.at(i), al) );
+    }
+
+    // take winner, advance its stream & put it back - as BamMultiReader does
+    const clock_t start = clock();
+    for ( uint64_t n = 0; n < numRecords; ++n ) {
+        MergeItem item = merger->TakeFirst();
+        BamAlignment* al = item.Alignment;
+        checksum += static_cast<uint64_t>(al->Position);
+
+        al->Position += static_cast<int32_t>( random.Next() % 1000 );
+        if ( al->Position > 200000000 ) {
+            ++al->RefID;
+            al->Position %= 1000;
+        }
+        merger->Add(item);
+    }
+    const clock_t end = clock();
+
+    // clean up
+    merger->Clear();
+    for ( size_t i = 0; i < numInputs; ++i ) {
+        delete readers.at(i);
+        delete alignments.at(i);
+    }
+
+    return static_cast<double>(end - start) / CLOCKS_PER_SEC;
+}
+
+// returns best-of-N time for the merger type
+template<typename Merger>
+double Measure(const size_t numInputs, const uint64_t numRecords, const int numRuns, uint64_t& checksum) {
+    double best = 0.0;
+    for ( int run = 0; run < numRuns; ++run ) {
+        Merger merger;
+        const double elapsed = TimeMerge(&merger, numInputs, numRecords, checksum);
+        if ( run == 0 || elapsed < best )
+            best = elapsed;
+    }
+    return best;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+
+    // usage: bamtools_merge_benchmark [numRecords [numRuns]]
+    uint64_t numRecords = DEFAULT_NUM_RECORDS;
+    int numRuns = DEFAULT_NUM_RUNS;
+    if ( argc > 1 ) numRecords = strtoull(argv[1], 0, 10);
+    if ( argc > 2 ) numRuns    = atoi(argv[2]);
+    if ( numRecords == 0 || numRuns <= 0 ) {
+        cerr << "usage: bamtools_merge_benchmark [numRecords [numRuns]]" << endl;
+        return 1;
+    }
+
+    typedef Algorithms::Sort::ByPosition ByPosition;
+
+    cout << "merging " << numRecords << " records by position, best of " << numRuns << " runs" << endl
+         << endl
+         << setw(8)  << "inputs"
+         << setw(16) << "multiset (s)"
+         << setw(16) << "loser tree (s)"
+         << setw(10) << "speedup" << endl;
+
+    // the threshold is the smallest input count from which the loser tree is always faster
+    size_t threshold = 0;
+    uint64_t checksum = 0;
+    cout << fixed;
+    for ( size_t i = 0; i < NUM_INPUT_COUNTS; ++i ) {
+        const size_t numInputs = INPUT_COUNTS[i];
+        const double multiset  = Measure< MultiMerger<ByPosition> >(numInputs, numRecords, numRuns, checksum);
+        const double loserTree = Measure< LoserTreeMerger<ByPosition> >(numInputs, numRecords, numRuns, checksum);
+
+        cout << setw(8)  << numInputs
+             << setw(16) << setprecision(3) << multiset
+             << setw(16) << setprecision(3) << loserTree
+             << setw(9)  << setprecision(2) << ( loserTree > 0.0 ? multiset / loserTree : 0.0 ) << "x"
+             << endl;
+
+        if ( loserTree < multiset ) {
+            if ( threshold == 0 )
+                threshold = numInputs;
+        } else
+            threshold = 0;
+    }
+
+    cout << endl;
+    if ( threshold == 0 )
+        cout << "loser tree is not faster at the largest input count" << endl;
+    else
+        cout << "loser tree is faster from " << threshold << " inputs" << endl;
+
+    // keep the merge loops from being optimized away
+    cerr << "(checksum " << checksum << ")" << endl;
+    return 0;
+}
@@ -11,12 +11,19 @@
 
 #include <api/BamConstants.h>
 #include <api/BamMultiReader.h>
+#include <api/BgzfWriter.h>
+#include <api/SamRecordFormatter.h>
+#include <utils/bamtools_allele_count_engine.h>
+#include <utils/bamtools_columnar.h>
 #include <utils/bamtools_fasta.h>
+#include <utils/bamtools_mate_collator.h>
 #include <utils/bamtools_options.h>
 #include <utils/bamtools_pileup_engine.h>
+#include <utils/bamtools_thread.h>
 #include <utils/bamtools_utilities.h>
 using namespace BamTools;
 
+#include <cstring>
 #include <fstream>
 #include <iostream>
 #include <sstream>
@@ -30,16 +37,321 @@ namespace BamTools {
 // ConvertTool constants
 
 // supported conversion format command-line names
-static const string FORMAT_BED    = "bed";
-static const string FORMAT_FASTA  = "fasta";
-static const string FORMAT_FASTQ  = "fastq";
-static const string FORMAT_JSON   = "json";
-static const string FORMAT_SAM    = "sam";
-static const string FORMAT_PILEUP = "pileup";
-static const string FORMAT_YAML   = "yaml";
+static const string FORMAT_BAM      = "bam";
+static const string FORMAT_BED      = "bed";
+static const string FORMAT_COLUMNAR = "columnar";
+static const string FORMAT_FASTA    = "fasta";
+static const string FORMAT_FASTQ    = "fastq";
+static const string FORMAT_JSON     = "json";
+static const string FORMAT_SAM      = "sam";
+static const string FORMAT_PILEUP   = "pileup";
+static const string FORMAT_YAML     = "yaml";
 
 // other constants
 static const unsigned int FASTA_LINE_MAX = 50;
+static const unsigned int PILEUP_DEFAULT_MIN_BASE_QUALITY = 0;
+
+// thread settings
+static const unsigned int CONVERT_DEFAULT_NUM_THREADS = 1;
+
+// alignments are formatted (& output written) in batches of this many alignments
+static const size_t CONVERT_BATCH_SIZE = 8192;
+
+// max number of batches read ahead of the output, per thread
+static const size_t CONVERT_PENDING_BATCHES_PER_THREAD = 2;
+
+// output filename extensions, for which output is compressed automatically
+static const string COMPRESSED_EXTENSION_BGZ = ".bgz";
+static const string COMPRESSED_EXTENSION_GZ  = ".gz";
+
+// size of stream buffer in front of compressed output
+static const size_t CONVERT_COMPRESSED_BUFFER_SIZE = 64 * 1024;
+
+// columnar output
+static const unsigned int COLUMNAR_DEFAULT_ROW_GROUP_SIZE = 65536;
+
+// paired FASTQ output
+static const string PAIRED_DEFAULT_MAX_MEMORY  = "512M";    // plain numbers are Mb
+static const string PAIRED_EXTENSION_FASTQ     = ".fastq";
+static const string PAIRED_EXTENSION_FQ        = ".fq";
+static const string PAIRED_SUFFIX_FIRST_MATE   = "_1";
+static const string PAIRED_SUFFIX_SECOND_MATE  = "_2";
+static const string PAIRED_SUFFIX_SINGLETONS   = "_singletons";
+static const string PAIRED_TEMP_FILENAME_STUB  = ".collate.temp";
+
+// returns true if alignment is the read's primary record (i.e. neither secondary nor supplementary)
+static inline
+bool IsPrimaryRead(const BamAlignment& a) {
+    return ( (a.AlignmentFlag & (Constants::BAM_ALIGNMENT_SECONDARY | Constants::BAM_ALIGNMENT_SUPPLEMENTARY)) == 0 );
+}
+
+// ---------------------------------------------
+// ConvertBatch
+
+struct ConvertBatch {
+
+    // data members
+    vector<BamAlignment> Alignments;
+    size_t NumAlignments;
+
+    // results
+    bool IsDone;
+    string Output;
+    vector<string> Records;     // per-alignment output (paired FASTQ only)
+
+    // ctor
+    ConvertBatch(void)
+        : NumAlignments(0)
+        , IsDone(false)
+    { }
+};
+
+// ---------------------------------------------
+// ConvertInput
+
+// alignments to convert, read from BAM file(s) or back from a columnar file
+class ConvertInput {
+    public:
+        virtual ~ConvertInput(void) { }
+        virtual bool GetNextAlignment(BamAlignment& a) =0;
+        virtual string GetHeaderText(void) const =0;
+};
+
+template<typename Reader>
+class ConvertReaderInput : public ConvertInput {
+
+    public:
+        explicit ConvertReaderInput(Reader* reader)
+            : m_reader(reader)
+        { }
+
+        bool GetNextAlignment(BamAlignment& a) {
+            return m_reader->GetNextAlignment(a);
+        }
+
+        string GetHeaderText(void) const {
+            return m_reader->GetHeaderText();
+        }
+
+    private:
+        Reader* m_reader;
+};
+
+// ---------------------------------------------
+// ConvertBgzfBuffer
+
+// stream buffer, passing all output on to a BgzfWriter
+class ConvertBgzfBuffer : public std::streambuf {
+
+    // ctor & dtor
+    public:
+        explicit ConvertBgzfBuffer(BgzfWriter* writer)
+            : m_writer(writer)
+            , m_buffer(CONVERT_COMPRESSED_BUFFER_SIZE)
+        {
+            setp(&m_buffer[0], &m_buffer[0] + m_buffer.size());
+        }
+        ~ConvertBgzfBuffer(void) { }
+
+    // std::streambuf implementation
+    protected:
+        int overflow(int c) {
+            if ( !WriteBuffer() )
+                return traits_type::eof();
+            if ( c != traits_type::eof() ) {
+                *pptr() = traits_type::to_char_type(c);
+                pbump(1);
+            }
+            return traits_type::not_eof(c);
+        }
+
+        int sync(void) {
+            return ( WriteBuffer() ? 0 : -1 );
+        }
+
+        streamsize xsputn(const char* data, streamsize length) {
+
+            // small writes are buffered
+            if ( length < epptr() - pptr() ) {
+                memcpy(pptr(), data, length);
+                pbump((int)length);
+                return length;
+            }
+
+            // large writes (e.g. formatted batches) are passed on directly
+            if ( !WriteBuffer() || !m_writer->Write(data, length) )
+                return 0;
+            return length;
+        }
+
+    // internal methods
+    private:
+        bool WriteBuffer(void) {
+            const size_t length = pptr() - pbase();
+            if ( length > 0 && !m_writer->Write(pbase(), length) )
+                return false;
+            setp(&m_buffer[0], &m_buffer[0] + m_buffer.size());
+            return true;
+        }
+
+    // data members
+    private:
+        BgzfWriter* m_writer;
+        vector<char> m_buffer;
+};
+
+// ---------------------------------------------
+// ConvertOutputFile
+
+// output file (or stdout), either plain or BGZF-compressed
+class ConvertOutputFile {
+
+    // ctor & dtor
+    public:
+        ConvertOutputFile(void)
+            : m_bgzfBuffer(&m_writer)
+            , m_buffer(0)
+            , m_isCompressed(false)
+        { }
+        ~ConvertOutputFile(void) {
+            Close();
+        }
+
+    // ConvertOutputFile interface
+    public:
+        streambuf* Buffer(void) const { return m_buffer; }
+        bool Close(void);
+        string GetErrorString(void) const { return m_writer.GetErrorString(); }
+        bool Open(const string& filename, const bool isCompressed, const unsigned int numThreads);
+        bool Write(const string& data) {
+            return ( m_buffer->sputn(data.data(), data.size()) == (streamsize)data.size() );
+        }
+
+    // data members
+    private:
+        ofstream m_file;
+        BgzfWriter m_writer;
+        ConvertBgzfBuffer m_bgzfBuffer;
+        streambuf* m_buffer;
+        bool m_isCompressed;
+};
+
+// writes out any buffered data & closes file
+bool ConvertOutputFile::Close(void) {
+
+    if ( m_buffer == 0 )
+        return true;
+
+    bool result = ( m_buffer->pubsync() == 0 );
+    if ( m_isCompressed )
+        result = m_writer.Close() && result;
+    else if ( m_file.is_open() ) {
+        m_file.close();
+        result = !m_file.fail() && result;
+    }
+    m_buffer = 0;
+    return result;
+}
+
+bool ConvertOutputFile::Open(const string& filename, const bool isCompressed, const unsigned int numThreads) {
+
+    m_isCompressed = isCompressed;
+
+    // compressed (file or stdout)
+    if ( isCompressed ) {
+        m_writer.SetNumThreads(numThreads);
+        if ( !m_writer.Open(filename) )
+            return false;
+        m_buffer = &m_bgzfBuffer;
+    }
+
+    // plain stdout
+    else if ( filename == Options::StandardOut() )
+        m_buffer = cout.rdbuf();
+
+    // plain file
+    else {
+        m_file.open(filename.c_str());
+        if ( !m_file )
+            return false;
+        m_buffer = m_file.rdbuf();
+    }
+
+    return true;
+}
+
+// ---------------------------------------------
+// ConvertPairedFastqVisitor
+
+// writes collated mates to their FASTQ files
+class ConvertPairedFastqVisitor : public MateCollatorVisitor {
+
+    // ctor & dtor
+    public:
+        ConvertPairedFastqVisitor(ConvertOutputFile* firstMates,
+                                  ConvertOutputFile* secondMates,
+                                  ConvertOutputFile* singletons)
+            : m_firstMates(firstMates)
+            , m_secondMates(secondMates)
+            , m_singletons(singletons)
+            , m_isOk(true)
+            , m_numPairs(0)
+            , m_numSingletons(0)
+        { }
+        ~ConvertPairedFastqVisitor(void) { }
+
+    // MateCollatorVisitor interface implementation
+    public:
+        void VisitPair(const string& firstMate, const string& secondMate) {
+            if ( !m_firstMates->Write(firstMate) || !m_secondMates->Write(secondMate) )
+                m_isOk = false;
+            ++m_numPairs;
+        }
+        void VisitSingleton(const string& record) {
+            if ( !m_singletons->Write(record) )
+                m_isOk = false;
+            ++m_numSingletons;
+        }
+
+    // ConvertPairedFastqVisitor interface
+    public:
+        bool IsOk(void) const { return m_isOk; }
+        uint64_t NumPairs(void) const { return m_numPairs; }
+        uint64_t NumSingletons(void) const { return m_numSingletons; }
+
+    // data members
+    private:
+        ConvertOutputFile* m_firstMates;
+        ConvertOutputFile* m_secondMates;
+        ConvertOutputFile* m_singletons;
+        bool m_isOk;
+        uint64_t m_numPairs;
+        uint64_t m_numSingletons;
+};
+
+// ---------------------------------------------
+// ConvertAlleleCountVisitor declaration
+
+class ConvertAlleleCountVisitor : public AlleleCountVisitor {
+
+    // ctor & dtor
+    public:
+        ConvertAlleleCountVisitor(const RefVector& references,
+                                  const string& fastaFilename,
+                                  ostream* out);
+        ~ConvertAlleleCountVisitor(void);
+
+    // AlleleCountVisitor interface implementation
+    public:
+        void VisitBlock(const AlleleCountBlock& block);
+
+    // data members
+    private:
+        Fasta     m_fasta;
+        bool      m_hasFasta;
+        ostream*  m_out;
+        RefVector m_references;
+};
 
 // ---------------------------------------------
 // ConvertPileupFormatVisitor declaration
@@ -79,11 +391,17 @@ struct ConvertTool::ConvertSettings {
     bool HasInputFilelist;
     bool HasOutput;
     bool HasFormat;
+    bool HasInputFormat;
     bool HasRegion;
 
     // pileup flags
     bool HasFastaFilename;
+    bool HasMinBaseQuality;
+    bool HasNumThreads;
+    bool IsCompressingOutput;
     bool IsOmittingSamHeader;
+    bool IsPairingMates;
+    bool IsPrintingPileupAlleleCounts;
     bool IsPrintingPileupMapQualities;
     
     // options
@@ -91,10 +409,25 @@ struct ConvertTool::ConvertSettings {
     string InputFilelist;
     string OutputFilename;
     string Format;
+    string InputFormat;
     string Region;
     
     // pileup options
     string FastaFilename;
+    unsigned int MinBaseQuality;
+
+    // columnar options
+    bool HasColumnarRowGroupSize;
+    bool HasColumnarTags;
+    unsigned int ColumnarRowGroupSize;
+    string ColumnarTags;
+
+    // paired FASTQ options
+    bool HasPairedMaxMemory;
+    string PairedMaxMemory;
+
+    // thread options
+    unsigned int NumThreads;
 
     // constructor
     ConvertSettings(void)
@@ -102,12 +435,27 @@ struct ConvertTool::ConvertSettings {
         , HasInputFilelist(false)
         , HasOutput(false)
         , HasFormat(false)
+        , HasInputFormat(false)
         , HasRegion(false)
         , HasFastaFilename(false)
+        , HasMinBaseQuality(false)
+        , HasNumThreads(false)
+        , IsCompressingOutput(false)
         , IsOmittingSamHeader(false)
+        , IsPairingMates(false)
+        , IsPrintingPileupAlleleCounts(false)
         , IsPrintingPileupMapQualities(false)
         , OutputFilename(Options::StandardOut())
+        , InputFormat(FORMAT_BAM)
         , FastaFilename("")
+        , MinBaseQuality(PILEUP_DEFAULT_MIN_BASE_QUALITY)
+        , HasColumnarRowGroupSize(false)
+        , HasColumnarTags(false)
+        , ColumnarRowGroupSize(COLUMNAR_DEFAULT_ROW_GROUP_SIZE)
+        , ColumnarTags("")
+        , HasPairedMaxMemory(false)
+        , PairedMaxMemory(PAIRED_DEFAULT_MAX_MEMORY)
+        , NumThreads(CONVERT_DEFAULT_NUM_THREADS)
     { } 
 };    
 
@@ -121,6 +469,10 @@ struct ConvertTool::ConvertToolPrivate {
         ConvertToolPrivate(ConvertTool::ConvertSettings* settings)
             : m_settings(settings)
             , m_out(cout.rdbuf())
+            , m_printFunction(0)
+            , m_samFormatter(0)
+            , m_mateCollator(0)
+            , m_pairedVisitor(0)
         { }
 
         ~ConvertToolPrivate(void) { }
@@ -131,21 +483,64 @@ struct ConvertTool::ConvertToolPrivate {
         
     // internal methods
     private:
-        void PrintBed(const BamAlignment& a);
-        void PrintFasta(const BamAlignment& a);
-        void PrintFastq(const BamAlignment& a);
-        void PrintJson(const BamAlignment& a);
-        void PrintSam(const BamAlignment& a);
-        void PrintYaml(const BamAlignment& a);
+        class BatchTask;
+        typedef void (ConvertToolPrivate::*PrintFunction)(const BamAlignment& a, ostream& out) const;
+
+        bool CollateBatch(const ConvertBatch& batch);
+        void FormatBatch(ConvertBatch& batch);
+        bool RunBatchedConversion(ConvertInput* reader);
+
+        void PrintBed(const BamAlignment& a, ostream& out) const;
+        void PrintFasta(const BamAlignment& a, ostream& out) const;
+        void PrintFastq(const BamAlignment& a, ostream& out) const;
+        void PrintJson(const BamAlignment& a, ostream& out) const;
+        void PrintYaml(const BamAlignment& a, ostream& out) const;
         
-        // special case - uses the PileupEngine
-        bool RunPileupConversion(BamMultiReader* reader);
+        // special case - uses the PileupEngine (or AlleleCountEngine)
+        bool RunAlleleCountConversion(ConvertInput* reader);
+        bool RunPileupConversion(ConvertInput* reader);
+
+        // special case - written column-wise, by ColumnarWriter
+        bool RunColumnarConversion(ConvertInput* reader);
+
+        // special case - FASTQ, with mates written to separate files
+        bool RunPairedFastqConversion(ConvertInput* reader, const bool isCompressingOutput);
         
     // data members
     private: 
         ConvertTool::ConvertSettings* m_settings;
         RefVector m_references;
         ostream m_out;
+
+        // per-alignment formatting (SAM uses formatter, all others a print function)
+        PrintFunction m_printFunction;
+        SamRecordFormatter* m_samFormatter;
+
+        // paired FASTQ only
+        MateCollator* m_mateCollator;
+        ConvertPairedFastqVisitor* m_pairedVisitor;
+
+        // batch state
+        Mutex m_batchMutex;
+        WaitCondition m_batchFinished;
+};
+
+// formats one batch on a worker thread
+class ConvertTool::ConvertToolPrivate::BatchTask : public ThreadPool::Task {
+
+    public:
+        BatchTask(ConvertToolPrivate* tool, ConvertBatch* batch)
+            : m_tool(tool)
+            , m_batch(batch)
+        { }
+
+        void Run(void) {
+            m_tool->FormatBatch(*m_batch);
+        }
+
+    private:
+        ConvertToolPrivate* m_tool;
+        ConvertBatch* m_batch;
 };
 
 bool ConvertTool::ConvertToolPrivate::Run(void) {
@@ -171,13 +566,42 @@ bool ConvertTool::ConvertToolPrivate::Run(void) {
             m_settings->InputFiles.push_back(line);
     }
 
-    // open input files
-    BamMultiReader reader;
-    if ( !reader.Open(m_settings->InputFiles) ) {
-        cerr << "bamtools convert ERROR: could not open input BAM file(s)... Aborting." << endl;
+    // check input format
+    const bool isColumnarInput = ( m_settings->InputFormat == FORMAT_COLUMNAR );
+    if ( m_settings->InputFormat != FORMAT_BAM && !isColumnarInput ) {
+        cerr << "bamtools convert ERROR: unrecognized input format: " << m_settings->InputFormat << endl;
         return false;
     }
 
+    // open columnar input file (read back as is, without an index)
+    ColumnarReader columnarReader;
+    if ( isColumnarInput ) {
+        if ( m_settings->InputFiles.size() != 1 ) {
+            cerr << "bamtools convert ERROR: columnar input must be a single file" << endl;
+            return false;
+        }
+        if ( m_settings->HasRegion ) {
+            cerr << "bamtools convert ERROR: -region is not supported for columnar input" << endl;
+            return false;
+        }
+        if ( !columnarReader.Open(m_settings->InputFiles.front()) ) {
+            cerr << "bamtools convert ERROR: could not open input columnar file... Aborting." << endl
+                 << columnarReader.GetErrorString() << endl;
+            return false;
+        }
+    }
+
+    // otherwise open input BAM files
+    // (if multithreaded, files are also decompressed & parsed ahead on background threads)
+    BamMultiReader reader;
+    if ( !isColumnarInput ) {
+        reader.SetPrefetching( m_settings->NumThreads > 1 && m_settings->Format != FORMAT_PILEUP );
+        if ( !reader.Open(m_settings->InputFiles) ) {
+            cerr << "bamtools convert ERROR: could not open input BAM file(s)... Aborting." << endl;
+            return false;
+        }
+    }
+
     // if input is not stdin & a region is provided, look for index files
     if ( m_settings->HasInput && m_settings->HasRegion ) {
         if ( !reader.LocateIndexes() ) {
@@ -187,7 +611,14 @@ bool ConvertTool::ConvertToolPrivate::Run(void) {
     }
 
     // retrieve reference data
-    m_references = reader.GetReferenceData();
+    m_references = ( isColumnarInput ? columnarReader.GetReferenceData() : reader.GetReferenceData() );
+
+    // alignments are converted from either reader
+    ConvertReaderInput<BamMultiReader> bamInput(&reader);
+    ConvertReaderInput<ColumnarReader> columnarInput(&columnarReader);
+    ConvertInput* input = &bamInput;
+    if ( isColumnarInput )
+        input = &columnarInput;
 
     // set region if specified
     BamRegion region;
@@ -211,20 +642,37 @@ bool ConvertTool::ConvertToolPrivate::Run(void) {
         }
     }
         
-    // if output file given
-    ofstream outFile;
-    if ( m_settings->HasOutput ) {
-      
-        // open output file stream
-        outFile.open(m_settings->OutputFilename.c_str());
-        if ( !outFile ) {
+    // mate pairing only makes sense for FASTQ
+    if ( m_settings->IsPairingMates && m_settings->Format != FORMAT_FASTQ ) {
+        cerr << "bamtools convert ERROR: -paired is only supported for FASTQ format" << endl;
+        return false;
+    }
+
+    // compress output if requested (explicitly, or by output filename)
+    const bool isCompressingOutput = ( m_settings->IsCompressingOutput ||
+                                       Utilities::EndsWith(m_settings->OutputFilename, COMPRESSED_EXTENSION_GZ) ||
+                                       Utilities::EndsWith(m_settings->OutputFilename, COMPRESSED_EXTENSION_BGZ) );
+
+    // columnar output is compressed per column already
+    if ( m_settings->Format == FORMAT_COLUMNAR && isCompressingOutput ) {
+        cerr << "bamtools convert ERROR: columnar output cannot be BGZF-compressed "
+                "(its columns are compressed already)" << endl;
+        return false;
+    }
+
+    // open output (columnar & paired FASTQ conversions open their own files)
+    ConvertOutputFile outFile;
+    if ( !m_settings->IsPairingMates && m_settings->Format != FORMAT_COLUMNAR ) {
+        if ( !outFile.Open(m_settings->OutputFilename, isCompressingOutput, m_settings->NumThreads) ) {
             cerr << "bamtools convert ERROR: could not open " << m_settings->OutputFilename
                  << " for output" << endl;
-            return false; 
+            if ( isCompressingOutput )
+                cerr << outFile.GetErrorString() << endl;
+            return false;
         }
-        
-        // set m_out to file's streambuf
-        m_out.rdbuf(outFile.rdbuf()); 
+
+        // set m_out to output's streambuf
+        m_out.rdbuf(outFile.Buffer());
     }
     
     // -------------------------------------
@@ -234,8 +682,22 @@ bool ConvertTool::ConvertToolPrivate::Run(void) {
     
     // pileup is special case
     // conversion not done per alignment, like the other formats
-    if ( m_settings->Format == FORMAT_PILEUP )
-        convertedOk = RunPileupConversion(&reader);
+    if ( m_settings->Format == FORMAT_PILEUP ) {
+        if ( m_settings->IsPrintingPileupAlleleCounts )
+            convertedOk = RunAlleleCountConversion(input);
+        else
+            convertedOk = RunPileupConversion(input);
+    }
+
+    // columnar is special case
+    // alignments are buffered & written per column, in row groups
+    else if ( m_settings->Format == FORMAT_COLUMNAR )
+        convertedOk = RunColumnarConversion(input);
+
+    // paired FASTQ is special case
+    // mates are collated into separate files
+    else if ( m_settings->IsPairingMates )
+        convertedOk = RunPairedFastqConversion(input, isCompressingOutput);
     
     // all other formats
     else {
@@ -243,13 +705,13 @@ bool ConvertTool::ConvertToolPrivate::Run(void) {
         bool formatError = false;
         
         // set function pointer to proper conversion method
-        void (BamTools::ConvertTool::ConvertToolPrivate::*pFunction)(const BamAlignment&) = 0;
-        if      ( m_settings->Format == FORMAT_BED )   pFunction = &BamTools::ConvertTool::ConvertToolPrivate::PrintBed;
-        else if ( m_settings->Format == FORMAT_FASTA ) pFunction = &BamTools::ConvertTool::ConvertToolPrivate::PrintFasta;
-        else if ( m_settings->Format == FORMAT_FASTQ ) pFunction = &BamTools::ConvertTool::ConvertToolPrivate::PrintFastq;
-        else if ( m_settings->Format == FORMAT_JSON )  pFunction = &BamTools::ConvertTool::ConvertToolPrivate::PrintJson;
-        else if ( m_settings->Format == FORMAT_SAM )   pFunction = &BamTools::ConvertTool::ConvertToolPrivate::PrintSam;
-        else if ( m_settings->Format == FORMAT_YAML )  pFunction = &BamTools::ConvertTool::ConvertToolPrivate::PrintYaml;
+        SamRecordFormatter samFormatter(m_references);
+        if      ( m_settings->Format == FORMAT_BED )   m_printFunction = &BamTools::ConvertTool::ConvertToolPrivate::PrintBed;
+        else if ( m_settings->Format == FORMAT_FASTA ) m_printFunction = &BamTools::ConvertTool::ConvertToolPrivate::PrintFasta;
+        else if ( m_settings->Format == FORMAT_FASTQ ) m_printFunction = &BamTools::ConvertTool::ConvertToolPrivate::PrintFastq;
+        else if ( m_settings->Format == FORMAT_JSON )  m_printFunction = &BamTools::ConvertTool::ConvertToolPrivate::PrintJson;
+        else if ( m_settings->Format == FORMAT_SAM )   m_samFormatter  = &samFormatter;
+        else if ( m_settings->Format == FORMAT_YAML )  m_printFunction = &BamTools::ConvertTool::ConvertToolPrivate::PrintYaml;
         else { 
             cerr << "bamtools convert ERROR: unrecognized format: " << m_settings->Format << endl;
             cerr << "Please see documentation for list of supported formats " << endl;
@@ -262,47 +724,289 @@ bool ConvertTool::ConvertToolPrivate::Run(void) {
         
             // if SAM format & not omitting header, print SAM header first
             if ( (m_settings->Format == FORMAT_SAM) && !m_settings->IsOmittingSamHeader ) 
-                m_out << reader.GetHeaderText();
-            
-            // iterate through file, doing conversion
-            BamAlignment a;
-            while ( reader.GetNextAlignment(a) )
-                (this->*pFunction)(a);
-            
-            // set flag for successful conversion
-            convertedOk = true;
+                m_out << input->GetHeaderText();
+
+            // do conversion
+            convertedOk = RunBatchedConversion(input);
         }
+        m_samFormatter = 0;
     }
     
     // ------------------------
     // clean up & exit
+
+    // a columnar file may end early, if damaged
+    if ( isColumnarInput && !columnarReader.GetErrorString().empty() ) {
+        cerr << "bamtools convert ERROR: could not read input columnar file" << endl
+             << columnarReader.GetErrorString() << endl;
+        convertedOk = false;
+    }
+
     reader.Close();
-    if ( m_settings->HasOutput )
-        outFile.close();
+    columnarReader.Close();
+    m_out.flush();
+    if ( !outFile.Close() || !m_out ) {
+        cerr << "bamtools convert ERROR: could not write output to " << m_settings->OutputFilename << endl;
+        if ( isCompressingOutput )
+            cerr << outFile.GetErrorString() << endl;
+        convertedOk = false;
+    }
     return convertedOk;   
 }
 
+// hands formatted FASTQ records of batch over to mate collator
+bool ConvertTool::ConvertToolPrivate::CollateBatch(const ConvertBatch& batch) {
+
+    for ( size_t i = 0; i < batch.NumAlignments; ++i ) {
+        const BamAlignment& a = batch.Alignments[i];
+        if ( !IsPrimaryRead(a) )
+            continue;
+
+        // determine mate number (0 = not paired, or unknown)
+        int mateNumber = 0;
+        if ( a.IsPaired() && (a.IsFirstMate() != a.IsSecondMate()) )
+            mateNumber = ( a.IsFirstMate() ? 1 : 2 );
+
+        // mates are collated by name, all other reads are singletons
+        if ( mateNumber == 0 )
+            m_pairedVisitor->VisitSingleton(batch.Records[i]);
+        else if ( !m_mateCollator->AddMate(a.Name, mateNumber, batch.Records[i]) )
+            return false;
+    }
+    return m_pairedVisitor->IsOk();
+}
+
+// formats all alignments in batch to its output buffer & notifies writer
+void ConvertTool::ConvertToolPrivate::FormatBatch(ConvertBatch& batch) {
+
+    batch.Output.clear();
+
+    // SAM formatter appends directly to output buffer
+    if ( m_samFormatter ) {
+        for ( size_t i = 0; i < batch.NumAlignments; ++i )
+            m_samFormatter->Append(batch.Alignments[i], batch.Output);
+    }
+
+    // paired FASTQ keeps records separate, for collating mates
+    else if ( m_mateCollator ) {
+        ostringstream out;
+        for ( size_t i = 0; i < batch.NumAlignments; ++i ) {
+            const BamAlignment& a = batch.Alignments[i];
+            if ( !IsPrimaryRead(a) )
+                continue;
+            out.str("");
+            (this->*m_printFunction)(a, out);
+            batch.Records[i] = out.str();
+        }
+    }
+
+    // all other formats print to stream
+    else {
+        ostringstream out;
+        for ( size_t i = 0; i < batch.NumAlignments; ++i )
+            (this->*m_printFunction)(batch.Alignments[i], out);
+        batch.Output = out.str();
+    }
+
+    MutexLocker locker(m_batchMutex);
+    batch.IsDone = true;
+    m_batchFinished.WakeAll();
+}
+
+// reads alignments in batches, formats batches on worker threads, & writes their output in input order
+bool ConvertTool::ConvertToolPrivate::RunBatchedConversion(ConvertInput* reader) {
+
+    ThreadPool pool(m_settings->NumThreads);
+
+    // batches (& tasks) are re-used, cycling through a fixed number of slots
+    const size_t numSlots = pool.NumThreads() * CONVERT_PENDING_BATCHES_PER_THREAD;
+    vector<ConvertBatch> batches(numSlots);
+    vector<BatchTask> tasks;
+    tasks.reserve(numSlots);
+    for ( size_t i = 0; i < numSlots; ++i ) {
+        batches[i].Alignments.resize(CONVERT_BATCH_SIZE);
+        if ( m_mateCollator )
+            batches[i].Records.resize(CONVERT_BATCH_SIZE);
+        tasks.push_back( BatchTask(this, &batches[i]) );
+    }
+
+    size_t numRead    = 0;
+    size_t numWritten = 0;
+    bool isReading = true;
+    while ( true ) {
+
+        // read & submit batches, while any slot is free
+        while ( isReading && numRead < numWritten + numSlots ) {
+            ConvertBatch& batch = batches[numRead % numSlots];
+            batch.NumAlignments = 0;
+            while ( batch.NumAlignments < CONVERT_BATCH_SIZE &&
+                    reader->GetNextAlignment(batch.Alignments[batch.NumAlignments]) )
+            {
+                ++batch.NumAlignments;
+            }
+            if ( batch.NumAlignments < CONVERT_BATCH_SIZE )
+                isReading = false;
+            if ( batch.NumAlignments == 0 )
+                break;
+
+            batch.IsDone = false;
+            pool.Submit(&tasks[numRead % numSlots]);
+            ++numRead;
+        }
+
+        // stop if all batches written
+        if ( numWritten == numRead )
+            break;
+
+        // wait for oldest batch & write its output
+        ConvertBatch& batch = batches[numWritten % numSlots];
+        {
+            MutexLocker locker(m_batchMutex);
+            while ( !batch.IsDone )
+                m_batchFinished.Wait(m_batchMutex);
+        }
+        if ( m_mateCollator ) {
+            if ( !CollateBatch(batch) ) {
+                pool.WaitForAll();
+                return false;
+            }
+        }
+        else
+            m_out.write(batch.Output.data(), batch.Output.size());
+        ++numWritten;
+    }
+
+    pool.WaitForAll();
+    return true;
+}
+
+// writes alignments in BamTools' columnar format (see utils/bamtools_columnar.h)
+bool ConvertTool::ConvertToolPrivate::RunColumnarConversion(ConvertInput* reader) {
+
+    // set up writer
+    ColumnarWriter writer;
+    writer.SetNumThreads(m_settings->NumThreads);
+    writer.SetRowGroupSize(m_settings->ColumnarRowGroupSize);
+    if ( m_settings->HasColumnarTags )
+        writer.SetTags( Utilities::Split(m_settings->ColumnarTags, ',') );
+    if ( !writer.Open(m_settings->OutputFilename, reader->GetHeaderText(), m_references) ) {
+        cerr << "bamtools convert ERROR: could not open " << m_settings->OutputFilename
+             << " for output" << endl
+             << writer.GetErrorString() << endl;
+        return false;
+    }
+
+    // write alignments
+    BamAlignment a;
+    while ( reader->GetNextAlignment(a) ) {
+        if ( !writer.Write(a) ) {
+            cerr << "bamtools convert ERROR: " << writer.GetErrorString() << endl;
+            writer.Close();
+            return false;
+        }
+    }
+
+    if ( !writer.Close() ) {
+        cerr << "bamtools convert ERROR: " << writer.GetErrorString() << endl;
+        return false;
+    }
+    return true;
+}
+
+// writes first & second mates of paired reads to separate FASTQ files, in matching order,
+// & all other reads (unpaired, or missing their mate) to a singletons file
+bool ConvertTool::ConvertToolPrivate::RunPairedFastqConversion(ConvertInput* reader, const bool isCompressingOutput) {
+
+    // output filename is used as template for mate files
+    if ( !m_settings->HasOutput || m_settings->OutputFilename == Options::StandardOut() ) {
+        cerr << "bamtools convert ERROR: -paired requires an output filename (-out)" << endl;
+        return false;
+    }
+
+    uint64_t maxMemory = 0;
+    if ( !Utilities::ParseMemorySize(m_settings->PairedMaxMemory, maxMemory, 'M') ) {
+        cerr << "bamtools convert ERROR: invalid memory size: " << m_settings->PairedMaxMemory << endl;
+        return false;
+    }
+
+    // split output filename into <prefix><extension>[<compressed extension>]
+    string prefix = m_settings->OutputFilename;
+    string compressedExtension = ( isCompressingOutput ? COMPRESSED_EXTENSION_GZ : "" );
+    if ( Utilities::EndsWith(prefix, COMPRESSED_EXTENSION_GZ) )
+        compressedExtension = COMPRESSED_EXTENSION_GZ;
+    else if ( Utilities::EndsWith(prefix, COMPRESSED_EXTENSION_BGZ) )
+        compressedExtension = COMPRESSED_EXTENSION_BGZ;
+    if ( Utilities::EndsWith(prefix, compressedExtension) )
+        prefix.erase(prefix.size() - compressedExtension.size());
+
+    string extension = PAIRED_EXTENSION_FASTQ;
+    if ( Utilities::EndsWith(prefix, PAIRED_EXTENSION_FQ) )
+        extension = PAIRED_EXTENSION_FQ;
+    if ( Utilities::EndsWith(prefix, extension) )
+        prefix.erase(prefix.size() - extension.size());
+
+    // open mate files
+    const string firstMatesFilename  = prefix + PAIRED_SUFFIX_FIRST_MATE  + extension + compressedExtension;
+    const string secondMatesFilename = prefix + PAIRED_SUFFIX_SECOND_MATE + extension + compressedExtension;
+    const string singletonsFilename  = prefix + PAIRED_SUFFIX_SINGLETONS  + extension + compressedExtension;
+    ConvertOutputFile firstMates;
+    ConvertOutputFile secondMates;
+    ConvertOutputFile singletons;
+    if ( !firstMates.Open(firstMatesFilename, isCompressingOutput, m_settings->NumThreads) ||
+         !secondMates.Open(secondMatesFilename, isCompressingOutput, m_settings->NumThreads) ||
+         !singletons.Open(singletonsFilename, isCompressingOutput, m_settings->NumThreads) )
+    {
+        cerr << "bamtools convert ERROR: could not open " << firstMatesFilename << ", "
+             << secondMatesFilename << " & " << singletonsFilename << " for output" << endl;
+        return false;
+    }
+
+    // set up mate collator
+    ConvertPairedFastqVisitor visitor(&firstMates, &secondMates, &singletons);
+    MateCollator collator(&visitor);
+    collator.SetMaxMemory(maxMemory);
+    collator.SetTempFilenameStub(prefix + PAIRED_TEMP_FILENAME_STUB);
+
+    // do conversion
+    m_printFunction = &BamTools::ConvertTool::ConvertToolPrivate::PrintFastq;
+    m_mateCollator  = &collator;
+    m_pairedVisitor = &visitor;
+    bool convertedOk = RunBatchedConversion(reader);
+    if ( convertedOk )
+        convertedOk = collator.Finish();
+    m_mateCollator  = 0;
+    m_pairedVisitor = 0;
+
+    // close files
+    const bool isClosedOk = firstMates.Close() && secondMates.Close() && singletons.Close();
+    if ( !visitor.IsOk() || !isClosedOk ) {
+        cerr << "bamtools convert ERROR: could not write paired FASTQ output" << endl;
+        convertedOk = false;
+    }
+    return convertedOk;
+}
+
 // ----------------------------------------------------------
 // Conversion/output methods
 // ----------------------------------------------------------
 
-void ConvertTool::ConvertToolPrivate::PrintBed(const BamAlignment& a) { 
+void ConvertTool::ConvertToolPrivate::PrintBed(const BamAlignment& a, ostream& out) const { 
   
     // tab-delimited, 0-based half-open 
     // (e.g. a 50-base read aligned to pos 10 could have BED coordinates (10, 60) instead of BAM coordinates (10, 59) )
     // <chromName> <chromStart> <chromEnd> <readName> <score> <strand>
 
-    m_out << m_references.at(a.RefID).RefName << "\t"
-          << a.Position << "\t"
-          << a.GetEndPosition() << "\t"
-          << a.Name << "\t"
-          << a.MapQuality << "\t"
-          << (a.IsReverseStrand() ? "-" : "+") << endl;
+    out << m_references.at(a.RefID).RefName << "\t"
+        << a.Position << "\t"
+        << a.GetEndPosition() << "\t"
+        << a.Name << "\t"
+        << a.MapQuality << "\t"
+        << (a.IsReverseStrand() ? "-" : "+") << endl;
 }
 
 // print BamAlignment in FASTA format
 // N.B. - uses QueryBases NOT AlignedBases
-void ConvertTool::ConvertToolPrivate::PrintFasta(const BamAlignment& a) { 
+void ConvertTool::ConvertToolPrivate::PrintFasta(const BamAlignment& a, ostream& out) const { 
     
     // >BamAlignment.Name
     // BamAlignment.QueryBases (up to FASTA_LINE_MAX bases per line)
@@ -311,7 +1015,7 @@ void ConvertTool::ConvertToolPrivate::PrintFasta(const BamAlignment& a) {
     // N.B. - QueryBases are reverse-complemented if aligned to reverse strand
   
     // print header
-    m_out << ">" << a.Name << endl;
+    out << ">" << a.Name << endl;
     
     // handle reverse strand alignment - bases 
     string sequence = a.QueryBases;
@@ -320,7 +1024,7 @@ void ConvertTool::ConvertToolPrivate::PrintFasta(const BamAlignment& a) {
     
     // if sequence fits on single line
     if ( sequence.length() <= FASTA_LINE_MAX )
-        m_out << sequence << endl;
+        out << sequence << endl;
     
     // else split over multiple lines
     else {
@@ -330,18 +1034,18 @@ void ConvertTool::ConvertToolPrivate::PrintFasta(const BamAlignment& a) {
         
         // write subsequences to each line
         while ( position < (seqLength - FASTA_LINE_MAX) ) {
-            m_out << sequence.substr(position, FASTA_LINE_MAX) << endl;
+            out << sequence.substr(position, FASTA_LINE_MAX) << endl;
             position += FASTA_LINE_MAX;
         }
         
         // write final subsequence
-        m_out << sequence.substr(position) << endl;
+        out << sequence.substr(position) << endl;
     }
 }
 
 // print BamAlignment in FASTQ format
 // N.B. - uses QueryBases NOT AlignedBases
-void ConvertTool::ConvertToolPrivate::PrintFastq(const BamAlignment& a) { 
+void ConvertTool::ConvertToolPrivate::PrintFastq(const BamAlignment& a, ostream& out) const { 
   
     // @BamAlignment.Name
     // BamAlignment.QueryBases
@@ -365,65 +1069,65 @@ void ConvertTool::ConvertToolPrivate::PrintFastq(const BamAlignment& a) {
     }
   
     // write to output stream
-    m_out << "@" << name << endl
-          << sequence    << endl
-          << "+"         << endl
-          << qualities   << endl;
+    out << "@" << name << endl
+        << sequence    << endl
+        << "+"         << endl
+        << qualities   << endl;
 }
 
 // print BamAlignment in JSON format
-void ConvertTool::ConvertToolPrivate::PrintJson(const BamAlignment& a) {
+void ConvertTool::ConvertToolPrivate::PrintJson(const BamAlignment& a, ostream& out) const {
   
     // write name & alignment flag
-    m_out << "{\"name\":\"" << a.Name << "\",\"alignmentFlag\":\"" << a.AlignmentFlag << "\",";
+    out << "{\"name\":\"" << a.Name << "\",\"alignmentFlag\":\"" << a.AlignmentFlag << "\",";
     
     // write reference name
     if ( (a.RefID >= 0) && (a.RefID < (int)m_references.size()) ) 
-        m_out << "\"reference\":\"" << m_references[a.RefID].RefName << "\",";
+        out << "\"reference\":\"" << m_references[a.RefID].RefName << "\",";
     
     // write position & map quality
-    m_out << "\"position\":" << a.Position+1 << ",\"mapQuality\":" << a.MapQuality << ",";
+    out << "\"position\":" << a.Position+1 << ",\"mapQuality\":" << a.MapQuality << ",";
     
     // write CIGAR
     const vector<CigarOp>& cigarData = a.CigarData;
     if ( !cigarData.empty() ) {
-        m_out << "\"cigar\":[";
+        out << "\"cigar\":[";
         vector<CigarOp>::const_iterator cigarBegin = cigarData.begin();
         vector<CigarOp>::const_iterator cigarIter  = cigarBegin;
         vector<CigarOp>::const_iterator cigarEnd   = cigarData.end();
         for ( ; cigarIter != cigarEnd; ++cigarIter ) {
             const CigarOp& op = (*cigarIter);
             if (cigarIter != cigarBegin)
-                m_out << ",";
-            m_out << "\"" << op.Length << op.Type << "\"";
+                out << ",";
+            out << "\"" << op.Length << op.Type << "\"";
         }
-        m_out << "],";
+        out << "],";
     }
     
     // write mate reference name, mate position, & insert size
     if ( a.IsPaired() && (a.MateRefID >= 0) && (a.MateRefID < (int)m_references.size()) ) {
-        m_out << "\"mate\":{"
-              << "\"reference\":\"" << m_references[a.MateRefID].RefName << "\","
-              << "\"position\":" << a.MatePosition+1
-              << ",\"insertSize\":" << a.InsertSize << "},";
+        out << "\"mate\":{"
+            << "\"reference\":\"" << m_references[a.MateRefID].RefName << "\","
+            << "\"position\":" << a.MatePosition+1
+            << ",\"insertSize\":" << a.InsertSize << "},";
     }
     
     // write sequence
     if ( !a.QueryBases.empty() ) 
-        m_out << "\"queryBases\":\"" << a.QueryBases << "\",";
+        out << "\"queryBases\":\"" << a.QueryBases << "\",";
     
     // write qualities
     if ( !a.Qualities.empty() && a.Qualities.at(0) != (char)0xFF ) {
         string::const_iterator s = a.Qualities.begin();
-        m_out << "\"qualities\":[" << static_cast<short>(*s) - 33;
+        out << "\"qualities\":[" << static_cast<short>(*s) - 33;
         ++s;
         for ( ; s != a.Qualities.end(); ++s )
-            m_out << "," << static_cast<short>(*s) - 33;
-        m_out << "],";
+            out << "," << static_cast<short>(*s) - 33;
+        out << "],";
     }
     
     // write alignment's source BAM file
-    m_out << "\"filename\":\"" << a.Filename << "\",";
+    out << "\"filename\":\"" << a.Filename << "\",";
 
     // write tag data
     const char* tagData = a.TagData.c_str();
@@ -431,15 +1135,15 @@ void ConvertTool::ConvertToolPrivate::PrintJson(const BamAlignment& a) {
     size_t index = 0;
     if ( index < tagDataLength ) {
 
-        m_out << "\"tags\":{";
+        out << "\"tags\":{";
         
         while ( index < tagDataLength ) {
 
             if ( index > 0 )
-                m_out << ",";
+                out << ",";
             
             // write tag name
-            m_out << "\"" << a.TagData.substr(index, 2) << "\":";
+            out << "\"" << a.TagData.substr(index, 2) << "\":";
             index += 2;
             
             // get data type
@@ -447,58 +1151,58 @@ void ConvertTool::ConvertToolPrivate::PrintJson(const BamAlignment& a) {
             ++index;
             switch ( type ) {
                 case (Constants::BAM_TAG_TYPE_ASCII) :
-                    m_out << "\"" << tagData[index] << "\"";
+                    out << "\"" << tagData[index] << "\"";
                     ++index; 
                     break;
                 
                 case (Constants::BAM_TAG_TYPE_INT8) :
                     // force value into integer-type (instead of char value)
-                    m_out << static_cast<int16_t>(tagData[index]);
+                    out << static_cast<int16_t>(tagData[index]);
                     ++index;
                     break;
 
                 case (Constants::BAM_TAG_TYPE_UINT8) :
                     // force value into integer-type (instead of char value)
-                    m_out << static_cast<uint16_t>(tagData[index]);
+                    out << static_cast<uint16_t>(tagData[index]);
                     ++index; 
                     break;
                 
                 case (Constants::BAM_TAG_TYPE_INT16) :
-                    m_out << BamTools::UnpackSignedShort(&tagData[index]);
+                    out << BamTools::UnpackSignedShort(&tagData[index]);
                     index += sizeof(int16_t);
                     break;
 
                 case (Constants::BAM_TAG_TYPE_UINT16) :
-                    m_out << BamTools::UnpackUnsignedShort(&tagData[index]);
+                    out << BamTools::UnpackUnsignedShort(&tagData[index]);
                     index += sizeof(uint16_t);
                     break;
                     
                 case (Constants::BAM_TAG_TYPE_INT32) :
-                    m_out << BamTools::UnpackSignedInt(&tagData[index]);
+                    out << BamTools::UnpackSignedInt(&tagData[index]);
                     index += sizeof(int32_t);
                     break;
 
                 case (Constants::BAM_TAG_TYPE_UINT32) :
-                    m_out << BamTools::UnpackUnsignedInt(&tagData[index]);
+                    out << BamTools::UnpackUnsignedInt(&tagData[index]);
                     index += sizeof(uint32_t);
                     break;
 
                 case (Constants::BAM_TAG_TYPE_FLOAT) :
-                    m_out << BamTools::UnpackFloat(&tagData[index]);
+                    out << BamTools::UnpackFloat(&tagData[index]);
                     index += sizeof(float);
                     break;
                 
                 case (Constants::BAM_TAG_TYPE_HEX)    :
                 case (Constants::BAM_TAG_TYPE_STRING) :
-                    m_out << "\""; 
+                    out << "\""; 
                     while (tagData[index]) {
                         if (tagData[index] == '\"')
-                            m_out << "\\\""; // escape for json
+                            out << "\\\""; // escape for json
                         else
-                            m_out << tagData[index];
+                            out << tagData[index];
                         ++index;
                     }
-                    m_out << "\""; 
+                    out << "\""; 
                     ++index; 
                     break;      
             }
@@ -507,184 +1211,83 @@ void ConvertTool::ConvertToolPrivate::PrintJson(const BamAlignment& a) {
                 break;
         }
 
-        m_out << "}";
-    }
-
-    m_out << "}" << endl;
-}
-
-// print BamAlignment in SAM format
-void ConvertTool::ConvertToolPrivate::PrintSam(const BamAlignment& a) {
-  
-    // tab-delimited
-    // <QNAME> <FLAG> <RNAME> <POS> <MAPQ> <CIGAR> <MRNM> <MPOS> <ISIZE> <SEQ> <QUAL> [ <TAG>:<VTYPE>:<VALUE> [...] ]
-  
-    // write name & alignment flag
-   m_out << a.Name << "\t" << a.AlignmentFlag << "\t";
-
-    // write reference name
-    if ( (a.RefID >= 0) && (a.RefID < (int)m_references.size()) ) 
-        m_out << m_references[a.RefID].RefName << "\t";
-    else 
-        m_out << "*\t";
-    
-    // write position & map quality
-    m_out << a.Position+1 << "\t" << a.MapQuality << "\t";
-    
-    // write CIGAR
-    const vector<CigarOp>& cigarData = a.CigarData;
-    if ( cigarData.empty() ) m_out << "*\t";
-    else {
-        vector<CigarOp>::const_iterator cigarIter = cigarData.begin();
-        vector<CigarOp>::const_iterator cigarEnd  = cigarData.end();
-        for ( ; cigarIter != cigarEnd; ++cigarIter ) {
-            const CigarOp& op = (*cigarIter);
-            m_out << op.Length << op.Type;
-        }
-        m_out << "\t";
-    }
-    
-    // write mate reference name, mate position, & insert size
-    if ( a.IsPaired() && (a.MateRefID >= 0) && (a.MateRefID < (int)m_references.size()) ) {
-        if ( a.MateRefID == a.RefID )
-            m_out << "=\t";
-        else
-           m_out << m_references[a.MateRefID].RefName << "\t";
-        m_out << a.MatePosition+1 << "\t" << a.InsertSize << "\t";
-    } 
-    else
-        m_out << "*\t0\t0\t";
-    
-    // write sequence
-    if ( a.QueryBases.empty() )
-        m_out << "*\t";
-    else
-        m_out << a.QueryBases << "\t";
-    
-    // write qualities
-    if ( a.Qualities.empty() || (a.Qualities.at(0) == (char)0xFF) )
-        m_out << "*";
-    else
-        m_out << a.Qualities;
-    
-    // write tag data
-    const char* tagData = a.TagData.c_str();
-    const size_t tagDataLength = a.TagData.length();
-    
-    size_t index = 0;
-    while ( index < tagDataLength ) {
-
-        // write tag name   
-        string tagName = a.TagData.substr(index, 2);
-        m_out << "\t" << tagName << ":";
-        index += 2;
-        
-        // get data type
-        char type = a.TagData.at(index);
-        ++index;
-        switch ( type ) {
-            case (Constants::BAM_TAG_TYPE_ASCII) :
-                m_out << "A:" << tagData[index];
-                ++index;
-                break;
-
-            case (Constants::BAM_TAG_TYPE_INT8) :
-                // force value into integer-type (instead of char value)
-                m_out << "i:" << static_cast<int16_t>(tagData[index]);
-                ++index;
-                break;
-
-            case (Constants::BAM_TAG_TYPE_UINT8) :
-                // force value into integer-type (instead of char value)
-                m_out << "i:" << static_cast<uint16_t>(tagData[index]);
-                ++index;
-                break;
-
-            case (Constants::BAM_TAG_TYPE_INT16) :
-                m_out << "i:" << BamTools::UnpackSignedShort(&tagData[index]);
-                index += sizeof(int16_t);
-                break;
-
-            case (Constants::BAM_TAG_TYPE_UINT16) :
-                m_out << "i:" << BamTools::UnpackUnsignedShort(&tagData[index]);
-                index += sizeof(uint16_t);
-                break;
-
-            case (Constants::BAM_TAG_TYPE_INT32) :
-                m_out << "i:" << BamTools::UnpackSignedInt(&tagData[index]);
-                index += sizeof(int32_t);
-                break;
-
-            case (Constants::BAM_TAG_TYPE_UINT32) :
-                m_out << "i:" << BamTools::UnpackUnsignedInt(&tagData[index]);
-                index += sizeof(uint32_t);
-                break;
-
-            case (Constants::BAM_TAG_TYPE_FLOAT) :
-                m_out << "f:" << BamTools::UnpackFloat(&tagData[index]);
-                index += sizeof(float);
-                break;
-
-            case (Constants::BAM_TAG_TYPE_HEX)    : // fall-through
-            case (Constants::BAM_TAG_TYPE_STRING) :
-                m_out << type << ":";
-                while (tagData[index]) {
-                    m_out << tagData[index];
-                    ++index;
-                }
-                ++index;
-                break;
-        }
-
-        if ( tagData[index] == '\0' )
-            break;
+        out << "}";
     }
 
-    m_out << endl;
+    out << "}" << endl;
 }
 
 // Print BamAlignment in YAML format
-void ConvertTool::ConvertToolPrivate::PrintYaml(const BamAlignment& a) {
+void ConvertTool::ConvertToolPrivate::PrintYaml(const BamAlignment& a, ostream& out) const {
 
     // write alignment name
-    m_out << "---" << endl;
-    m_out << a.Name << ":" << endl;
+    out << "---" << endl;
+    out << a.Name << ":" << endl;
 
     // write alignment data
-    m_out << "   " << "AlndBases: "     << a.AlignedBases << endl;
-    m_out << "   " << "Qualities: "     << a.Qualities << endl;
-    m_out << "   " << "Name: "          << a.Name << endl;
-    m_out << "   " << "Length: "        << a.Length << endl;
-    m_out << "   " << "TagData: "       << a.TagData << endl;
-    m_out << "   " << "RefID: "         << a.RefID << endl;
-    m_out << "   " << "RefName: "       << m_references[a.RefID].RefName << endl;
-    m_out << "   " << "Position: "      << a.Position << endl;
-    m_out << "   " << "Bin: "           << a.Bin << endl;
-    m_out << "   " << "MapQuality: "    << a.MapQuality << endl;
-    m_out << "   " << "AlignmentFlag: " << a.AlignmentFlag << endl;
-    m_out << "   " << "MateRefID: "     << a.MateRefID << endl;
-    m_out << "   " << "MatePosition: "  << a.MatePosition << endl;
-    m_out << "   " << "InsertSize: "    << a.InsertSize << endl;
-    m_out << "   " << "Filename: "      << a.Filename << endl;
+    out << "   " << "AlndBases: "     << a.AlignedBases << endl;
+    out << "   " << "Qualities: "     << a.Qualities << endl;
+    out << "   " << "Name: "          << a.Name << endl;
+    out << "   " << "Length: "        << a.Length << endl;
+    out << "   " << "TagData: "       << a.TagData << endl;
+    out << "   " << "RefID: "         << a.RefID << endl;
+    out << "   " << "RefName: "       << m_references[a.RefID].RefName << endl;
+    out << "   " << "Position: "      << a.Position << endl;
+    out << "   " << "Bin: "           << a.Bin << endl;
+    out << "   " << "MapQuality: "    << a.MapQuality << endl;
+    out << "   " << "AlignmentFlag: " << a.AlignmentFlag << endl;
+    out << "   " << "MateRefID: "     << a.MateRefID << endl;
+    out << "   " << "MatePosition: "  << a.MatePosition << endl;
+    out << "   " << "InsertSize: "    << a.InsertSize << endl;
+    out << "   " << "Filename: "      << a.Filename << endl;
 
     // write Cigar data
     const vector<CigarOp>& cigarData = a.CigarData;
     if ( !cigarData.empty() ) {
-        m_out << "   " <<  "Cigar: ";
+        out << "   " <<  "Cigar: ";
         vector<CigarOp>::const_iterator cigarBegin = cigarData.begin();
         vector<CigarOp>::const_iterator cigarIter  = cigarBegin;
         vector<CigarOp>::const_iterator cigarEnd   = cigarData.end();
         for ( ; cigarIter != cigarEnd; ++cigarIter ) {
             const CigarOp& op = (*cigarIter);
-            m_out << op.Length << op.Type;
+            out << op.Length << op.Type;
         }
-        m_out << endl;
+        out << endl;
     }
 }
 
-bool ConvertTool::ConvertToolPrivate::RunPileupConversion(BamMultiReader* reader) {
+bool ConvertTool::ConvertToolPrivate::RunAlleleCountConversion(ConvertInput* reader) {
+
+    // check for valid input
+    if ( reader == 0 ) return false;
+
+    // set up our allele count 'visitor'
+    ConvertAlleleCountVisitor* v = new ConvertAlleleCountVisitor(m_references,
+                                                                 m_settings->FastaFilename,
+                                                                 &m_out);
+
+    // set up AlleleCountEngine
+    AlleleCountEngine counts;
+    counts.SetMinBaseQuality(m_settings->MinBaseQuality);
+    counts.AddVisitor(v);
+
+    // iterate through data
+    BamAlignment al;
+    while ( reader->GetNextAlignment(al) )
+        counts.AddAlignment(al);
+    counts.Flush();
+
+    // clean up
+    delete v;
+    v = 0;
+
+    // return success
+    return true;
+}
+
+bool ConvertTool::ConvertToolPrivate::RunPileupConversion(ConvertInput* reader) {
   
-    // check for valid BamMultiReader
+    // check for valid input
     if ( reader == 0 ) return false;
   
     // set up our pileup format 'visitor'
@@ -721,7 +1324,7 @@ ConvertTool::ConvertTool(void)
 {
     // set program details
     Options::SetProgramInfo("bamtools convert", "converts BAM to a number of other formats",
-                            "-format <FORMAT> [-in <filename> -in <filename> ... | -list <filelist>] [-out <filename>] [-region <REGION>] [format-specific options]");
+                            "-format <FORMAT> [-informat <FORMAT>] [-in <filename> -in <filename> ... | -list <filelist>] [-out <filename>] [-region <REGION>] [-compress] [-threads <count>] [format-specific options]");
     
     // set up options 
     OptionGroup* IO_Opts = Options::CreateOptionGroup("Input & Output");
@@ -729,14 +1332,29 @@ ConvertTool::ConvertTool(void)
     Options::AddValueOption("-list",   "filename", "the input BAM file list, one line per file", "", m_settings->HasInputFilelist,  m_settings->InputFilelist, IO_Opts);
     Options::AddValueOption("-out",    "BAM filename", "the output BAM file",   "", m_settings->HasOutput,  m_settings->OutputFilename, IO_Opts, Options::StandardOut());
     Options::AddValueOption("-format", "FORMAT", "the output file format - see README for recognized formats", "", m_settings->HasFormat, m_settings->Format, IO_Opts);
+    Options::AddValueOption("-informat", "FORMAT", "the input file format: bam (default), or columnar to read back a single file written with -format columnar (holding only the tags stored then)", "", m_settings->HasInputFormat, m_settings->InputFormat, IO_Opts, FORMAT_BAM);
     Options::AddValueOption("-region", "REGION", "genomic region. Index file is recommended for better performance, and is used automatically if it exists. See \'bamtools help index\' for more details on creating one", "", m_settings->HasRegion, m_settings->Region, IO_Opts);
+    Options::AddOption("-compress", "write BGZF-compressed (gzip-compatible) output. Used automatically if output filename ends with .gz or .bgz", m_settings->IsCompressingOutput, IO_Opts);
     
     OptionGroup* PileupOpts = Options::CreateOptionGroup("Pileup Options");
     Options::AddValueOption("-fasta", "FASTA filename", "FASTA reference file", "", m_settings->HasFastaFilename, m_settings->FastaFilename, PileupOpts);
     Options::AddOption("-mapqual", "print the mapping qualities", m_settings->IsPrintingPileupMapQualities, PileupOpts);
+    Options::AddOption("-counts", "print per-strand counts of A,C,G,T,N,deletions & insertions (as forward,reverse) instead of the read bases", m_settings->IsPrintingPileupAlleleCounts, PileupOpts);
+    Options::AddValueOption("-minqual", "quality", "minimum base quality counted (-counts only)", "", m_settings->HasMinBaseQuality, m_settings->MinBaseQuality, PileupOpts, PILEUP_DEFAULT_MIN_BASE_QUALITY);
     
     OptionGroup* SamOpts = Options::CreateOptionGroup("SAM Options");
     Options::AddOption("-noheader", "omit the SAM header from output", m_settings->IsOmittingSamHeader, SamOpts);
+
+    OptionGroup* ColumnarOpts = Options::CreateOptionGroup("Columnar Options");
+    Options::AddValueOption("-tags", "TAG,TAG,...", "tags stored (one column each), in addition to core fields, CIGAR, sequence & qualities", "", m_settings->HasColumnarTags, m_settings->ColumnarTags, ColumnarOpts);
+    Options::AddValueOption("-rowgroup", "count", "number of alignments per row group", "", m_settings->HasColumnarRowGroupSize, m_settings->ColumnarRowGroupSize, ColumnarOpts, COLUMNAR_DEFAULT_ROW_GROUP_SIZE);
+
+    OptionGroup* FastqOpts = Options::CreateOptionGroup("FASTQ Options");
+    Options::AddOption("-paired", "write first & second mates to <out>_1.fastq & <out>_2.fastq (in matching order), all other reads to <out>_singletons.fastq. Secondary & supplementary alignments are skipped. Input need not be sorted by name", m_settings->IsPairingMates, FastqOpts);
+    Options::AddValueOption("-pairmem", "size", "max memory for reads waiting for their mate, e.g. 512M or 8G (more are spilled to temp files)", "", m_settings->HasPairedMaxMemory, m_settings->PairedMaxMemory, FastqOpts, PAIRED_DEFAULT_MAX_MEMORY);
+
+    OptionGroup* ThreadOpts = Options::CreateOptionGroup("Thread Settings");
+    Options::AddValueOption("-threads", "count", "number of threads formatting alignments (not used for pileup) & compressing output (or columns), output order is unchanged", "", m_settings->HasNumThreads, m_settings->NumThreads, ThreadOpts, CONVERT_DEFAULT_NUM_THREADS);
 }
 
 ConvertTool::~ConvertTool(void) {
@@ -768,6 +1386,78 @@ int ConvertTool::Run(int argc, char* argv[]) {
         return 1;
 }
 
+// ---------------------------------------------
+// ConvertAlleleCountVisitor implementation
+
+ConvertAlleleCountVisitor::ConvertAlleleCountVisitor(const RefVector& references,
+                                                     const string& fastaFilename,
+                                                     ostream* out)
+    : AlleleCountVisitor()
+    , m_hasFasta(false)
+    , m_out(out)
+    , m_references(references)
+{
+    // set up Fasta reader if file is provided
+    if ( !fastaFilename.empty() ) {
+
+        // check for FASTA index
+        string indexFilename = "";
+        if ( Utilities::FileExists(fastaFilename + ".fai") )
+            indexFilename = fastaFilename + ".fai";
+
+        // open FASTA file
+        if ( m_fasta.Open(fastaFilename, indexFilename) )
+            m_hasFasta = true;
+    }
+}
+
+ConvertAlleleCountVisitor::~ConvertAlleleCountVisitor(void) {
+    // be sure to close Fasta reader
+    if ( m_hasFasta ) {
+        m_fasta.Close();
+        m_hasFasta = false;
+    }
+}
+
+void ConvertAlleleCountVisitor::VisitBlock(const AlleleCountBlock& block) {
+
+    const string& referenceName = m_references[block.RefId].RefName;
+    const int referenceLength   = m_references[block.RefId].RefLength;
+
+    // tab-delimited
+    // <refName> <1-based pos> <refBase> <depth> <A> <C> <G> <T> <N> <deletions> <insertions>
+    // with each count printed as <forward>,<reverse>
+
+    for ( int i = 0; i < block.NumPositions; ++i ) {
+
+        // skip if no alignments at this position
+        const uint32_t numInsertions = block.Counts[AlleleCountBlock::AlleleInsertion][AlleleCountBlock::ForwardStrand][i] +
+                                       block.Counts[AlleleCountBlock::AlleleInsertion][AlleleCountBlock::ReverseStrand][i];
+        if ( block.Depths[i] == 0 && numInsertions == 0 )
+            continue;
+
+        // retrieve reference base from FASTA file, if one provided; otherwise default to 'N'
+        const int position = block.Position + i;
+        char referenceBase('N');
+        if ( m_hasFasta && (position < referenceLength) ) {
+            if ( !m_fasta.GetBase(block.RefId, position, referenceBase ) ) {
+                cerr << "bamtools convert ERROR: pileup conversion - could not read reference base from FASTA file" << endl;
+                return;
+            }
+        }
+
+        *m_out << referenceName << '\t'
+               << position + 1  << '\t'
+               << referenceBase << '\t'
+               << block.Depths[i];
+        for ( int type = 0; type < AlleleCountBlock::NumAlleleTypes; ++type ) {
+            *m_out << '\t' << block.Counts[type][AlleleCountBlock::ForwardStrand][i]
+                   << ','  << block.Counts[type][AlleleCountBlock::ReverseStrand][i];
+        }
+        *m_out << '\n';
+    }
+}
+
 // ---------------------------------------------
 // ConvertPileupFormatVisitor implementation
 
@@ -835,8 +1525,8 @@ void ConvertPileupFormatVisitor::Visit(const PileupPosition& pileupData ) {
     vector<PileupAlignment>::const_iterator pileupIter = pileupData.PileupAlignments.begin();
     vector<PileupAlignment>::const_iterator pileupEnd  = pileupData.PileupAlignments.end();
     for ( ; pileupIter != pileupEnd; ++pileupIter ) {
-        const PileupAlignment pa = (*pileupIter);
-        const BamAlignment& ba = pa.Alignment;
+        const PileupAlignment& pa = (*pileupIter);
+        const BamAlignment& ba = *pa.Alignment;
         
         // if beginning of read segment
         if ( pa.IsSegmentBegin )
@@ -10,43 +10,703 @@
 #include "bamtools_coverage.h"
 
 #include <api/BamReader.h>
+#include <utils/bamtools_depth_engine.h>
 #include <utils/bamtools_options.h>
-#include <utils/bamtools_pileup_engine.h>
+#include <utils/bamtools_thread.h>
+#include <utils/bamtools_utilities.h>
 using namespace BamTools;
 
+#include <algorithm>
 #include <iostream>
 #include <fstream>
+#include <limits>
+#include <list>
+#include <map>
+#include <sstream>
 #include <string>
 #include <vector>
 using namespace std;
   
 namespace BamTools {
- 
-// ---------------------------------------------  
-// CoverageVisitor implementation 
-  
-class CoverageVisitor : public PileupVisitor {
+
+// output is collected up to this size, before writing
+static const size_t COVERAGE_OUTPUT_BUFFER_SIZE = 1024 * 1024;
+
+// default filter values (no filtering)
+static const unsigned int COVERAGE_DEFAULT_EXCLUDED_FLAGS  = 0;
+static const unsigned int COVERAGE_DEFAULT_MIN_MAP_QUALITY = 0;
+
+// interval summaries (-bed) report fraction of positions at (or above) this depth, by default
+static const unsigned int COVERAGE_DEFAULT_MIN_DEPTH = 1;
+
+// intervals closer than this are queried together (one index jump), linear index windows
+// are 16kb anyway
+static const int COVERAGE_INTERVAL_MERGE_DISTANCE = 16 * 1024;
+
+static const unsigned int COVERAGE_DEFAULT_NUM_THREADS = 1;
+
+// when multi-threaded, the genome is split into this many shards per thread (more, smaller
+// shards balance better, but need more index lookups)
+static const unsigned int COVERAGE_SHARDS_PER_THREAD = 8;
+
+// positions probed (per shard) when estimating data volume from the index, probes closer
+// than the index's linear window (16kb) gain nothing
+static const int64_t COVERAGE_PROBES_PER_SHARD = 16;
+static const int64_t COVERAGE_MIN_PROBE_STEP   = 16 * 1024;
+static const int64_t COVERAGE_MAX_PROBE_STEP   = 1024 * 1024;
+
+// shards are also limited in length, since each shard's output is buffered until written
+static const int64_t COVERAGE_MAX_SHARD_LENGTH = 8 * 1024 * 1024;
+
+// max number of shards (per thread) submitted ahead of the one being written
+static const size_t COVERAGE_PENDING_SHARDS_PER_THREAD = 2;
+
+// positions [Begin, End) on one reference, with (bedGraph) depth
+struct CoverageRun {
+
+    // data members
+    int RefId;
+    int Begin;
+    int End;
+    uint32_t Depth;
+
+    // ctor
+    CoverageRun(const int refId = -1,
+                const int begin = 0,
+                const int end = 0,
+                const uint32_t depth = 0)
+        : RefId(refId)
+        , Begin(begin)
+        , End(end)
+        , Depth(depth)
+    { }
+};
+
+// ---------------------------------------------
+// CoverageWriter implementation
+
+// buffers formatted output, writing it out in large chunks
+//
+// N.B. - a writer without output stream simply keeps everything in its buffer
+class CoverageWriter {
+
+    public:
+        explicit CoverageWriter(ostream* out)
+            : m_out(out)
+        {
+            m_buffer.reserve(COVERAGE_OUTPUT_BUFFER_SIZE + 256);
+        }
+        ~CoverageWriter(void) {
+            Flush();
+        }
+
+    public:
+        void Append(const string& s) {
+            m_buffer.append(s);
+        }
+
+        void Append(const char c) {
+            m_buffer.push_back(c);
+        }
+
+        void AppendNumber(int64_t value) {
+
+            if ( value < 0 ) {
+                m_buffer.push_back('-');
+                value = -value;
+            }
+
+            char digits[24];
+            char* d = digits + sizeof(digits);
+            do {
+                *--d = (char)('0' + (value % 10));
+                value /= 10;
+            } while ( value != 0 );
+            m_buffer.append(d, digits + sizeof(digits) - d);
+        }
+
+        // non-negative value, rounded to precision decimals
+        void AppendFixed(const double value, const int precision) {
+
+            int64_t scale = 1;
+            for ( int i = 0; i < precision; ++i )
+                scale *= 10;
+            const int64_t scaled = (int64_t)(value * scale + 0.5);
+            AppendNumber(scaled / scale);
+            if ( precision == 0 )
+                return;
+
+            Append('.');
+            int64_t fraction = scaled % scale;
+            char digits[24];
+            for ( int i = precision - 1; i >= 0; --i ) {
+                digits[i] = (char)('0' + (fraction % 10));
+                fraction /= 10;
+            }
+            m_buffer.append(digits, precision);
+        }
+
+        // <refName> <pos> <depth>
+        void AppendPosition(const string& refName, const int position, const uint32_t depth) {
+            Append(refName);
+            Append('\t');
+            AppendNumber(position);
+            Append('\t');
+            AppendNumber(depth);
+            Append('\n');
+        }
+
+        // <refName> <start> <end> <depth>, zero depth is omitted
+        void AppendRun(const string& refName, const CoverageRun& run) {
+            if ( run.Depth == 0 )
+                return;
+            Append(refName);
+            Append('\t');
+            AppendNumber(run.Begin);
+            Append('\t');
+            AppendNumber(run.End);
+            Append('\t');
+            AppendNumber(run.Depth);
+            Append('\n');
+        }
+
+        string& Buffer(void) {
+            return m_buffer;
+        }
+
+        // writes buffered output, if enough has been collected
+        void Commit(void) {
+            if ( m_buffer.size() >= COVERAGE_OUTPUT_BUFFER_SIZE )
+                Flush();
+        }
+
+        void Flush(void) {
+            if ( m_out != 0 && !m_buffer.empty() ) {
+                m_out->write(m_buffer.data(), m_buffer.size());
+                m_buffer.clear();
+            }
+        }
+
+        // writes (already formatted) data, bypassing buffer
+        void Write(const string& data) {
+            Flush();
+            m_out->write(data.data(), data.size());
+        }
+
+    private:
+        ostream* m_out;
+        string   m_buffer;
+};
+
+// ---------------------------------------------
+// CoverageVisitor implementation
+
+// prints per-base depth (tab-delimited: <refName> <pos> <depth>), or bedGraph
+// (<refName> <start> <end> <depth>, positions with zero depth are omitted)
+//
+// N.B. - when withholding boundaries (computing one shard of the output), the first
+//        & last bedGraph runs are not printed, nor is the closing position of the last
+//        reference. Those are left for CoverageStitcher, which joins neighbouring shards.
+class CoverageVisitor : public DepthVisitor {
   
     public:
-        CoverageVisitor(const RefVector& references, ostream* out)
-            : PileupVisitor()
+        CoverageVisitor(const RefVector& references,
+                        CoverageWriter* writer,
+                        const bool isPrintingBedGraph,
+                        const bool isPrintingRangeEnd,
+                        const bool isWithholdingBoundaries)
+            : DepthVisitor()
             , m_references(references)
-            , m_out(out)
+            , m_writer(writer)
+            , m_isPrintingBedGraph(isPrintingBedGraph)
+            , m_isPrintingRangeEnd(isPrintingRangeEnd)
+            , m_isWithholdingBoundaries(isWithholdingBoundaries)
+            , m_hasFirst(false)
+            , m_hasLast(false)
         { }
         ~CoverageVisitor(void) { }
   
-    // PileupVisitor interface implementation
+    // DepthVisitor interface implementation
+    public:
+        void VisitBlock(const DepthBlock& block) {
+
+            // finish up previous reference
+            if ( block.RefId != m_run.RefId ) {
+                FinishReference(false);
+                m_run = CoverageRun(block.RefId, block.Position, block.Position);
+            }
+
+            if ( m_isPrintingBedGraph )
+                AddRuns(block);
+            else
+                PrintPositions(block);
+            m_writer->Commit();
+        }
+
+    // CoverageVisitor interface
     public:
-	// prints coverage results ( tab-delimited )
-        void Visit(const PileupPosition& pileupData) {
-            *m_out << m_references[pileupData.RefId].RefName << "\t" 
-                   << pileupData.Position << "\t" 
-                   << pileupData.PileupAlignments.size() << endl;
+        // prints (or withholds) any pending output
+        void Finish(void) {
+            FinishReference(true);
+            m_run = CoverageRun();
         }
-        
+
+        // withheld boundaries: first run & last run (bedGraph), or first & last printed position
+        // (per-base, as Begin & End respectively)
+        bool HasFirst(void) const { return m_hasFirst; }
+        bool HasLast(void) const { return m_hasLast; }
+        const CoverageRun& First(void) const { return m_first; }
+        const CoverageRun& Last(void) const { return m_last; }
+
+    // internal methods
     private:
-        RefVector m_references;
-        ostream*  m_out;
+        void AddRuns(const DepthBlock& block) {
+
+            // extend or close runs of equal depth
+            for ( int i = 0; i < block.NumPositions; ++i ) {
+                const int position = block.Position + i;
+                const uint32_t depth = block.Depths[i];
+                if ( depth == m_run.Depth && position == m_run.End )
+                    ++m_run.End;
+                else {
+                    CloseRun();
+                    m_run = CoverageRun(block.RefId, position, position + 1, depth);
+                }
+            }
+        }
+
+        void CloseRun(void) {
+
+            // skip empty run
+            if ( m_run.End == m_run.Begin )
+                return;
+
+            if ( m_isWithholdingBoundaries && !m_hasFirst ) {
+                m_first = m_run;
+                m_hasFirst = true;
+            }
+            else
+                m_writer->AppendRun(m_references[m_run.RefId].RefName, m_run);
+        }
+
+        void FinishReference(const bool isLastReference) {
+
+            if ( m_run.RefId < 0 )
+                return;
+
+            // leave boundary to caller
+            if ( isLastReference && m_isWithholdingBoundaries ) {
+                if ( m_isPrintingBedGraph && !m_hasFirst ) {
+                    m_first = m_run;
+                    m_hasFirst = true;
+                } else {
+                    m_last = m_run;
+                    m_hasLast = true;
+                }
+                return;
+            }
+
+            // print pending run
+            if ( m_isPrintingBedGraph )
+                CloseRun();
+
+            // print closing zero-depth position (as PileupEngine-based versions did)
+            else if ( m_isPrintingRangeEnd )
+                m_writer->AppendPosition(m_references[m_run.RefId].RefName, m_run.End, 0);
+        }
+
+        void PrintPositions(const DepthBlock& block) {
+
+            if ( m_isWithholdingBoundaries && !m_hasFirst ) {
+                m_first = CoverageRun(block.RefId, block.Position, block.Position);
+                m_hasFirst = true;
+            }
+
+            const string& refName = m_references[block.RefId].RefName;
+            for ( int i = 0; i < block.NumPositions; ++i )
+                m_writer->AppendPosition(refName, block.Position + i, block.Depths[i]);
+            m_run.End = block.Position + block.NumPositions;
+        }
+
+    private:
+        const RefVector& m_references;
+        CoverageWriter* m_writer;
+        bool m_isPrintingBedGraph;
+        bool m_isPrintingRangeEnd;
+        bool m_isWithholdingBoundaries;
+
+        // current run (bedGraph) or printed positions (per-base) on current reference
+        CoverageRun m_run;
+
+        // withheld boundaries
+        CoverageRun m_first;
+        CoverageRun m_last;
+        bool m_hasFirst;
+        bool m_hasLast;
+};
+
+// ---------------------------------------------
+// CoverageShard implementation
+
+// consecutive stretch of the genome, computed independently of the others
+struct CoverageShard {
+
+    // data members
+    BamRegion ReaderRegion;     // alignments read (overlapping shard)
+    BamRegion DepthRegion;      // positions reported
+
+    // results
+    bool IsDone;
+    bool IsOk;
+    string Output;
+    bool HasFirst;
+    bool HasLast;
+    CoverageRun First;
+    CoverageRun Last;
+
+    // ctor
+    CoverageShard(const BamRegion& readerRegion, const BamRegion& depthRegion)
+        : ReaderRegion(readerRegion)
+        , DepthRegion(depthRegion)
+        , IsDone(false)
+        , IsOk(false)
+        , HasFirst(false)
+        , HasLast(false)
+    { }
+};
+
+// ---------------------------------------------
+// CoverageStitcher implementation
+
+// writes shard outputs (in genome order), filling in what each shard withheld:
+// zero-depth positions between shards & closing positions (per-base), or bedGraph runs
+// continuing across shards
+class CoverageStitcher {
+
+    public:
+        CoverageStitcher(const RefVector& references,
+                         CoverageWriter* writer,
+                         const bool isPrintingBedGraph,
+                         const bool isPrintingRangeEnd)
+            : m_references(references)
+            , m_writer(writer)
+            , m_isPrintingBedGraph(isPrintingBedGraph)
+            , m_isPrintingRangeEnd(isPrintingRangeEnd)
+            , m_hasCarry(false)
+        { }
+
+    public:
+        void AddShard(const CoverageShard& shard) {
+
+            // skip shard without any positions
+            if ( !shard.HasFirst )
+                return;
+
+            if ( m_isPrintingBedGraph )
+                AddRuns(shard);
+            else
+                AddPositions(shard);
+        }
+
+        // prints any pending output
+        void Finish(void) {
+
+            if ( !m_hasCarry )
+                return;
+
+            if ( m_isPrintingBedGraph )
+                m_writer->AppendRun(m_references[m_carry.RefId].RefName, m_carry);
+            else if ( m_isPrintingRangeEnd )
+                m_writer->AppendPosition(m_references[m_carry.RefId].RefName, m_carry.End, 0);
+            m_hasCarry = false;
+        }
+
+    // internal methods
+    private:
+        void AddPositions(const CoverageShard& shard) {
+
+            const CoverageRun& first = shard.First;
+            if ( m_hasCarry ) {
+
+                // fill gap on same reference
+                if ( m_carry.RefId == first.RefId ) {
+                    const string& refName = m_references[first.RefId].RefName;
+                    for ( int position = m_carry.End; position < first.Begin; ++position )
+                        m_writer->AppendPosition(refName, position, 0);
+                }
+
+                // or close previous reference
+                else if ( m_isPrintingRangeEnd )
+                    m_writer->AppendPosition(m_references[m_carry.RefId].RefName, m_carry.End, 0);
+            }
+
+            m_writer->Write(shard.Output);
+            m_carry = shard.Last;
+            m_hasCarry = true;
+        }
+
+        void AddRuns(const CoverageShard& shard) {
+
+            // join first run to carried one, if continuing it
+            const CoverageRun& first = shard.First;
+            if ( m_hasCarry &&
+                 m_carry.RefId == first.RefId &&
+                 m_carry.End   == first.Begin &&
+                 m_carry.Depth == first.Depth )
+            {
+                m_carry.End = first.End;
+            }
+            else {
+                if ( m_hasCarry )
+                    m_writer->AppendRun(m_references[m_carry.RefId].RefName, m_carry);
+                m_carry = first;
+                m_hasCarry = true;
+            }
+
+            // single-run shards have nothing else to print
+            if ( !shard.HasLast )
+                return;
+
+            m_writer->AppendRun(m_references[m_carry.RefId].RefName, m_carry);
+            m_writer->Write(shard.Output);
+            m_carry = shard.Last;
+        }
+
+    private:
+        const RefVector& m_references;
+        CoverageWriter* m_writer;
+        bool m_isPrintingBedGraph;
+        bool m_isPrintingRangeEnd;
+
+        // last run (bedGraph) or printed positions (per-base) so far
+        CoverageRun m_carry;
+        bool m_hasCarry;
+};
+
+// ---------------------------------------------
+// CoverageInterval implementation
+
+// BED interval (-bed), with its depth summary
+struct CoverageInterval {
+
+    // data members
+    string Line;        // as given in BED file
+    int RefId;          // -1 if reference not found in BAM file
+    int Begin;
+    int End;
+
+    // summary
+    double MeanDepth;
+    double MedianDepth;
+    double FractionAtMinDepth;
+
+    // ctor
+    CoverageInterval(void)
+        : RefId(-1)
+        , Begin(0)
+        , End(0)
+        , MeanDepth(0.0)
+        , MedianDepth(0.0)
+        , FractionAtMinDepth(0.0)
+    { }
+};
+
+// orders interval indices by reference & position
+struct CoverageIntervalLessThan {
+
+    explicit CoverageIntervalLessThan(const vector<CoverageInterval>& intervals)
+        : m_intervals(intervals)
+    { }
+
+    bool operator()(const size_t lhs, const size_t rhs) const {
+        const CoverageInterval& l = m_intervals[lhs];
+        const CoverageInterval& r = m_intervals[rhs];
+        if ( l.RefId != r.RefId ) return l.RefId < r.RefId;
+        if ( l.Begin != r.Begin ) return l.Begin < r.Begin;
+        return l.End < r.End;
+    }
+
+    const vector<CoverageInterval>& m_intervals;
+};
+
+// ---------------------------------------------
+// IntervalVisitor implementation
+
+// summarizes depth over intervals, visited in (reference, position) order
+//
+// N.B. - each interval only keeps a histogram of its depths (number of positions per
+//        depth) while positions within it are visited, positions never visited have zero depth
+class IntervalVisitor : public DepthVisitor {
+
+    // data structures
+    private:
+        struct ActiveInterval {
+            size_t Index;
+            uint64_t DepthSum;
+            int NumPositions;
+            vector<uint32_t> Histogram;
+
+            ActiveInterval(const size_t index)
+                : Index(index)
+                , DepthSum(0)
+                , NumPositions(0)
+            { }
+        };
+
+    public:
+        IntervalVisitor(vector<CoverageInterval>& intervals,
+                        const vector<size_t>& sortedIndices,
+                        const uint32_t minDepth)
+            : DepthVisitor()
+            , m_intervals(intervals)
+            , m_sortedIndices(sortedIndices)
+            , m_minDepth(minDepth)
+            , m_next(0)
+        { }
+        ~IntervalVisitor(void) { }
+
+    // DepthVisitor interface implementation
+    public:
+        void VisitBlock(const DepthBlock& block) {
+
+            const int blockEnd = block.Position + block.NumPositions;
+            int position = block.Position;
+            while ( position < blockEnd ) {
+
+                // update active intervals
+                FinishIntervals(block.RefId, position);
+                ActivateIntervals(block.RefId, position);
+
+                // if none active, skip ahead to next interval (on this reference)
+                if ( m_active.empty() ) {
+                    if ( m_next == m_sortedIndices.size() )
+                        return;
+                    const CoverageInterval& next = m_intervals[ m_sortedIndices[m_next] ];
+                    if ( next.RefId != block.RefId )
+                        return;
+                    position = next.Begin;
+                    continue;
+                }
+
+                // add depths up to next change in active intervals
+                int stop = blockEnd;
+                if ( m_next < m_sortedIndices.size() ) {
+                    const CoverageInterval& next = m_intervals[ m_sortedIndices[m_next] ];
+                    if ( next.RefId == block.RefId )
+                        stop = std::min(stop, next.Begin);
+                }
+                list<ActiveInterval>::iterator activeIter = m_active.begin();
+                list<ActiveInterval>::iterator activeEnd  = m_active.end();
+                for ( ; activeIter != activeEnd; ++activeIter )
+                    stop = std::min(stop, m_intervals[activeIter->Index].End);
+
+                const uint32_t* depths = &block.Depths[position - block.Position];
+                const int numPositions = stop - position;
+                for ( activeIter = m_active.begin(); activeIter != activeEnd; ++activeIter ) {
+                    ActiveInterval& active = (*activeIter);
+                    for ( int i = 0; i < numPositions; ++i ) {
+                        const uint32_t depth = depths[i];
+                        if ( depth >= active.Histogram.size() )
+                            active.Histogram.resize(depth + 1, 0);
+                        ++active.Histogram[depth];
+                        active.DepthSum += depth;
+                    }
+                    active.NumPositions += numPositions;
+                }
+                position = stop;
+            }
+        }
+
+    // IntervalVisitor interface
+    public:
+        // summarizes all remaining intervals
+        void Finish(void) {
+            while ( !m_active.empty() ) {
+                Summarize(m_active.front());
+                m_active.pop_front();
+            }
+            for ( ; m_next < m_sortedIndices.size(); ++m_next ) {
+                ActiveInterval unvisited( m_sortedIndices[m_next] );
+                Summarize(unvisited);
+            }
+        }
+
+    // internal methods
+    private:
+        // activates intervals beginning at (or before) position, summarizing any that
+        // were passed entirely
+        void ActivateIntervals(const int refId, const int position) {
+            for ( ; m_next < m_sortedIndices.size(); ++m_next ) {
+                const size_t index = m_sortedIndices[m_next];
+                const CoverageInterval& interval = m_intervals[index];
+                if ( interval.RefId > refId || (interval.RefId == refId && interval.Begin > position) )
+                    break;
+
+                if ( interval.RefId == refId && interval.End > position )
+                    m_active.push_back( ActiveInterval(index) );
+                else {
+                    ActiveInterval passed(index);
+                    Summarize(passed);
+                }
+            }
+        }
+
+        // summarizes active intervals ending at (or before) position
+        void FinishIntervals(const int refId, const int position) {
+            list<ActiveInterval>::iterator activeIter = m_active.begin();
+            while ( activeIter != m_active.end() ) {
+                const CoverageInterval& interval = m_intervals[activeIter->Index];
+                if ( interval.RefId == refId && interval.End > position )
+                    ++activeIter;
+                else {
+                    Summarize(*activeIter);
+                    activeIter = m_active.erase(activeIter);
+                }
+            }
+        }
+
+        void Summarize(ActiveInterval& active) {
+
+            CoverageInterval& interval = m_intervals[active.Index];
+            const int length = interval.End - interval.Begin;
+            if ( length <= 0 )
+                return;
+
+            // positions not visited have zero depth
+            if ( active.Histogram.empty() )
+                active.Histogram.push_back(0);
+            active.Histogram[0] += (uint32_t)(length - active.NumPositions);
+
+            // median is mean of the middle 2 depths, for an even number of positions
+            const uint32_t lowerMiddle = (uint32_t)(length - 1) / 2;
+            const uint32_t upperMiddle = (uint32_t)length / 2;
+            uint32_t lowerMedian = 0;
+            uint32_t upperMedian = 0;
+            uint32_t numBelow = 0;
+            uint32_t numAtMinDepth = 0;
+            for ( size_t depth = 0; depth < active.Histogram.size(); ++depth ) {
+                const uint32_t count = active.Histogram[depth];
+                if ( numBelow <= lowerMiddle && lowerMiddle < numBelow + count )
+                    lowerMedian = (uint32_t)depth;
+                if ( numBelow <= upperMiddle && upperMiddle < numBelow + count )
+                    upperMedian = (uint32_t)depth;
+                if ( depth >= m_minDepth )
+                    numAtMinDepth += count;
+                numBelow += count;
+            }
+
+            interval.MeanDepth          = (double)active.DepthSum / length;
+            interval.MedianDepth        = ( (double)lowerMedian + upperMedian ) / 2.0;
+            interval.FractionAtMinDepth = (double)numAtMinDepth / length;
+        }
+
+    private:
+        vector<CoverageInterval>& m_intervals;
+        const vector<size_t>& m_sortedIndices;
+        uint32_t m_minDepth;
+
+        size_t m_next;                      // next interval (sorted) not yet activated
+        list<ActiveInterval> m_active;
 };
 
 } // namespace BamTools
@@ -59,17 +719,43 @@ struct CoverageTool::CoverageSettings {
     // flags
     bool HasInputFile;
     bool HasOutputFile;
+    bool HasRegion;
+    bool HasExcludedFlags;
+    bool HasMinMapQuality;
+    bool HasNumThreads;
+    bool HasBedFilename;
+    bool HasMinDepth;
+    bool IsPrintingBedGraph;
 
     // filenames
     string InputBamFilename;
     string OutputFilename;
+    string BedFilename;
+
+    // options
+    string Region;
+    unsigned int ExcludedFlags;
+    unsigned int MinMapQuality;
+    unsigned int NumThreads;
+    unsigned int MinDepth;
     
     // constructor
     CoverageSettings(void)
         : HasInputFile(false)
         , HasOutputFile(false)
+        , HasRegion(false)
+        , HasExcludedFlags(false)
+        , HasMinMapQuality(false)
+        , HasNumThreads(false)
+        , HasBedFilename(false)
+        , HasMinDepth(false)
+        , IsPrintingBedGraph(false)
         , InputBamFilename(Options::StandardIn())
         , OutputFilename(Options::StandardOut())
+        , ExcludedFlags(COVERAGE_DEFAULT_EXCLUDED_FLAGS)
+        , MinMapQuality(COVERAGE_DEFAULT_MIN_MAP_QUALITY)
+        , NumThreads(COVERAGE_DEFAULT_NUM_THREADS)
+        , MinDepth(COVERAGE_DEFAULT_MIN_DEPTH)
     { } 
 };  
 
@@ -85,19 +771,253 @@ struct CoverageTool::CoverageToolPrivate {
             , m_out(cout.rdbuf())
         { }
 
-        ~CoverageToolPrivate(void) { }
+        ~CoverageToolPrivate(void);
     
     // interface
     public:
         bool Run(void);
+
+    // internal methods
+    private:
+        class ShardTask;
+
+        BamReader* AcquireReader(void);
+        bool LoadIntervals(vector<CoverageInterval>& intervals);
+        void PlanShards(BamReader& reader, const BamRegion& bounds, vector<CoverageShard>& shards);
+        void ReleaseReader(BamReader* reader);
+        bool RunIntervals(BamReader& reader, const bool hasIndex);
+        void RunShard(CoverageShard& shard);
+        bool RunSharded(BamReader& reader, const BamRegion& bounds);
+        void SetupDepthEngine(DepthEngine& depth) const;
         
     // data members
     private: 
         CoverageTool::CoverageSettings* m_settings;
         ostream m_out;
         RefVector m_references;
+
+        // shard state
+        Mutex m_shardMutex;
+        WaitCondition m_shardFinished;
+        vector<BamReader*> m_readers;        // all readers opened for shards
+        vector<BamReader*> m_freeReaders;    // readers not in use by a shard
 };  
 
+// computes one shard on a worker thread
+class CoverageTool::CoverageToolPrivate::ShardTask : public ThreadPool::Task {
+
+    public:
+        ShardTask(CoverageToolPrivate* tool, CoverageShard* shard)
+            : m_tool(tool)
+            , m_shard(shard)
+        { }
+
+        void Run(void) {
+            m_tool->RunShard(*m_shard);
+        }
+
+    private:
+        CoverageToolPrivate* m_tool;
+        CoverageShard* m_shard;
+};
+
+CoverageTool::CoverageToolPrivate::~CoverageToolPrivate(void) {
+    for ( size_t i = 0; i < m_readers.size(); ++i )
+        delete m_readers[i];
+    m_readers.clear();
+    m_freeReaders.clear();
+}
+
+// returns an indexed reader, not used by any other shard
+BamReader* CoverageTool::CoverageToolPrivate::AcquireReader(void) {
+
+    // re-use free reader, if available
+    {
+        MutexLocker locker(m_shardMutex);
+        if ( !m_freeReaders.empty() ) {
+            BamReader* reader = m_freeReaders.back();
+            m_freeReaders.pop_back();
+            return reader;
+        }
+    }
+
+    // otherwise open new one
+    BamReader* reader = new BamReader;
+    if ( !reader->Open(m_settings->InputBamFilename) || !reader->LocateIndex() ) {
+        delete reader;
+        return 0;
+    }
+
+    MutexLocker locker(m_shardMutex);
+    m_readers.push_back(reader);
+    return reader;
+}
+
+// reads BED intervals (<refName> <start> <end> ...), skipping header & comment lines
+bool CoverageTool::CoverageToolPrivate::LoadIntervals(vector<CoverageInterval>& intervals) {
+
+    ifstream bedStream(m_settings->BedFilename.c_str());
+    if ( !bedStream ) {
+        cerr << "bamtools coverage ERROR: could not open BED file: " << m_settings->BedFilename << endl;
+        return false;
+    }
+
+    // map reference names to IDs
+    map<string, int> refIds;
+    for ( size_t i = 0; i < m_references.size(); ++i )
+        refIds.insert( make_pair(m_references[i].RefName, (int)i) );
+
+    string line;
+    int lineNumber = 0;
+    while ( getline(bedStream, line) ) {
+        ++lineNumber;
+
+        // skip empty, comment & header lines
+        if ( !line.empty() && line[line.size()-1] == '\r' )
+            line.resize(line.size()-1);
+        if ( line.empty() || line[0] == '#' ||
+             Utilities::StartsWith(line, "track") || Utilities::StartsWith(line, "browser") )
+        {
+            continue;
+        }
+
+        // parse interval
+        string refName;
+        int begin = -1;
+        int end   = -1;
+        istringstream fields(line);
+        if ( !(fields >> refName >> begin >> end) || begin < 0 || end < begin ) {
+            cerr << "bamtools coverage ERROR: invalid interval on line " << lineNumber
+                 << " of BED file: " << m_settings->BedFilename << endl;
+            return false;
+        }
+
+        // intervals on references missing from BAM file simply have no coverage
+        CoverageInterval interval;
+        const map<string, int>::const_iterator refIter = refIds.find(refName);
+        if ( refIter != refIds.end() )
+            interval.RefId = refIter->second;
+        interval.Begin = begin;
+        interval.End   = end;
+        interval.Line  = line;
+        intervals.push_back(interval);
+    }
+
+    return true;
+}
+
+// splits bounds (on reference boundaries, or between probed positions) into shards of
+// roughly equal data volume
+//
+// N.B. - data volume is estimated from the (compressed) file offsets that the index
+//        yields for evenly spaced positions
+void CoverageTool::CoverageToolPrivate::PlanShards(BamReader& reader,
+                                                   const BamRegion& bounds,
+                                                   vector<CoverageShard>& shards)
+{
+    const int numReferences = (int)m_references.size();
+    if ( numReferences == 0 )
+        return;
+
+    // determine genome range [begin, end) to split
+    int beginRefId    = 0;
+    int beginPosition = 0;
+    if ( bounds.isLeftBoundSpecified() ) {
+        beginRefId    = bounds.LeftRefID;
+        beginPosition = bounds.LeftPosition;
+    }
+    int endRefId    = numReferences - 1;
+    int endPosition = m_references.at(endRefId).RefLength;
+    if ( bounds.isRightBoundSpecified() ) {
+        endRefId    = bounds.RightRefID;
+        endPosition = bounds.RightPosition;
+    }
+
+    int64_t genomeLength = 0;
+    for ( int refId = beginRefId; refId <= endRefId; ++refId ) {
+        const int first = ( refId == beginRefId ? beginPosition : 0 );
+        const int last  = ( refId == endRefId   ? endPosition   : m_references.at(refId).RefLength );
+        if ( last > first )
+            genomeLength += (last - first);
+    }
+
+    // pick probe positions: each reference start, then evenly spaced
+    const int64_t numShards = (int64_t)m_settings->NumThreads * COVERAGE_SHARDS_PER_THREAD;
+    int64_t probeStep = genomeLength / (numShards * COVERAGE_PROBES_PER_SHARD);
+    probeStep = std::max(probeStep, COVERAGE_MIN_PROBE_STEP);
+    probeStep = std::min(probeStep, COVERAGE_MAX_PROBE_STEP);
+
+    vector<CoverageRun> probes; // (RefId, Begin) only
+    for ( int refId = beginRefId; refId <= endRefId; ++refId ) {
+        const int first = ( refId == beginRefId ? beginPosition : 0 );
+        const int last  = ( refId == endRefId   ? endPosition   : m_references.at(refId).RefLength );
+        for ( int64_t position = first; position < last; position += probeStep )
+            probes.push_back( CoverageRun(refId, (int)position) );
+    }
+    if ( probes.empty() )
+        return;
+    probes.push_back( CoverageRun(endRefId, endPosition) );
+
+    // look up file offset of each probe
+    //
+    // N.B. - if the index has no data at or after a probe (on its reference), the reader
+    //        does not move at all. So the reader is rewound after each lookup, and offsets
+    //        that come back unchanged are replaced by the next probe's (or file end).
+    ifstream file(m_settings->InputBamFilename.c_str(), ios::in | ios::binary | ios::ate);
+    const int64_t fileEnd = ( file ? (int64_t)file.tellg() : 0 );
+    file.close();
+
+    reader.Rewind();
+    const int64_t rewoundOffset = reader.Tell();
+    vector<int64_t> offsets(probes.size(), fileEnd);
+    for ( size_t i = 0; i + 1 < probes.size(); ++i ) {
+        if ( reader.SetRegion( BamRegion(probes[i].RefId, probes[i].Begin) ) ) {
+            const int64_t offset = reader.Tell();
+            if ( offset != rewoundOffset )
+                offsets[i] = ( offset >> 16 ); // compressed offset
+        }
+        reader.Rewind();
+    }
+    for ( size_t i = offsets.size() - 1; i > 0; --i )
+        offsets[i-1] = std::min(offsets[i-1], offsets[i]);
+
+    // group probed stretches into shards
+    const int64_t shardVolume = std::max<int64_t>( (offsets.back() - offsets.front()) / numShards, 1 );
+    size_t shardBegin = 0;
+    for ( size_t i = 1; i < probes.size(); ++i ) {
+
+        const int64_t volume = offsets[i] - offsets[shardBegin];
+        const int64_t length = (int64_t)(i - shardBegin) * probeStep;
+        if ( volume < shardVolume && length < COVERAGE_MAX_SHARD_LENGTH && i + 1 < probes.size() )
+            continue;
+
+        const CoverageRun& begin = probes[shardBegin];
+        const CoverageRun& end   = probes[i];
+
+        // shard ending at a reference start actually ends with the previous reference,
+        // positions are not clipped there (matching a single pass over the data)
+        BamRegion readerRegion(begin.RefId, begin.Begin, end.RefId, end.Begin);
+        BamRegion depthRegion(readerRegion);
+        const bool isGenomeEnd = ( i + 1 == probes.size() && !bounds.isRightBoundSpecified() );
+        if ( end.Begin == 0 || isGenomeEnd ) {
+            const int refId = ( end.Begin == 0 ? end.RefId - 1 : end.RefId );
+            readerRegion.RightRefID    = refId;
+            readerRegion.RightPosition = std::max(m_references.at(refId).RefLength, 1);
+            depthRegion.RightRefID     = refId;
+            depthRegion.RightPosition  = numeric_limits<int>::max();
+        }
+        shards.push_back( CoverageShard(readerRegion, depthRegion) );
+        shardBegin = i;
+    }
+}
+
+void CoverageTool::CoverageToolPrivate::ReleaseReader(BamReader* reader) {
+    if ( reader == 0 )
+        return;
+    MutexLocker locker(m_shardMutex);
+    m_freeReaders.push_back(reader);
+}
+
 bool CoverageTool::CoverageToolPrivate::Run(void) {  
   
     // if output filename given
@@ -125,31 +1045,249 @@ bool CoverageTool::CoverageToolPrivate::Run(void) {
 
     // retrieve references
     m_references = reader.GetReferenceData();
+
+    // set up depth engine
+    DepthEngine depth;
+    SetupDepthEngine(depth);
+
+    // if interval summaries requested
+    if ( m_settings->HasBedFilename ) {
+        const bool success = RunIntervals(reader, reader.LocateIndex());
+        reader.Close();
+        if ( m_settings->HasOutputFile )
+            outFile.close();
+        return success;
+    }
+
+    // restrict to region, if requested
+    BamRegion region;
+    if ( m_settings->HasRegion ) {
+
+        if ( !Utilities::ParseRegionString(m_settings->Region, reader, region) ) {
+            cerr << "bamtools coverage ERROR: could not parse REGION - " << m_settings->Region << endl;
+            cerr << "Check that REGION is in valid format (see documentation) and that the coordinates are valid"
+                 << endl;
+            reader.Close();
+            return false;
+        }
+        depth.SetRegion(region);
+    }
+
+    // if multi-threaded, split work into shards (requires index)
+    const bool hasIndex = reader.LocateIndex();
+    if ( m_settings->NumThreads > 1 ) {
+        if ( hasIndex ) {
+            const bool success = RunSharded(reader, region);
+            reader.Close();
+            if ( m_settings->HasOutputFile )
+                outFile.close();
+            return success;
+        }
+        cerr << "bamtools coverage WARNING: no index found for " << m_settings->InputBamFilename
+             << ", running single-threaded" << endl;
+    }
+
+    // jump to region if index is available, otherwise positions outside region are simply not reported
+    if ( m_settings->HasRegion && hasIndex && !reader.SetRegion(region) ) {
+        cerr << "bamtools coverage ERROR: set region failed. Check that REGION describes a valid range" << endl;
+        reader.Close();
+        return false;
+    }
     
     // set up our output 'visitor'
-    CoverageVisitor* cv = new CoverageVisitor(m_references, &m_out);
-    
-    // set up pileup engine with 'visitor'
-    PileupEngine pileup;
-    pileup.AddVisitor(cv);
+    CoverageWriter writer(&m_out);
+    CoverageVisitor cv(m_references, &writer, m_settings->IsPrintingBedGraph, !m_settings->HasRegion, false);
+    depth.AddVisitor(&cv);
     
     // process input data
     BamAlignment al;    
-    while ( reader.GetNextAlignment(al) ) 
-        pileup.AddAlignment(al);
-    pileup.Flush();
+    while ( reader.GetNextAlignmentCore(al) ) 
+        depth.AddAlignment(al);
+    depth.Flush();
+    cv.Finish();
+    writer.Flush();
     
     // clean up 
     reader.Close();
     if ( m_settings->HasOutputFile )
         outFile.close();
-    delete cv;
-    cv = 0;
     
     // return success
     return true;
 }
 
+// prints depth summary for each BED interval (in BED file order):
+// <BED line> <mean depth> <median depth> <fraction of positions at min depth>
+bool CoverageTool::CoverageToolPrivate::RunIntervals(BamReader& reader, const bool hasIndex) {
+
+    vector<CoverageInterval> intervals;
+    if ( !LoadIntervals(intervals) )
+        return false;
+
+    // visit intervals in position order
+    vector<size_t> sortedIndices(intervals.size());
+    for ( size_t i = 0; i < sortedIndices.size(); ++i )
+        sortedIndices[i] = i;
+    std::sort( sortedIndices.begin(), sortedIndices.end(), CoverageIntervalLessThan(intervals) );
+    IntervalVisitor visitor(intervals, sortedIndices, m_settings->MinDepth);
+
+    // without index, simply pass over all data
+    if ( !hasIndex ) {
+        DepthEngine depth;
+        SetupDepthEngine(depth);
+        depth.AddVisitor(&visitor);
+        BamAlignment al;
+        while ( reader.GetNextAlignmentCore(al) )
+            depth.AddAlignment(al);
+        depth.Flush();
+    }
+
+    // otherwise jump to each group of nearby intervals
+    else {
+        size_t groupBegin = 0;
+        while ( groupBegin < sortedIndices.size() ) {
+
+            const CoverageInterval& first = intervals[ sortedIndices[groupBegin] ];
+            int groupEnd = first.End;
+            size_t groupStop = groupBegin + 1;
+            for ( ; groupStop < sortedIndices.size(); ++groupStop ) {
+                const CoverageInterval& interval = intervals[ sortedIndices[groupStop] ];
+                if ( interval.RefId != first.RefId || interval.Begin > groupEnd + COVERAGE_INTERVAL_MERGE_DISTANCE )
+                    break;
+                groupEnd = std::max(groupEnd, interval.End);
+            }
+
+            // skip groups on unknown references, or without any positions
+            if ( first.RefId >= 0 && groupEnd > first.Begin ) {
+
+                const BamRegion region(first.RefId, first.Begin, first.RefId, groupEnd);
+                if ( !reader.SetRegion(region) ) {
+                    cerr << "bamtools coverage ERROR: set region failed for BED interval: " << first.Line << endl;
+                    return false;
+                }
+
+                DepthEngine depth;
+                SetupDepthEngine(depth);
+                depth.SetRegion(region);
+                depth.AddVisitor(&visitor);
+                BamAlignment al;
+                while ( reader.GetNextAlignmentCore(al) )
+                    depth.AddAlignment(al);
+                depth.Flush();
+            }
+            groupBegin = groupStop;
+        }
+    }
+    visitor.Finish();
+
+    // print summaries
+    CoverageWriter writer(&m_out);
+    vector<CoverageInterval>::const_iterator intervalIter = intervals.begin();
+    vector<CoverageInterval>::const_iterator intervalEnd  = intervals.end();
+    for ( ; intervalIter != intervalEnd; ++intervalIter ) {
+        const CoverageInterval& interval = (*intervalIter);
+        writer.Append(interval.Line);
+        writer.Append('\t');
+        writer.AppendFixed(interval.MeanDepth, 2);
+        writer.Append('\t');
+        writer.AppendFixed(interval.MedianDepth, 1);
+        writer.Append('\t');
+        writer.AppendFixed(interval.FractionAtMinDepth, 4);
+        writer.Append('\n');
+        writer.Commit();
+    }
+    writer.Flush();
+    return true;
+}
+
+// computes shard on its own reader, keeping output (& withheld boundaries) in shard
+void CoverageTool::CoverageToolPrivate::RunShard(CoverageShard& shard) {
+
+    CoverageWriter writer(0);
+    CoverageVisitor cv(m_references, &writer, m_settings->IsPrintingBedGraph, !m_settings->HasRegion, true);
+    DepthEngine depth;
+    SetupDepthEngine(depth);
+    depth.SetRegion(shard.DepthRegion);
+    depth.AddVisitor(&cv);
+
+    BamReader* reader = AcquireReader();
+    const bool isOk = ( reader != 0 && reader->SetRegion(shard.ReaderRegion) );
+    if ( isOk ) {
+        BamAlignment al;
+        while ( reader->GetNextAlignmentCore(al) )
+            depth.AddAlignment(al);
+        depth.Flush();
+        cv.Finish();
+    }
+    ReleaseReader(reader);
+
+    // store results & notify writer
+    MutexLocker locker(m_shardMutex);
+    shard.IsOk     = isOk;
+    shard.HasFirst = cv.HasFirst();
+    shard.HasLast  = cv.HasLast();
+    shard.First    = cv.First();
+    shard.Last     = cv.Last();
+    shard.Output.swap( writer.Buffer() );
+    shard.IsDone = true;
+    m_shardFinished.WakeAll();
+}
+
+// computes shards on worker threads, writing their output in genome order
+bool CoverageTool::CoverageToolPrivate::RunSharded(BamReader& reader, const BamRegion& bounds) {
+
+    vector<CoverageShard> shards;
+    PlanShards(reader, bounds, shards);
+
+    ThreadPool pool(m_settings->NumThreads);
+    vector<ShardTask> tasks;
+    tasks.reserve(shards.size());
+    for ( size_t i = 0; i < shards.size(); ++i )
+        tasks.push_back( ShardTask(this, &shards[i]) );
+
+    CoverageWriter writer(&m_out);
+    CoverageStitcher stitcher(m_references, &writer, m_settings->IsPrintingBedGraph, !m_settings->HasRegion);
+
+    // keep workers busy, while limiting number of buffered shards
+    const size_t maxPending = pool.NumThreads() * COVERAGE_PENDING_SHARDS_PER_THREAD;
+    size_t numSubmitted = 0;
+    bool success = true;
+    for ( size_t i = 0; i < shards.size(); ++i ) {
+
+        while ( numSubmitted < shards.size() && numSubmitted < i + maxPending )
+            pool.Submit(&tasks[numSubmitted++]);
+
+        // wait for shard
+        {
+            MutexLocker locker(m_shardMutex);
+            while ( !shards[i].IsDone )
+                m_shardFinished.Wait(m_shardMutex);
+        }
+
+        if ( !shards[i].IsOk ) {
+            cerr << "bamtools coverage ERROR: could not read shard of input BAM file: "
+                 << m_settings->InputBamFilename << endl;
+            success = false;
+            break;
+        }
+
+        stitcher.AddShard(shards[i]);
+        string().swap(shards[i].Output);
+    }
+    pool.WaitForAll();
+
+    if ( success ) {
+        stitcher.Finish();
+        writer.Flush();
+    }
+    return success;
+}
+
+void CoverageTool::CoverageToolPrivate::SetupDepthEngine(DepthEngine& depth) const {
+    depth.SetExcludedFlags(m_settings->ExcludedFlags);
+    depth.SetMinMapQuality(m_settings->MinMapQuality);
+}
+
 // ---------------------------------------------
 // CoverageTool implementation
 
@@ -159,12 +1297,27 @@ CoverageTool::CoverageTool(void)
     , m_impl(0)
 { 
     // set program details
-    Options::SetProgramInfo("bamtools coverage", "prints coverage data for a single BAM file", "[-in <filename>] [-out <filename>]");
+    Options::SetProgramInfo("bamtools coverage", "prints coverage data for a single BAM file", "[-in <filename>] [-out <filename>] [-region <REGION>] [-bedgraph] [-minmapq <quality>] [-excludeflags <flags>] [-threads <count>] [-bed <filename> [-mindepth <depth>]]");
     
     // set up options 
     OptionGroup* IO_Opts = Options::CreateOptionGroup("Input & Output");
     Options::AddValueOption("-in",  "BAM filename", "the input BAM file", "", m_settings->HasInputFile,  m_settings->InputBamFilename, IO_Opts, Options::StandardIn());
     Options::AddValueOption("-out", "filename",     "the output file",    "", m_settings->HasOutputFile, m_settings->OutputFilename,   IO_Opts, Options::StandardOut());
+    Options::AddValueOption("-region", "REGION", "genomic region. Index file is recommended for better performance, and is used automatically if it exists. See \'bamtools help index\' for more details on creating one", "", m_settings->HasRegion, m_settings->Region, IO_Opts);
+
+    OptionGroup* OutputOpts = Options::CreateOptionGroup("Output Format");
+    Options::AddOption("-bedgraph", "print runs of equal depth as bedGraph (<refName> <start> <end> <depth>, 0-based, half-open), omitting zero depth", m_settings->IsPrintingBedGraph, OutputOpts);
+
+    OptionGroup* IntervalOpts = Options::CreateOptionGroup("Interval Summary");
+    Options::AddValueOption("-bed", "filename", "BED file of intervals. Prints each interval followed by its mean depth, median depth & fraction of positions at (or above) -mindepth, instead of per-base output (-region, -bedgraph & -threads are ignored)", "", m_settings->HasBedFilename, m_settings->BedFilename, IntervalOpts);
+    Options::AddValueOption("-mindepth", "depth", "depth counted as covered, for -bed fraction", "", m_settings->HasMinDepth, m_settings->MinDepth, IntervalOpts, COVERAGE_DEFAULT_MIN_DEPTH);
+
+    OptionGroup* FilterOpts = Options::CreateOptionGroup("Filters");
+    Options::AddValueOption("-minmapq", "quality", "ignore alignments below this mapping quality", "", m_settings->HasMinMapQuality, m_settings->MinMapQuality, FilterOpts, COVERAGE_DEFAULT_MIN_MAP_QUALITY);
+    Options::AddValueOption("-excludeflags", "flags", "ignore alignments with any of these flag bits set, e.g. 1796 (unmapped, secondary, QC-failed, duplicate)", "", m_settings->HasExcludedFlags, m_settings->ExcludedFlags, FilterOpts, COVERAGE_DEFAULT_EXCLUDED_FLAGS);
+
+    OptionGroup* ThreadOpts = Options::CreateOptionGroup("Thread Settings");
+    Options::AddValueOption("-threads", "count", "number of threads, each computing separate regions (requires index)", "", m_settings->HasNumThreads, m_settings->NumThreads, ThreadOpts, COVERAGE_DEFAULT_NUM_THREADS);
 }
 
 CoverageTool::~CoverageTool(void) { 
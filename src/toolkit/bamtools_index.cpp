@@ -13,8 +13,11 @@
 #include <utils/bamtools_options.h>
 using namespace BamTools;
 
+#include <cerrno>
+#include <cstdlib>
 #include <iostream>
 #include <string>
+#include <vector>
 using namespace std;
 
 // ---------------------------------------------
@@ -25,14 +28,22 @@ struct IndexTool::IndexSettings {
     // flags
     bool HasInputBamFilename;
     bool IsUsingBamtoolsIndex;
+    bool HasShardIndexFilenames;
+    bool HasShardOffsets;
 
     // filenames
     string InputBamFilename;
+    vector<string> ShardIndexFilenames;
+
+    // other parameters
+    vector<string> ShardOffsets;
     
     // constructor
     IndexSettings(void)
         : HasInputBamFilename(false)
         , IsUsingBamtoolsIndex(false)
+        , HasShardIndexFilenames(false)
+        , HasShardOffsets(false)
         , InputBamFilename(Options::StandardIn())
     { }
 };  
@@ -69,10 +80,46 @@ bool IndexTool::IndexToolPrivate::Run(void) {
         return false;
     }
 
-    // create index for BAM file
     const BamIndex::IndexType type = ( m_settings->IsUsingBamtoolsIndex ? BamIndex::BAMTOOLS
                                                                         : BamIndex::STANDARD );
-    reader.CreateIndex(type);
+
+    // if shard indexes provided, merge them instead of scanning BAM file
+    if ( m_settings->HasShardIndexFilenames ) {
+
+        if ( m_settings->ShardIndexFilenames.size() != m_settings->ShardOffsets.size() ) {
+            cerr << "bamtools index ERROR: each -merge index file requires an -offset" << endl;
+            reader.Close();
+            return false;
+        }
+
+        vector<int64_t> offsets;
+        vector<string>::const_iterator offsetIter = m_settings->ShardOffsets.begin();
+        vector<string>::const_iterator offsetEnd  = m_settings->ShardOffsets.end();
+        for ( ; offsetIter != offsetEnd; ++offsetIter ) {
+
+            // offset must be a non-negative number, with nothing trailing
+            const string& offsetString = (*offsetIter);
+            char* end = 0;
+            errno = 0;
+            const long long offset = strtoll(offsetString.c_str(), &end, 10);
+            if ( offsetString.empty() || *end != '\0' || errno != 0 || offset < 0 ) {
+                cerr << "bamtools index ERROR: invalid -offset: " << offsetString << endl;
+                reader.Close();
+                return false;
+            }
+            offsets.push_back( (int64_t)offset );
+        }
+
+        if ( !reader.MergeIndexes(m_settings->ShardIndexFilenames, offsets, type) ) {
+            cerr << "bamtools index ERROR: could not merge index files" << endl
+                 << reader.GetErrorString() << endl;
+            reader.Close();
+            return false;
+        }
+    }
+
+    // otherwise create index for BAM file
+    else reader.CreateIndex(type);
 
     // clean & exit
     reader.Close();
@@ -88,12 +135,16 @@ IndexTool::IndexTool(void)
     , m_impl(0)
 {
     // set program details
-    Options::SetProgramInfo("bamtools index", "creates index for BAM file", "[-in <filename>] [-bti]");
+    Options::SetProgramInfo("bamtools index", "creates index for BAM file", "[-in <filename>] [-bti] [-merge <filename> -offset <offset> ...]");
     
     // set up options 
     OptionGroup* IO_Opts = Options::CreateOptionGroup("Input & Output");
     Options::AddValueOption("-in", "BAM filename", "the input BAM file", "", m_settings->HasInputBamFilename, m_settings->InputBamFilename, IO_Opts, Options::StandardIn());
     Options::AddOption("-bti", "create (non-standard) BamTools index file (*.bti). Default behavior is to create standard BAM index (*.bai)", m_settings->IsUsingBamtoolsIndex, IO_Opts);
+
+    OptionGroup* MergeOpts = Options::CreateOptionGroup("Merge Shard Indexes");
+    Options::AddValueOption("-merge", "filename", "index file of a shard concatenated into the input BAM file. Builds the index by merging these instead of scanning the BAM file", "", m_settings->HasShardIndexFilenames, m_settings->ShardIndexFilenames, MergeOpts);
+    Options::AddValueOption("-offset", "offset", "compressed byte offset at which the corresponding -merge shard landed in the input BAM file", "", m_settings->HasShardOffsets, m_settings->ShardOffsets, MergeOpts);
 }
 
 IndexTool::~IndexTool(void) {
@@ -32,6 +32,7 @@ struct MergeTool::MergeSettings {
     bool HasOutput;
     bool IsForceCompression;
     bool HasRegion;
+    bool HasMaxOpenFiles;
     
     // filenames
     vector<string> InputFiles;
@@ -40,6 +41,7 @@ struct MergeTool::MergeSettings {
     // other parameters
     string OutputFilename;
     string Region;
+    unsigned int MaxOpenFiles;
     
     // constructor
     MergeSettings(void)
@@ -48,7 +50,9 @@ struct MergeTool::MergeSettings {
         , HasOutput(false)
         , IsForceCompression(false)
         , HasRegion(false)
+        , HasMaxOpenFiles(false)
         , OutputFilename(Options::StandardOut())
+        , MaxOpenFiles(0)
     { }
 };  
 
@@ -95,7 +99,11 @@ bool MergeTool::MergeToolPrivate::Run(void) {
     }
 
     // opens the BAM files (by default without checking for indexes)
+    // decoding inputs ahead on a few background threads when merging several
     BamMultiReader reader;
+    reader.SetPrefetching( m_settings->InputFiles.size() > 1 );
+    if ( m_settings->HasMaxOpenFiles )
+        reader.SetMaxOpenFiles(m_settings->MaxOpenFiles);
     if ( !reader.Open(m_settings->InputFiles) ) {
         cerr << "bamtools merge ERROR: could not open input BAM file(s)... Aborting." << endl;
         return false;
@@ -200,7 +208,7 @@ MergeTool::MergeTool(void)
 {
     // set program details
     Options::SetProgramInfo("bamtools merge", "merges multiple BAM files into one",
-                            "[-in <filename> -in <filename> ... | -list <filelist>] [-out <filename> | [-forceCompression]] [-region <REGION>]");
+                            "[-in <filename> -in <filename> ... | -list <filelist>] [-out <filename> | [-forceCompression]] [-region <REGION>] [-maxOpen <N>]");
     
     // set up options 
     OptionGroup* IO_Opts = Options::CreateOptionGroup("Input & Output");
@@ -209,6 +217,7 @@ MergeTool::MergeTool(void)
     Options::AddValueOption("-out", "BAM filename", "the output BAM file",   "", m_settings->HasOutput, m_settings->OutputFilename, IO_Opts);
     Options::AddOption("-forceCompression", "if results are sent to stdout (like when piping to another tool), default behavior is to leave output uncompressed. Use this flag to override and force compression", m_settings->IsForceCompression, IO_Opts);
     Options::AddValueOption("-region", "REGION", "genomic region. See README for more details", "", m_settings->HasRegion, m_settings->Region, IO_Opts);
+    Options::AddValueOption("-maxOpen", "N", "keep at most N input files open at a time (for merging very many files)", "", m_settings->HasMaxOpenFiles, m_settings->MaxOpenFiles, IO_Opts);
 }
 
 MergeTool::~MergeTool(void) {
@@ -10,16 +10,20 @@
 #include "bamtools_sort.h"
 
 #include <api/SamConstants.h>
-#include <api/BamMultiReader.h>
+#include <api/BamReader.h>
 #include <api/BamWriter.h>
 #include <api/algorithms/Sort.h>
 #include <utils/bamtools_options.h>
+#include <utils/bamtools_thread.h>
+#include <utils/bamtools_utilities.h>
 using namespace BamTools;
 using namespace BamTools::Algorithms;
 
 #include <cstdio>
 #include <algorithm>
+#include <deque>
 #include <iostream>
+#include <set>
 #include <sstream>
 #include <string>
 #include <vector>
@@ -34,9 +38,686 @@ namespace BamTools {
 //    I say 'optimized' because each system will naturally perform
 //    differently.  We will attempt to determine a sensible
 //    compromise that should perform well on average.
-const unsigned int SORT_DEFAULT_MAX_BUFFER_COUNT  = 500000;  // max numberOfAlignments for buffer
-const unsigned int SORT_DEFAULT_MAX_BUFFER_MEMORY = 1024;    // Mb
+const unsigned int SORT_DEFAULT_MAX_BUFFER_COUNT  = 0;        // max numberOfAlignments for buffer (0 = no limit)
+const string       SORT_DEFAULT_MAX_BUFFER_MEMORY = "1024M";  // plain numbers are Mb
+const unsigned int SORT_DEFAULT_NUM_THREADS       = 1;
+const unsigned int SORT_DEFAULT_MAX_FAN_IN        = 64;       // max number of runs merged at once
+
+// bytes of sort bookkeeping per buffered alignment (keys, pointers & merge scratch space)
+const size_t SORT_ALIGNMENT_OVERHEAD = 64;
+
+// buffers smaller than this are not worth splitting across threads
+const size_t PARALLEL_SORT_MIN_SIZE = 16384;
+
+// spill file is short-lived, so favor speed over size
+const int SORT_SPILL_COMPRESSION_LEVEL = 1;
+
+// every Nth record of a run is kept as a sample, for picking merge splitters
+// & for seeking into the middle of a run
+const uint64_t SORT_RUN_SAMPLE_INTERVAL = 4096;
+
+// merges smaller than this are not worth splitting across threads
+const uint64_t PARALLEL_MERGE_MIN_SIZE = 65536;
+
+// natural (already sorted) stretches of input shorter than this mean the input is
+// not presorted, so the rest of it is sorted in buffers
+const uint64_t SORT_MIN_NATURAL_RUN_SIZE = 65536;
+
+// bounds for the per-run read buffers of a merge (sized from the memory budget)
+const size_t SORT_MIN_READ_BUFFER_SIZE = 64 * 1024;
+const size_t SORT_MAX_READ_BUFFER_SIZE = 16 * 1024 * 1024;
+
+// sampled record of a sorted run
+struct RunSample {
+    uint64_t Index;   // record number within run
+    int64_t Offset;   // virtual offset of record in the run's file
+    BamAlignment Alignment;
+
+    RunSample(const uint64_t index, const int64_t offset, const BamAlignment& al)
+        : Index(index)
+        , Offset(offset)
+        , Alignment(al)
+    { }
+};
+
+// sorted run, stored as a contiguous stretch of records in a spill file
+struct SortedRun {
+    string Filename;
+    int64_t Offset;   // virtual offset of run's first record
+    uint64_t Count;
+    vector<RunSample> Samples;   // N.B. - first record is always sampled
+
+    SortedRun(const string& filename = "", const int64_t offset = 0, const uint64_t count = 0)
+        : Filename(filename)
+        , Offset(offset)
+        , Count(count)
+    { }
+};
+
+// appends records to a spill file as a sorted run, sampling them along the way
+class RunSpiller {
+
+    public:
+        RunSpiller(BamWriter& writer, const string& filename)
+            : m_writer(writer)
+            , m_run(filename, writer.Tell(), 0)
+        { }
+
+        bool SaveAlignment(const BamAlignment& al) {
+            if ( m_run.Count % SORT_RUN_SAMPLE_INTERVAL == 0 )
+                m_run.Samples.push_back( RunSample(m_run.Count, m_writer.Tell(), al) );
+            if ( !m_writer.SaveAlignment(al) )
+                return false;
+            ++m_run.Count;
+            return true;
+        }
+
+        string GetErrorString(void) const {
+            return m_writer.GetErrorString();
+        }
+
+        const SortedRun& Run(void) const {
+            return m_run;
+        }
+
+    private:
+        BamWriter& m_writer;
+        SortedRun m_run;
+};
+
+// current record of a sorted run, as seen by the merge
+template<typename Compare>
+struct RunHead {
+
+    typename Compare::KeyType Key;
+    size_t Run;
+
+    RunHead(const typename Compare::KeyType& key, const size_t run)
+        : Key(key)
+        , Run(run)
+    { }
+};
+
+// orders run heads for a (max-)heap: smallest key on top, ties broken by
+// run number, so that the merge keeps the input order of equal records
+template<typename Compare>
+struct RunHeadSorter {
+
+    RunHeadSorter(const Compare& comp = Compare())
+        : m_comp(comp)
+    { }
+
+    bool operator()(const RunHead<Compare>& lhs, const RunHead<Compare>& rhs) {
+        if ( m_comp(rhs.Key, lhs.Key) ) return true;
+        if ( m_comp(lhs.Key, rhs.Key) ) return false;
+        return ( lhs.Run > rhs.Run );
+    }
+
+    private:
+        Compare m_comp;
+};
     
+// alignment (pointer) decorated with its pre-computed sort key
+template<typename Compare>
+struct KeyedAlignment {
+
+    typename Compare::KeyType Key;
+    const BamAlignment* Alignment;
+
+    KeyedAlignment(void)
+        : Alignment(0)
+    { }
+
+    KeyedAlignment(const typename Compare::KeyType& key, const BamAlignment* al)
+        : Key(key)
+        , Alignment(al)
+    { }
+};
+
+// compares keyed alignments on their keys only
+template<typename Compare>
+struct KeyedAlignmentSorter {
+
+    KeyedAlignmentSorter(const Compare& comp = Compare())
+        : m_comp(comp)
+    { }
+
+    bool operator()(const KeyedAlignment<Compare>& lhs, const KeyedAlignment<Compare>& rhs) {
+        return m_comp(lhs.Key, rhs.Key);
+    }
+
+    private:
+        Compare m_comp;
+};
+
+// stable-sorts a range of elements, by default using the comparison function
+template<typename T, typename Compare>
+void SortChunk(T* begin, T* end, const Compare& comp) {
+    std::stable_sort(begin, end, comp);
+}
+
+// returns the packed coordinate key of a keyed alignment
+struct PositionKeyOf {
+    uint64_t operator()(const KeyedAlignment<Sort::ByPosition>& entry) const {
+        return entry.Key.Value;
+    }
+};
+
+// coordinate keys are radix sorted instead
+inline void SortChunk(KeyedAlignment<Sort::ByPosition>* begin,
+                      KeyedAlignment<Sort::ByPosition>* end,
+                      const KeyedAlignmentSorter<Sort::ByPosition>&)
+{
+    Sort::RadixSort(begin, end, PositionKeyOf());
+}
+
+// stable-sorts one chunk of a parallel sort
+template<typename T, typename Compare>
+class ChunkSortTask : public ThreadPool::Task {
+
+    public:
+        ChunkSortTask(T* begin, T* end, const Compare& comp)
+            : m_begin(begin)
+            , m_end(end)
+            , m_comp(comp)
+        { }
+
+        void Run(void) {
+            SortChunk(m_begin, m_end, m_comp);
+        }
+
+    private:
+        T* m_begin;
+        T* m_end;
+        Compare m_comp;
+};
+
+// merges one piece of two neighbouring sorted chunks into the output
+template<typename T, typename Compare>
+class ChunkMergeTask : public ThreadPool::Task {
+
+    public:
+        ChunkMergeTask(const T* leftBegin,  const T* leftEnd,
+                       const T* rightBegin, const T* rightEnd,
+                       T* out,
+                       const Compare& comp)
+            : m_leftBegin(leftBegin)
+            , m_leftEnd(leftEnd)
+            , m_rightBegin(rightBegin)
+            , m_rightEnd(rightEnd)
+            , m_out(out)
+            , m_comp(comp)
+        { }
+
+        void Run(void) {
+            // N.B. - std::merge takes from the left range on ties, which keeps the sort stable
+            std::merge(m_leftBegin, m_leftEnd, m_rightBegin, m_rightEnd, m_out, m_comp);
+        }
+
+    private:
+        const T* m_leftBegin;
+        const T* m_leftEnd;
+        const T* m_rightBegin;
+        const T* m_rightEnd;
+        T* m_out;
+        Compare m_comp;
+};
+
+// returns how many of the first 'count' merged elements come from 'left' (ties favor left)
+template<typename T, typename Compare>
+size_t MergeSplitPoint(const T* left,  const size_t leftSize,
+                       const T* right, const size_t rightSize,
+                       const size_t count,
+                       Compare& comp)
+{
+    size_t low  = ( count > rightSize ? count - rightSize : 0 );
+    size_t high = ( count < leftSize  ? count : leftSize );
+    while ( low < high ) {
+        const size_t i = low + (high - low)/2;
+        const size_t j = count - i;
+        // left[i] still belongs before right[j-1]
+        if ( j > 0 && !comp(right[j-1], left[i]) )
+            low = i + 1;
+        else
+            high = i;
+    }
+    return low;
+}
+
+// stable-sorts data using all threads in pool
+//
+// The data is split into one chunk per thread, each sorted concurrently. Neighbouring
+// chunks are then merged pairwise until a single run remains. Each merge round is
+// itself split (at co-ranked positions) into roughly one piece per thread, so the
+// final merges use the whole pool as well.
+template<typename T, typename Compare>
+void ParallelStableSort(vector<T>& data, const Compare& comp, ThreadPool& pool) {
+
+    const size_t numThreads = pool.NumThreads();
+    const size_t numElements = data.size();
+    if ( numThreads == 1 || numElements < PARALLEL_SORT_MIN_SIZE ) {
+        if ( numElements > 0 )
+            SortChunk(&data[0], &data[0] + numElements, comp);
+        return;
+    }
+
+    // sort chunks
+    vector<size_t> bounds;
+    for ( size_t i = 0; i <= numThreads; ++i )
+        bounds.push_back( numElements * i / numThreads );
+
+    vector< ChunkSortTask<T, Compare> > sortTasks;
+    sortTasks.reserve(numThreads);
+    for ( size_t i = 0; i < numThreads; ++i )
+        sortTasks.push_back( ChunkSortTask<T, Compare>(&data[0] + bounds[i], &data[0] + bounds[i+1], comp) );
+    for ( size_t i = 0; i < sortTasks.size(); ++i )
+        pool.Submit(&sortTasks[i]);
+    pool.WaitForAll();
+
+    // merge neighbouring chunks, ping-ponging between data & scratch space
+    vector<T> scratch(numElements);
+    T* source = &data[0];
+    T* target = &scratch[0];
+    Compare splitComp(comp);
+
+    while ( bounds.size() > 2 ) {
+
+        const size_t numChunks = bounds.size() - 1;
+        vector<size_t> mergedBounds;
+        vector< ChunkMergeTask<T, Compare> > mergeTasks;
+
+        for ( size_t c = 0; c < numChunks; c += 2 ) {
+
+            const size_t begin = bounds[c];
+            const size_t mid   = bounds[c+1];
+            const size_t end   = ( c+1 < numChunks ? bounds[c+2] : mid );
+            mergedBounds.push_back(begin);
+
+            const T* left  = source + begin;
+            const T* right = source + mid;
+            const size_t leftSize  = mid - begin;
+            const size_t rightSize = end - mid;
+            const size_t mergeSize = end - begin;
+
+            // split merge into pieces, proportional to its share of the data
+            size_t numPieces = ( numThreads * mergeSize + numElements - 1 ) / numElements;
+            if ( numPieces == 0 ) numPieces = 1;
+
+            size_t prevCount = 0;
+            size_t prevSplit = 0;
+            for ( size_t p = 1; p <= numPieces; ++p ) {
+                const size_t count = mergeSize * p / numPieces;
+                const size_t split = MergeSplitPoint(left, leftSize, right, rightSize, count, splitComp);
+                mergeTasks.push_back( ChunkMergeTask<T, Compare>(left  + prevSplit, left  + split,
+                                                                 right + (prevCount - prevSplit),
+                                                                 right + (count - split),
+                                                                 target + begin + prevCount,
+                                                                 comp) );
+                prevCount = count;
+                prevSplit = split;
+            }
+        }
+        mergedBounds.push_back(numElements);
+
+        for ( size_t i = 0; i < mergeTasks.size(); ++i )
+            pool.Submit(&mergeTasks[i]);
+        pool.WaitForAll();
+
+        std::swap(source, target);
+        bounds.swap(mergedBounds);
+    }
+
+    // make sure result ends up in data
+    if ( source != &data[0] )
+        data.swap(scratch);
+}
+
+// (stable) sorts alignments via their pre-computed keys, each key is extracted just once
+template<typename Compare>
+void SortByKey(const deque<BamAlignment>& buffer,
+               const Compare& comp,
+               ThreadPool& pool,
+               vector<const BamAlignment*>& sorted)
+{
+    vector< KeyedAlignment<Compare> > keyed;
+    keyed.reserve(buffer.size());
+    deque<BamAlignment>::const_iterator buffIter = buffer.begin();
+    deque<BamAlignment>::const_iterator buffEnd  = buffer.end();
+    for ( ; buffIter != buffEnd; ++buffIter ) {
+        const BamAlignment& al = (*buffIter);
+        keyed.push_back( KeyedAlignment<Compare>(comp.MakeKey(al), &al) );
+    }
+
+    ParallelStableSort( keyed, KeyedAlignmentSorter<Compare>(comp), pool );
+
+    sorted.clear();
+    sorted.reserve(keyed.size());
+    typename vector< KeyedAlignment<Compare> >::const_iterator keyIter = keyed.begin();
+    typename vector< KeyedAlignment<Compare> >::const_iterator keyEnd  = keyed.end();
+    for ( ; keyIter != keyEnd; ++keyIter )
+        sorted.push_back( (*keyIter).Alignment );
+}
+
+// reads the records of one sorted run that fall within a key range [lower, upper)
+// N.B. - a missing (null) bound means that side of the range is open
+template<typename Compare>
+class RunCursor {
+
+    typedef typename Compare::KeyType KeyType;
+
+    // ctor
+    public:
+        RunCursor(const Compare& comp, const KeyType* lowerBound, const KeyType* upperBound)
+            : m_comp(comp)
+            , m_lowerBound(lowerBound)
+            , m_upperBound(upperBound)
+            , m_numRemaining(0)
+        { }
+
+    // RunCursor interface
+    public:
+        // positions cursor at the last sample preceding the lower bound
+        bool Open(const SortedRun& run, const size_t readBufferSize) {
+
+            const vector<RunSample>& samples = run.Samples;
+            if ( run.Count == 0 || samples.empty() )
+                return true;
+
+            // skip run entirely if it starts beyond the range
+            if ( m_upperBound && !m_comp(m_comp.MakeKey(samples.front().Alignment), *m_upperBound) )
+                return true;
+
+            // binary search for first sample not below lower bound
+            size_t start = 0;
+            if ( m_lowerBound ) {
+                size_t low  = 0;
+                size_t high = samples.size();
+                while ( low < high ) {
+                    const size_t mid = low + (high - low) / 2;
+                    if ( m_comp(m_comp.MakeKey(samples[mid].Alignment), *m_lowerBound) )
+                        low = mid + 1;
+                    else
+                        high = mid;
+                }
+                start = ( low > 0 ? low - 1 : 0 );
+            }
+
+            const RunSample& sample = samples[start];
+            m_reader.SetReadBufferSize(readBufferSize);
+            if ( !m_reader.Open(run.Filename) || !m_reader.Seek(sample.Offset) )
+                return false;
+            m_numRemaining = run.Count - sample.Index;
+            return true;
+        }
+
+        // loads next record in range, returns false when there are no more
+        bool Next(void) {
+            while ( m_numRemaining > 0 && m_reader.GetNextAlignmentCore(Alignment) ) {
+                --m_numRemaining;
+                Key = m_comp.MakeKey(Alignment);
+                if ( m_lowerBound && m_comp(Key, *m_lowerBound) )
+                    continue;
+                if ( m_upperBound && !m_comp(Key, *m_upperBound) )
+                    break;
+                return true;
+            }
+            m_numRemaining = 0;
+            return false;
+        }
+
+    // data members
+    public:
+        BamAlignment Alignment;
+        KeyType Key;
+    private:
+        Compare m_comp;
+        const KeyType* m_lowerBound;
+        const KeyType* m_upperBound;
+        BamReader m_reader;
+        uint64_t m_numRemaining;
+};
+
+// merges the records of all runs within a key range [lower, upper) into output
+// (a BamWriter or a RunSpiller)
+//
+// N.B. - equal records are written in run order, so the merge is stable
+template<typename Compare, typename Output>
+bool MergeRunRange(const vector<SortedRun>& runs,
+                   const typename Compare::KeyType* lowerBound,
+                   const typename Compare::KeyType* upperBound,
+                   const Compare& comp,
+                   const size_t readBufferSize,
+                   Output& output)
+{
+    // open a cursor for each run
+    // N.B. - runs may share a spill file, just at different offsets
+    const size_t numRuns = runs.size();
+    vector< RunCursor<Compare>* > cursors(numRuns, (RunCursor<Compare>*)0);
+    bool success = true;
+    for ( size_t i = 0; i < numRuns; ++i ) {
+        cursors[i] = new RunCursor<Compare>(comp, lowerBound, upperBound);
+        if ( !cursors[i]->Open(runs[i], readBufferSize) ) {
+            cerr << "bamtools sort ERROR: could not read sorted run from " << runs[i].Filename << endl;
+            success = false;
+            break;
+        }
+    }
+
+    if ( success ) {
+
+        // load first record of each run
+        vector< RunHead<Compare> > heap;
+        heap.reserve(numRuns);
+        RunHeadSorter<Compare> headSorter(comp);
+        for ( size_t i = 0; i < numRuns; ++i ) {
+            if ( cursors[i]->Next() )
+                heap.push_back( RunHead<Compare>(cursors[i]->Key, i) );
+        }
+        std::make_heap(heap.begin(), heap.end(), headSorter);
+
+        // repeatedly write smallest record & replace it with the next one from its run
+        while ( !heap.empty() ) {
+            std::pop_heap(heap.begin(), heap.end(), headSorter);
+            const size_t run = heap.back().Run;
+            heap.pop_back();
+
+            if ( !output.SaveAlignment(cursors[run]->Alignment) ) {
+                cerr << "bamtools sort ERROR: could not write merged alignment" << endl
+                     << output.GetErrorString() << endl;
+                success = false;
+                break;
+            }
+
+            if ( cursors[run]->Next() ) {
+                heap.push_back( RunHead<Compare>(cursors[run]->Key, run) );
+                std::push_heap(heap.begin(), heap.end(), headSorter);
+            }
+        }
+    }
+
+    // clean up & return success/fail
+    for ( size_t i = 0; i < numRuns; ++i )
+        delete cursors[i];
+    return success;
+}
+
+// BGZF file holding a merged key range, records start & end on block boundaries
+struct MergeSegment {
+    string Filename;
+    int64_t DataBegin;   // file offset of first record block
+    int64_t DataEnd;     // file offset of EOF marker block
+    bool IsOk;
+
+    MergeSegment(const string& filename = "")
+        : Filename(filename)
+        , DataBegin(0)
+        , DataEnd(0)
+        , IsOk(false)
+    { }
+};
+
+// merges one key range of the runs into its own segment file
+template<typename Compare>
+class RangeMergeTask : public ThreadPool::Task {
+
+    typedef typename Compare::KeyType KeyType;
+
+    public:
+        RangeMergeTask(const vector<SortedRun>& runs,
+                       const string& headerText,
+                       const RefVector& references,
+                       const KeyType* lowerBound,
+                       const KeyType* upperBound,
+                       const Compare& comp,
+                       const size_t readBufferSize,
+                       MergeSegment* segment)
+            : m_runs(&runs)
+            , m_headerText(&headerText)
+            , m_references(&references)
+            , m_lowerBound(lowerBound)
+            , m_upperBound(upperBound)
+            , m_comp(comp)
+            , m_readBufferSize(readBufferSize)
+            , m_segment(segment)
+        { }
+
+        void Run(void) {
+
+            BamWriter writer;
+            if ( !writer.Open(m_segment->Filename, *m_headerText, *m_references) ) {
+                cerr << "bamtools sort ERROR: could not open " << m_segment->Filename
+                     << " for writing" << endl;
+                return;
+            }
+
+            // keep header & records in separate blocks, so segments can be joined as-is
+            bool success = writer.Flush();
+            m_segment->DataBegin = ( writer.Tell() >> 16 );
+            success = success && MergeRunRange(*m_runs, m_lowerBound, m_upperBound, m_comp, m_readBufferSize, writer);
+            success = success && writer.Flush();
+            m_segment->DataEnd = ( writer.Tell() >> 16 );
+            writer.Close();
+            m_segment->IsOk = success;
+        }
+
+    private:
+        const vector<SortedRun>* m_runs;
+        const string* m_headerText;
+        const RefVector* m_references;
+        const KeyType* m_lowerBound;
+        const KeyType* m_upperBound;
+        Compare m_comp;
+        size_t m_readBufferSize;
+        MergeSegment* m_segment;
+};
+
+// merges a group of runs into a single new run, in its own spill file
+// (used by intermediate merge passes)
+template<typename Compare>
+class GroupMergeTask : public ThreadPool::Task {
+
+    public:
+        GroupMergeTask(const vector<SortedRun>& runs,
+                       const string& filename,
+                       const string& headerText,
+                       const RefVector& references,
+                       const Compare& comp,
+                       const size_t readBufferSize)
+            : Runs(runs)
+            , Filename(filename)
+            , BytesWritten(0)
+            , IsOk(false)
+            , m_headerText(&headerText)
+            , m_references(&references)
+            , m_comp(comp)
+            , m_readBufferSize(readBufferSize)
+        { }
+
+        void Run(void) {
+
+            BamWriter writer;
+            writer.SetCompressionLevel(SORT_SPILL_COMPRESSION_LEVEL);
+            if ( !writer.Open(Filename, *m_headerText, *m_references) ) {
+                cerr << "bamtools sort ERROR: could not open " << Filename
+                     << " for writing" << endl;
+                return;
+            }
+
+            RunSpiller spiller(writer, Filename);
+            bool success = MergeRunRange(Runs, 0, 0, m_comp, m_readBufferSize, spiller);
+            success = success && writer.Flush();
+            BytesWritten = ( writer.Tell() >> 16 );
+            writer.Close();
+
+            MergedRun = spiller.Run();
+            IsOk = success;
+        }
+
+    // input & results
+    public:
+        vector<SortedRun> Runs;
+        string Filename;
+        SortedRun MergedRun;
+        uint64_t BytesWritten;
+        bool IsOk;
+
+    private:
+        const string* m_headerText;
+        const RefVector* m_references;
+        Compare m_comp;
+        size_t m_readBufferSize;
+};
+
+// deletes the spill files holding a set of runs
+static void RemoveRunFiles(const vector<SortedRun>& runs) {
+    set<string> filenames;
+    vector<SortedRun>::const_iterator runIter = runs.begin();
+    vector<SortedRun>::const_iterator runEnd  = runs.end();
+    for ( ; runIter != runEnd; ++runIter )
+        filenames.insert( (*runIter).Filename );
+    set<string>::const_iterator nameIter = filenames.begin();
+    set<string>::const_iterator nameEnd  = filenames.end();
+    for ( ; nameIter != nameEnd; ++nameIter )
+        remove( (*nameIter).c_str() );
+}
+
+// copies bytes [begin, end) of a file to output (end < 0 means: until end of file)
+static bool CopyFileRange(const string& filename, const int64_t begin, const int64_t end, FILE* out) {
+
+    FILE* in = fopen(filename.c_str(), "rb");
+    if ( in == 0 )
+        return false;
+
+    // N.B. - input is read sequentially from its start, so no (64-bit) seeking is needed
+    static const size_t COPY_BUFFER_SIZE = 1024 * 1024;
+    vector<char> buffer(COPY_BUFFER_SIZE);
+    int64_t position = 0;
+    bool success = true;
+    while ( end < 0 || position < end ) {
+        size_t numBytes = COPY_BUFFER_SIZE;
+        if ( end >= 0 && static_cast<int64_t>(numBytes) > end - position )
+            numBytes = static_cast<size_t>(end - position);
+        const size_t numRead = fread(&buffer[0], 1, numBytes, in);
+        if ( numRead == 0 ) {
+            success = ( end < 0 );
+            break;
+        }
+
+        // write the part of this chunk that lies beyond begin
+        if ( position + static_cast<int64_t>(numRead) > begin ) {
+            const size_t skip = ( position < begin ? static_cast<size_t>(begin - position) : 0 );
+            if ( fwrite(&buffer[0] + skip, 1, numRead - skip, out) != numRead - skip ) {
+                success = false;
+                break;
+            }
+        }
+        position += numRead;
+    }
+
+    fclose(in);
+    return success;
+}
+
 } // namespace BamTools
 
 // ---------------------------------------------
@@ -48,8 +729,11 @@ struct SortTool::SortSettings {
     bool HasInputBamFilename;
     bool HasMaxBufferCount;
     bool HasMaxBufferMemory;
+    bool HasMaxFanIn;
+    bool HasNumThreads;
     bool HasOutputBamFilename;
     bool IsSortingByName;
+    bool IsVerbose;
 
     // filenames
     string InputBamFilename;
@@ -57,19 +741,26 @@ struct SortTool::SortSettings {
 
     // parameters
     unsigned int MaxBufferCount;
-    unsigned int MaxBufferMemory;
+    string MaxBufferMemory;
+    unsigned int MaxFanIn;
+    unsigned int NumThreads;
 
     // constructor
     SortSettings(void)
         : HasInputBamFilename(false)
         , HasMaxBufferCount(false)
         , HasMaxBufferMemory(false)
+        , HasMaxFanIn(false)
+        , HasNumThreads(false)
         , HasOutputBamFilename(false)
         , IsSortingByName(false)
+        , IsVerbose(false)
         , InputBamFilename(Options::StandardIn())
         , OutputBamFilename(Options::StandardOut())
         , MaxBufferCount(SORT_DEFAULT_MAX_BUFFER_COUNT)
         , MaxBufferMemory(SORT_DEFAULT_MAX_BUFFER_MEMORY)
+        , MaxFanIn(SORT_DEFAULT_MAX_FAN_IN)
+        , NumThreads(SORT_DEFAULT_NUM_THREADS)
     { }
 };
 
@@ -81,7 +772,7 @@ class SortTool::SortToolPrivate {
     // ctor & dtor
     public:
         SortToolPrivate(SortTool::SortSettings* settings);
-        ~SortToolPrivate(void) { }
+        ~SortToolPrivate(void);
         
     // 'public' interface
     public:
@@ -89,26 +780,98 @@ class SortTool::SortToolPrivate {
         
     // internal methods
     private:
-        bool CreateSortedTempFile(vector<BamAlignment>& buffer);
-        bool GenerateSortedRuns(void);
-        bool MergeSortedRuns(void);
-        bool WriteTempFile(const vector<BamAlignment>& buffer, const string& tempFilename);
-        void SortBuffer(vector<BamAlignment>& buffer);
+        bool CreateSortedRun(deque<BamAlignment>& buffer, const bool isSorted);
+        template<typename Compare>
+        bool GenerateSortedRuns(const Compare& comp);
+        template<typename Compare>
+        bool MergePass(const Compare& comp, const size_t maxFanIn);
+        template<typename Compare>
+        bool MergeSortedRuns(const Compare& comp);
+        template<typename Compare>
+        bool ParallelMergeRuns(const Compare& comp, bool& success);
+        size_t ReadBufferSize(const size_t numReaders) const;
+        template<typename Compare>
+        bool SortInput(const Compare& comp);
+        void SortBuffer(const deque<BamAlignment>& buffer, vector<const BamAlignment*>& sorted);
+        bool SpillRun(const vector<const BamAlignment*>& sorted);
+        bool WriteSortedRun(deque<BamAlignment>& buffer, const bool isSorted);
+
+    // background sorting & writing of runs
+    private:
+        class RunWriter;
         
     // data members
     private:
         SortTool::SortSettings* m_settings;
         string m_tempFilenameStub;
-        int m_numberOfRuns;
         string m_headerText;
         RefVector m_references;
-        vector<string> m_tempFilenames;
+        string m_spillFilename;
+        BamWriter m_spillWriter;
+        vector<SortedRun> m_runs;
+        uint64_t m_maxMemory;
+        int m_numMergePasses;
+        uint64_t m_bytesSpilled;
+        bool m_isOutputComplete;
+        ThreadPool* m_threadPool;
+        RunWriter* m_runWriter;
+};
+
+// sorts & spills a full buffer on its own thread, while the next buffer is filled
+class SortTool::SortToolPrivate::RunWriter : public Thread {
+
+    // ctor & dtor
+    public:
+        RunWriter(SortTool::SortToolPrivate* tool)
+            : Thread()
+            , m_tool(tool)
+            , m_isSorted(false)
+            , m_hasFailed(false)
+        { }
+        ~RunWriter(void) { Wait(); }
+
+    // RunWriter interface
+    public:
+        // waits for any pending run, returns true if all runs were written successfully
+        bool Finish(void) {
+            Wait();
+            return !m_hasFailed;
+        }
+
+        // takes over the buffer contents and starts writing them in the background
+        // N.B. - on return, buffer holds the (emptied) storage of the previous run
+        void WriteRun(deque<BamAlignment>& buffer, const bool isSorted) {
+            Wait();
+            m_buffer.swap(buffer);
+            m_isSorted = isSorted;
+            if ( !Start() )
+                Run();
+        }
+
+    // Thread implementation
+    protected:
+        void Run(void) {
+            if ( !m_tool->WriteSortedRun(m_buffer, m_isSorted) )
+                m_hasFailed = true;
+        }
+
+    // data members
+    private:
+        SortTool::SortToolPrivate* m_tool;
+        deque<BamAlignment> m_buffer;
+        bool m_isSorted;
+        bool m_hasFailed;
 };
 
 // constructor
 SortTool::SortToolPrivate::SortToolPrivate(SortTool::SortSettings* settings) 
     : m_settings(settings)
-    , m_numberOfRuns(0) 
+    , m_maxMemory(0)
+    , m_numMergePasses(0)
+    , m_bytesSpilled(0)
+    , m_isOutputComplete(false)
+    , m_threadPool(0)
+    , m_runWriter(0)
 { 
     // set filename stub depending on inputfile path
     // that way multiple sort runs don't trip on each other's temp files
@@ -117,11 +880,35 @@ SortTool::SortToolPrivate::SortToolPrivate(SortTool::SortSettings* settings)
         if ( extensionFound != string::npos )
             m_tempFilenameStub = m_settings->InputBamFilename.substr(0,extensionFound);
         m_tempFilenameStub.append(".sort.temp.");
+        m_spillFilename = m_tempFilenameStub + "spill";
+
+        // set up worker threads for in-memory sorting
+        m_threadPool = new ThreadPool(m_settings->NumThreads);
+
+        // if multi-threaded, also overlap sorting & writing runs with reading input
+        if ( m_settings->NumThreads > 1 )
+            m_runWriter = new RunWriter(this);
     }
 }
 
-// generates mutiple sorted temp BAM files from single unsorted BAM file
-bool SortTool::SortToolPrivate::GenerateSortedRuns(void) {
+// destructor
+SortTool::SortToolPrivate::~SortToolPrivate(void) {
+    delete m_runWriter;
+    m_runWriter = 0;
+    delete m_threadPool;
+    m_threadPool = 0;
+}
+
+// generates multiple sorted runs (in spill files) from single unsorted BAM file
+//
+// N.B. - input that is already in order is never buffered: each non-decreasing
+//        ('natural') stretch of records is streamed straight into a run, as long
+//        as these stretches are long. Fully sorted input is streamed straight into
+//        the output file (if possible), so no merge is needed at all.
+template<typename Compare>
+bool SortTool::SortToolPrivate::GenerateSortedRuns(const Compare& comp) {
+
+    typedef typename Compare::KeyType KeyType;
     
     // open input BAM file
     BamReader reader;
@@ -140,178 +927,476 @@ bool SortTool::SortToolPrivate::GenerateSortedRuns(void) {
                        : Constants::SAM_HD_SORTORDER_COORDINATE );
     m_headerText = header.ToString();
     m_references = reader.GetReferenceData();
+
+    // determine buffer limits
+    // N.B. - when runs are written in the background, 2 buffers are in use at once,
+    //        so each gets half of the budget
+    if ( !Utilities::ParseMemorySize(m_settings->MaxBufferMemory, m_maxMemory, 'M') ) {
+        cerr << "bamtools sort ERROR: invalid memory size: " << m_settings->MaxBufferMemory
+             << "... Aborting." << endl;
+        reader.Close();
+        return false;
+    }
+    uint64_t maxBufferBytes = m_maxMemory;
+    size_t maxBufferCount = m_settings->MaxBufferCount;
+    if ( m_runWriter ) {
+        maxBufferBytes /= 2;
+        maxBufferCount = ( maxBufferCount + 1 ) / 2;
+    }
+
+    // open spill file, all runs are appended here one after another
+    m_spillWriter.SetCompressionLevel(SORT_SPILL_COMPRESSION_LEVEL);
+    if ( !m_spillWriter.Open(m_spillFilename, m_headerText, m_references) ) {
+        cerr << "bamtools sort ERROR: could not open " << m_spillFilename
+             << " for writing... Aborting." << endl;
+        reader.Close();
+        return false;
+    }
+
+    // the first natural run goes into a temp file next to the output (unless writing
+    // to stdout), which becomes the output file if it turns out to hold all input
+    // N.B. - the output file is only replaced once all input is read, as it may be the input file
+    const string& outputFilename = m_settings->OutputBamFilename;
+    const bool canStreamToOutput = ( outputFilename != Options::StandardOut() && outputFilename != "-" );
+    const string presortedFilename = outputFilename + ".sort.temp.presorted";
+    BamWriter presortedWriter;
+    bool isPresorted = false;
+    RunSpiller* naturalRun = 0;
+    bool isStreaming = true;
     
     // set up alignments buffer
-    BamAlignment al;
-    vector<BamAlignment> buffer;
-    buffer.reserve( (size_t)(m_settings->MaxBufferCount*1.1) );
+    // (deque, so that growing it never copies the buffered alignments)
+    deque<BamAlignment> buffer;
+    uint64_t bufferBytes = 0;
     bool bufferFull = false;
+    bool isBufferSorted = true;
+    bool success = true;
 
-    // if sorting by name, we need to generate full char data
-    // so can't use GetNextAlignmentCore()
-    if ( m_settings->IsSortingByName ) {
+    // N.B. - name sorting works on pre-computed name keys (see Sort::NameKey),
+    //        so we can take advantage of GNACore() speedup for either sort order
 
-        // iterate through file
-        while ( reader.GetNextAlignment(al)) {
+    // read into 2 alternating alignments, so that the previous record (& its key) stays valid
+    BamAlignment alignments[2];
+    size_t current = 0;
+    KeyType previousKey;
+    bool hasPrevious = false;
+    Compare keyComp(comp);
 
-            // check buffer's usage
-            bufferFull = ( buffer.size() >= m_settings->MaxBufferCount );
+    // iterate through file
+    while ( success && reader.GetNextAlignmentCore(alignments[current]) ) {
 
-            // store alignments until buffer is "full"
-            if ( !bufferFull )
-                buffer.push_back(al);
+        const BamAlignment& al = alignments[current];
+        const KeyType key = comp.MakeKey(al);
+        const bool isDescending = ( hasPrevious && keyComp(key, previousKey) );
 
-            // if buffer is "full"
-            else {
-                // so create a sorted temp file with current buffer contents
-                // then push "al" into fresh buffer
-                CreateSortedTempFile(buffer);
-                buffer.push_back(al);
-            }
-        }
-    }
+        // end of a natural run
+        if ( isStreaming && isDescending ) {
 
-    // sorting by position, can take advantage of GNACore() speedup
-    else {
+            // switch to sorting in buffers from here, if input does not look presorted
+            if ( naturalRun->Run().Count < SORT_MIN_NATURAL_RUN_SIZE )
+                isStreaming = false;
 
-        // iterate through file
-        while ( reader.GetNextAlignmentCore(al) ) {
+            // (the first run's temp file is then merged like any other run)
+            if ( m_runs.empty() && canStreamToOutput )
+                presortedWriter.Close();
+            m_runs.push_back(naturalRun->Run());
+            delete naturalRun;
+            naturalRun = 0;
+        }
 
-            // check buffer's usage
-            bufferFull = ( buffer.size() >= m_settings->MaxBufferCount );
+        // stream record into current natural run
+        if ( isStreaming ) {
+            if ( naturalRun == 0 ) {
+                if ( m_runs.empty() && canStreamToOutput ) {
+                    if ( !presortedWriter.Open(presortedFilename, m_headerText, m_references) ) {
+                        cerr << "bamtools sort ERROR: could not open " << presortedFilename
+                             << " for writing... Aborting." << endl;
+                        success = false;
+                        break;
+                    }
+                    naturalRun = new RunSpiller(presortedWriter, presortedFilename);
+                } else
+                    naturalRun = new RunSpiller(m_spillWriter, m_spillFilename);
+            }
+            if ( !naturalRun->SaveAlignment(al) ) {
+                cerr << "bamtools sort ERROR: could not write alignment" << endl
+                     << naturalRun->GetErrorString() << endl;
+                success = false;
+            }
+        }
 
-            // store alignments until buffer is "full"
-            if ( !bufferFull )
-                buffer.push_back(al);
+        // otherwise buffer record
+        else {
 
-            // if buffer is "full"
-            else {
-                // create a sorted temp file with current buffer contents
-                // then push "al" into fresh buffer
-                CreateSortedTempFile(buffer);
-                buffer.push_back(al);
+            // check buffer's usage, in actual bytes held (and alignment count, if requested)
+            const uint64_t alignmentBytes = al.GetMemoryUsage() + SORT_ALIGNMENT_OVERHEAD;
+            bufferFull = ( !buffer.empty() &&
+                           ( bufferBytes + alignmentBytes > maxBufferBytes ||
+                             ( maxBufferCount > 0 && buffer.size() >= maxBufferCount ) ) );
+
+            // if buffer is "full", create a sorted run with current buffer contents
+            if ( bufferFull ) {
+                if ( !CreateSortedRun(buffer, isBufferSorted) )
+                    success = false;
+                bufferBytes = 0;
             }
+
+            // store alignment in (fresh) buffer, noting if it is still in order
+            if ( !buffer.empty() && isDescending )
+                isBufferSorted = false;
+            else if ( buffer.empty() )
+                isBufferSorted = true;
+            buffer.push_back(al);
+            bufferBytes += alignmentBytes;
         }
+
+        previousKey = key;
+        hasPrevious = true;
+        current ^= 1;
+    }
+
+    // finish last natural run
+    // N.B. - if it is the only one, its temp file already is the sorted output
+    if ( naturalRun ) {
+        if ( m_runs.empty() && canStreamToOutput ) {
+            presortedWriter.Close();
+            isPresorted = true;
+        } else
+            m_runs.push_back(naturalRun->Run());
+        delete naturalRun;
+        naturalRun = 0;
     }
 
     // handle any leftover buffer contents
-    if ( !buffer.empty() )
-        CreateSortedTempFile(buffer);
+    if ( !buffer.empty() && !CreateSortedRun(buffer, isBufferSorted) )
+        success = false;
+
+    // wait for any background run to complete
+    if ( m_runWriter && !m_runWriter->Finish() )
+        success = false;
     
-    // close reader & return success
+    // close files
     reader.Close();
-    return true;
+    if ( !m_spillWriter.Flush() )
+        success = false;
+    m_bytesSpilled += ( m_spillWriter.Tell() >> 16 );
+    m_spillWriter.Close();
+
+    // input was presorted, move its copy over the output file
+    if ( isPresorted ) {
+        if ( success ) {
+            if ( rename(presortedFilename.c_str(), outputFilename.c_str()) == 0 )
+                m_isOutputComplete = true;
+            else {
+                cerr << "bamtools sort ERROR: could not rename " << presortedFilename
+                     << " to " << outputFilename << endl;
+                success = false;
+            }
+        }
+        if ( !success )
+            remove(presortedFilename.c_str());
+    }
+
+    // return success
+    return success;
 }
 
-bool SortTool::SortToolPrivate::CreateSortedTempFile(vector<BamAlignment>& buffer) {
+bool SortTool::SortToolPrivate::CreateSortedRun(deque<BamAlignment>& buffer, const bool isSorted) {
  
-    // do sorting
-    SortBuffer(buffer);
-  
-    // write sorted contents to temp file, store success/fail
-    stringstream tempStr;
-    tempStr << m_tempFilenameStub << m_numberOfRuns;
-    bool success = WriteTempFile( buffer, tempStr.str() );
-    
-    // save temp filename for merging later
-    m_tempFilenames.push_back(tempStr.str());
-    
-    // clear buffer contents & update run counter
-    buffer.clear();
-    ++m_numberOfRuns;
-    
-    // return success/fail of writing to temp file
-    // TODO: a failure returned here is not actually caught and handled anywhere
+    // hand buffer off to background writer, if available
+    // (a failure there is reported once all runs are finished)
+    if ( m_runWriter ) {
+        m_runWriter->WriteRun(buffer, isSorted);
+        buffer.clear();
+        return true;
+    }
+
+    // otherwise sort & write buffer right here
+    return WriteSortedRun(buffer, isSorted);
+}
+
+// merges groups of (up to) maxFanIn consecutive runs into single runs, one
+// new spill file per group
+//
+// N.B. - groups keep the original run order, so the overall merge stays stable
+template<typename Compare>
+bool SortTool::SortToolPrivate::MergePass(const Compare& comp, const size_t maxFanIn) {
+
+    ++m_numMergePasses;
+
+    const size_t numRuns   = m_runs.size();
+    const size_t numGroups = ( numRuns + maxFanIn - 1 ) / maxFanIn;
+    const size_t numConcurrent = std::min<size_t>(numGroups, m_threadPool->NumThreads());
+    const size_t readBufferSize = ReadBufferSize( std::min(numRuns, maxFanIn * numConcurrent) );
+
+    vector< GroupMergeTask<Compare> > tasks;
+    tasks.reserve(numGroups);
+    for ( size_t i = 0; i < numGroups; ++i ) {
+        const size_t first = i * maxFanIn;
+        const size_t last  = std::min(first + maxFanIn, numRuns);
+        const vector<SortedRun> group(m_runs.begin() + first, m_runs.begin() + last);
+        stringstream groupFilename;
+        groupFilename << m_tempFilenameStub << "spill." << m_numMergePasses << "." << i;
+        tasks.push_back( GroupMergeTask<Compare>(group, groupFilename.str(),
+                                                 m_headerText, m_references,
+                                                 comp, readBufferSize) );
+    }
+    for ( size_t i = 0; i < numGroups; ++i )
+        m_threadPool->Submit(&tasks[i]);
+    m_threadPool->WaitForAll();
+
+    // replace input runs with merged ones
+    bool success = true;
+    vector<SortedRun> mergedRuns;
+    mergedRuns.reserve(numGroups);
+    for ( size_t i = 0; i < numGroups; ++i ) {
+        success = success && tasks[i].IsOk;
+        mergedRuns.push_back(tasks[i].MergedRun);
+        m_bytesSpilled += tasks[i].BytesWritten;
+    }
+    RemoveRunFiles(m_runs);
+    m_runs.swap(mergedRuns);
     return success;
 }
 
-// merges sorted temp BAM files into single sorted output BAM file
-bool SortTool::SortToolPrivate::MergeSortedRuns(void) {
-  
-    // open up multi reader for all of our temp files
-    // this might get broken up if we do a multi-pass system later ??
-    BamMultiReader multiReader;
-    if ( !multiReader.Open(m_tempFilenames) ) {
-        cerr << "bamtools sort ERROR: could not open BamMultiReader for merging temp files... Aborting."
-             << endl;
-        return false;
+// merges sorted runs from spill files into single sorted output BAM file
+template<typename Compare>
+bool SortTool::SortToolPrivate::MergeSortedRuns(const Compare& comp) {
+
+    // reduce number of runs in intermediate passes, until they fit in a single merge
+    const size_t maxFanIn = std::max<size_t>(m_settings->MaxFanIn, 2);
+    bool success = true;
+    while ( success && m_runs.size() > maxFanIn )
+        success = MergePass(comp, maxFanIn);
+
+    if ( success ) {
+
+        ++m_numMergePasses;
+
+        uint64_t numAlignments = 0;
+        vector<SortedRun>::const_iterator runIter = m_runs.begin();
+        vector<SortedRun>::const_iterator runEnd  = m_runs.end();
+        for ( ; runIter != runEnd; ++runIter )
+            numAlignments += (*runIter).Count;
+
+        // split large merges into key ranges, merged concurrently
+        // (falls back to a single merge if no useful splitters could be found)
+        bool isMerged = false;
+        if ( m_threadPool->NumThreads() > 1 && numAlignments >= PARALLEL_MERGE_MIN_SIZE )
+            isMerged = ParallelMergeRuns(comp, success);
+
+        if ( !isMerged ) {
+
+            // open writer for our completely sorted output BAM file
+            BamWriter mergedWriter;
+            if ( !mergedWriter.Open(m_settings->OutputBamFilename, m_headerText, m_references) ) {
+                cerr << "bamtools sort ERROR: could not open " << m_settings->OutputBamFilename
+                     << " for writing... Aborting." << endl;
+                success = false;
+            } else {
+                success = MergeRunRange(m_runs, 0, 0, comp, ReadBufferSize(m_runs.size()), mergedWriter);
+                mergedWriter.Close();
+            }
+        }
     }
 
-    // open writer for our completely sorted output BAM file
-    BamWriter mergedWriter;
-    if ( !mergedWriter.Open(m_settings->OutputBamFilename, m_headerText, m_references) ) {
-        cerr << "bamtools sort ERROR: could not open " << m_settings->OutputBamFilename
-             << " for writing... Aborting." << endl;
-        multiReader.Close();
+    // delete spill files & return success/fail
+    RemoveRunFiles(m_runs);
+    remove(m_spillFilename.c_str());
+    return success;
+}
+
+// merges P key ranges of the runs on separate threads, each into its own BGZF
+// segment, then joins the segments block-wise into the output file
+//
+// returns false if key space could not be split (nothing is written in that case)
+template<typename Compare>
+bool SortTool::SortToolPrivate::ParallelMergeRuns(const Compare& comp, bool& success) {
+
+    typedef typename Compare::KeyType KeyType;
+
+    // pick splitters at evenly spaced quantiles of the run samples
+    // N.B. - samples are taken at a fixed record interval, so each stands for
+    //        (roughly) the same number of records
+    vector<KeyType> sampleKeys;
+    vector<SortedRun>::const_iterator runIter = m_runs.begin();
+    vector<SortedRun>::const_iterator runEnd  = m_runs.end();
+    for ( ; runIter != runEnd; ++runIter ) {
+        const vector<RunSample>& samples = (*runIter).Samples;
+        vector<RunSample>::const_iterator sampleIter = samples.begin();
+        vector<RunSample>::const_iterator sampleEnd  = samples.end();
+        for ( ; sampleIter != sampleEnd; ++sampleIter )
+            sampleKeys.push_back( comp.MakeKey((*sampleIter).Alignment) );
+    }
+    Compare keyComp(comp);
+    std::sort(sampleKeys.begin(), sampleKeys.end(), keyComp);
+
+    const size_t numRanges = m_threadPool->NumThreads();
+    vector<KeyType> splitters;
+    for ( size_t i = 1; i < numRanges; ++i ) {
+        const KeyType& key = sampleKeys[ (i * sampleKeys.size()) / numRanges ];
+        if ( splitters.empty() || keyComp(splitters.back(), key) )
+            splitters.push_back(key);
+    }
+    if ( splitters.empty() )
         return false;
+
+    // merge each range [splitter(i-1), splitter(i)) into its own segment
+    const size_t numSegments = splitters.size() + 1;
+    const size_t readBufferSize = ReadBufferSize( m_runs.size() * std::min<size_t>(numSegments, m_threadPool->NumThreads()) );
+    vector<MergeSegment> segments;
+    vector< RangeMergeTask<Compare> > tasks;
+    segments.reserve(numSegments);
+    tasks.reserve(numSegments);
+    for ( size_t i = 0; i < numSegments; ++i ) {
+        stringstream segmentFilename;
+        segmentFilename << m_tempFilenameStub << "part." << i;
+        segments.push_back( MergeSegment(segmentFilename.str()) );
+        tasks.push_back( RangeMergeTask<Compare>(m_runs, m_headerText, m_references,
+                                                 ( i > 0 ? &splitters[i-1] : 0 ),
+                                                 ( i + 1 < numSegments ? &splitters[i] : 0 ),
+                                                 comp, readBufferSize, &segments[i]) );
     }
-    
-    // while data available in temp files
-    BamAlignment al;
-    while ( multiReader.GetNextAlignmentCore(al) )
-        mergedWriter.SaveAlignment(al);
-  
-    // close files
-    multiReader.Close();
-    mergedWriter.Close();
-    
-    // delete all temp files
-    vector<string>::const_iterator tempIter = m_tempFilenames.begin();
-    vector<string>::const_iterator tempEnd  = m_tempFilenames.end();
-    for ( ; tempIter != tempEnd; ++tempIter ) {
-        const string& tempFilename = (*tempIter);
-        remove(tempFilename.c_str());
+    for ( size_t i = 0; i < numSegments; ++i )
+        m_threadPool->Submit(&tasks[i]);
+    m_threadPool->WaitForAll();
+
+    success = true;
+    for ( size_t i = 0; i < numSegments; ++i )
+        success = success && segments[i].IsOk;
+
+    // join segments: header from the first one, records from all, EOF marker from the last
+    if ( success ) {
+        const string& outputFilename = m_settings->OutputBamFilename;
+        const bool isStdout = ( outputFilename == Options::StandardOut() || outputFilename == "-" );
+        FILE* out = ( isStdout ? stdout : fopen(outputFilename.c_str(), "wb") );
+        if ( out == 0 ) {
+            cerr << "bamtools sort ERROR: could not open " << outputFilename
+                 << " for writing... Aborting." << endl;
+            success = false;
+        } else {
+            for ( size_t i = 0; success && i < numSegments; ++i ) {
+                const MergeSegment& segment = segments[i];
+                const int64_t begin = ( i == 0 ? 0 : segment.DataBegin );
+                const bool isLast = ( i + 1 == numSegments );
+                success = CopyFileRange(segment.Filename, begin, ( isLast ? -1 : segment.DataEnd ), out);
+            }
+            if ( isStdout )
+                success = ( fflush(out) == 0 ) && success;
+            else
+                success = ( fclose(out) == 0 ) && success;
+            if ( !success )
+                cerr << "bamtools sort ERROR: could not write merged segments to " << outputFilename << endl;
+        }
     }
-  
-    // return success
+
+    // delete segment files
+    for ( size_t i = 0; i < numSegments; ++i )
+        remove(segments[i].Filename.c_str());
     return true;
 }
 
 bool SortTool::SortToolPrivate::Run(void) {
  
-    // this does a single pass, chunking up the input file into smaller sorted temp files, 
-    // then write out using BamMultiReader to handle merging
-    
-    if ( GenerateSortedRuns() )
-        return MergeSortedRuns();
-    else 
+    bool success = false;
+    if ( m_settings->IsSortingByName )
+        success = SortInput( Sort::ByName() );
+    else
+        success = SortInput( Sort::ByPosition() );
+
+    // report merge statistics, if requested
+    if ( m_settings->IsVerbose )
+        cerr << "bamtools sort: merge passes: " << m_numMergePasses
+             << ", bytes spilled: " << m_bytesSpilled << endl;
+    return success;
+}
+
+// this does a single pass, chunking up the input file into sorted runs in
+// spill files, then merges those runs into the output file
+template<typename Compare>
+bool SortTool::SortToolPrivate::SortInput(const Compare& comp) {
+
+    if ( !GenerateSortedRuns(comp) ) {
+        RemoveRunFiles(m_runs);
+        remove(m_spillFilename.c_str());
         return false;
-} 
+    }
+
+    // input was already sorted
+    if ( m_isOutputComplete ) {
+        remove(m_spillFilename.c_str());
+        return true;
+    }
+
+    return MergeSortedRuns(comp);
+}
+
+// returns read buffer size for each of numReaders concurrently open runs,
+// splitting the memory budget between them
+size_t SortTool::SortToolPrivate::ReadBufferSize(const size_t numReaders) const {
+    uint64_t bufferSize = m_maxMemory / std::max<size_t>(numReaders, 1);
+    bufferSize = std::min<uint64_t>(bufferSize, SORT_MAX_READ_BUFFER_SIZE);
+    bufferSize = std::max<uint64_t>(bufferSize, SORT_MIN_READ_BUFFER_SIZE);
+    return static_cast<size_t>(bufferSize);
+}
     
-void SortTool::SortToolPrivate::SortBuffer(vector<BamAlignment>& buffer) {
- 
+// sorts (pointers to) buffer contents, leaving the alignments themselves in place
+void SortTool::SortToolPrivate::SortBuffer(const deque<BamAlignment>& buffer,
+                                           vector<const BamAlignment*>& sorted)
+{
     // ** add further custom sort options later ?? **
-    
+
     // sort buffer by desired method
+    // N.B. - position keys are radix sorted, see SortChunk()
     if ( m_settings->IsSortingByName )
-        std::stable_sort( buffer.begin(), buffer.end(), Sort::ByName() );
+        SortByKey(buffer, Sort::ByName(), *m_threadPool, sorted);
     else
-        std::stable_sort( buffer.begin(), buffer.end(), Sort::ByPosition() );
+        SortByKey(buffer, Sort::ByPosition(), *m_threadPool, sorted);
 }
-    
-bool SortTool::SortToolPrivate::WriteTempFile(const vector<BamAlignment>& buffer,
-                                              const string& tempFilename)
-{
-    // open temp file for writing
-    BamWriter tempWriter;
-    if ( !tempWriter.Open(tempFilename, m_headerText, m_references) ) {
-        cerr << "bamtools sort ERROR: could not open " << tempFilename
-             << " for writing." << endl;
-        return false;
-    }
-  
-    // write data
-    vector<BamAlignment>::const_iterator buffIter = buffer.begin();
-    vector<BamAlignment>::const_iterator buffEnd  = buffer.end();
-    for ( ; buffIter != buffEnd; ++buffIter )  {
-        const BamAlignment& al = (*buffIter);
-        tempWriter.SaveAlignment(al);
+
+// appends sorted alignments to spill file, as a new run
+bool SortTool::SortToolPrivate::SpillRun(const vector<const BamAlignment*>& sorted) {
+
+    // write data (run start & samples are noted along the way)
+    RunSpiller spiller(m_spillWriter, m_spillFilename);
+    vector<const BamAlignment*>::const_iterator sortedIter = sorted.begin();
+    vector<const BamAlignment*>::const_iterator sortedEnd  = sorted.end();
+    for ( ; sortedIter != sortedEnd; ++sortedIter ) {
+        const BamAlignment& al = *(*sortedIter);
+        if ( !spiller.SaveAlignment(al) ) {
+            cerr << "bamtools sort ERROR: could not write to " << m_spillFilename << endl
+                 << spiller.GetErrorString() << endl;
+            return false;
+        }
     }
-  
-    // close temp file & return success
-    tempWriter.Close();
+
+    // store run for merging later & return success
+    m_runs.push_back(spiller.Run());
     return true;
 }
+    
+// sorts buffer (unless already in order) & appends it to spill file, clearing the buffer afterwards
+// N.B. - runs are written one at a time (either here or on the RunWriter thread)
+bool SortTool::SortToolPrivate::WriteSortedRun(deque<BamAlignment>& buffer, const bool isSorted) {
+
+    // do sorting
+    vector<const BamAlignment*> sorted;
+    if ( isSorted ) {
+        sorted.reserve(buffer.size());
+        deque<BamAlignment>::const_iterator buffIter = buffer.begin();
+        deque<BamAlignment>::const_iterator buffEnd  = buffer.end();
+        for ( ; buffIter != buffEnd; ++buffIter )
+            sorted.push_back( &(*buffIter) );
+    } else
+        SortBuffer(buffer, sorted);
+
+    // write sorted contents to spill file, store success/fail
+    const bool success = SpillRun(sorted);
+
+    // clear buffer contents & return success/fail
+    buffer.clear();
+    return success;
+}
 
 // ---------------------------------------------
 // SortTool implementation
@@ -337,12 +1422,22 @@ SortTool::SortTool(void)
     Options::AddOption("-byname", "sort by alignment name", m_settings->IsSortingByName, SortOpts);
 
     OptionGroup* MemOpts = Options::CreateOptionGroup("Memory Settings");
-    Options::AddValueOption("-n",   "count", "max number of alignments per tempfile", "",
+    Options::AddValueOption("-n",   "count", "max number of alignments per sorted run (0 = no limit)", "",
                             m_settings->HasMaxBufferCount,  m_settings->MaxBufferCount,
                             MemOpts, SORT_DEFAULT_MAX_BUFFER_COUNT);
-    Options::AddValueOption("-mem", "Mb", "max memory to use", "",
+    Options::AddValueOption("-mem", "size", "max memory for buffered alignments, e.g. 512M or 8G (plain numbers are Mb)", "",
                             m_settings->HasMaxBufferMemory, m_settings->MaxBufferMemory,
                             MemOpts, SORT_DEFAULT_MAX_BUFFER_MEMORY);
+    Options::AddValueOption("-fanin", "count", "max number of sorted runs merged at once (more runs are merged in several passes)", "",
+                            m_settings->HasMaxFanIn, m_settings->MaxFanIn,
+                            MemOpts, SORT_DEFAULT_MAX_FAN_IN);
+    Options::AddOption("-verbose", "report number of merge passes & bytes spilled to temp files (on stderr)",
+                       m_settings->IsVerbose, MemOpts);
+
+    OptionGroup* ThreadOpts = Options::CreateOptionGroup("Thread Settings");
+    Options::AddValueOption("-threads", "count", "number of threads for sorting & writing sorted runs", "",
+                            m_settings->HasNumThreads, m_settings->NumThreads,
+                            ThreadOpts, SORT_DEFAULT_NUM_THREADS);
 }
 
 SortTool::~SortTool(void) {
@@ -0,0 +1,400 @@
+// ***************************************************************************
+// bamtools_allele_count_engine.cpp (c) 2026
+// Marth Lab, Department of Biology, Boston College
+// ---------------------------------------------------------------------------
+// Last modified: 17 October 2026
+// ---------------------------------------------------------------------------
+// Provides per-position allele counts (a lightweight alternative to the
+// PileupEngine, when no per-read detail is needed)
+// ***************************************************************************
+
+#include "utils/bamtools_allele_count_engine.h"
+
+#include <api/BamConstants.h>
+using namespace BamTools;
+
+#include <algorithm>
+#include <iostream>
+using namespace std;
+
+// number of positions handed to visitors at once
+static const int ALLELE_COUNT_BLOCK_SIZE = 1024;
+
+// initial number of positions held in the counting window
+static const size_t ALLELE_COUNT_WINDOW_SIZE = 4096;
+
+// maps (query) base to AlleleCountBlock::AlleleType
+static const char ALLELE_COUNT_BASE_LOOKUP[256] = {
+    4,4,4,4,4,4,4,4,4,4,4,4,4,4,4,4, 4,4,4,4,4,4,4,4,4,4,4,4,4,4,4,4,
+    4,4,4,4,4,4,4,4,4,4,4,4,4,4,4,4, 4,4,4,4,4,4,4,4,4,4,4,4,4,4,4,4,
+    4,0,4,1,4,4,4,2,4,4,4,4,4,4,4,4, 4,4,4,4,3,4,4,4,4,4,4,4,4,4,4,4,
+    4,0,4,1,4,4,4,2,4,4,4,4,4,4,4,4, 4,4,4,4,3,4,4,4,4,4,4,4,4,4,4,4,
+    4,4,4,4,4,4,4,4,4,4,4,4,4,4,4,4, 4,4,4,4,4,4,4,4,4,4,4,4,4,4,4,4,
+    4,4,4,4,4,4,4,4,4,4,4,4,4,4,4,4, 4,4,4,4,4,4,4,4,4,4,4,4,4,4,4,4,
+    4,4,4,4,4,4,4,4,4,4,4,4,4,4,4,4, 4,4,4,4,4,4,4,4,4,4,4,4,4,4,4,4,
+    4,4,4,4,4,4,4,4,4,4,4,4,4,4,4,4, 4,4,4,4,4,4,4,4,4,4,4,4,4,4,4,4
+};
+
+// ---------------------------------------------
+// AlleleCountEnginePrivate implementation
+
+// N.B. - Counts are accumulated in a circular window of positions, starting at the first
+//        position not yet reported. Each added alignment scatters its bases (& insertions)
+//        directly into the window's count columns, while its depth & deletion spans are
+//        recorded in difference arrays (+1 at span start, -1 at span end). Once all
+//        alignments overlapping a position have been added (i.e. the next alignment
+//        starts beyond it), the position is final: the difference arrays are summed up
+//        & the position's columns are moved into the current block.
+
+struct AlleleCountEngine::AlleleCountEnginePrivate {
+
+    // data members
+    int CurrentId;
+    int CurrentPosition;    // last alignment start
+    int WindowBegin;        // first unreported position
+    int WindowEnd;          // end of furthest-reaching alignment so far
+    bool IsFirstAlignment;
+
+    // circular window columns (size is a power of 2)
+    size_t WindowSize;
+    vector<uint32_t> BaseCounts[AlleleCountBlock::NumAlleleTypes][AlleleCountBlock::NumStrandTypes];
+    vector<int32_t>  DepthDiffs;
+    vector<int32_t>  DeletionDiffs[AlleleCountBlock::NumStrandTypes];
+
+    // running sums over difference arrays
+    int32_t Depth;
+    int32_t Deletions[AlleleCountBlock::NumStrandTypes];
+
+    // base quality filter, indexed by FASTQ-style quality char
+    bool IsQualityPassing[256];
+
+    AlleleCountBlock CurrentBlock;
+    vector<AlleleCountVisitor*> Visitors;
+
+    // ctor & dtor
+    AlleleCountEnginePrivate(void)
+        : CurrentId(-1)
+        , CurrentPosition(-1)
+        , WindowBegin(0)
+        , WindowEnd(0)
+        , IsFirstAlignment(true)
+        , WindowSize(0)
+        , Depth(0)
+    {
+        Deletions[AlleleCountBlock::ForwardStrand] = 0;
+        Deletions[AlleleCountBlock::ReverseStrand] = 0;
+        ResizeWindow(ALLELE_COUNT_WINDOW_SIZE);
+        SetMinBaseQuality(0);
+    }
+    ~AlleleCountEnginePrivate(void) { }
+
+    // 'public' methods
+    bool AddAlignment(const BamAlignment& al);
+    void Flush(void);
+    void SetMinBaseQuality(const int quality);
+
+    // internal methods
+    private:
+        void ApplyVisitors(void);
+        void CountAlignment(const BamAlignment& al);
+        void FinishWindow(void);
+        void ReportPositions(const int end);
+        void ResizeWindow(const size_t minSize);
+};
+
+bool AlleleCountEngine::AlleleCountEnginePrivate::AddAlignment(const BamAlignment& al) {
+
+    // unmapped alignments contribute nothing
+    if ( !al.IsMapped() )
+        return true;
+
+    // if first time
+    if ( IsFirstAlignment ) {
+        CurrentId   = al.RefID;
+        WindowBegin = al.Position;
+        WindowEnd   = al.Position;
+        IsFirstAlignment = false;
+    }
+
+    // if same reference
+    else if ( al.RefID == CurrentId ) {
+
+        // if less than CurrentPosition - sorting error => ABORT
+        if ( al.Position < CurrentPosition ) {
+            cerr << "AlleleCount::Run() : Data not sorted correctly!" << endl;
+            return false;
+        }
+
+        // report all positions before this alignment
+        if ( al.Position > WindowEnd ) {
+            FinishWindow();
+            ApplyVisitors();
+            WindowBegin = al.Position;
+            WindowEnd   = al.Position;
+        }
+        else
+            ReportPositions(al.Position);
+    }
+
+    // if reference ID less than CurrentId - sorting error => ABORT
+    else if ( al.RefID < CurrentId ) {
+        cerr << "AlleleCount::Run() : Data not sorted correctly!" << endl;
+        return false;
+    }
+
+    // else moved forward onto next reference
+    else {
+        FinishWindow();
+        ApplyVisitors();
+        CurrentId   = al.RefID;
+        WindowBegin = al.Position;
+        WindowEnd   = al.Position;
+    }
+
+    CurrentPosition = al.Position;
+    CountAlignment(al);
+    return true;
+}
+
+void AlleleCountEngine::AlleleCountEnginePrivate::ApplyVisitors(void) {
+
+    // skip if block is empty
+    if ( CurrentBlock.NumPositions == 0 )
+        return;
+
+    // apply all visitors to current block
+    vector<AlleleCountVisitor*>::const_iterator visitorIter = Visitors.begin();
+    vector<AlleleCountVisitor*>::const_iterator visitorEnd  = Visitors.end();
+    for ( ; visitorIter != visitorEnd; ++visitorIter )
+        (*visitorIter)->VisitBlock(CurrentBlock);
+
+    // reset block
+    CurrentBlock.NumPositions = 0;
+    CurrentBlock.Depths.clear();
+    for ( int type = 0; type < AlleleCountBlock::NumAlleleTypes; ++type ) {
+        for ( int strand = 0; strand < AlleleCountBlock::NumStrandTypes; ++strand )
+            CurrentBlock.Counts[type][strand].clear();
+    }
+}
+
+void AlleleCountEngine::AlleleCountEnginePrivate::CountAlignment(const BamAlignment& al) {
+
+    // make sure window can hold alignment (plus its span-end entries)
+    const int alignmentEnd = al.GetEndPosition();
+    if ( (size_t)(alignmentEnd - WindowBegin) >= WindowSize )
+        ResizeWindow( (size_t)(alignmentEnd - WindowBegin) + 1 );
+    const size_t mask = WindowSize - 1;
+
+    const int strand = ( al.IsReverseStrand() ? AlleleCountBlock::ReverseStrand
+                                              : AlleleCountBlock::ForwardStrand );
+    uint32_t* baseCounts[AlleleCountBlock::NumAlleleTypes];
+    for ( int type = 0; type < AlleleCountBlock::NumAlleleTypes; ++type )
+        baseCounts[type] = &BaseCounts[type][strand][0];
+    int32_t* depthDiffs    = &DepthDiffs[0];
+    int32_t* deletionDiffs = &DeletionDiffs[strand][0];
+
+    // qualities may be missing, in which case all bases are counted
+    const string& bases = al.QueryBases;
+    const string& qualities = al.Qualities;
+    const bool hasBases = ( !bases.empty() && bases != "*" );
+    const bool hasQualities = ( qualities.size() == bases.size() );
+
+    // iterate over CIGAR operations
+    int genomePosition = al.Position;
+    int readPosition   = 0;
+    vector<CigarOp>::const_iterator cigarIter = al.CigarData.begin();
+    vector<CigarOp>::const_iterator cigarEnd  = al.CigarData.end();
+    for ( ; cigarIter != cigarEnd; ++cigarIter ) {
+        const CigarOp& op = (*cigarIter);
+        const int length = (int)op.Length;
+
+        switch ( op.Type ) {
+
+            // MATCH ops - scatter bases into window, extend depth span
+            case ( Constants::BAM_CIGAR_MATCH_CHAR )    :
+            case ( Constants::BAM_CIGAR_MISMATCH_CHAR ) :
+            case ( Constants::BAM_CIGAR_SEQMATCH_CHAR ) :
+                ++depthDiffs[ genomePosition & mask ];
+                --depthDiffs[ (genomePosition + length) & mask ];
+                if ( hasBases && readPosition + length <= (int)bases.size() ) {
+                    const unsigned char* b = (const unsigned char*)bases.data() + readPosition;
+                    if ( hasQualities ) {
+                        const unsigned char* q = (const unsigned char*)qualities.data() + readPosition;
+                        for ( int i = 0; i < length; ++i ) {
+                            if ( IsQualityPassing[q[i]] )
+                                ++baseCounts[ (int)ALLELE_COUNT_BASE_LOOKUP[b[i]] ][ (genomePosition + i) & mask ];
+                        }
+                    } else {
+                        for ( int i = 0; i < length; ++i )
+                            ++baseCounts[ (int)ALLELE_COUNT_BASE_LOOKUP[b[i]] ][ (genomePosition + i) & mask ];
+                    }
+                } else {
+                    for ( int i = 0; i < length; ++i )
+                        ++baseCounts[AlleleCountBlock::AlleleN][ (genomePosition + i) & mask ];
+                }
+                genomePosition += length;
+                readPosition   += length;
+                break;
+
+            // DELETION - extend depth & deletion spans
+            case ( Constants::BAM_CIGAR_DEL_CHAR ) :
+                ++depthDiffs[ genomePosition & mask ];
+                --depthDiffs[ (genomePosition + length) & mask ];
+                ++deletionDiffs[ genomePosition & mask ];
+                --deletionDiffs[ (genomePosition + length) & mask ];
+                genomePosition += length;
+                break;
+
+            // REF_SKIP - no coverage
+            case ( Constants::BAM_CIGAR_REFSKIP_CHAR ) :
+                genomePosition += length;
+                break;
+
+            // INSERTION - count at preceding base, if not yet reported
+            case ( Constants::BAM_CIGAR_INS_CHAR ) :
+                if ( genomePosition > WindowBegin )
+                    ++baseCounts[AlleleCountBlock::AlleleInsertion][ (genomePosition - 1) & mask ];
+                readPosition += length;
+                break;
+
+            case ( Constants::BAM_CIGAR_SOFTCLIP_CHAR ) :
+                readPosition += length;
+                break;
+
+            // all other CIGAR chars do not consume reference or read
+            default :
+                break;
+        }
+    }
+
+    // update window end
+    if ( alignmentEnd > WindowEnd )
+        WindowEnd = alignmentEnd;
+}
+
+// reports all remaining positions & resets span sums for a new window
+void AlleleCountEngine::AlleleCountEnginePrivate::FinishWindow(void) {
+
+    ReportPositions(WindowEnd);
+
+    // all spans end at (or before) WindowEnd, so its only entries are span-end markers
+    const size_t index = (size_t)WindowEnd & (WindowSize - 1);
+    DepthDiffs[index] = 0;
+    for ( int strand = 0; strand < AlleleCountBlock::NumStrandTypes; ++strand ) {
+        DeletionDiffs[strand][index] = 0;
+        Deletions[strand] = 0;
+    }
+    Depth = 0;
+}
+
+void AlleleCountEngine::AlleleCountEnginePrivate::Flush(void) {
+    if ( IsFirstAlignment )
+        return;
+    FinishWindow();
+    ApplyVisitors();
+}
+
+// moves positions [WindowBegin, end) from window to current block
+void AlleleCountEngine::AlleleCountEnginePrivate::ReportPositions(const int end) {
+
+    const size_t mask = WindowSize - 1;
+    while ( WindowBegin < end ) {
+
+        // start new block at window start, if necessary
+        AlleleCountBlock& block = CurrentBlock;
+        if ( block.NumPositions == 0 ) {
+            block.RefId    = CurrentId;
+            block.Position = WindowBegin;
+        }
+
+        // move positions, up to block capacity
+        const int numPositions = std::min(end - WindowBegin, ALLELE_COUNT_BLOCK_SIZE - block.NumPositions);
+        for ( int i = 0; i < numPositions; ++i ) {
+            const size_t index = (size_t)(WindowBegin + i) & mask;
+
+            Depth += DepthDiffs[index];
+            DepthDiffs[index] = 0;
+            block.Depths.push_back( (uint32_t)Depth );
+
+            for ( int strand = 0; strand < AlleleCountBlock::NumStrandTypes; ++strand ) {
+                Deletions[strand] += DeletionDiffs[strand][index];
+                DeletionDiffs[strand][index] = 0;
+
+                for ( int type = 0; type < AlleleCountBlock::NumAlleleTypes; ++type ) {
+                    if ( type == AlleleCountBlock::AlleleDeletion )
+                        block.Counts[type][strand].push_back( (uint32_t)Deletions[strand] );
+                    else {
+                        block.Counts[type][strand].push_back( BaseCounts[type][strand][index] );
+                        BaseCounts[type][strand][index] = 0;
+                    }
+                }
+            }
+        }
+        block.NumPositions += numPositions;
+        WindowBegin += numPositions;
+
+        // hand over block, if full
+        if ( block.NumPositions == ALLELE_COUNT_BLOCK_SIZE )
+            ApplyVisitors();
+    }
+}
+
+// grows window to (at least) minSize positions, keeping current content
+void AlleleCountEngine::AlleleCountEnginePrivate::ResizeWindow(const size_t minSize) {
+
+    size_t newSize = ( WindowSize == 0 ? 1 : WindowSize );
+    while ( newSize < minSize )
+        newSize *= 2;
+    if ( newSize == WindowSize )
+        return;
+
+    // re-map window positions [WindowBegin, WindowEnd] to new size
+    const size_t oldMask = WindowSize - 1;
+    const size_t newMask = newSize - 1;
+    const int end = ( WindowSize == 0 ? WindowBegin - 1 : WindowEnd );
+
+    vector<int32_t> depthDiffs(newSize, 0);
+    for ( int p = WindowBegin; p <= end; ++p )
+        depthDiffs[p & newMask] = DepthDiffs[p & oldMask];
+    DepthDiffs.swap(depthDiffs);
+
+    for ( int strand = 0; strand < AlleleCountBlock::NumStrandTypes; ++strand ) {
+        vector<int32_t> deletionDiffs(newSize, 0);
+        for ( int p = WindowBegin; p <= end; ++p )
+            deletionDiffs[p & newMask] = DeletionDiffs[strand][p & oldMask];
+        DeletionDiffs[strand].swap(deletionDiffs);
+
+        for ( int type = 0; type < AlleleCountBlock::NumAlleleTypes; ++type ) {
+            vector<uint32_t> counts(newSize, 0);
+            for ( int p = WindowBegin; p <= end; ++p )
+                counts[p & newMask] = BaseCounts[type][strand][p & oldMask];
+            BaseCounts[type][strand].swap(counts);
+        }
+    }
+
+    WindowSize = newSize;
+}
+
+void AlleleCountEngine::AlleleCountEnginePrivate::SetMinBaseQuality(const int quality) {
+    for ( int c = 0; c < 256; ++c )
+        IsQualityPassing[c] = ( c - 33 >= quality );
+    // unstored qualities are never filtered
+    IsQualityPassing[0xff] = true;
+}
+
+// ---------------------------------------------
+// AlleleCountEngine implementation
+
+AlleleCountEngine::AlleleCountEngine(void)
+    : d( new AlleleCountEnginePrivate )
+{ }
+
+AlleleCountEngine::~AlleleCountEngine(void) {
+    delete d;
+    d = 0;
+}
+
+bool AlleleCountEngine::AddAlignment(const BamAlignment& al) { return d->AddAlignment(al); }
+void AlleleCountEngine::AddVisitor(AlleleCountVisitor* visitor) { d->Visitors.push_back(visitor); }
+void AlleleCountEngine::Flush(void) { d->Flush(); }
+void AlleleCountEngine::SetMinBaseQuality(const int quality) { d->SetMinBaseQuality(quality); }
@@ -0,0 +1,91 @@
+// ***************************************************************************
+// bamtools_allele_count_engine.h (c) 2026
+// Marth Lab, Department of Biology, Boston College
+// ---------------------------------------------------------------------------
+// Last modified: 17 October 2026
+// ---------------------------------------------------------------------------
+// Provides per-position allele counts (a lightweight alternative to the
+// PileupEngine, when no per-read detail is needed)
+// ***************************************************************************
+
+#ifndef BAMTOOLS_ALLELE_COUNT_ENGINE_H
+#define BAMTOOLS_ALLELE_COUNT_ENGINE_H
+
+#include "utils/utils_global.h"
+
+#include <api/BamAlignment.h>
+#include <vector>
+
+namespace BamTools {
+
+// contains allele counts for a run of consecutive positions on one reference, stored column-wise
+//
+// N.B. - position i (0 <= i < NumPositions) is (Position + i)
+//      - Depths count all alignments covering a position with a match or deletion,
+//        regardless of base quality
+//      - bases below the engine's minimum base quality are not counted at all
+//      - insertions are counted at the base preceding them
+struct UTILS_EXPORT AlleleCountBlock {
+
+    enum AlleleType { AlleleA = 0
+                    , AlleleC
+                    , AlleleG
+                    , AlleleT
+                    , AlleleN
+                    , AlleleDeletion
+                    , AlleleInsertion
+                    , NumAlleleTypes
+                    };
+
+    enum StrandType { ForwardStrand = 0
+                    , ReverseStrand
+                    , NumStrandTypes
+                    };
+
+    // data members
+    int RefId;
+    int Position;
+    int NumPositions;
+    std::vector<uint32_t> Depths;
+    std::vector<uint32_t> Counts[NumAlleleTypes][NumStrandTypes];
+
+    // ctor
+    AlleleCountBlock(void)
+        : RefId(0)
+        , Position(0)
+        , NumPositions(0)
+    { }
+};
+
+class UTILS_EXPORT AlleleCountVisitor {
+
+    public:
+        AlleleCountVisitor(void) { }
+        virtual ~AlleleCountVisitor(void) { }
+
+    public:
+        virtual void VisitBlock(const AlleleCountBlock& block) =0;
+};
+
+// N.B. - alignments must be added in position-sorted order, with char data (bases & qualities)
+//      - only positions spanned by at least one alignment are reported
+class UTILS_EXPORT AlleleCountEngine {
+
+    public:
+        AlleleCountEngine(void);
+        ~AlleleCountEngine(void);
+
+    public:
+        bool AddAlignment(const BamAlignment& al);
+        void AddVisitor(AlleleCountVisitor* visitor);
+        void Flush(void);
+        void SetMinBaseQuality(const int quality);
+
+    private:
+        struct AlleleCountEnginePrivate;
+        AlleleCountEnginePrivate* d;
+};
+
+} // namespace BamTools
+
+#endif // BAMTOOLS_ALLELE_COUNT_ENGINE_H
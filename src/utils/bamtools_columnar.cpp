@@ -0,0 +1,902 @@
+// ***************************************************************************
+// bamtools_columnar.cpp (c) 2026
+// Marth Lab, Department of Biology, Boston College
+// ---------------------------------------------------------------------------
+// Last modified: 17 October 2026
+// ---------------------------------------------------------------------------
+// Provides writing & reading of alignments in BamTools' columnar format
+// ***************************************************************************
+
+#include <api/BamConstants.h>
+#include "utils/bamtools_columnar.h"
+#include "utils/bamtools_options.h"
+#include "utils/bamtools_thread.h"
+using namespace BamTools;
+
+#include "zlib.h"
+
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+using namespace std;
+
+// file magic & format version
+static const char COLUMNAR_MAGIC[4] = { 'B', 'T', 'C', 'F' };
+static const uint32_t COLUMNAR_VERSION = 1;
+
+// default number of rows per row group
+static const unsigned int COLUMNAR_DEFAULT_ROW_GROUP_SIZE = 65536;
+
+// row group is also written once its buffered data reaches this size
+// (keeps column lengths well within uint32, even for very long reads)
+static const size_t COLUMNAR_MAX_ROW_GROUP_BYTES = 256 * 1024 * 1024;
+
+// column encodings
+static const uint8_t COLUMNAR_ENCODING_PLAIN = 0;
+static const uint8_t COLUMNAR_ENCODING_DELTA = 1;
+
+// column compression
+static const uint8_t COLUMNAR_COMPRESSION_NONE = 0;
+static const uint8_t COLUMNAR_COMPRESSION_ZLIB = 1;
+
+// default zlib level - columns compress well even at fastest setting
+static const int COLUMNAR_DEFAULT_COMPRESSION_LEVEL = Z_BEST_SPEED;
+
+// core columns, in file order (followed by any tag columns)
+enum ColumnarCoreColumn { COLUMN_NAME = 0
+                        , COLUMN_FLAG
+                        , COLUMN_REF_ID
+                        , COLUMN_POSITION
+                        , COLUMN_MAP_QUALITY
+                        , COLUMN_CIGAR
+                        , COLUMN_MATE_REF_ID
+                        , COLUMN_MATE_POSITION
+                        , COLUMN_INSERT_SIZE
+                        , COLUMN_SEQUENCE
+                        , COLUMN_QUALITIES
+                        , NUM_CORE_COLUMNS
+                        };
+
+// value width of core columns (0 = variable-length)
+static const size_t COLUMN_WIDTHS[NUM_CORE_COLUMNS] = { 0, 2, 4, 4, 1, 0, 4, 4, 4, 0, 0 };
+
+// ---------------------------------------------
+// little-endian packing
+
+static inline
+void AppendUInt8(string& buffer, const uint8_t value) {
+    buffer += (char)value;
+}
+
+static inline
+void AppendUInt16(string& buffer, const uint16_t value) {
+    const char bytes[2] = { (char)(value & 0xff), (char)(value >> 8) };
+    buffer.append(bytes, 2);
+}
+
+static inline
+void AppendUInt32(string& buffer, const uint32_t value) {
+    const char bytes[4] = { (char)(value & 0xff),
+                            (char)((value >> 8)  & 0xff),
+                            (char)((value >> 16) & 0xff),
+                            (char)((value >> 24) & 0xff) };
+    buffer.append(bytes, 4);
+}
+
+static inline
+void AppendUInt64(string& buffer, const uint64_t value) {
+    AppendUInt32(buffer, (uint32_t)(value & 0xffffffff));
+    AppendUInt32(buffer, (uint32_t)(value >> 32));
+}
+
+static inline
+uint16_t UnpackUInt16(const char* data) {
+    const unsigned char* bytes = (const unsigned char*)data;
+    return (uint16_t)( bytes[0] | (bytes[1] << 8) );
+}
+
+static inline
+uint32_t UnpackUInt32(const char* data) {
+    const unsigned char* bytes = (const unsigned char*)data;
+    return ( (uint32_t)bytes[0]         |
+             ((uint32_t)bytes[1] << 8)  |
+             ((uint32_t)bytes[2] << 16) |
+             ((uint32_t)bytes[3] << 24) );
+}
+
+// ---------------------------------------------
+// tag data lookup
+
+// returns size of a (single) tag value of type, or 0 if not a fixed-size type
+static size_t TagValueSize(const char type) {
+    switch ( type ) {
+        case ( Constants::BAM_TAG_TYPE_ASCII )  :
+        case ( Constants::BAM_TAG_TYPE_INT8 )   :
+        case ( Constants::BAM_TAG_TYPE_UINT8 )  : return 1;
+        case ( Constants::BAM_TAG_TYPE_INT16 )  :
+        case ( Constants::BAM_TAG_TYPE_UINT16 ) : return 2;
+        case ( Constants::BAM_TAG_TYPE_INT32 )  :
+        case ( Constants::BAM_TAG_TYPE_UINT32 ) :
+        case ( Constants::BAM_TAG_TYPE_FLOAT )  : return 4;
+        default : return 0;
+    }
+}
+
+// finds tag in BAM tag data, returning start & length of its type character & value
+static bool FindTagValue(const string& tagData, const string& tag, size_t& start, size_t& length) {
+
+    const size_t dataLength = tagData.size();
+    size_t pos = 0;
+    while ( pos + 3 <= dataLength ) {
+
+        // determine value length
+        const char type = tagData[pos+2];
+        size_t valueLength = TagValueSize(type);
+        if ( type == Constants::BAM_TAG_TYPE_STRING || type == Constants::BAM_TAG_TYPE_HEX ) {
+            const size_t end = tagData.find('\0', pos+3);
+            if ( end == string::npos )
+                return false;
+            valueLength = end - (pos+3) + 1;
+        }
+        else if ( type == Constants::BAM_TAG_TYPE_ARRAY ) {
+            if ( pos + 8 > dataLength )
+                return false;
+            int32_t numElements = 0;
+            memcpy(&numElements, &tagData[pos+4], sizeof(int32_t));
+            const size_t elementSize = TagValueSize(tagData[pos+3]);
+            if ( elementSize == 0 || numElements < 0 )
+                return false;
+            valueLength = 1 + sizeof(int32_t) + numElements*elementSize;
+        }
+        if ( valueLength == 0 || pos + 3 + valueLength > dataLength )
+            return false;
+
+        // return value if tag matches, else skip to next tag
+        if ( tagData[pos] == tag[0] && tagData[pos+1] == tag[1] ) {
+            start  = pos + 2;
+            length = 1 + valueLength;
+            return true;
+        }
+        pos += 3 + valueLength;
+    }
+    return false;
+}
+
+// ---------------------------------------------
+// ColumnarWriterPrivate implementation
+
+struct ColumnarWriter::ColumnarWriterPrivate {
+
+    // buffered column data, for current row group
+    struct Column {
+
+        // data members
+        uint8_t Encoding;
+        string Lengths;         // variable-length columns only
+        string Data;
+
+        // set by CompressColumn()
+        uint8_t Compression;
+        uint32_t EncodedLength;
+        string Stored;
+
+        // ctor
+        Column(void)
+            : Encoding(COLUMNAR_ENCODING_PLAIN)
+            , Compression(COLUMNAR_COMPRESSION_NONE)
+            , EncodedLength(0)
+        { }
+    };
+
+    // compresses one column of a row group
+    class CompressTask : public ThreadPool::Task {
+
+        public:
+            CompressTask(Column* column, const int compressionLevel)
+                : m_column(column)
+                , m_compressionLevel(compressionLevel)
+            { }
+
+        public:
+            void Run(void) {
+                CompressColumn(*m_column, m_compressionLevel);
+            }
+
+        private:
+            Column* m_column;
+            int m_compressionLevel;
+    };
+
+    // data members
+    FILE* Stream;
+    uint64_t Offset;
+    string ErrorString;
+    ThreadPool* Pool;
+
+    // settings
+    int CompressionLevel;
+    unsigned int NumThreads;
+    unsigned int RowGroupSize;
+    vector<string> Tags;
+
+    // current row group
+    vector<Column> Columns;
+    uint32_t NumRows;
+    int32_t LastPosition;
+
+    // written row groups (file offset, number of rows)
+    vector< pair<uint64_t, uint32_t> > RowGroups;
+    uint64_t TotalRows;
+
+    // ctor & dtor
+    ColumnarWriterPrivate(void)
+        : Stream(0)
+        , Offset(0)
+        , Pool(0)
+        , CompressionLevel(COLUMNAR_DEFAULT_COMPRESSION_LEVEL)
+        , NumThreads(1)
+        , RowGroupSize(COLUMNAR_DEFAULT_ROW_GROUP_SIZE)
+        , NumRows(0)
+        , LastPosition(0)
+        , TotalRows(0)
+    { }
+    ~ColumnarWriterPrivate(void) {
+        Close();
+    }
+
+    // ColumnarWriterPrivate interface
+    bool Close(void);
+    bool Open(const string& filename, const string& samHeaderText, const RefVector& references);
+    bool Write(const BamAlignment& al);
+
+    // internal methods
+    static void AppendVariable(Column& column, const char* data, const size_t length);
+    size_t BufferedBytes(void) const;
+    static void CompressColumn(Column& column, const int compressionLevel);
+    bool WriteData(const string& data);
+    bool WriteRowGroup(void);
+};
+
+// appends value to variable-length column
+void ColumnarWriter::ColumnarWriterPrivate::AppendVariable(Column& column,
+                                                           const char* data,
+                                                           const size_t length)
+{
+    AppendUInt32(column.Lengths, (uint32_t)length);
+    column.Data.append(data, length);
+}
+
+size_t ColumnarWriter::ColumnarWriterPrivate::BufferedBytes(void) const {
+    size_t numBytes = 0;
+    vector<Column>::const_iterator colIter = Columns.begin();
+    vector<Column>::const_iterator colEnd  = Columns.end();
+    for ( ; colIter != colEnd; ++colIter )
+        numBytes += colIter->Lengths.size() + colIter->Data.size();
+    return numBytes;
+}
+
+bool ColumnarWriter::ColumnarWriterPrivate::Close(void) {
+
+    // skip if not open
+    if ( Stream == 0 )
+        return true;
+
+    // write remaining rows & footer
+    bool result = WriteRowGroup();
+    if ( result ) {
+        const uint64_t footerOffset = Offset;
+        string footer;
+        AppendUInt32(footer, 0);
+        AppendUInt32(footer, (uint32_t)RowGroups.size());
+        for ( size_t i = 0; i < RowGroups.size(); ++i ) {
+            AppendUInt64(footer, RowGroups[i].first);
+            AppendUInt32(footer, RowGroups[i].second);
+        }
+        AppendUInt64(footer, TotalRows);
+        AppendUInt64(footer, footerOffset);
+        footer.append(COLUMNAR_MAGIC, sizeof(COLUMNAR_MAGIC));
+        result = WriteData(footer);
+    }
+
+    // close file
+    if ( Stream == stdout ) {
+        if ( fflush(Stream) != 0 && result ) {
+            ErrorString = "ColumnarWriter::Close: could not write to stdout";
+            result = false;
+        }
+    }
+    else if ( fclose(Stream) != 0 && result ) {
+        ErrorString = "ColumnarWriter::Close: could not close file";
+        result = false;
+    }
+    Stream = 0;
+
+    // reset state
+    delete Pool;
+    Pool = 0;
+    Columns.clear();
+    RowGroups.clear();
+    NumRows = 0;
+    TotalRows = 0;
+    return result;
+}
+
+// compresses column's encoded data, unless that would not make it any smaller
+void ColumnarWriter::ColumnarWriterPrivate::CompressColumn(Column& column, const int compressionLevel) {
+
+    const string encoded = column.Lengths + column.Data;
+    column.EncodedLength = (uint32_t)encoded.size();
+
+    if ( compressionLevel != 0 && !encoded.empty() ) {
+        uLongf storedLength = compressBound(encoded.size());
+        column.Stored.resize(storedLength);
+        const int status = compress2( (Bytef*)&column.Stored[0], &storedLength,
+                                      (const Bytef*)encoded.data(), encoded.size(),
+                                      compressionLevel );
+        if ( status == Z_OK && storedLength < encoded.size() ) {
+            column.Stored.resize(storedLength);
+            column.Compression = COLUMNAR_COMPRESSION_ZLIB;
+            return;
+        }
+    }
+
+    column.Stored = encoded;
+    column.Compression = COLUMNAR_COMPRESSION_NONE;
+}
+
+bool ColumnarWriter::ColumnarWriterPrivate::Open(const string& filename,
+                                                 const string& samHeaderText,
+                                                 const RefVector& references)
+{
+    // close any previous file
+    Close();
+
+    // validate tags
+    for ( size_t i = 0; i < Tags.size(); ++i ) {
+        if ( Tags[i].size() != 2 ) {
+            ErrorString = "ColumnarWriter::Open: invalid tag name: " + Tags[i];
+            return false;
+        }
+    }
+
+    // open file
+    if ( filename == Options::StandardOut() )
+        Stream = stdout;
+    else
+        Stream = fopen(filename.c_str(), "wb");
+    if ( Stream == 0 ) {
+        ErrorString = "ColumnarWriter::Open: could not open " + filename + " for writing";
+        return false;
+    }
+
+    // set up columns
+    Columns.assign(NUM_CORE_COLUMNS + Tags.size(), Column());
+    Columns[COLUMN_POSITION].Encoding = COLUMNAR_ENCODING_DELTA;
+    NumRows = 0;
+    LastPosition = 0;
+    Offset = 0;
+    RowGroups.clear();
+    TotalRows = 0;
+    Pool = new ThreadPool(NumThreads);
+
+    // write file header
+    string header(COLUMNAR_MAGIC, sizeof(COLUMNAR_MAGIC));
+    AppendUInt32(header, COLUMNAR_VERSION);
+    AppendUInt32(header, (uint32_t)samHeaderText.size());
+    header.append(samHeaderText);
+    AppendUInt32(header, (uint32_t)references.size());
+    RefVector::const_iterator refIter = references.begin();
+    RefVector::const_iterator refEnd  = references.end();
+    for ( ; refIter != refEnd; ++refIter ) {
+        AppendUInt32(header, (uint32_t)refIter->RefName.size());
+        header.append(refIter->RefName);
+        AppendUInt32(header, (uint32_t)refIter->RefLength);
+    }
+    AppendUInt32(header, (uint32_t)Tags.size());
+    for ( size_t i = 0; i < Tags.size(); ++i )
+        header.append(Tags[i]);
+    return WriteData(header);
+}
+
+bool ColumnarWriter::ColumnarWriterPrivate::Write(const BamAlignment& al) {
+
+    if ( Stream == 0 ) {
+        ErrorString = "ColumnarWriter::Write: file not open for writing";
+        return false;
+    }
+
+    // core fields
+    AppendVariable(Columns[COLUMN_NAME], al.Name.data(), al.Name.size());
+    AppendUInt16(Columns[COLUMN_FLAG].Data, (uint16_t)al.AlignmentFlag);
+    AppendUInt32(Columns[COLUMN_REF_ID].Data, (uint32_t)al.RefID);
+    AppendUInt32(Columns[COLUMN_POSITION].Data, (uint32_t)al.Position - (uint32_t)LastPosition);
+    AppendUInt8(Columns[COLUMN_MAP_QUALITY].Data, (uint8_t)al.MapQuality);
+    AppendUInt32(Columns[COLUMN_MATE_REF_ID].Data, (uint32_t)al.MateRefID);
+    AppendUInt32(Columns[COLUMN_MATE_POSITION].Data, (uint32_t)al.MatePosition);
+    AppendUInt32(Columns[COLUMN_INSERT_SIZE].Data, (uint32_t)al.InsertSize);
+    AppendVariable(Columns[COLUMN_SEQUENCE], al.QueryBases.data(), al.QueryBases.size());
+    AppendVariable(Columns[COLUMN_QUALITIES], al.Qualities.data(), al.Qualities.size());
+    LastPosition = al.Position;
+
+    // CIGAR, packed as in BAM
+    Column& cigar = Columns[COLUMN_CIGAR];
+    AppendUInt32(cigar.Lengths, (uint32_t)(al.CigarData.size() * sizeof(uint32_t)));
+    vector<CigarOp>::const_iterator cigarIter = al.CigarData.begin();
+    vector<CigarOp>::const_iterator cigarEnd  = al.CigarData.end();
+    for ( ; cigarIter != cigarEnd; ++cigarIter ) {
+        const char* op = strchr(Constants::BAM_CIGAR_LOOKUP, cigarIter->Type);
+        if ( op == 0 || cigarIter->Type == '\0' ) {
+            ErrorString = "ColumnarWriter::Write: invalid CIGAR operation in alignment: " + al.Name;
+            return false;
+        }
+        AppendUInt32(cigar.Data, (cigarIter->Length << 4) | (uint32_t)(op - Constants::BAM_CIGAR_LOOKUP));
+    }
+
+    // selected tags (empty value if not present)
+    for ( size_t i = 0; i < Tags.size(); ++i ) {
+        Column& column = Columns[NUM_CORE_COLUMNS + i];
+        size_t start = 0;
+        size_t length = 0;
+        if ( FindTagValue(al.TagData, Tags[i], start, length) )
+            AppendVariable(column, al.TagData.data() + start, length);
+        else
+            AppendVariable(column, 0, 0);
+    }
+
+    // write row group if full
+    ++NumRows;
+    if ( NumRows >= RowGroupSize || BufferedBytes() >= COLUMNAR_MAX_ROW_GROUP_BYTES )
+        return WriteRowGroup();
+    return true;
+}
+
+bool ColumnarWriter::ColumnarWriterPrivate::WriteData(const string& data) {
+    if ( fwrite(data.data(), 1, data.size(), Stream) != data.size() ) {
+        ErrorString = "ColumnarWriter::WriteData: could not write to file";
+        return false;
+    }
+    Offset += data.size();
+    return true;
+}
+
+// compresses & writes buffered rows
+bool ColumnarWriter::ColumnarWriterPrivate::WriteRowGroup(void) {
+
+    if ( NumRows == 0 )
+        return true;
+
+    // compress columns (concurrently, if multiple threads)
+    vector<CompressTask> tasks;
+    tasks.reserve(Columns.size());
+    for ( size_t i = 0; i < Columns.size(); ++i )
+        tasks.push_back( CompressTask(&Columns[i], CompressionLevel) );
+    for ( size_t i = 0; i < tasks.size(); ++i )
+        Pool->Submit(&tasks[i]);
+    Pool->WaitForAll();
+
+    // write row group
+    RowGroups.push_back( make_pair(Offset, NumRows) );
+    string buffer;
+    AppendUInt32(buffer, NumRows);
+    for ( size_t i = 0; i < Columns.size(); ++i ) {
+        const Column& column = Columns[i];
+        AppendUInt8(buffer, column.Encoding);
+        AppendUInt8(buffer, column.Compression);
+        AppendUInt32(buffer, column.EncodedLength);
+        AppendUInt32(buffer, (uint32_t)column.Stored.size());
+        if ( !WriteData(buffer) || !WriteData(column.Stored) )
+            return false;
+        buffer.clear();
+    }
+
+    // reset for next row group
+    for ( size_t i = 0; i < Columns.size(); ++i ) {
+        Columns[i].Lengths.clear();
+        Columns[i].Data.clear();
+        Columns[i].Stored.clear();
+    }
+    TotalRows += NumRows;
+    NumRows = 0;
+    LastPosition = 0;
+    return true;
+}
+
+// ---------------------------------------------
+// ColumnarWriter implementation
+
+ColumnarWriter::ColumnarWriter(void)
+    : d( new ColumnarWriterPrivate )
+{ }
+
+ColumnarWriter::~ColumnarWriter(void) {
+    delete d;
+    d = 0;
+}
+
+bool ColumnarWriter::Close(void) {
+    return d->Close();
+}
+
+string ColumnarWriter::GetErrorString(void) const {
+    return d->ErrorString;
+}
+
+bool ColumnarWriter::Open(const string& filename,
+                          const string& samHeaderText,
+                          const RefVector& references)
+{
+    return d->Open(filename, samHeaderText, references);
+}
+
+// level as used by zlib (0 = no compression, 9 = best compression)
+void ColumnarWriter::SetCompressionLevel(const int level) {
+    d->CompressionLevel = level;
+}
+
+// columns of each row group are compressed concurrently
+void ColumnarWriter::SetNumThreads(const unsigned int numThreads) {
+    d->NumThreads = ( numThreads > 1 ? numThreads : 1 );
+}
+
+void ColumnarWriter::SetRowGroupSize(const unsigned int numRows) {
+    d->RowGroupSize = ( numRows > 0 ? numRows : 1 );
+}
+
+// N.B. - tag names must be 2 characters each
+void ColumnarWriter::SetTags(const vector<string>& tags) {
+    d->Tags = tags;
+}
+
+bool ColumnarWriter::Write(const BamAlignment& al) {
+    return d->Write(al);
+}
+
+// ---------------------------------------------
+// ColumnarReaderPrivate implementation
+
+// N.B. - row groups are read sequentially (footer is not needed), so input may be stdin
+struct ColumnarReader::ColumnarReaderPrivate {
+
+    // decoded column data, for current row group
+    struct Column {
+
+        // data members
+        uint8_t Encoding;
+        string Data;
+        size_t ValueOffset;     // variable-length columns only: start of next value
+
+        // ctor
+        Column(void)
+            : Encoding(COLUMNAR_ENCODING_PLAIN)
+            , ValueOffset(0)
+        { }
+    };
+
+    // data members
+    FILE* Stream;
+    string Filename;
+    string ErrorString;
+    string HeaderText;
+    RefVector References;
+    vector<string> Tags;
+
+    // current row group
+    vector<Column> Columns;
+    uint32_t NumRows;
+    uint32_t CurrentRow;
+    int32_t LastPosition;
+
+    // ctor & dtor
+    ColumnarReaderPrivate(void)
+        : Stream(0)
+        , NumRows(0)
+        , CurrentRow(0)
+        , LastPosition(0)
+    { }
+    ~ColumnarReaderPrivate(void) {
+        Close();
+    }
+
+    // ColumnarReaderPrivate interface
+    void Close(void);
+    bool GetNextAlignment(BamAlignment& al);
+    bool Open(const string& filename);
+
+    // internal methods
+    const char* FixedValue(const size_t column, const size_t width) const;
+    bool ReadData(string& data, const size_t length);
+    bool ReadRowGroup(void);
+    bool ReadUInt32(uint32_t& value);
+    void VariableValue(const size_t column, const char*& data, uint32_t& length);
+};
+
+void ColumnarReader::ColumnarReaderPrivate::Close(void) {
+
+    if ( Stream != 0 && Stream != stdin )
+        fclose(Stream);
+    Stream = 0;
+
+    Filename.clear();
+    HeaderText.clear();
+    References.clear();
+    Tags.clear();
+    Columns.clear();
+    NumRows = 0;
+    CurrentRow = 0;
+}
+
+const char* ColumnarReader::ColumnarReaderPrivate::FixedValue(const size_t column, const size_t width) const {
+    return Columns[column].Data.data() + CurrentRow*width;
+}
+
+bool ColumnarReader::ColumnarReaderPrivate::GetNextAlignment(BamAlignment& al) {
+
+    if ( Stream == 0 ) {
+        ErrorString = "ColumnarReader::GetNextAlignment: file not open for reading";
+        return false;
+    }
+
+    // load next row group if needed
+    if ( CurrentRow == NumRows ) {
+        if ( !ReadRowGroup() )
+            return false;
+    }
+
+    const char* data = 0;
+    uint32_t length = 0;
+
+    // core fields
+    VariableValue(COLUMN_NAME, data, length);
+    al.Name.assign(data, length);
+    al.AlignmentFlag = UnpackUInt16( FixedValue(COLUMN_FLAG, 2) );
+    al.RefID         = (int32_t)UnpackUInt32( FixedValue(COLUMN_REF_ID, 4) );
+    const uint32_t position = UnpackUInt32( FixedValue(COLUMN_POSITION, 4) );
+    if ( Columns[COLUMN_POSITION].Encoding == COLUMNAR_ENCODING_DELTA )
+        LastPosition = (int32_t)((uint32_t)LastPosition + position);
+    else
+        LastPosition = (int32_t)position;
+    al.Position      = LastPosition;
+    al.MapQuality    = (uint8_t)*FixedValue(COLUMN_MAP_QUALITY, 1);
+    al.MateRefID     = (int32_t)UnpackUInt32( FixedValue(COLUMN_MATE_REF_ID, 4) );
+    al.MatePosition  = (int32_t)UnpackUInt32( FixedValue(COLUMN_MATE_POSITION, 4) );
+    al.InsertSize    = (int32_t)UnpackUInt32( FixedValue(COLUMN_INSERT_SIZE, 4) );
+    VariableValue(COLUMN_SEQUENCE, data, length);
+    al.QueryBases.assign(data, length);
+    al.Length = (int32_t)al.QueryBases.size();
+    VariableValue(COLUMN_QUALITIES, data, length);
+    al.Qualities.assign(data, length);
+    al.AlignedBases.clear();
+    al.Bin = 0;
+    al.Filename = Filename;
+
+    // CIGAR
+    VariableValue(COLUMN_CIGAR, data, length);
+    al.CigarData.clear();
+    const size_t numCigarOps = length / sizeof(uint32_t);
+    const size_t numLookupOps = strlen(Constants::BAM_CIGAR_LOOKUP);
+    for ( size_t i = 0; i < numCigarOps; ++i ) {
+        const uint32_t op = UnpackUInt32(data + i*sizeof(uint32_t));
+        if ( (op & 0xf) >= numLookupOps ) {
+            ErrorString = "ColumnarReader::GetNextAlignment: invalid CIGAR operation in alignment: " + al.Name;
+            return false;
+        }
+        al.CigarData.push_back( CigarOp(Constants::BAM_CIGAR_LOOKUP[op & 0xf], op >> 4) );
+    }
+
+    // selected tags
+    al.TagData.clear();
+    for ( size_t i = 0; i < Tags.size(); ++i ) {
+        VariableValue(NUM_CORE_COLUMNS + i, data, length);
+        if ( length > 0 ) {
+            al.TagData.append(Tags[i]);
+            al.TagData.append(data, length);
+        }
+    }
+
+    ++CurrentRow;
+    return true;
+}
+
+bool ColumnarReader::ColumnarReaderPrivate::Open(const string& filename) {
+
+    // close any previous file
+    Close();
+
+    // open file
+    if ( filename == Options::StandardIn() )
+        Stream = stdin;
+    else
+        Stream = fopen(filename.c_str(), "rb");
+    if ( Stream == 0 ) {
+        ErrorString = "ColumnarReader::Open: could not open " + filename + " for reading";
+        return false;
+    }
+    Filename = filename;
+
+    // check magic & version
+    string magic;
+    uint32_t version = 0;
+    if ( !ReadData(magic, sizeof(COLUMNAR_MAGIC)) ||
+         memcmp(magic.data(), COLUMNAR_MAGIC, sizeof(COLUMNAR_MAGIC)) != 0 ||
+         !ReadUInt32(version) )
+    {
+        ErrorString = "ColumnarReader::Open: " + filename + " is not a columnar alignment file";
+        Close();
+        return false;
+    }
+    if ( version > COLUMNAR_VERSION ) {
+        stringstream s("");
+        s << "ColumnarReader::Open: unsupported format version " << version << " in " << filename;
+        ErrorString = s.str();
+        Close();
+        return false;
+    }
+
+    // read SAM header, references & tag names
+    uint32_t length = 0;
+    uint32_t numReferences = 0;
+    uint32_t numTags = 0;
+    bool isOk = ( ReadUInt32(length) && ReadData(HeaderText, length) && ReadUInt32(numReferences) );
+    for ( uint32_t i = 0; isOk && i < numReferences; ++i ) {
+        RefData reference;
+        uint32_t refLength = 0;
+        isOk = ( ReadUInt32(length) && ReadData(reference.RefName, length) && ReadUInt32(refLength) );
+        reference.RefLength = (int32_t)refLength;
+        References.push_back(reference);
+    }
+    isOk = isOk && ReadUInt32(numTags);
+    for ( uint32_t i = 0; isOk && i < numTags; ++i ) {
+        string tag;
+        isOk = ReadData(tag, 2);
+        Tags.push_back(tag);
+    }
+    if ( !isOk ) {
+        ErrorString = "ColumnarReader::Open: could not read file header from " + filename;
+        Close();
+        return false;
+    }
+
+    Columns.assign(NUM_CORE_COLUMNS + Tags.size(), Column());
+    return true;
+}
+
+bool ColumnarReader::ColumnarReaderPrivate::ReadData(string& data, const size_t length) {
+    data.resize(length);
+    if ( length > 0 && fread(&data[0], 1, length, Stream) != length ) {
+        ErrorString = "ColumnarReader::ReadData: unexpected end of file";
+        return false;
+    }
+    return true;
+}
+
+// loads & decompresses next row group, returns false (with no error) at end of row groups
+bool ColumnarReader::ColumnarReaderPrivate::ReadRowGroup(void) {
+
+    uint32_t numRows = 0;
+    if ( !ReadUInt32(numRows) )
+        return false;
+    NumRows = 0;
+    CurrentRow = 0;
+    LastPosition = 0;
+    if ( numRows == 0 )
+        return false;
+
+    string stored;
+    for ( size_t i = 0; i < Columns.size(); ++i ) {
+        Column& column = Columns[i];
+
+        // read column header & stored data
+        string header;
+        if ( !ReadData(header, 10) )
+            return false;
+        column.Encoding = (uint8_t)header[0];
+        const uint8_t compression = (uint8_t)header[1];
+        const uint32_t encodedLength = UnpackUInt32(header.data() + 2);
+        const uint32_t storedLength  = UnpackUInt32(header.data() + 6);
+        if ( !ReadData(stored, storedLength) )
+            return false;
+
+        // decompress
+        if ( compression == COLUMNAR_COMPRESSION_NONE && storedLength == encodedLength )
+            column.Data.swap(stored);
+        else if ( compression == COLUMNAR_COMPRESSION_ZLIB ) {
+            column.Data.resize(encodedLength);
+            uLongf dataLength = encodedLength;
+            const int status = ( encodedLength == 0 ? Z_DATA_ERROR
+                                                    : uncompress( (Bytef*)&column.Data[0], &dataLength,
+                                                                  (const Bytef*)stored.data(), storedLength ) );
+            if ( status != Z_OK || dataLength != encodedLength ) {
+                ErrorString = "ColumnarReader::ReadRowGroup: could not decompress column data";
+                return false;
+            }
+        }
+        else {
+            ErrorString = "ColumnarReader::ReadRowGroup: invalid column compression";
+            return false;
+        }
+
+        // check data size
+        const size_t width = ( i < NUM_CORE_COLUMNS ? COLUMN_WIDTHS[i] : 0 );
+        bool isValid = false;
+        if ( width > 0 )
+            isValid = ( column.Data.size() == numRows*width );
+        else if ( column.Data.size() >= numRows*sizeof(uint32_t) ) {
+            uint64_t valuesLength = 0;
+            for ( uint32_t row = 0; row < numRows; ++row )
+                valuesLength += UnpackUInt32(column.Data.data() + row*sizeof(uint32_t));
+            isValid = ( valuesLength == column.Data.size() - numRows*sizeof(uint32_t) );
+        }
+        // only the position column may be delta-encoded
+        const bool isValidEncoding = ( column.Encoding == COLUMNAR_ENCODING_PLAIN ||
+                                      (column.Encoding == COLUMNAR_ENCODING_DELTA && i == COLUMN_POSITION) );
+        if ( !isValid || !isValidEncoding ) {
+            ErrorString = "ColumnarReader::ReadRowGroup: invalid column data";
+            return false;
+        }
+        column.ValueOffset = numRows*sizeof(uint32_t);
+    }
+
+    NumRows = numRows;
+    return true;
+}
+
+bool ColumnarReader::ColumnarReaderPrivate::ReadUInt32(uint32_t& value) {
+    string data;
+    if ( !ReadData(data, sizeof(uint32_t)) )
+        return false;
+    value = UnpackUInt32(data.data());
+    return true;
+}
+
+// returns current row's value of variable-length column
+void ColumnarReader::ColumnarReaderPrivate::VariableValue(const size_t column,
+                                                          const char*& data,
+                                                          uint32_t& length)
+{
+    Column& c = Columns[column];
+    length = UnpackUInt32(c.Data.data() + CurrentRow*sizeof(uint32_t));
+    data = c.Data.data() + c.ValueOffset;
+    c.ValueOffset += length;
+}
+
+// ---------------------------------------------
+// ColumnarReader implementation
+
+ColumnarReader::ColumnarReader(void)
+    : d( new ColumnarReaderPrivate )
+{ }
+
+ColumnarReader::~ColumnarReader(void) {
+    delete d;
+    d = 0;
+}
+
+void ColumnarReader::Close(void) {
+    d->Close();
+}
+
+string ColumnarReader::GetErrorString(void) const {
+    return d->ErrorString;
+}
+
+string ColumnarReader::GetHeaderText(void) const {
+    return d->HeaderText;
+}
+
+// returns false at end of file, or on error (GetErrorString() is non-empty)
+bool ColumnarReader::GetNextAlignment(BamAlignment& al) {
+    d->ErrorString.clear();
+    return d->GetNextAlignment(al);
+}
+
+RefVector ColumnarReader::GetReferenceData(void) const {
+    return d->References;
+}
+
+vector<string> ColumnarReader::GetTags(void) const {
+    return d->Tags;
+}
+
+bool ColumnarReader::Open(const string& filename) {
+    return d->Open(filename);
+}
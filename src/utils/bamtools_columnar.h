@@ -0,0 +1,120 @@
+// ***************************************************************************
+// bamtools_columnar.h (c) 2026
+// Marth Lab, Department of Biology, Boston College
+// ---------------------------------------------------------------------------
+// Last modified: 17 October 2026
+// ---------------------------------------------------------------------------
+// Provides writing & reading of alignments in BamTools' columnar format
+// ***************************************************************************
+
+#ifndef BAMTOOLS_COLUMNAR_H
+#define BAMTOOLS_COLUMNAR_H
+
+#include "utils/utils_global.h"
+
+#include <api/BamAlignment.h>
+#include <api/BamAux.h>
+#include <string>
+#include <vector>
+
+// BamTools columnar format (version 1)
+//
+// Alignments are stored in row groups, each holding one block per column, so that
+// a single field can be loaded (and decompressed) without parsing whole records.
+// All integers are little-endian.
+//
+//   file header:
+//     char[4]   magic "BTCF"
+//     uint32    format version
+//     uint32    length of SAM header text, followed by the text
+//     uint32    number of references, followed by (for each reference):
+//                 uint32 name length, name, int32 reference length
+//     uint32    number of tag columns, followed by each 2-character tag name
+//
+//   row group (repeated):
+//     uint32    number of rows (> 0)
+//     for each column, in order:
+//       uint8   encoding     (0 = plain, 1 = delta: each value minus the previous one in row group;
+//                             only the position column may be delta-encoded)
+//       uint8   compression  (0 = none, 1 = zlib)
+//       uint32  encoded length
+//       uint32  stored length, followed by stored (i.e. encoded, maybe compressed) data
+//
+//   footer:
+//     uint32    0 (i.e. no more row groups)
+//     uint32    number of row groups, followed by (for each row group):
+//                 uint64 file offset, uint32 number of rows
+//     uint64    total number of rows
+//     uint64    file offset of footer
+//     char[4]   magic "BTCF"
+//
+// Columns (fixed-width columns hold one value per row; variable-length columns hold
+// one uint32 length per row, followed by all values concatenated):
+//
+//     name            variable    read name
+//     flag            uint16      alignment flag
+//     refId           int32       reference ID
+//     position        int32       position (0-based), written delta-encoded
+//     mapQuality      uint8       mapping quality
+//     cigar           variable    CIGAR operations, as in BAM (uint32: length << 4 | op)
+//     mateRefId       int32       mate's reference ID
+//     matePosition    int32       mate's position (0-based)
+//     insertSize      int32       insert size
+//     sequence        variable    query bases (ASCII)
+//     qualities       variable    base qualities (ASCII, Phred+33)
+//     <tag>...        variable    one column per selected tag: type character & value,
+//                                 as in BAM tag data (empty if tag not present)
+
+namespace BamTools {
+
+class UTILS_EXPORT ColumnarWriter {
+
+    public:
+        ColumnarWriter(void);
+        ~ColumnarWriter(void);
+
+    public:
+        // writes remaining rows & footer, closes file
+        bool Close(void);
+        std::string GetErrorString(void) const;
+        bool Open(const std::string& filename,
+                  const std::string& samHeaderText,
+                  const RefVector& references);
+        bool Write(const BamAlignment& al);
+
+        // settings (must be set before Open)
+        void SetCompressionLevel(const int level);
+        void SetNumThreads(const unsigned int numThreads);
+        void SetRowGroupSize(const unsigned int numRows);
+        void SetTags(const std::vector<std::string>& tags);
+
+    private:
+        struct ColumnarWriterPrivate;
+        ColumnarWriterPrivate* d;
+};
+
+// N.B. - alignments read back contain the columns above only: i.e. no tags beyond
+//        those selected when writing, & no data derived from them (e.g. AlignedBases)
+class UTILS_EXPORT ColumnarReader {
+
+    public:
+        ColumnarReader(void);
+        ~ColumnarReader(void);
+
+    public:
+        void Close(void);
+        std::string GetErrorString(void) const;
+        std::string GetHeaderText(void) const;
+        bool GetNextAlignment(BamAlignment& al);
+        RefVector GetReferenceData(void) const;
+        std::vector<std::string> GetTags(void) const;
+        bool Open(const std::string& filename);
+
+    private:
+        struct ColumnarReaderPrivate;
+        ColumnarReaderPrivate* d;
+};
+
+} // namespace BamTools
+
+#endif // BAMTOOLS_COLUMNAR_H
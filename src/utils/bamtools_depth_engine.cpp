@@ -0,0 +1,298 @@
+// ***************************************************************************
+// bamtools_depth_engine.cpp (c) 2026
+// Marth Lab, Department of Biology, Boston College
+// ---------------------------------------------------------------------------
+// Last modified: 17 October 2026
+// ---------------------------------------------------------------------------
+// Provides per-position read depth, from alignment core data only
+// ***************************************************************************
+
+#include "utils/bamtools_depth_engine.h"
+
+#include <api/BamConstants.h>
+using namespace BamTools;
+
+#include <algorithm>
+#include <iostream>
+using namespace std;
+
+// number of positions handed to visitors at once
+static const int DEPTH_BLOCK_SIZE = 4096;
+
+// initial number of positions held in the depth window
+static const size_t DEPTH_WINDOW_SIZE = 4096;
+
+// ---------------------------------------------
+// DepthEnginePrivate implementation
+
+// N.B. - Depth is tracked as a difference array (+1 at span start, -1 at span end) over
+//        a circular window of positions, starting at the first position not yet reported.
+//        Once the next alignment starts beyond a position, that position is final, and
+//        its depth is simply the running sum over the difference array.
+
+struct DepthEngine::DepthEnginePrivate {
+
+    // data members
+    int CurrentId;
+    int CurrentPosition;    // last alignment start
+    int WindowBegin;        // first unreported position
+    int WindowEnd;          // end of furthest-reaching alignment so far
+    bool IsFirstAlignment;
+
+    // circular window (size is a power of 2) & running sum
+    vector<int32_t> DepthDiffs;
+    int32_t Depth;
+
+    // filters
+    uint32_t ExcludedFlags;
+    uint16_t MinMapQuality;
+    BamRegion Region;
+
+    DepthBlock CurrentBlock;
+    vector<DepthVisitor*> Visitors;
+
+    // ctor & dtor
+    DepthEnginePrivate(void)
+        : CurrentId(-1)
+        , CurrentPosition(-1)
+        , WindowBegin(0)
+        , WindowEnd(0)
+        , IsFirstAlignment(true)
+        , DepthDiffs(DEPTH_WINDOW_SIZE, 0)
+        , Depth(0)
+        , ExcludedFlags(0)
+        , MinMapQuality(0)
+    { }
+    ~DepthEnginePrivate(void) { }
+
+    // 'public' methods
+    bool AddAlignment(const BamAlignment& al);
+    void Flush(void);
+
+    // internal methods
+    private:
+        void ApplyVisitors(void);
+        void CountAlignment(const BamAlignment& al);
+        void FinishWindow(void);
+        void ReportPositions(const int end);
+        void ResizeWindow(const size_t minSize);
+};
+
+bool DepthEngine::DepthEnginePrivate::AddAlignment(const BamAlignment& al) {
+
+    // skip unmapped & filtered alignments
+    if ( !al.IsMapped() )
+        return true;
+    if ( (al.AlignmentFlag & ExcludedFlags) != 0 || al.MapQuality < MinMapQuality )
+        return true;
+
+    // if first time
+    if ( IsFirstAlignment ) {
+        CurrentId   = al.RefID;
+        WindowBegin = al.Position;
+        WindowEnd   = al.Position;
+        IsFirstAlignment = false;
+    }
+
+    // if same reference
+    else if ( al.RefID == CurrentId ) {
+
+        // if less than CurrentPosition - sorting error => ABORT
+        if ( al.Position < CurrentPosition ) {
+            cerr << "Depth::Run() : Data not sorted correctly!" << endl;
+            return false;
+        }
+
+        // report all positions before this alignment
+        ReportPositions(al.Position);
+    }
+
+    // if reference ID less than CurrentId - sorting error => ABORT
+    else if ( al.RefID < CurrentId ) {
+        cerr << "Depth::Run() : Data not sorted correctly!" << endl;
+        return false;
+    }
+
+    // else moved forward onto next reference
+    else {
+        FinishWindow();
+        ApplyVisitors();
+        CurrentId   = al.RefID;
+        WindowBegin = al.Position;
+        WindowEnd   = al.Position;
+    }
+
+    CurrentPosition = al.Position;
+    CountAlignment(al);
+    return true;
+}
+
+void DepthEngine::DepthEnginePrivate::ApplyVisitors(void) {
+
+    // skip if block is empty
+    if ( CurrentBlock.NumPositions == 0 )
+        return;
+
+    // apply all visitors to current block
+    vector<DepthVisitor*>::const_iterator visitorIter = Visitors.begin();
+    vector<DepthVisitor*>::const_iterator visitorEnd  = Visitors.end();
+    for ( ; visitorIter != visitorEnd; ++visitorIter )
+        (*visitorIter)->VisitBlock(CurrentBlock);
+
+    // reset block
+    CurrentBlock.NumPositions = 0;
+    CurrentBlock.Depths.clear();
+}
+
+void DepthEngine::DepthEnginePrivate::CountAlignment(const BamAlignment& al) {
+
+    // make sure window can hold alignment (plus its span-end entry)
+    const int alignmentEnd = al.GetEndPosition();
+    if ( (size_t)(alignmentEnd - WindowBegin) >= DepthDiffs.size() )
+        ResizeWindow( (size_t)(alignmentEnd - WindowBegin) + 1 );
+    const size_t mask = DepthDiffs.size() - 1;
+    int32_t* depthDiffs = &DepthDiffs[0];
+
+    // add spans of (adjacent) MATCH & DELETION ops
+    int genomePosition = al.Position;
+    int spanBegin = genomePosition;
+    vector<CigarOp>::const_iterator cigarIter = al.CigarData.begin();
+    vector<CigarOp>::const_iterator cigarEnd  = al.CigarData.end();
+    for ( ; cigarIter != cigarEnd; ++cigarIter ) {
+        const CigarOp& op = (*cigarIter);
+        switch ( op.Type ) {
+
+            case ( Constants::BAM_CIGAR_MATCH_CHAR )    :
+            case ( Constants::BAM_CIGAR_MISMATCH_CHAR ) :
+            case ( Constants::BAM_CIGAR_SEQMATCH_CHAR ) :
+            case ( Constants::BAM_CIGAR_DEL_CHAR )      :
+                genomePosition += op.Length;
+                break;
+
+            // REF_SKIP - close current span
+            case ( Constants::BAM_CIGAR_REFSKIP_CHAR ) :
+                if ( genomePosition > spanBegin ) {
+                    ++depthDiffs[ spanBegin & mask ];
+                    --depthDiffs[ genomePosition & mask ];
+                }
+                genomePosition += op.Length;
+                spanBegin = genomePosition;
+                break;
+
+            // all other CIGAR chars do not consume reference
+            default :
+                break;
+        }
+    }
+    if ( genomePosition > spanBegin ) {
+        ++depthDiffs[ spanBegin & mask ];
+        --depthDiffs[ genomePosition & mask ];
+    }
+
+    // update window end
+    if ( alignmentEnd > WindowEnd )
+        WindowEnd = alignmentEnd;
+}
+
+// reports all remaining positions & resets running sum for a new window
+void DepthEngine::DepthEnginePrivate::FinishWindow(void) {
+
+    ReportPositions(WindowEnd);
+
+    // all spans end at (or before) WindowEnd, so its only entries are span-end markers
+    DepthDiffs[ (size_t)WindowEnd & (DepthDiffs.size() - 1) ] = 0;
+    Depth = 0;
+}
+
+void DepthEngine::DepthEnginePrivate::Flush(void) {
+    if ( IsFirstAlignment )
+        return;
+    FinishWindow();
+    ApplyVisitors();
+}
+
+// moves positions [WindowBegin, end) from window to current block
+void DepthEngine::DepthEnginePrivate::ReportPositions(const int end) {
+
+    // determine reportable range on current reference
+    int reportBegin = WindowBegin;
+    int reportEnd   = end;
+    if ( Region.isLeftBoundSpecified() ) {
+        if ( CurrentId < Region.LeftRefID )
+            reportEnd = reportBegin;
+        else if ( CurrentId == Region.LeftRefID )
+            reportBegin = std::max(reportBegin, Region.LeftPosition);
+    }
+    if ( Region.isRightBoundSpecified() ) {
+        if ( CurrentId > Region.RightRefID )
+            reportEnd = reportBegin;
+        else if ( CurrentId == Region.RightRefID )
+            reportEnd = std::min(reportEnd, Region.RightPosition);
+    }
+
+    // start new block, if current one does not continue at reportBegin
+    DepthBlock& block = CurrentBlock;
+    if ( block.NumPositions > 0 && block.Position + block.NumPositions != reportBegin )
+        ApplyVisitors();
+
+    const size_t mask = DepthDiffs.size() - 1;
+    int32_t* depthDiffs = &DepthDiffs[0];
+    for ( int position = WindowBegin; position < end; ++position ) {
+        const size_t index = (size_t)position & mask;
+        Depth += depthDiffs[index];
+        depthDiffs[index] = 0;
+
+        if ( position < reportBegin || position >= reportEnd )
+            continue;
+
+        if ( block.NumPositions == 0 ) {
+            block.RefId    = CurrentId;
+            block.Position = position;
+        }
+        block.Depths.push_back( (uint32_t)Depth );
+        ++block.NumPositions;
+
+        // hand over block, if full
+        if ( block.NumPositions == DEPTH_BLOCK_SIZE )
+            ApplyVisitors();
+    }
+
+    if ( end > WindowBegin )
+        WindowBegin = end;
+}
+
+// grows window to (at least) minSize positions, keeping current content
+void DepthEngine::DepthEnginePrivate::ResizeWindow(const size_t minSize) {
+
+    const size_t oldSize = DepthDiffs.size();
+    size_t newSize = oldSize;
+    while ( newSize < minSize )
+        newSize *= 2;
+    if ( newSize == oldSize )
+        return;
+
+    // re-map window positions [WindowBegin, WindowEnd] to new size
+    vector<int32_t> depthDiffs(newSize, 0);
+    for ( int position = WindowBegin; position <= WindowEnd; ++position )
+        depthDiffs[ (size_t)position & (newSize - 1) ] = DepthDiffs[ (size_t)position & (oldSize - 1) ];
+    DepthDiffs.swap(depthDiffs);
+}
+
+// ---------------------------------------------
+// DepthEngine implementation
+
+DepthEngine::DepthEngine(void)
+    : d( new DepthEnginePrivate )
+{ }
+
+DepthEngine::~DepthEngine(void) {
+    delete d;
+    d = 0;
+}
+
+bool DepthEngine::AddAlignment(const BamAlignment& al) { return d->AddAlignment(al); }
+void DepthEngine::AddVisitor(DepthVisitor* visitor) { d->Visitors.push_back(visitor); }
+void DepthEngine::Flush(void) { d->Flush(); }
+void DepthEngine::SetExcludedFlags(const uint32_t flags) { d->ExcludedFlags = flags; }
+void DepthEngine::SetMinMapQuality(const uint16_t quality) { d->MinMapQuality = quality; }
+void DepthEngine::SetRegion(const BamRegion& region) { d->Region = region; }
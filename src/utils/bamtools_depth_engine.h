@@ -0,0 +1,81 @@
+// ***************************************************************************
+// bamtools_depth_engine.h (c) 2026
+// Marth Lab, Department of Biology, Boston College
+// ---------------------------------------------------------------------------
+// Last modified: 17 October 2026
+// ---------------------------------------------------------------------------
+// Provides per-position read depth, from alignment core data only
+// ***************************************************************************
+
+#ifndef BAMTOOLS_DEPTH_ENGINE_H
+#define BAMTOOLS_DEPTH_ENGINE_H
+
+#include "utils/utils_global.h"
+
+#include <api/BamAlignment.h>
+#include <api/BamAux.h>
+#include <vector>
+
+namespace BamTools {
+
+// contains read depth for a run of consecutive positions on one reference
+//
+// N.B. - position i (0 <= i < NumPositions) is (Position + i)
+//      - depth counts alignments covering a position with a match or deletion
+struct UTILS_EXPORT DepthBlock {
+
+    // data members
+    int RefId;
+    int Position;
+    int NumPositions;
+    std::vector<uint32_t> Depths;
+
+    // ctor
+    DepthBlock(void)
+        : RefId(0)
+        , Position(0)
+        , NumPositions(0)
+    { }
+};
+
+class UTILS_EXPORT DepthVisitor {
+
+    public:
+        DepthVisitor(void) { }
+        virtual ~DepthVisitor(void) { }
+
+    public:
+        virtual void VisitBlock(const DepthBlock& block) =0;
+};
+
+// N.B. - alignments must be added in position-sorted order, core data (e.g. from
+//        BamReader::GetNextAlignmentCore()) is sufficient
+//      - on each reference, all positions from the first alignment's start up to the
+//        furthest alignment end are reported (including any zero-depth gaps), unless
+//        restricted by SetRegion()
+class UTILS_EXPORT DepthEngine {
+
+    public:
+        DepthEngine(void);
+        ~DepthEngine(void);
+
+    public:
+        bool AddAlignment(const BamAlignment& al);
+        void AddVisitor(DepthVisitor* visitor);
+        void Flush(void);
+
+        // alignments with any of these flag bits set are ignored
+        void SetExcludedFlags(const uint32_t flags);
+        // alignments below this mapping quality are ignored
+        void SetMinMapQuality(const uint16_t quality);
+        // only positions within region are reported
+        void SetRegion(const BamRegion& region);
+
+    private:
+        struct DepthEnginePrivate;
+        DepthEnginePrivate* d;
+};
+
+} // namespace BamTools
+
+#endif // BAMTOOLS_DEPTH_ENGINE_H
@@ -0,0 +1,482 @@
+// ***************************************************************************
+// bamtools_mate_collator.cpp (c) 2026
+// Marth Lab, Department of Biology, Boston College
+// ---------------------------------------------------------------------------
+// Last modified: 17 October 2026
+// ---------------------------------------------------------------------------
+// Pairs up mate records (in any input order) in a single streaming pass,
+// spilling unmatched mates to temp files when over its memory budget
+// ***************************************************************************
+
+#include "utils/bamtools_mate_collator.h"
+using namespace BamTools;
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <vector>
+using namespace std;
+
+// default memory budget for unmatched mates
+static const uint64_t MATE_COLLATOR_DEFAULT_MAX_MEMORY = 512 * 1024 * 1024;
+
+// number of temp files unmatched mates are spread over, when spilled
+static const size_t MATE_COLLATOR_NUM_PARTITIONS = 16;
+
+// partitions are split again (if still too large) up to this depth, then held in memory regardless
+static const int MATE_COLLATOR_MAX_DEPTH = 4;
+
+// initial number of hash buckets (power of 2)
+static const size_t MATE_TABLE_INITIAL_SIZE = 1024;
+
+// (approximate) per-entry overhead of a pending mate, on top of its string data
+static const uint64_t PENDING_MATE_OVERHEAD = sizeof(void*) * 8 + 64;
+
+namespace BamTools {
+
+// ---------------------------------------------
+// PendingMate
+
+// unmatched mate, chained within its hash bucket
+struct PendingMate {
+
+    // data members
+    string Name;
+    string Record;
+    int MateNumber;
+    uint32_t Hash;
+    PendingMate* Next;
+
+    // ctor
+    PendingMate(const string& name, const int mateNumber, const string& record, const uint32_t hash)
+        : Name(name)
+        , Record(record)
+        , MateNumber(mateNumber)
+        , Hash(hash)
+        , Next(0)
+    { }
+
+    uint64_t MemoryUsage(void) const {
+        return Name.capacity() + Record.capacity() + PENDING_MATE_OVERHEAD;
+    }
+};
+
+// ---------------------------------------------
+// MateTable
+
+// hash table of unmatched mates, by name
+class MateTable {
+
+    // ctor & dtor
+    public:
+        MateTable(void)
+            : m_buckets(MATE_TABLE_INITIAL_SIZE, (PendingMate*)0)
+            , m_size(0)
+            , m_memoryUsage(0)
+        { }
+        ~MateTable(void) {
+            vector<PendingMate*> mates;
+            TakeAll(mates);
+            for ( size_t i = 0; i < mates.size(); ++i )
+                delete mates[i];
+        }
+
+    // MateTable interface
+    public:
+        void Insert(PendingMate* mate);
+        uint64_t MemoryUsage(void) const { return m_memoryUsage + m_buckets.size() * sizeof(PendingMate*); }
+        // removes & returns mate with name, or 0 if not found
+        PendingMate* Take(const string& name, const uint32_t hash);
+        // removes all mates, handing them over to caller
+        void TakeAll(vector<PendingMate*>& mates);
+
+    // internal methods
+    private:
+        void Rehash(const size_t numBuckets);
+
+    // data members
+    private:
+        vector<PendingMate*> m_buckets;
+        size_t m_size;
+        uint64_t m_memoryUsage;
+};
+
+void MateTable::Insert(PendingMate* mate) {
+
+    // keep load factor at (or below) 1
+    if ( m_size >= m_buckets.size() )
+        Rehash(m_buckets.size() * 2);
+
+    PendingMate*& head = m_buckets[ mate->Hash & (m_buckets.size() - 1) ];
+    mate->Next = head;
+    head = mate;
+    ++m_size;
+    m_memoryUsage += mate->MemoryUsage();
+}
+
+void MateTable::Rehash(const size_t numBuckets) {
+
+    vector<PendingMate*> buckets(numBuckets, (PendingMate*)0);
+    for ( size_t i = 0; i < m_buckets.size(); ++i ) {
+        PendingMate* mate = m_buckets[i];
+        while ( mate ) {
+            PendingMate* next = mate->Next;
+            PendingMate*& head = buckets[ mate->Hash & (numBuckets - 1) ];
+            mate->Next = head;
+            head = mate;
+            mate = next;
+        }
+    }
+    m_buckets.swap(buckets);
+}
+
+PendingMate* MateTable::Take(const string& name, const uint32_t hash) {
+
+    PendingMate** link = &m_buckets[ hash & (m_buckets.size() - 1) ];
+    while ( *link ) {
+        PendingMate* mate = (*link);
+        if ( mate->Hash == hash && mate->Name == name ) {
+            *link = mate->Next;
+            mate->Next = 0;
+            --m_size;
+            m_memoryUsage -= mate->MemoryUsage();
+            return mate;
+        }
+        link = &mate->Next;
+    }
+    return 0;
+}
+
+void MateTable::TakeAll(vector<PendingMate*>& mates) {
+
+    mates.reserve(mates.size() + m_size);
+    for ( size_t i = 0; i < m_buckets.size(); ++i ) {
+        PendingMate* mate = m_buckets[i];
+        while ( mate ) {
+            PendingMate* next = mate->Next;
+            mate->Next = 0;
+            mates.push_back(mate);
+            mate = next;
+        }
+        m_buckets[i] = 0;
+    }
+    m_size = 0;
+    m_memoryUsage = 0;
+}
+
+// ---------------------------------------------
+// MateCollatorLevel
+
+// collates a stream of mates in memory, spilling them into partitions (by hash of name)
+// when over budget. Each partition is then collated on its own, at the next level.
+//
+// N.B. - both mates of a read always land in the same partition, so every pair is found
+//        at some level
+class MateCollatorLevel {
+
+    // ctor & dtor
+    public:
+        MateCollatorLevel(const int depth,
+                          const string& tempFilenameStub,
+                          const uint64_t maxMemory,
+                          MateCollatorVisitor* visitor,
+                          uint64_t* numSpilledMates);
+        ~MateCollatorLevel(void);
+
+    // MateCollatorLevel interface
+    public:
+        bool AddMate(const string& name, const int mateNumber, const string& record);
+        bool Finish(void);
+
+    // internal methods
+    private:
+        bool CollatePartition(const size_t index);
+        uint32_t Hash(const string& name) const;
+        string PartitionFilename(const size_t index) const;
+        bool Spill(void);
+
+    // data members
+    private:
+        int m_depth;
+        string m_tempFilenameStub;
+        uint64_t m_maxMemory;
+        MateCollatorVisitor* m_visitor;
+        uint64_t* m_numSpilledMates;
+
+        MateTable m_table;
+        bool m_hasSpilled;
+        vector<ofstream*> m_partitions;     // open partition files (0 if not created)
+};
+
+MateCollatorLevel::MateCollatorLevel(const int depth,
+                                     const string& tempFilenameStub,
+                                     const uint64_t maxMemory,
+                                     MateCollatorVisitor* visitor,
+                                     uint64_t* numSpilledMates)
+    : m_depth(depth)
+    , m_tempFilenameStub(tempFilenameStub)
+    , m_maxMemory(maxMemory)
+    , m_visitor(visitor)
+    , m_numSpilledMates(numSpilledMates)
+    , m_hasSpilled(false)
+    , m_partitions(MATE_COLLATOR_NUM_PARTITIONS, (ofstream*)0)
+{ }
+
+// N.B. - only leaves anything to clean up if Finish() was not called (or failed)
+MateCollatorLevel::~MateCollatorLevel(void) {
+    for ( size_t i = 0; i < m_partitions.size(); ++i ) {
+        if ( m_partitions[i] ) {
+            delete m_partitions[i];
+            m_partitions[i] = 0;
+            remove( PartitionFilename(i).c_str() );
+        }
+    }
+}
+
+bool MateCollatorLevel::AddMate(const string& name, const int mateNumber, const string& record) {
+
+    const uint32_t hash = Hash(name);
+
+    // if other mate is waiting, report pair
+    PendingMate* mate = m_table.Take(name, hash);
+    if ( mate ) {
+        if ( mate->MateNumber != mateNumber ) {
+            if ( mateNumber == 1 )
+                m_visitor->VisitPair(record, mate->Record);
+            else
+                m_visitor->VisitPair(mate->Record, record);
+            delete mate;
+            return true;
+        }
+
+        // same mate seen again - report earlier one as singleton, keep waiting with this one
+        m_visitor->VisitSingleton(mate->Record);
+        mate->Record = record;
+        m_table.Insert(mate);
+    }
+
+    // else wait for other mate
+    else
+        m_table.Insert( new PendingMate(name, mateNumber, record, hash) );
+
+    // spill if over budget
+    if ( m_table.MemoryUsage() > m_maxMemory && m_depth < MATE_COLLATOR_MAX_DEPTH )
+        return Spill();
+    return true;
+}
+
+bool MateCollatorLevel::CollatePartition(const size_t index) {
+
+    const string filename = PartitionFilename(index);
+    ifstream in(filename.c_str(), ios::in | ios::binary);
+    if ( !in ) {
+        cerr << "MateCollator ERROR: could not open temp file: " << filename << endl;
+        return false;
+    }
+
+    MateCollatorLevel level(m_depth + 1, filename, m_maxMemory, m_visitor, m_numSpilledMates);
+    bool result = true;
+    string name;
+    string record;
+    while ( result ) {
+
+        // read next entry: <nameLength> <name> <mateNumber> <recordLength> <record>
+        uint32_t nameLength = 0;
+        if ( !in.read((char*)&nameLength, sizeof(nameLength)) )
+            break;
+        name.resize(nameLength);
+        char mateNumber = 0;
+        uint32_t recordLength = 0;
+        if ( nameLength > 0 ) in.read(&name[0], nameLength);
+        in.read(&mateNumber, 1);
+        in.read((char*)&recordLength, sizeof(recordLength));
+        record.resize(recordLength);
+        if ( recordLength > 0 ) in.read(&record[0], recordLength);
+        if ( !in ) {
+            cerr << "MateCollator ERROR: could not read temp file: " << filename << endl;
+            result = false;
+            break;
+        }
+
+        result = level.AddMate(name, (int)mateNumber, record);
+    }
+    in.close();
+
+    if ( result )
+        result = level.Finish();
+    remove(filename.c_str());
+    return result;
+}
+
+bool MateCollatorLevel::Finish(void) {
+
+    // if nothing spilled, all remaining mates are singletons
+    if ( !m_hasSpilled ) {
+        vector<PendingMate*> mates;
+        m_table.TakeAll(mates);
+        for ( size_t i = 0; i < mates.size(); ++i ) {
+            m_visitor->VisitSingleton(mates[i]->Record);
+            delete mates[i];
+        }
+        return true;
+    }
+
+    // otherwise, the other mates might be in any partition - spill the rest as well
+    if ( !Spill() )
+        return false;
+
+    // close all partitions, then collate each one
+    vector<bool> isCreated(m_partitions.size(), false);
+    for ( size_t i = 0; i < m_partitions.size(); ++i ) {
+        if ( m_partitions[i] ) {
+            delete m_partitions[i];
+            m_partitions[i] = 0;
+            isCreated[i] = true;
+        }
+    }
+
+    bool result = true;
+    for ( size_t i = 0; i < m_partitions.size(); ++i ) {
+        if ( !isCreated[i] )
+            continue;
+        if ( result )
+            result = CollatePartition(i);
+        else
+            remove( PartitionFilename(i).c_str() );
+    }
+    return result;
+}
+
+// FNV-1a, seeded by depth (so that partitions are split differently at each level)
+uint32_t MateCollatorLevel::Hash(const string& name) const {
+
+    uint32_t hash = 2166136261u ^ ( (uint32_t)m_depth * 0x9e3779b9u );
+    const char* data = name.data();
+    const size_t length = name.size();
+    for ( size_t i = 0; i < length; ++i ) {
+        hash ^= (unsigned char)data[i];
+        hash *= 16777619u;
+    }
+
+    // final mix, so that high bits (used for partitions) depend on all input
+    hash ^= hash >> 16;
+    hash *= 0x85ebca6bu;
+    hash ^= hash >> 13;
+    hash *= 0xc2b2ae35u;
+    hash ^= hash >> 16;
+    return hash;
+}
+
+string MateCollatorLevel::PartitionFilename(const size_t index) const {
+    stringstream s("");
+    s << m_tempFilenameStub << "." << index;
+    return s.str();
+}
+
+// writes all unmatched mates to their partition files
+bool MateCollatorLevel::Spill(void) {
+
+    m_hasSpilled = true;
+
+    vector<PendingMate*> mates;
+    m_table.TakeAll(mates);
+
+    bool result = true;
+    for ( size_t i = 0; i < mates.size(); ++i ) {
+        PendingMate* mate = mates[i];
+
+        if ( result ) {
+
+            // open partition file on first use
+            const size_t index = (mate->Hash >> 24) % MATE_COLLATOR_NUM_PARTITIONS;
+            ofstream*& out = m_partitions[index];
+            if ( out == 0 ) {
+                out = new ofstream(PartitionFilename(index).c_str(), ios::out | ios::binary | ios::trunc);
+                if ( !(*out) ) {
+                    cerr << "MateCollator ERROR: could not create temp file: " << PartitionFilename(index) << endl;
+                    result = false;
+                }
+            }
+
+            // write entry: <nameLength> <name> <mateNumber> <recordLength> <record>
+            if ( result ) {
+                const uint32_t nameLength   = mate->Name.size();
+                const uint32_t recordLength = mate->Record.size();
+                const char mateNumber = (char)mate->MateNumber;
+                out->write((const char*)&nameLength, sizeof(nameLength));
+                out->write(mate->Name.data(), nameLength);
+                out->write(&mateNumber, 1);
+                out->write((const char*)&recordLength, sizeof(recordLength));
+                out->write(mate->Record.data(), recordLength);
+                if ( !(*out) ) {
+                    cerr << "MateCollator ERROR: could not write temp file: " << PartitionFilename(index) << endl;
+                    result = false;
+                }
+                ++(*m_numSpilledMates);
+            }
+        }
+
+        delete mate;
+    }
+    return result;
+}
+
+} // namespace BamTools
+
+// ---------------------------------------------
+// MateCollatorPrivate implementation
+
+struct MateCollator::MateCollatorPrivate {
+
+    // data members
+    MateCollatorVisitor* Visitor;
+    uint64_t MaxMemory;
+    string TempFilenameStub;
+    uint64_t NumSpilledMates;
+    MateCollatorLevel* TopLevel;    // created on first mate added
+
+    // ctor & dtor
+    MateCollatorPrivate(MateCollatorVisitor* visitor)
+        : Visitor(visitor)
+        , MaxMemory(MATE_COLLATOR_DEFAULT_MAX_MEMORY)
+        , TempFilenameStub("bamtools.collate.temp")
+        , NumSpilledMates(0)
+        , TopLevel(0)
+    { }
+    ~MateCollatorPrivate(void) {
+        delete TopLevel;
+        TopLevel = 0;
+    }
+};
+
+// ---------------------------------------------
+// MateCollator implementation
+
+MateCollator::MateCollator(MateCollatorVisitor* visitor)
+    : d( new MateCollatorPrivate(visitor) )
+{ }
+
+MateCollator::~MateCollator(void) {
+    delete d;
+    d = 0;
+}
+
+bool MateCollator::AddMate(const string& name, const int mateNumber, const string& record) {
+    if ( d->TopLevel == 0 )
+        d->TopLevel = new MateCollatorLevel(0, d->TempFilenameStub, d->MaxMemory, d->Visitor, &d->NumSpilledMates);
+    return d->TopLevel->AddMate(name, mateNumber, record);
+}
+
+bool MateCollator::Finish(void) {
+    if ( d->TopLevel == 0 )
+        return true;
+    const bool result = d->TopLevel->Finish();
+    delete d->TopLevel;
+    d->TopLevel = 0;
+    return result;
+}
+
+uint64_t MateCollator::NumSpilledMates(void) const { return d->NumSpilledMates; }
+void MateCollator::SetMaxMemory(const uint64_t numBytes) { d->MaxMemory = numBytes; }
+void MateCollator::SetTempFilenameStub(const string& stub) { d->TempFilenameStub = stub; }
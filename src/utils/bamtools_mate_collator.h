@@ -0,0 +1,62 @@
+// ***************************************************************************
+// bamtools_mate_collator.h (c) 2026
+// Marth Lab, Department of Biology, Boston College
+// ---------------------------------------------------------------------------
+// Last modified: 17 October 2026
+// ---------------------------------------------------------------------------
+// Pairs up mate records (in any input order) in a single streaming pass,
+// spilling unmatched mates to temp files when over its memory budget
+// ***************************************************************************
+
+#ifndef BAMTOOLS_MATE_COLLATOR_H
+#define BAMTOOLS_MATE_COLLATOR_H
+
+#include "utils/utils_global.h"
+
+#include <string>
+
+namespace BamTools {
+
+class UTILS_EXPORT MateCollatorVisitor {
+
+    public:
+        MateCollatorVisitor(void) { }
+        virtual ~MateCollatorVisitor(void) { }
+
+    public:
+        virtual void VisitPair(const std::string& firstMate, const std::string& secondMate) =0;
+        virtual void VisitSingleton(const std::string& record) =0;
+};
+
+// N.B. - records are opaque data (e.g. formatted FASTQ entries), matched up by name
+//      - pairs are reported as soon as both mates have been added, unless one of them
+//        was spilled, in which case it is reported by Finish()
+//      - mates still unmatched at Finish() are reported as singletons
+class UTILS_EXPORT MateCollator {
+
+    public:
+        MateCollator(MateCollatorVisitor* visitor);
+        ~MateCollator(void);
+
+    public:
+        // adds record for first (mateNumber 1) or second (mateNumber 2) mate of read
+        bool AddMate(const std::string& name, const int mateNumber, const std::string& record);
+        // reports all remaining pairs & singletons, removes temp files
+        bool Finish(void);
+
+        // unmatched mates over this many bytes (approximately) are spilled to temp files
+        void SetMaxMemory(const uint64_t numBytes);
+        // temp files are named <stub>.<partition>[.<partition>...]
+        void SetTempFilenameStub(const std::string& stub);
+
+        // number of mates written to temp files
+        uint64_t NumSpilledMates(void) const;
+
+    private:
+        struct MateCollatorPrivate;
+        MateCollatorPrivate* d;
+};
+
+} // namespace BamTools
+
+#endif // BAMTOOLS_MATE_COLLATOR_H
@@ -10,22 +10,73 @@
 #include "utils/bamtools_pileup_engine.h"
 using namespace BamTools;
 
+#include <deque>
 #include <iostream>
 using namespace std;
 
+// number of positions handed to visitors at once
+static const int PILEUP_BLOCK_SIZE = 1024;
+
+// maps (query) base to PileupBlock::BaseType
+static const char PILEUP_BASE_TYPE_LOOKUP[256] = {
+    4,4,4,4,4,4,4,4,4,4,4,4,4,4,4,4, 4,4,4,4,4,4,4,4,4,4,4,4,4,4,4,4,
+    4,4,4,4,4,4,4,4,4,4,4,4,4,4,4,4, 4,4,4,4,4,4,4,4,4,4,4,4,4,4,4,4,
+    4,0,4,1,4,4,4,2,4,4,4,4,4,4,4,4, 4,4,4,4,3,4,4,4,4,4,4,4,4,4,4,4,
+    4,0,4,1,4,4,4,2,4,4,4,4,4,4,4,4, 4,4,4,4,3,4,4,4,4,4,4,4,4,4,4,4,
+    4,4,4,4,4,4,4,4,4,4,4,4,4,4,4,4, 4,4,4,4,4,4,4,4,4,4,4,4,4,4,4,4,
+    4,4,4,4,4,4,4,4,4,4,4,4,4,4,4,4, 4,4,4,4,4,4,4,4,4,4,4,4,4,4,4,4,
+    4,4,4,4,4,4,4,4,4,4,4,4,4,4,4,4, 4,4,4,4,4,4,4,4,4,4,4,4,4,4,4,4,
+    4,4,4,4,4,4,4,4,4,4,4,4,4,4,4,4, 4,4,4,4,4,4,4,4,4,4,4,4,4,4,4,4
+};
+
+// ---------------------------------------------
+// PileupVisitor implementation
+
+void PileupVisitor::VisitBlock(const PileupBlock& block) {
+
+    m_position.RefId = block.RefId;
+    for ( int i = 0; i < block.NumPositions; ++i ) {
+        m_position.Position = block.Position + i;
+        m_position.PileupAlignments.assign( block.Alignments.begin() + block.AlignmentOffsets[i],
+                                            block.Alignments.begin() + block.AlignmentOffsets[i+1] );
+        Visit(m_position);
+    }
+}
+
 // ---------------------------------------------
 // PileupEnginePrivate implementation
 
+// N.B. - Each added alignment is copied just once, into a reusable record slot. The
+//        active reads are then tracked as parallel arrays (struct-of-arrays) of slot
+//        index, cached end position & CIGAR cursor, so that moving on to the next
+//        position only touches a few integers per read, instead of re-parsing CIGAR
+//        data & copying each alignment.
+//
+//        Positions are collected into a PileupBlock & handed to visitors in batches.
+//        Slots of alignments that end within the current block are only re-used once
+//        that block has been visited.
+
 struct PileupEngine::PileupEnginePrivate {
   
     // data members
     int CurrentId;
     int CurrentPosition;
-    vector<BamAlignment> CurrentAlignments;
-    PileupPosition CurrentPileupData;
+    PileupBlock CurrentBlock;
+
+    // record slots (each holding one alignment), unused slots & slots released in current block
+    deque<BamAlignment> Records;
+    vector<size_t> FreeRecords;
+    vector<size_t> ReleasedRecords;
+
+    // active reads, in order of addition
+    vector<size_t>   ActiveRecords;     // record slot
+    vector<int>      ActiveEnds;        // cached (half-open) end position
+    vector<uint32_t> ActiveCigarOps;    // CIGAR cursor: current op index
+    vector<int>      ActiveCigarRefs;   //               reference position at start of op
+    vector<int>      ActiveCigarReads;  //               read position at start of op
     
     bool IsFirstAlignment;
-    vector<PileupVisitor*> Visitors;
+    vector<PileupBlockVisitor*> Visitors;
   
     // ctor & dtor
     PileupEnginePrivate(void)
@@ -41,12 +92,35 @@ struct PileupEngine::PileupEnginePrivate {
     
     // internal methods
     private:
+        void ActivateAlignment(const BamAlignment& al);
+        void AddPosition(void);
         void ApplyVisitors(void);
         void ClearOldData(void);
         void CreatePileupData(void);
-        void ParseAlignmentCigar(const BamAlignment& al);
+        void ParseAlignmentCigar(const size_t activeIndex);
 };
 
+void PileupEngine::PileupEnginePrivate::ActivateAlignment(const BamAlignment& al) {
+
+    // store alignment in a free slot, re-using its buffers where possible
+    size_t slot;
+    if ( FreeRecords.empty() ) {
+        slot = Records.size();
+        Records.push_back(al);
+    } else {
+        slot = FreeRecords.back();
+        FreeRecords.pop_back();
+        Records[slot] = al;
+    }
+
+    // append to active reads, with CIGAR cursor at alignment start
+    ActiveRecords.push_back(slot);
+    ActiveEnds.push_back(al.GetEndPosition());
+    ActiveCigarOps.push_back(0);
+    ActiveCigarRefs.push_back(al.Position);
+    ActiveCigarReads.push_back(0);
+}
+
 bool PileupEngine::PileupEnginePrivate::AddAlignment(const BamAlignment& al) {
   
     // if first time
@@ -57,8 +131,7 @@ bool PileupEngine::PileupEnginePrivate::AddAlignment(const BamAlignment& al) {
         CurrentPosition = al.Position;
         
         // store first entry
-        CurrentAlignments.clear();
-        CurrentAlignments.push_back(al);
+        ActivateAlignment(al);
         
         // set flag & return
         IsFirstAlignment = false;
@@ -70,7 +143,7 @@ bool PileupEngine::PileupEnginePrivate::AddAlignment(const BamAlignment& al) {
       
         // if same position, store and move on
         if ( al.Position == CurrentPosition )
-            CurrentAlignments.push_back(al);
+            ActivateAlignment(al);
         
         // if less than CurrentPosition - sorting error => ABORT
         else if ( al.Position < CurrentPosition ) {
@@ -81,10 +154,10 @@ bool PileupEngine::PileupEnginePrivate::AddAlignment(const BamAlignment& al) {
         // else print pileup data until 'catching up' to CurrentPosition
         else {
             while ( al.Position > CurrentPosition ) {
-                ApplyVisitors();
+                AddPosition();
                 ++CurrentPosition;
             }
-            CurrentAlignments.push_back(al);
+            ActivateAlignment(al);
         }
     } 
 
@@ -98,14 +171,14 @@ bool PileupEngine::PileupEnginePrivate::AddAlignment(const BamAlignment& al) {
     else {
         
         // print any remaining pileup data from previous reference
-        while ( !CurrentAlignments.empty() ) {
-            ApplyVisitors();
+        while ( !ActiveRecords.empty() ) {
+            AddPosition();
             ++CurrentPosition;
         }
+        ApplyVisitors();
         
         // store first entry on this new reference, update markers
-        CurrentAlignments.clear();
-        CurrentAlignments.push_back(al);
+        ActivateAlignment(al);
         CurrentId = al.RefID;
         CurrentPosition = al.Position;
     }
@@ -113,16 +186,39 @@ bool PileupEngine::PileupEnginePrivate::AddAlignment(const BamAlignment& al) {
     return true;
 }
 
-void PileupEngine::PileupEnginePrivate::ApplyVisitors(void) {
-  
-    // parse CIGAR data in BamAlignments to build up current pileup data
+void PileupEngine::PileupEnginePrivate::AddPosition(void) {
+
+    // parse CIGAR data in BamAlignments to add current position to block
     CreatePileupData();
+
+    // hand over block, if full
+    if ( CurrentBlock.NumPositions == PILEUP_BLOCK_SIZE )
+        ApplyVisitors();
+}
+
+void PileupEngine::PileupEnginePrivate::ApplyVisitors(void) {
+
+    // skip if block is empty
+    if ( CurrentBlock.NumPositions == 0 )
+        return;
   
-    // apply all visitors to current alignment set
-    vector<PileupVisitor*>::const_iterator visitorIter = Visitors.begin();
-    vector<PileupVisitor*>::const_iterator visitorEnd  = Visitors.end();
+    // apply all visitors to current block
+    vector<PileupBlockVisitor*>::const_iterator visitorIter = Visitors.begin();
+    vector<PileupBlockVisitor*>::const_iterator visitorEnd  = Visitors.end();
     for ( ; visitorIter != visitorEnd; ++visitorIter ) 
-        (*visitorIter)->Visit(CurrentPileupData);
+        (*visitorIter)->VisitBlock(CurrentBlock);
+
+    // reset block
+    CurrentBlock.NumPositions = 0;
+    CurrentBlock.Depths.clear();
+    for ( int i = 0; i < PileupBlock::NumBaseTypes; ++i )
+        CurrentBlock.BaseCounts[i].clear();
+    CurrentBlock.AlignmentOffsets.clear();
+    CurrentBlock.Alignments.clear();
+
+    // alignments that ended within block are no longer referenced
+    FreeRecords.insert(FreeRecords.end(), ReleasedRecords.begin(), ReleasedRecords.end());
+    ReleasedRecords.clear();
 }
 
 void PileupEngine::PileupEnginePrivate::ClearOldData(void) {
@@ -134,29 +230,37 @@ void PileupEngine::PileupEnginePrivate::ClearOldData(void) {
 
     size_t i = 0;
     size_t j = 0;
-    const size_t numAlignments = CurrentAlignments.size();
+    const size_t numAlignments = ActiveRecords.size();
     while ( i < numAlignments ) {
 
-        // skip over alignment if its (1-based) endPosition is <= to (0-based) CurrentPosition
-        // i.e. this entry will not be saved upon vector resize
-        const int endPosition = CurrentAlignments[i].GetEndPosition();
-        if ( endPosition <= CurrentPosition ) {
+        // release alignment's slot if its (1-based) endPosition is <= to (0-based) CurrentPosition
+        if ( ActiveEnds[i] <= CurrentPosition ) {
+            ReleasedRecords.push_back(ActiveRecords[i]);
             ++i;
             continue;
         }
 
         // otherwise alignment ends after CurrentPosition
-        // move it towards vector beginning, at index j
-        if ( i != j )
-            CurrentAlignments[j] = CurrentAlignments[i];
+        // move it towards beginning, at index j
+        if ( i != j ) {
+            ActiveRecords[j]    = ActiveRecords[i];
+            ActiveEnds[j]       = ActiveEnds[i];
+            ActiveCigarOps[j]   = ActiveCigarOps[i];
+            ActiveCigarRefs[j]  = ActiveCigarRefs[i];
+            ActiveCigarReads[j] = ActiveCigarReads[i];
+        }
 
         // increment our indices
         ++i;
         ++j;
     }
 
-    // 'squeeze' vector to size j, discarding all remaining alignments in the container
-    CurrentAlignments.resize(j);
+    // 'squeeze' to size j, discarding all remaining entries
+    ActiveRecords.resize(j);
+    ActiveEnds.resize(j);
+    ActiveCigarOps.resize(j);
+    ActiveCigarRefs.resize(j);
+    ActiveCigarReads.resize(j);
 }
 
 void PileupEngine::PileupEnginePrivate::CreatePileupData(void) {
@@ -164,169 +268,175 @@ void PileupEngine::PileupEnginePrivate::CreatePileupData(void) {
     // remove any non-overlapping alignments
     ClearOldData();
   
-    // set pileup refId, position to current markers
-    CurrentPileupData.RefId = CurrentId;
-    CurrentPileupData.Position = CurrentPosition;
-    CurrentPileupData.PileupAlignments.clear();
+    // start new block at current markers, if necessary
+    PileupBlock& block = CurrentBlock;
+    if ( block.NumPositions == 0 ) {
+        block.RefId    = CurrentId;
+        block.Position = CurrentPosition;
+        block.AlignmentOffsets.push_back(0);
+    }
     
     // parse CIGAR data in remaining alignments 
-    vector<BamAlignment>::const_iterator alIter = CurrentAlignments.begin();
-    vector<BamAlignment>::const_iterator alEnd  = CurrentAlignments.end(); 
-    for ( ; alIter != alEnd; ++alIter )
-        ParseAlignmentCigar( (*alIter) );
+    const size_t begin = block.Alignments.size();
+    const size_t numAlignments = ActiveRecords.size();
+    for ( size_t i = 0; i < numAlignments; ++i )
+        ParseAlignmentCigar(i);
+    const size_t end = block.Alignments.size();
+
+    // count bases at this position
+    int counts[PileupBlock::NumBaseTypes] = { 0, 0, 0, 0, 0, 0 };
+    for ( size_t i = begin; i < end; ++i ) {
+        const PileupAlignment& pa = block.Alignments[i];
+        if ( pa.IsCurrentDeletion )
+            ++counts[PileupBlock::BaseDeletion];
+        else {
+            const string& bases = pa.Alignment->QueryBases;
+            if ( pa.PositionInAlignment >= 0 && pa.PositionInAlignment < (int)bases.size() )
+                ++counts[ (int)PILEUP_BASE_TYPE_LOOKUP[(unsigned char)bases[pa.PositionInAlignment]] ];
+            else
+                ++counts[PileupBlock::BaseN];
+        }
+    }
+
+    // store position's columns
+    block.Depths.push_back( (int)(end - begin) );
+    for ( int i = 0; i < PileupBlock::NumBaseTypes; ++i )
+        block.BaseCounts[i].push_back(counts[i]);
+    block.AlignmentOffsets.push_back(end);
+    ++block.NumPositions;
 }
 
 void PileupEngine::PileupEnginePrivate::Flush(void) {
-    while ( !CurrentAlignments.empty() ) {
-        ApplyVisitors();
+    while ( !ActiveRecords.empty() ) {
+        AddPosition();
         ++CurrentPosition;
     }
+    ApplyVisitors();
 }
 
-void PileupEngine::PileupEnginePrivate::ParseAlignmentCigar(const BamAlignment& al) {
+void PileupEngine::PileupEnginePrivate::ParseAlignmentCigar(const size_t activeIndex) {
   
     // skip if unmapped
+    const BamAlignment& al = Records[ ActiveRecords[activeIndex] ];
     if ( !al.IsMapped() ) return;
     
-    // intialize local variables
-    int  genomePosition      = al.Position;
-    int  positionInAlignment = 0;
-    bool isNewReadSegment    = true;
-    bool saveAlignment       = true;    
-    PileupAlignment pileupAlignment(al);
-    
-    // iterate over CIGAR operations
-    const int numCigarOps = (const int)al.CigarData.size();
-    for (int i = 0; i < numCigarOps; ++i ) { 
-        const CigarOp& op = al.CigarData.at(i);
-      
-        // if op is MATCH
-        if ( op.Type == 'M' ) {
-          
-            // if match op overlaps current position
-            if ( genomePosition + (int)op.Length > CurrentPosition ) {
-              
-                // set pileup data
-                pileupAlignment.IsCurrentDeletion   = false;
-                pileupAlignment.IsNextDeletion      = false;
-                pileupAlignment.IsNextInsertion     = false;
-                pileupAlignment.PositionInAlignment = positionInAlignment + (CurrentPosition - genomePosition);
-                
-                // check for beginning of read segment
-                if ( genomePosition == CurrentPosition && isNewReadSegment ) 
-                    pileupAlignment.IsSegmentBegin = true;
-                
-                // if we're at the end of a match operation
-                if ( genomePosition + (int)op.Length - 1 == CurrentPosition ) {
-                    
-                    // if not last operation
-                    if ( i < numCigarOps - 1 ) {
-                        
-                        // check next CIGAR op
-                        const CigarOp& nextOp = al.CigarData.at(i+1);
-                        
-                        // if next CIGAR op is DELETION
-                        if ( nextOp.Type == 'D') {
-                            pileupAlignment.IsNextDeletion = true;
-                            pileupAlignment.DeletionLength = nextOp.Length;
-                        }
-                        
-                        // if next CIGAR op is INSERTION
-                        else if ( nextOp.Type == 'I' ) {
-                            pileupAlignment.IsNextInsertion = true;
-                            pileupAlignment.InsertionLength = nextOp.Length;
-                        }
-                            
-                        // if next CIGAR op is either DELETION or INSERTION
-                        if ( nextOp.Type == 'D' || nextOp.Type == 'I' ) {
-
-                            // if there is a CIGAR op after the DEL/INS
-                            if ( i < numCigarOps - 2 ) {
-                                const CigarOp& nextNextOp = al.CigarData.at(i+2);
-                                
-                                // if next CIGAR op is clipping or ref_skip
-                                if ( nextNextOp.Type == 'S' || 
-                                     nextNextOp.Type == 'N' ||
-                                     nextNextOp.Type == 'H' )
-                                    pileupAlignment.IsSegmentEnd = true;
-                            } 
-                            else {
-                                pileupAlignment.IsSegmentEnd = true;
-                                
-                                // if next CIGAR op is clipping or ref_skip
-                                if ( nextOp.Type == 'S' || 
-                                     nextOp.Type == 'N' ||
-                                     nextOp.Type == 'H' )
-                                    pileupAlignment.IsSegmentEnd = true;
-                            }
-                        }
-                        
-                        // otherwise
-                        else { 
-                        
-                            // if next CIGAR op is clipping or ref_skip
-                            if ( nextOp.Type == 'S' || 
-                                 nextOp.Type == 'N' ||
-                                 nextOp.Type == 'H' )
-                                pileupAlignment.IsSegmentEnd = true;
-                        }
-                    }
-                    
-                    // else this is last operation
-                    else pileupAlignment.IsSegmentEnd = true;
-                }
-            }
-          
-            // increment markers
-            genomePosition      += op.Length;
-            positionInAlignment += op.Length;
-        } 
-        
-        // if op is DELETION
-        else if ( op.Type == 'D' ) {
-          
-            // if deletion op overlaps current position
-            if ( genomePosition + (int)op.Length > CurrentPosition ) {
-              
-                // set pileup data
-                pileupAlignment.IsCurrentDeletion   = true;
-                pileupAlignment.IsNextDeletion      = false;
-                pileupAlignment.IsNextInsertion     = true;
-                pileupAlignment.PositionInAlignment = positionInAlignment + (CurrentPosition - genomePosition);
-            }
-            
-            // increment marker
-            genomePosition += op.Length;
-        }
+    // advance read's CIGAR cursor to the op covering current position
+    // N.B. - positions only ever increase, so the cursor never needs to move back
+    uint32_t& opIndex = ActiveCigarOps[activeIndex];
+    int& genomePosition      = ActiveCigarRefs[activeIndex];
+    int& positionInAlignment = ActiveCigarReads[activeIndex];
+
+    const vector<CigarOp>& cigar = al.CigarData;
+    const int numCigarOps = (const int)cigar.size();
+    for ( ; (int)opIndex < numCigarOps; ++opIndex ) {
+        const CigarOp& op = cigar[opIndex];
 
-        // if op is REF_SKIP
-        else if ( op.Type == 'N' ) {
+        // stop at MATCH, DELETION or REF_SKIP op that overlaps current position
+        if ( op.Type == 'M' || op.Type == 'D' || op.Type == 'N' ) {
+            if ( genomePosition + (int)op.Length > CurrentPosition )
+                break;
             genomePosition += op.Length;
+            if ( op.Type == 'M' )
+                positionInAlignment += op.Length;
         }
-        
+
         // if op is INSERTION or SOFT_CLIP
-        else if ( op.Type == 'I' || op.Type == 'S' ) {
+        else if ( op.Type == 'I' || op.Type == 'S' )
             positionInAlignment += op.Length;
+    }
+
+    PileupAlignment pileupAlignment(al);
+
+    // no such op (CIGAR does not reach current position), store without any position details
+    const int i = (int)opIndex;
+    if ( i == numCigarOps ) {
+        CurrentBlock.Alignments.push_back( pileupAlignment );
+        return;
+    }
+
+    const CigarOp& op = cigar[i];
+
+    // ignore alignment if REF_SKIP
+    if ( op.Type == 'N' )
+        return;
+
+    // if op is DELETION
+    if ( op.Type == 'D' ) {
+        pileupAlignment.IsCurrentDeletion   = true;
+        pileupAlignment.IsNextDeletion      = false;
+        pileupAlignment.IsNextInsertion     = true;
+        pileupAlignment.PositionInAlignment = positionInAlignment + (CurrentPosition - genomePosition);
+        CurrentBlock.Alignments.push_back( pileupAlignment );
+        return;
+    }
+
+    // otherwise op is MATCH
+    pileupAlignment.PositionInAlignment = positionInAlignment + (CurrentPosition - genomePosition);
+
+    // check for beginning of read segment
+    if ( genomePosition == CurrentPosition ) {
+        const bool isNewReadSegment = ( i == 0 ||
+                                        cigar[i-1].Type == 'N' ||
+                                        cigar[i-1].Type == 'S' ||
+                                        cigar[i-1].Type == 'H' );
+        if ( isNewReadSegment )
+            pileupAlignment.IsSegmentBegin = true;
+    }
+
+    // if we're at the end of a match operation
+    if ( genomePosition + (int)op.Length - 1 == CurrentPosition ) {
+
+        // if not last operation
+        if ( i < numCigarOps - 1 ) {
+
+            // check next CIGAR op
+            const CigarOp& nextOp = cigar[i+1];
+
+            // if next CIGAR op is DELETION
+            if ( nextOp.Type == 'D') {
+                pileupAlignment.IsNextDeletion = true;
+                pileupAlignment.DeletionLength = nextOp.Length;
+            }
+
+            // if next CIGAR op is INSERTION
+            else if ( nextOp.Type == 'I' ) {
+                pileupAlignment.IsNextInsertion = true;
+                pileupAlignment.InsertionLength = nextOp.Length;
+            }
+
+            // if next CIGAR op is either DELETION or INSERTION
+            if ( nextOp.Type == 'D' || nextOp.Type == 'I' ) {
+
+                // if there is a CIGAR op after the DEL/INS
+                if ( i < numCigarOps - 2 ) {
+                    const CigarOp& nextNextOp = cigar[i+2];
+
+                    // if next CIGAR op is clipping or ref_skip
+                    if ( nextNextOp.Type == 'S' ||
+                         nextNextOp.Type == 'N' ||
+                         nextNextOp.Type == 'H' )
+                        pileupAlignment.IsSegmentEnd = true;
+                }
+                else pileupAlignment.IsSegmentEnd = true;
+            }
+
+            // otherwise
+            else {
+
+                // if next CIGAR op is clipping or ref_skip
+                if ( nextOp.Type == 'S' ||
+                     nextOp.Type == 'N' ||
+                     nextOp.Type == 'H' )
+                    pileupAlignment.IsSegmentEnd = true;
+            }
         }
-        
-        // checl for beginning of new read segment
-        if ( op.Type == 'N' ||
-             op.Type == 'S' ||
-             op.Type == 'H' )
-            isNewReadSegment = true;
-        else 
-            isNewReadSegment = false;
-      
-        // if we've moved beyond current position
-        if ( genomePosition > CurrentPosition ) {
-            if ( op.Type == 'N' ) saveAlignment = false; // ignore alignment if REF_SKIP
-            break;
-        }
+
+        // else this is last operation
+        else pileupAlignment.IsSegmentEnd = true;
     }
 
-    // save pileup position if flag is true
-    if ( saveAlignment )
-        CurrentPileupData.PileupAlignments.push_back( pileupAlignment );
+    // save pileup position
+    CurrentBlock.Alignments.push_back( pileupAlignment );
 }
 
 // ---------------------------------------------
@@ -342,5 +452,5 @@ PileupEngine::~PileupEngine(void) {
 }
 
 bool PileupEngine::AddAlignment(const BamAlignment& al) { return d->AddAlignment(al); }
-void PileupEngine::AddVisitor(PileupVisitor* visitor) { d->Visitors.push_back(visitor); }
+void PileupEngine::AddVisitor(PileupBlockVisitor* visitor) { d->Visitors.push_back(visitor); }
 void PileupEngine::Flush(void) { d->Flush(); }
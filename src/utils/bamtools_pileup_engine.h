@@ -19,10 +19,13 @@ namespace BamTools {
 
 // contains auxiliary data about a single BamAlignment
 // at current position considered
+//
+// N.B. - Alignment points to the engine's own copy of the read, which is only
+//        valid during the PileupVisitor::Visit() call
 struct UTILS_EXPORT PileupAlignment {
   
     // data members
-    BamAlignment Alignment;
+    const BamAlignment* Alignment;
     int32_t PositionInAlignment;
     bool IsCurrentDeletion;
     bool IsNextDeletion;
@@ -34,7 +37,7 @@ struct UTILS_EXPORT PileupAlignment {
     
     // ctor
     PileupAlignment(const BamAlignment& al)
-        : Alignment(al)
+        : Alignment(&al)
         , PositionInAlignment(-1)
         , IsCurrentDeletion(false)
         , IsNextDeletion(false)
@@ -64,7 +67,53 @@ struct UTILS_EXPORT PileupPosition {
     { }
 };
   
-class UTILS_EXPORT PileupVisitor {
+// contains all data for a run of consecutive positions on one reference, stored column-wise
+//
+// N.B. - position i (0 <= i < NumPositions) is (Position + i), its alignments are
+//        Alignments[ AlignmentOffsets[i] ] up to (not including) Alignments[ AlignmentOffsets[i+1] ]
+struct UTILS_EXPORT PileupBlock {
+
+    // per-position base counts
+    // N.B. - alignments without QueryBases (i.e. core-only) are counted as BaseN
+    enum BaseType { BaseA = 0
+                  , BaseC
+                  , BaseG
+                  , BaseT
+                  , BaseN
+                  , BaseDeletion
+                  , NumBaseTypes
+                  };
+
+    // data members
+    int RefId;
+    int Position;
+    int NumPositions;
+    std::vector<int> Depths;
+    std::vector<int> BaseCounts[NumBaseTypes];
+    std::vector<size_t> AlignmentOffsets;
+    std::vector<PileupAlignment> Alignments;
+
+    // ctor
+    PileupBlock(void)
+        : RefId(0)
+        , Position(0)
+        , NumPositions(0)
+    { }
+};
+
+// receives pileup data a block of positions at a time
+class UTILS_EXPORT PileupBlockVisitor {
+
+    public:
+        PileupBlockVisitor(void) { }
+        virtual ~PileupBlockVisitor(void) { }
+
+    public:
+        virtual void VisitBlock(const PileupBlock& block) =0;
+};
+
+// receives pileup data one position at a time
+class UTILS_EXPORT PileupVisitor : public PileupBlockVisitor {
   
     public:
         PileupVisitor(void) { }
@@ -72,6 +121,13 @@ class UTILS_EXPORT PileupVisitor {
   
     public:
         virtual void Visit(const PileupPosition& pileupData) =0;
+
+    // PileupBlockVisitor implementation - calls Visit() for each position
+    public:
+        void VisitBlock(const PileupBlock& block);
+
+    private:
+        PileupPosition m_position;
 };
 
 class UTILS_EXPORT PileupEngine {
@@ -82,7 +138,7 @@ class UTILS_EXPORT PileupEngine {
         
     public:
         bool AddAlignment(const BamAlignment& al);
-        void AddVisitor(PileupVisitor* visitor);
+        void AddVisitor(PileupBlockVisitor* visitor);
         void Flush(void);
         
     private:
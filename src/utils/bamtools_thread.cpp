@@ -0,0 +1,177 @@
+// ***************************************************************************
+// bamtools_thread.cpp (c) 2026
+// Marth Lab, Department of Biology, Boston College
+// ---------------------------------------------------------------------------
+// Last modified: 17 October 2026
+// ---------------------------------------------------------------------------
+// Provides a thread pool for the toolkit, on top of BamTools' own threading
+// primitives (mutex, wait condition, thread)
+// ***************************************************************************
+
+#include "utils/bamtools_thread.h"
+using namespace BamTools;
+
+#include <deque>
+#include <vector>
+using namespace std;
+
+// ---------------------------------------------
+// ThreadPoolPrivate implementation
+
+struct ThreadPool::ThreadPoolPrivate {
+
+    // worker thread
+    class Worker : public Thread {
+        public:
+            explicit Worker(ThreadPoolPrivate* pool) : Thread(), m_pool(pool) { }
+            ~Worker(void) { Wait(); }
+        protected:
+            void Run(void) { m_pool->RunWorker(); }
+        private:
+            ThreadPoolPrivate* m_pool;
+    };
+
+    // data members
+    vector<Worker*> Workers;
+    unsigned int NumThreads;
+
+    Mutex TaskMutex;
+    WaitCondition TaskAvailable;
+    WaitCondition TasksFinished;
+    deque<Task*> Tasks;
+    unsigned int NumUnfinished;   // queued + running
+    bool IsStopping;
+
+    // ctor & dtor
+    ThreadPoolPrivate(const unsigned int numThreads)
+        : NumThreads( numThreads > 1 ? numThreads : 1 )
+        , NumUnfinished(0)
+        , IsStopping(false)
+    { }
+    ~ThreadPoolPrivate(void) { }
+
+    // 'public' methods
+    void Start(void);
+    void Stop(void);
+    void Submit(Task* task);
+    void WaitForAll(void);
+
+    // internal methods
+    private:
+        void RunWorker(void);
+
+    friend class Worker;
+};
+
+void ThreadPool::ThreadPoolPrivate::RunWorker(void) {
+
+    while ( true ) {
+
+        // wait for next task
+        Task* task = 0;
+        {
+            MutexLocker locker(TaskMutex);
+            while ( Tasks.empty() && !IsStopping )
+                TaskAvailable.Wait(TaskMutex);
+            if ( Tasks.empty() )
+                return;
+            task = Tasks.front();
+            Tasks.pop_front();
+        }
+
+        // run task (without holding lock)
+        task->Run();
+
+        // report task finished
+        {
+            MutexLocker locker(TaskMutex);
+            --NumUnfinished;
+            if ( NumUnfinished == 0 )
+                TasksFinished.WakeAll();
+        }
+    }
+}
+
+void ThreadPool::ThreadPoolPrivate::Start(void) {
+
+    // single-threaded pools run tasks on the caller's thread
+    if ( NumThreads == 1 )
+        return;
+
+    for ( unsigned int i = 0; i < NumThreads; ++i ) {
+        Worker* worker = new Worker(this);
+        if ( !worker->Start() ) {
+            delete worker;
+            break;
+        }
+        Workers.push_back(worker);
+    }
+
+    // fall back to caller's thread if no worker could be started
+    if ( Workers.empty() )
+        NumThreads = 1;
+}
+
+void ThreadPool::ThreadPoolPrivate::Stop(void) {
+
+    // let workers drain queue & exit
+    {
+        MutexLocker locker(TaskMutex);
+        IsStopping = true;
+        TaskAvailable.WakeAll();
+    }
+
+    for ( size_t i = 0; i < Workers.size(); ++i )
+        delete Workers[i];
+    Workers.clear();
+}
+
+void ThreadPool::ThreadPoolPrivate::Submit(Task* task) {
+
+    if ( task == 0 )
+        return;
+
+    // no workers, just run task here
+    if ( Workers.empty() ) {
+        task->Run();
+        return;
+    }
+
+    MutexLocker locker(TaskMutex);
+    Tasks.push_back(task);
+    ++NumUnfinished;
+    TaskAvailable.WakeOne();
+}
+
+void ThreadPool::ThreadPoolPrivate::WaitForAll(void) {
+    MutexLocker locker(TaskMutex);
+    while ( NumUnfinished > 0 )
+        TasksFinished.Wait(TaskMutex);
+}
+
+// ---------------------------------------------
+// ThreadPool implementation
+
+ThreadPool::ThreadPool(const unsigned int numThreads)
+    : d( new ThreadPoolPrivate(numThreads) )
+{
+    d->Start();
+}
+
+ThreadPool::~ThreadPool(void) {
+    d->Stop();
+    delete d;
+    d = 0;
+}
+
+unsigned int ThreadPool::NumThreads(void) const {
+    return d->NumThreads;
+}
+
+void ThreadPool::Submit(Task* task) {
+    d->Submit(task);
+}
+
+void ThreadPool::WaitForAll(void) {
+    d->WaitForAll();
+}
@@ -0,0 +1,66 @@
+// ***************************************************************************
+// bamtools_thread.h (c) 2026
+// Marth Lab, Department of Biology, Boston College
+// ---------------------------------------------------------------------------
+// Last modified: 17 October 2026
+// ---------------------------------------------------------------------------
+// Provides a thread pool for the toolkit, on top of BamTools' own threading
+// primitives (mutex, wait condition, thread)
+// ***************************************************************************
+
+#ifndef BAMTOOLS_THREAD_H
+#define BAMTOOLS_THREAD_H
+
+#include "api/internal/utils/BamThread_p.h"
+#include "utils/utils_global.h"
+
+namespace BamTools {
+
+// the toolkit shares the library's threading primitives
+typedef Internal::BamMutex         Mutex;
+typedef Internal::BamMutexLocker   MutexLocker;
+typedef Internal::BamWaitCondition WaitCondition;
+typedef Internal::BamThread        Thread;
+
+// fixed-size pool of worker threads, executing submitted tasks in FIFO order
+//
+// N.B. - a pool created with (numThreads <= 1) has no workers at all, each task
+//        simply runs on the calling thread inside Submit()
+class UTILS_EXPORT ThreadPool {
+
+    // task interface
+    public:
+        class UTILS_EXPORT Task {
+            public:
+                virtual ~Task(void) { }
+                virtual void Run(void) =0;
+        };
+
+    // ctor & dtor
+    public:
+        explicit ThreadPool(const unsigned int numThreads);
+        ~ThreadPool(void);
+
+    // ThreadPool interface
+    public:
+        // returns number of tasks that may run concurrently
+        unsigned int NumThreads(void) const;
+        // queues task for execution, caller retains ownership
+        void Submit(Task* task);
+        // blocks until all submitted tasks have finished
+        void WaitForAll(void);
+
+    // not copyable
+    private:
+        ThreadPool(const ThreadPool& other);
+        ThreadPool& operator=(const ThreadPool& other);
+
+    // internal implementation
+    private:
+        struct ThreadPoolPrivate;
+        ThreadPoolPrivate* d;
+};
+
+} // namespace BamTools
+
+#endif // BAMTOOLS_THREAD_H
@@ -13,6 +13,7 @@
 using namespace BamTools;
 
 #include <algorithm>
+#include <cctype>
 #include <cstdlib>
 #include <cstring>
 #include <fstream>
@@ -58,6 +59,41 @@ bool Utilities::FileExists(const string& filename) {
     return !f.fail();
 }
 
+// Parses a memory size string (e.g. "512M", "8G", "1.5GB"), stores number of bytes
+// Returns success (true/false)
+bool Utilities::ParseMemorySize(const string& sizeString,
+                                uint64_t& numBytes,
+                                const char defaultUnit)
+{
+    // parse numeric part
+    const char* begin = sizeString.c_str();
+    char* end = 0;
+    const double value = strtod(begin, &end);
+    if ( end == begin || value < 0.0 )
+        return false;
+
+    // parse (optional) unit suffix, allowing a trailing 'B' as in "8GB"
+    string suffix(end);
+    if ( suffix.size() == 2 && toupper(suffix[1]) == 'B' )
+        suffix.resize(1);
+    const char unit = ( suffix.empty() ? defaultUnit : static_cast<char>(toupper(suffix[0])) );
+    if ( suffix.size() > 1 )
+        return false;
+
+    double multiplier;
+    switch ( unit ) {
+        case 'B' : multiplier = 1.0; break;
+        case 'K' : multiplier = 1024.0; break;
+        case 'M' : multiplier = 1024.0*1024.0; break;
+        case 'G' : multiplier = 1024.0*1024.0*1024.0; break;
+        case 'T' : multiplier = 1024.0*1024.0*1024.0*1024.0; break;
+        default  : return false;
+    }
+
+    numBytes = static_cast<uint64_t>(value * multiplier);
+    return true;
+}
+
 // Parses a region string, does validation (valid ID's, positions), stores in Region struct
 // Returns success (true/false)
 bool Utilities::ParseRegionString(const string& regionString,
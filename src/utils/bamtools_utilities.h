@@ -37,6 +37,13 @@ class UTILS_EXPORT Utilities {
         // check if a file exists
         static bool FileExists(const std::string& fname);
         
+        // Parses a memory size string (e.g. "512M", "8G", "1.5GB"), stores number of bytes
+        // K/M/G/T suffixes are powers of 1024, plain numbers are taken in 'defaultUnit' ('B', 'K', 'M', ...)
+        // Returns success (true/false)
+        static bool ParseMemorySize(const std::string& sizeString,
+                                    uint64_t& numBytes,
+                                    const char defaultUnit = 'B');
+
         // Parses a region string, uses reader to do validation (valid ID's, positions), stores in Region struct
         // Returns success (true/false)
         static bool ParseRegionString(const std::string& regionString,